@@ -0,0 +1,332 @@
+// bench_harness.h - 微基準測試框架 (暖機、重複取樣、CPU 綁定、JSON 輸出、兩次結果比較)
+// 每個測試案例提供一個 run(ctx, iters) 函數，執行 iters 次被測操作。
+// 框架先倍增 iters 直到一個樣本至少 sample_us 微秒 (降低計時誤差)，
+// 暖機 warmup_ms 毫秒後收集 reps 個樣本，每個樣本換算成 ns/op：
+//   median 作為主要指標 (比較兩次結果時使用)，p99 代表批次間的抖動，
+//   ops_per_sec = 1e9 / median。
+//
+// 用法 (由 bench_main() 解析)：
+//   程式 [--reps N] [--warmup-ms N] [--sample-us N] [--cpu N|-1] [--filter 子字串] [--json 檔案]
+//   程式 --compare 基準.json 新結果.json [--threshold 百分比]
+// 比較模式下任何案例的 median 變慢超過門檻即回傳 1，可直接用於 CI。
+
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <sched.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/utsname.h>
+
+#define BENCH_MAX_CASES             64U
+#define BENCH_MAX_REPS              10000U
+#define BENCH_NAME_LEN              64U
+
+// 防止編譯器把被測運算的結果當成無用而刪除
+#define BENCH_KEEP(value)           __asm__ volatile("" : : "g"(value) : "memory")
+
+typedef void (*BenchFn)(void *ctx, uint64_t iters);
+
+typedef struct {
+    const char *name;
+    const char *module;             // week1 子目錄，例如 "state-machine"
+    BenchFn run;
+    void *ctx;
+} BenchCase;
+
+typedef struct {
+    uint32_t reps;
+    uint32_t warmup_ms;
+    uint32_t sample_us;
+    int cpu;                        // -1 表示不綁定
+    const char *filter;
+    const char *json_path;
+} BenchOptions;
+
+typedef struct {
+    char name[BENCH_NAME_LEN];
+    char module[BENCH_NAME_LEN];
+    uint64_t iters_per_sample;
+    uint32_t reps;
+    double min_ns;
+    double median_ns;
+    double mean_ns;
+    double p99_ns;
+    double max_ns;
+    double ops_per_sec;
+} BenchResult;
+
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static inline bool bench_pin_cpu(int cpu) {
+    cpu_set_t set;
+
+    if (cpu < 0) {
+        return true;
+    }
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+static int bench_compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static inline double bench_sample(const BenchCase *c, uint64_t iters) {
+    uint64_t start = bench_now_ns();
+    c->run(c->ctx, iters);
+    return (double)(bench_now_ns() - start);
+}
+
+static bool bench_run_case(const BenchCase *c, const BenchOptions *opt, BenchResult *r) {
+    double *samples = malloc((size_t)opt->reps * sizeof(double));
+    double target_ns = (double)opt->sample_us * 1e3;
+    uint64_t iters = 1U;
+
+    if (samples == NULL) {
+        return false;
+    }
+
+    // 校正：倍增到單一樣本超過目標時間
+    while ((bench_sample(c, iters) < target_ns) && (iters < (UINT64_C(1) << 40))) {
+        iters <<= 1;
+    }
+
+    uint64_t warmup_end = bench_now_ns() + ((uint64_t)opt->warmup_ms * 1000000ULL);
+    while (bench_now_ns() < warmup_end) {
+        (void)bench_sample(c, iters);
+    }
+
+    double sum = 0.0;
+    for (uint32_t i = 0U; i < opt->reps; i++) {
+        samples[i] = bench_sample(c, iters) / (double)iters;
+        sum += samples[i];
+    }
+    qsort(samples, opt->reps, sizeof(double), bench_compare_double);
+
+    memset(r, 0, sizeof(*r));
+    snprintf(r->name, sizeof(r->name), "%s", c->name);
+    snprintf(r->module, sizeof(r->module), "%s", c->module);
+    r->iters_per_sample = iters;
+    r->reps = opt->reps;
+    r->min_ns = samples[0];
+    r->median_ns = samples[opt->reps / 2U];
+    r->mean_ns = sum / opt->reps;
+    r->p99_ns = samples[((opt->reps * 99U) + 99U) / 100U - 1U];
+    r->max_ns = samples[opt->reps - 1U];
+    r->ops_per_sec = (r->median_ns > 0.0) ? (1e9 / r->median_ns) : 0.0;
+
+    free(samples);
+    return true;
+}
+
+// === JSON 輸出：每個案例一行，欄位順序固定 (bench_load_json 依此解析) ===
+static bool bench_write_json(const char *path, const BenchResult *results, uint32_t count,
+                             const BenchOptions *opt) {
+    struct utsname host;
+    FILE *out = fopen(path, "w");
+
+    if (out == NULL) {
+        return false;
+    }
+    if (uname(&host) != 0) {
+        memset(&host, 0, sizeof(host));
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"timestamp\": %lld,\n", (long long)time(NULL));
+    fprintf(out, "  \"host\": \"%s\",\n", host.nodename);
+    fprintf(out, "  \"machine\": \"%s\",\n", host.machine);
+    fprintf(out, "  \"compiler\": \"%s\",\n", __VERSION__);
+    fprintf(out, "  \"cpu\": %d,\n", opt->cpu);
+    fprintf(out, "  \"reps\": %u,\n", opt->reps);
+    fprintf(out, "  \"warmup_ms\": %u,\n", opt->warmup_ms);
+    fprintf(out, "  \"sample_us\": %u,\n", opt->sample_us);
+    fprintf(out, "  \"results\": [\n");
+    for (uint32_t i = 0U; i < count; i++) {
+        const BenchResult *r = &results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"module\": \"%s\", \"median_ns\": %.3f, \"p99_ns\": %.3f, "
+                     "\"min_ns\": %.3f, \"mean_ns\": %.3f, \"max_ns\": %.3f, \"ops_per_sec\": %.0f, "
+                     "\"iters_per_sample\": %llu, \"reps\": %u}%s\n",
+                r->name, r->module, r->median_ns, r->p99_ns, r->min_ns, r->mean_ns, r->max_ns,
+                r->ops_per_sec, (unsigned long long)r->iters_per_sample, r->reps,
+                (i + 1U < count) ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+
+    return fclose(out) == 0;
+}
+
+// 只讀取 bench_write_json() 產生的格式，不是通用 JSON 解析器；無法開啟時回傳 0
+static uint32_t bench_load_json(const char *path, BenchResult *results, uint32_t max) {
+    char line[1024];
+    uint32_t count = 0U;
+    FILE *in = fopen(path, "r");
+
+    if (in == NULL) {
+        return 0U;
+    }
+    while ((count < max) && (fgets(line, sizeof(line), in) != NULL)) {
+        const char *name = strstr(line, "\"name\": \"");
+        const char *median = strstr(line, "\"median_ns\": ");
+        const char *p99 = strstr(line, "\"p99_ns\": ");
+        if ((name == NULL) || (median == NULL) || (p99 == NULL)) {
+            continue;
+        }
+        BenchResult *r = &results[count];
+        memset(r, 0, sizeof(*r));
+        name += strlen("\"name\": \"");
+        size_t len = strcspn(name, "\"");
+        if (len >= sizeof(r->name)) {
+            len = sizeof(r->name) - 1U;
+        }
+        memcpy(r->name, name, len);
+        if ((sscanf(median + strlen("\"median_ns\": "), "%lf", &r->median_ns) == 1) &&
+            (sscanf(p99 + strlen("\"p99_ns\": "), "%lf", &r->p99_ns) == 1)) {
+            count++;
+        }
+    }
+    (void)fclose(in);
+
+    return count;
+}
+
+// 以 median 比較；回傳失敗數 = 變慢超過門檻的案例 + 基準有但新結果缺少的案例。
+// 任一檔案無法讀取或沒有案例時直接回傳 1，不能當成「沒有變慢」。
+static uint32_t bench_compare(const char *base_path, const char *new_path, double threshold_pct) {
+    static BenchResult base[BENCH_MAX_CASES];
+    static BenchResult next[BENCH_MAX_CASES];
+    uint32_t base_count = bench_load_json(base_path, base, BENCH_MAX_CASES);
+    uint32_t next_count = bench_load_json(new_path, next, BENCH_MAX_CASES);
+    uint32_t regressions = 0U;
+    uint32_t missing = 0U;
+
+    if ((base_count == 0U) || (next_count == 0U)) {
+        printf("無法讀取或沒有任何案例: %s\n", (base_count == 0U) ? base_path : new_path);
+        return 1U;
+    }
+
+    printf("%-32s %12s %12s %9s %12s  %s\n", "案例", "基準 ns/op", "新 ns/op", "變化", "新 p99", "判定");
+    for (uint32_t i = 0U; i < next_count; i++) {
+        const BenchResult *n = &next[i];
+        const BenchResult *b = NULL;
+        for (uint32_t j = 0U; j < base_count; j++) {
+            if (strcmp(base[j].name, n->name) == 0) {
+                b = &base[j];
+                break;
+            }
+        }
+        if ((b == NULL) || (b->median_ns <= 0.0)) {
+            printf("%-32s %12s %12.2f %9s %12.2f  新案例\n", n->name, "-", n->median_ns, "-", n->p99_ns);
+            continue;
+        }
+        double change = 100.0 * ((n->median_ns - b->median_ns) / b->median_ns);
+        const char *verdict = "持平";
+        if (change > threshold_pct) {
+            verdict = "變慢!";
+            regressions++;
+        } else if (change < -threshold_pct) {
+            verdict = "變快";
+        }
+        printf("%-32s %12.2f %12.2f %+8.1f%% %12.2f  %s\n",
+               n->name, b->median_ns, n->median_ns, change, n->p99_ns, verdict);
+    }
+    for (uint32_t j = 0U; j < base_count; j++) {
+        bool found = false;
+        for (uint32_t i = 0U; (i < next_count) && !found; i++) {
+            found = strcmp(base[j].name, next[i].name) == 0;
+        }
+        if (!found) {
+            printf("%-32s %12.2f %12s %9s %12s  缺少!\n", base[j].name, base[j].median_ns, "-", "-", "-");
+            missing++;
+        }
+    }
+    printf("\n基準 %u 個案例，新結果 %u 個案例，門檻 ±%.1f%%，變慢 %u 個，缺少 %u 個\n",
+           base_count, next_count, threshold_pct, regressions, missing);
+
+    return regressions + missing;
+}
+
+static int bench_main(int argc, char *argv[], const BenchCase *cases, uint32_t case_count) {
+    static BenchResult results[BENCH_MAX_CASES];
+    BenchOptions opt = { .reps = 101U, .warmup_ms = 100U, .sample_us = 200U, .cpu = 0 };
+    double threshold = 5.0;
+    uint32_t done = 0U;
+
+    if ((argc >= 4) && (strcmp(argv[1], "--compare") == 0)) {
+        if ((argc >= 6) && (strcmp(argv[4], "--threshold") == 0)) {
+            threshold = strtod(argv[5], NULL);
+        }
+        uint32_t failures = bench_compare(argv[2], argv[3], threshold);
+        return (failures == 0U) ? 0 : 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = (i + 1) < argc;
+        if (has_value && (strcmp(argv[i], "--reps") == 0)) {
+            opt.reps = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (has_value && (strcmp(argv[i], "--warmup-ms") == 0)) {
+            opt.warmup_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (has_value && (strcmp(argv[i], "--sample-us") == 0)) {
+            opt.sample_us = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (has_value && (strcmp(argv[i], "--cpu") == 0)) {
+            opt.cpu = (int)strtol(argv[++i], NULL, 10);
+        } else if (has_value && (strcmp(argv[i], "--filter") == 0)) {
+            opt.filter = argv[++i];
+        } else if (has_value && (strcmp(argv[i], "--json") == 0)) {
+            opt.json_path = argv[++i];
+        } else {
+            printf("未知的參數: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if ((opt.reps == 0U) || (opt.reps > BENCH_MAX_REPS) || (case_count > BENCH_MAX_CASES)) {
+        printf("reps 必須介於 1 與 %u 之間\n", BENCH_MAX_REPS);
+        return 2;
+    }
+
+    bool pinned = bench_pin_cpu(opt.cpu);
+    printf("reps %u, 暖機 %u ms, 每樣本 >= %u us, CPU %d%s\n", opt.reps, opt.warmup_ms,
+           opt.sample_us, opt.cpu, pinned ? "" : " (綁定失敗，未綁定)");
+    if (!pinned) {
+        opt.cpu = -1;
+    }
+    printf("%-32s %-14s %12s %12s %14s\n", "案例", "模組", "median ns", "p99 ns", "ops/sec");
+
+    for (uint32_t i = 0U; i < case_count; i++) {
+        if ((opt.filter != NULL) && (strstr(cases[i].name, opt.filter) == NULL)) {
+            continue;
+        }
+        if (!bench_run_case(&cases[i], &opt, &results[done])) {
+            printf("記憶體配置失敗\n");
+            return 1;
+        }
+        const BenchResult *r = &results[done];
+        printf("%-32s %-14s %12.2f %12.2f %14.0f\n", r->name, r->module, r->median_ns, r->p99_ns,
+               r->ops_per_sec);
+        done++;
+    }
+
+    if (opt.json_path != NULL) {
+        if (!bench_write_json(opt.json_path, results, done, &opt)) {
+            printf("無法寫入 %s\n", opt.json_path);
+            return 1;
+        }
+        printf("結果已寫入 %s\n", opt.json_path);
+    }
+
+    return 0;
+}
+
+#endif  // BENCH_HARNESS_H
@@ -0,0 +1,158 @@
+// bench_week1.c - week1 熱路徑微基準測試
+// 直接 #include 各模組的原始檔 (以 *_NO_MAIN 關閉各自的 main)，量測：
+//   state-machine: sm_process_event (穩定/劇烈波動)、get_temperature_event
+//   misra:         calculate_fan_speed、read_sensor (含 1/8 的錯誤路徑)
+//   callbacks:     sort_array (256 個 int)、BMCComponent 輪詢迴圈
+// pointers/ 只有教學用的列印示範；配置追蹤器的開銷由 pointers/alloc_tracker_bench.c 量測。
+//
+// 建議透過 Makefile：make bench、make bench-compare BASE=舊.json NEW=新.json
+
+#define _GNU_SOURCE
+#define SM_QUIET
+#define FAN_CONTROL_NO_MAIN
+#include "../state-machine/fan_control_state_machine.c"
+#define MISRA_C_BASICS_NO_MAIN
+#include "../misra/misra_c_basics.c"
+#define FUNCTION_POINTERS_CALLBACKS_NO_MAIN
+#include "../callbacks/function_pointers_callbacks.c"
+
+#include "bench_harness.h"
+
+#define INPUT_COUNT             4096U   // 輸入資料循環使用 (2 的冪次)
+#define INPUT_MASK              (INPUT_COUNT - 1U)
+#define SORT_SIZE               256
+
+static uint32_t bench_rng = 0xB3C4D5E6U;
+
+static uint32_t bench_rand(void) {
+    bench_rng ^= bench_rng << 13;
+    bench_rng ^= bench_rng >> 17;
+    bench_rng ^= bench_rng << 5;
+    return bench_rng;
+}
+
+// === state-machine ===
+typedef struct {
+    StateMachine sm;
+    SystemEvent events[INPUT_COUNT];
+} SmEventCtx;
+
+static void sm_event_ctx_init(SmEventCtx *ctx, TempMilliC low, uint32_t span_mc) {
+    sm_init(&ctx->sm);
+    sm_process_event(&ctx->sm, EVENT_SYSTEM_INIT);
+    for (uint32_t i = 0U; i < INPUT_COUNT; i++) {
+        ctx->events[i] = get_temperature_event(low + (TempMilliC)(bench_rand() % span_mc));
+    }
+}
+
+static void bench_sm_process_event(void *arg, uint64_t iters) {
+    SmEventCtx *ctx = (SmEventCtx *)arg;
+
+    for (uint64_t i = 0U; i < iters; i++) {
+        sm_process_event(&ctx->sm, ctx->events[i & INPUT_MASK]);
+    }
+    BENCH_KEEP(ctx->sm.current_state);
+}
+
+static TempMilliC temperatures[INPUT_COUNT];     // 40-99.999°C，跨越所有閾值
+
+static void bench_get_temperature_event(void *arg, uint64_t iters) {
+    uint32_t acc = 0U;
+    (void)arg;
+
+    for (uint64_t i = 0U; i < iters; i++) {
+        acc += (uint32_t)get_temperature_event(temperatures[i & INPUT_MASK]);
+    }
+    BENCH_KEEP(acc);
+}
+
+// === misra ===
+static void bench_calculate_fan_speed(void *arg, uint64_t iters) {
+    uint32_t acc = 0U;
+    (void)arg;
+
+    for (uint64_t i = 0U; i < iters; i++) {
+        acc += calculate_fan_speed(temperatures[i & INPUT_MASK]);
+    }
+    BENCH_KEEP(acc);
+}
+
+static void bench_read_sensor(void *arg, uint64_t iters) {
+    TempMilliC value = 0;
+    int32_t acc = 0;
+    (void)arg;
+
+    for (uint64_t i = 0U; i < iters; i++) {
+        // sensor_id 0 走錯誤路徑
+        BMCStatus status = read_sensor((uint32_t)(i & 7U), &value);
+        acc += (status == BMC_OK) ? value : (int32_t)status;
+    }
+    BENCH_KEEP(acc);
+}
+
+// === callbacks ===
+typedef struct {
+    int source[SORT_SIZE];
+    int work[SORT_SIZE];
+} SortCtx;
+
+// 每次操作：複製未排序資料後排序一次
+static void bench_sort_array(void *arg, uint64_t iters) {
+    SortCtx *ctx = (SortCtx *)arg;
+
+    for (uint64_t i = 0U; i < iters; i++) {
+        memcpy(ctx->work, ctx->source, sizeof(ctx->work));
+        sort_array(ctx->work, SORT_SIZE, compare_ascending);
+        BENCH_KEEP(ctx->work[0]);
+    }
+}
+
+static const BMCComponent poll_components[] = {
+    { .name = "CPU溫度感測器", .init = temp_sensor_init, .read = temp_sensor_read,
+      .cleanup = temp_sensor_cleanup },
+    { .name = "系統風扇", .init = fan_controller_init, .read = fan_controller_read,
+      .cleanup = fan_controller_cleanup }
+};
+
+// 每次操作：依序呼叫所有元件的 read()，與 component_interface_demo() 的讀取迴圈相同
+static void bench_component_poll(void *arg, uint64_t iters) {
+    int acc = 0;
+    int count = (int)(sizeof(poll_components) / sizeof(poll_components[0]));
+    (void)arg;
+
+    for (uint64_t i = 0U; i < iters; i++) {
+        for (int c = 0; c < count; c++) {
+            acc += poll_components[c].read();
+        }
+    }
+    BENCH_KEEP(acc);
+}
+
+int main(int argc, char *argv[]) {
+    static SmEventCtx steady;
+    static SmEventCtx volatile_temps;
+    static SortCtx sort_ctx;
+
+    sm_event_ctx_init(&steady, TEMP_MC_FROM_C(40), 5000U);              // 維持 NORMAL
+    sm_event_ctx_init(&volatile_temps, TEMP_MC_FROM_C(40), 60000U);     // 頻繁轉換
+    for (uint32_t i = 0U; i < INPUT_COUNT; i++) {
+        temperatures[i] = TEMP_MC_FROM_C(40) + (TempMilliC)(bench_rand() % 60000U);
+    }
+    for (uint32_t i = 0U; i < SORT_SIZE; i++) {
+        sort_ctx.source[i] = (int)(bench_rand() % 100000U);
+    }
+    srand(1U);
+
+    const BenchCase cases[] = {
+        { "sm_process_event/steady", "state-machine", bench_sm_process_event, &steady },
+        { "sm_process_event/volatile", "state-machine", bench_sm_process_event, &volatile_temps },
+        { "get_temperature_event", "state-machine", bench_get_temperature_event, NULL },
+        { "calculate_fan_speed", "misra", bench_calculate_fan_speed, NULL },
+        { "read_sensor", "misra", bench_read_sensor, NULL },
+        { "sort_array/256", "callbacks", bench_sort_array, &sort_ctx },
+        { "bmc_component_poll/2", "callbacks", bench_component_poll, NULL }
+    };
+
+    printf("=== week1 熱路徑微基準測試 ===\n");
+    return bench_main(argc, argv, cases, (uint32_t)(sizeof(cases) / sizeof(cases[0])));
+}
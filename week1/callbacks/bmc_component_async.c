@@ -0,0 +1,413 @@
+// bmc_component_async.c - 非同步 BMC 元件驅動模型 (v2 介面)
+// function_pointers_callbacks.c 中的 BMCComponent 只有同步的 int (*read)(void)：
+// 沒有 context 指標，也無法把錯誤與數值分開回報，一次只能等一個慢速裝置。
+// v2 介面加入 context、submit/complete 非同步讀取、每元件逾時與 BMCStatus 錯誤碼，
+// 讓單一執行緒可以同時維持數百個讀取在途中。
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// === 錯誤碼 (沿用 misra_c_basics.c 的 BMCStatus) ===
+#ifndef BMC_STATUS_DEFINED
+#define BMC_STATUS_DEFINED
+typedef enum {
+    BMC_OK = 0,
+    BMC_ERROR_INVALID_PARAM = -1,
+    BMC_ERROR_TIMEOUT = -2,
+    BMC_ERROR_HARDWARE = -3,
+    BMC_ERROR_BUSY = -4
+} BMCStatus;
+#endif
+
+// === 時間工具 ===
+static inline uint64_t bmc_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+// === v2 元件介面 ===
+typedef struct BMCReadRequest BMCReadRequest;
+
+// 完成回調：在 poll() 的呼叫端執行緒中被呼叫
+typedef void (*BMCReadCallback)(BMCReadRequest *req);
+
+struct BMCReadRequest {
+    uint32_t channel;             // 元件內的通道 (例如感測器編號)
+    int32_t value;                // 讀取結果，僅在 status == BMC_OK 時有效
+    BMCStatus status;
+    bool completed;               // 輪詢模式下由呼叫端檢查
+    uint64_t submit_ns;
+    uint64_t deadline_ns;
+    uint64_t complete_ns;
+    BMCReadCallback on_complete;  // NULL 表示使用輪詢模式
+    void *user_data;
+};
+
+typedef struct {
+    char name[50];
+    void *ctx;                    // 驅動私有資料，傳給每個操作
+    uint32_t timeout_us;          // 每元件讀取逾時
+    BMCStatus (*init)(void *ctx);
+    BMCStatus (*submit_read)(void *ctx, BMCReadRequest *req);
+    uint32_t (*poll)(void *ctx, uint64_t now_ns);  // 推進完成，回傳完成數量
+    void (*cleanup)(void *ctx);
+} BMCComponentV2;
+
+// 驅動在請求完成 (成功、失敗或逾時) 時呼叫
+static inline void bmc_request_complete(BMCReadRequest *req, BMCStatus status,
+                                        int32_t value, uint64_t now_ns) {
+    req->status = status;
+    req->value = value;
+    req->complete_ns = now_ns;
+    req->completed = true;
+    if (req->on_complete != NULL) {
+        req->on_complete(req);
+    }
+}
+
+BMCStatus bmc_component_submit(BMCComponentV2 *comp, BMCReadRequest *req) {
+    BMCStatus status;
+
+    if ((comp == NULL) || (req == NULL) || (comp->submit_read == NULL)) {
+        status = BMC_ERROR_INVALID_PARAM;
+    } else {
+        req->completed = false;
+        req->status = BMC_OK;
+        req->submit_ns = bmc_now_ns();
+        req->deadline_ns = req->submit_ns + ((uint64_t)comp->timeout_us * 1000ULL);
+        status = comp->submit_read(comp->ctx, req);
+    }
+
+    return status;
+}
+
+uint32_t bmc_component_poll(BMCComponentV2 *comp) {
+    uint32_t done = 0U;
+
+    if ((comp != NULL) && (comp->poll != NULL)) {
+        done = comp->poll(comp->ctx, bmc_now_ns());
+    }
+
+    return done;
+}
+
+// 同步讀取輔助：submit 後輪詢直到完成，給只需要單次讀取的呼叫端
+BMCStatus bmc_component_read_blocking(BMCComponentV2 *comp, uint32_t channel,
+                                      int32_t *value) {
+    BMCReadRequest req = { .channel = channel };
+    BMCStatus status = bmc_component_submit(comp, &req);
+
+    if (status == BMC_OK) {
+        while (!req.completed) {
+            (void)bmc_component_poll(comp);
+        }
+        status = req.status;
+        if ((status == BMC_OK) && (value != NULL)) {
+            *value = req.value;
+        }
+    }
+
+    return status;
+}
+
+// === 模擬慢速裝置驅動 ===
+// 每次讀取需要 base_latency_us (加上隨機抖動) 才完成；
+// 每 fail_every 次回傳硬體錯誤，每 hang_every 次永不回應 (靠逾時結束)。
+#define SLOW_DEVICE_MAX_INFLIGHT  1024U
+
+typedef struct {
+    uint32_t base_latency_us;
+    uint32_t jitter_us;
+    uint32_t fail_every;          // 0 表示不注入錯誤
+    uint32_t hang_every;          // 0 表示不注入無回應
+    uint32_t seq;
+    uint32_t inflight_count;
+    BMCReadRequest *inflight[SLOW_DEVICE_MAX_INFLIGHT];
+    uint64_t ready_ns[SLOW_DEVICE_MAX_INFLIGHT];  // UINT64_MAX 表示不會回應
+    uint32_t rng;
+} SlowDeviceCtx;
+
+static uint32_t slow_device_rand(SlowDeviceCtx *dev) {
+    // xorshift32：足夠模擬抖動，且不受 rand() 全域狀態影響
+    uint32_t x = dev->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    dev->rng = x;
+    return x;
+}
+
+static uint32_t slow_device_latency_us(SlowDeviceCtx *dev) {
+    uint32_t latency = dev->base_latency_us;
+    if (dev->jitter_us > 0U) {
+        latency += slow_device_rand(dev) % dev->jitter_us;
+    }
+    return latency;
+}
+
+BMCStatus slow_device_init(void *ctx) {
+    SlowDeviceCtx *dev = (SlowDeviceCtx *)ctx;
+    dev->seq = 0U;
+    dev->inflight_count = 0U;
+    dev->rng = 0x2545F491U;
+    return BMC_OK;
+}
+
+BMCStatus slow_device_submit(void *ctx, BMCReadRequest *req) {
+    SlowDeviceCtx *dev = (SlowDeviceCtx *)ctx;
+    BMCStatus status = BMC_OK;
+
+    if (dev->inflight_count >= SLOW_DEVICE_MAX_INFLIGHT) {
+        status = BMC_ERROR_BUSY;
+    } else {
+        uint32_t slot = dev->inflight_count;
+        dev->seq++;
+        dev->inflight[slot] = req;
+        if ((dev->hang_every != 0U) && ((dev->seq % dev->hang_every) == 0U)) {
+            dev->ready_ns[slot] = UINT64_MAX;
+        } else {
+            dev->ready_ns[slot] = req->submit_ns +
+                                  ((uint64_t)slow_device_latency_us(dev) * 1000ULL);
+        }
+        dev->inflight_count++;
+    }
+
+    return status;
+}
+
+uint32_t slow_device_poll(void *ctx, uint64_t now_ns) {
+    SlowDeviceCtx *dev = (SlowDeviceCtx *)ctx;
+    uint32_t done = 0U;
+    uint32_t i = 0U;
+
+    while (i < dev->inflight_count) {
+        BMCReadRequest *req = dev->inflight[i];
+        BMCStatus status = BMC_OK;
+        int32_t value = 0;
+        bool finished = true;
+
+        // 先檢查截止時間：輪詢得太晚時，即使資料已經就緒也算逾時
+        if (now_ns >= req->deadline_ns) {
+            status = BMC_ERROR_TIMEOUT;
+        } else if (now_ns >= dev->ready_ns[i]) {
+            if ((dev->fail_every != 0U) &&
+                (((req->channel + dev->seq) % dev->fail_every) == 0U)) {
+                status = BMC_ERROR_HARDWARE;
+            } else {
+                // 模擬溫度 25-64°C，與 temp_sensor_read() 相同範圍
+                value = 25 + (int32_t)(slow_device_rand(dev) % 40U);
+            }
+        } else {
+            finished = false;
+        }
+
+        if (finished) {
+            // 先以最後一個元素填補空位 (順序不重要)，回調才能安全地重新送出
+            dev->inflight_count--;
+            dev->inflight[i] = dev->inflight[dev->inflight_count];
+            dev->ready_ns[i] = dev->ready_ns[dev->inflight_count];
+            bmc_request_complete(req, status, value, now_ns);
+            done++;
+        } else {
+            i++;
+        }
+    }
+
+    return done;
+}
+
+void slow_device_cleanup(void *ctx) {
+    SlowDeviceCtx *dev = (SlowDeviceCtx *)ctx;
+    uint64_t now = bmc_now_ns();
+
+    // 取消所有在途請求，確保呼叫端不會永遠等待
+    while (dev->inflight_count > 0U) {
+        dev->inflight_count--;
+        bmc_request_complete(dev->inflight[dev->inflight_count],
+                             BMC_ERROR_TIMEOUT, 0, now);
+    }
+}
+
+// 舊版同步介面的對照實作：每次讀取都要睡滿整個裝置延遲
+static SlowDeviceCtx sync_device = {
+    .base_latency_us = 200U,
+    .jitter_us = 100U,
+    .rng = 0x2545F491U
+};
+
+int slow_device_read_sync(void) {
+    uint32_t latency_us = slow_device_latency_us(&sync_device);
+    struct timespec ts = {
+        .tv_sec = 0,
+        .tv_nsec = (long)latency_us * 1000L
+    };
+    nanosleep(&ts, NULL);
+    return 25 + (int)(slow_device_rand(&sync_device) % 40U);
+}
+
+#ifndef BMC_COMPONENT_ASYNC_NO_MAIN
+
+// === 示範：回調與輪詢兩種完成模式 ===
+static void demo_on_complete(BMCReadRequest *req) {
+    const char *name = (const char *)req->user_data;
+    if (req->status == BMC_OK) {
+        printf("  [回調] %s 通道 %u: %d°C (延遲 %lu us)\n", name, req->channel,
+               req->value, (unsigned long)((req->complete_ns - req->submit_ns) / 1000U));
+    } else {
+        printf("  [回調] %s 通道 %u: 錯誤碼 %d\n", name, req->channel, req->status);
+    }
+}
+
+void async_component_demo(void) {
+    printf("\n=== 1. 非同步元件讀取示範 ===\n");
+
+    SlowDeviceCtx dev = {
+        .base_latency_us = 500U,
+        .jitter_us = 500U,
+        .fail_every = 5U,
+        .hang_every = 7U
+    };
+    BMCComponentV2 comp = {
+        .name = "慢速 I2C 溫度感測器",
+        .ctx = &dev,
+        .timeout_us = 3000U,
+        .init = slow_device_init,
+        .submit_read = slow_device_submit,
+        .poll = slow_device_poll,
+        .cleanup = slow_device_cleanup
+    };
+
+    if (comp.init(comp.ctx) != BMC_OK) {
+        printf("初始化失敗\n");
+        return;
+    }
+
+    BMCReadRequest reqs[8];
+    memset(reqs, 0, sizeof(reqs));
+
+    printf("一次送出 %zu 個讀取 (回調模式):\n", sizeof(reqs) / sizeof(reqs[0]));
+    for (uint32_t i = 0U; i < (sizeof(reqs) / sizeof(reqs[0])); i++) {
+        reqs[i].channel = i;
+        reqs[i].on_complete = demo_on_complete;
+        reqs[i].user_data = comp.name;
+        if (bmc_component_submit(&comp, &reqs[i]) != BMC_OK) {
+            printf("  通道 %u 送出失敗\n", i);
+        }
+    }
+
+    uint32_t remaining = (uint32_t)(sizeof(reqs) / sizeof(reqs[0]));
+    while (remaining > 0U) {
+        remaining -= bmc_component_poll(&comp);
+    }
+
+    printf("\n輪詢模式 (阻塞輔助函數):\n");
+    int32_t value = 0;
+    BMCStatus status = bmc_component_read_blocking(&comp, 42U, &value);
+    if (status == BMC_OK) {
+        printf("  通道 42: %d°C\n", value);
+    } else {
+        printf("  通道 42: 錯誤碼 %d\n", status);
+    }
+
+    comp.cleanup(comp.ctx);
+}
+
+// === 效能比較：同步 vs 非同步 ===
+#define BENCH_DURATION_NS   500000000ULL  // 0.5 秒
+#define BENCH_INFLIGHT      256U
+
+typedef struct {
+    BMCComponentV2 *comp;
+    uint64_t completed;
+    uint64_t errors;
+    bool resubmit;
+} BenchState;
+
+static void bench_on_complete(BMCReadRequest *req) {
+    BenchState *bench = (BenchState *)req->user_data;
+    bench->completed++;
+    if (req->status != BMC_OK) {
+        bench->errors++;
+    }
+    if (bench->resubmit) {
+        (void)bmc_component_submit(bench->comp, req);
+    }
+}
+
+void async_vs_sync_benchmark(void) {
+    printf("\n=== 2. 效能比較：同步 read() vs 非同步 submit/poll ===\n");
+    printf("裝置延遲 200-300 us，測量 %.1f 秒\n", (double)BENCH_DURATION_NS / 1e9);
+
+    // 同步：舊版 int (*read)(void)
+    uint64_t sync_reads = 0U;
+    uint64_t start = bmc_now_ns();
+    uint64_t elapsed = 0U;
+    while (elapsed < BENCH_DURATION_NS) {
+        (void)slow_device_read_sync();
+        sync_reads++;
+        elapsed = bmc_now_ns() - start;
+    }
+    double sync_rate = (double)sync_reads / ((double)elapsed / 1e9);
+    printf("同步介面:   %10.0f reads/sec\n", sync_rate);
+
+    // 非同步：單一執行緒維持 BENCH_INFLIGHT 個讀取在途
+    SlowDeviceCtx dev = { .base_latency_us = 200U, .jitter_us = 100U };
+    BMCComponentV2 comp = {
+        .name = "bench",
+        .ctx = &dev,
+        .timeout_us = 10000U,
+        .init = slow_device_init,
+        .submit_read = slow_device_submit,
+        .poll = slow_device_poll,
+        .cleanup = slow_device_cleanup
+    };
+    static BMCReadRequest reqs[BENCH_INFLIGHT];
+    BenchState bench = { .comp = &comp, .resubmit = true };
+
+    (void)comp.init(comp.ctx);
+    for (uint32_t i = 0U; i < BENCH_INFLIGHT; i++) {
+        reqs[i].channel = i;
+        reqs[i].on_complete = bench_on_complete;
+        reqs[i].user_data = &bench;
+        (void)bmc_component_submit(&comp, &reqs[i]);
+    }
+
+    start = bmc_now_ns();
+    elapsed = 0U;
+    while (elapsed < BENCH_DURATION_NS) {
+        (void)bmc_component_poll(&comp);
+        elapsed = bmc_now_ns() - start;
+    }
+    bench.resubmit = false;
+    uint64_t async_reads = bench.completed;
+    uint64_t async_errors = bench.errors;
+    comp.cleanup(comp.ctx);
+
+    double async_rate = (double)async_reads / ((double)elapsed / 1e9);
+    printf("非同步介面: %10.0f reads/sec (%u 個在途, 錯誤 %lu)\n",
+           async_rate, BENCH_INFLIGHT, (unsigned long)async_errors);
+    printf("加速比: %.1fx\n", async_rate / sync_rate);
+}
+
+// 主程式
+int main(void) {
+    printf("=== OpenBMC 非同步元件驅動模型 ===\n");
+
+    async_component_demo();
+    async_vs_sync_benchmark();
+
+    printf("\n=== 重點總結 ===\n");
+    printf("1. context 指標讓同一份驅動程式碼可服務多個裝置實例\n");
+    printf("2. submit/complete 分離，單一執行緒即可維持數百個讀取在途\n");
+    printf("3. 數值與 BMCStatus 分開回報，逾時由框架統一處理\n");
+
+    return 0;
+}
+
+#endif  // BMC_COMPONENT_ASYNC_NO_MAIN
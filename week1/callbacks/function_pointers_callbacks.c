@@ -240,6 +240,8 @@ void component_interface_demo() {
     }
 }
 
+#ifndef FUNCTION_POINTERS_CALLBACKS_NO_MAIN
+
 // 主程式
 int main() {
     printf("=== OpenBMC 函數指標與回調機制教學 ===\n");
@@ -266,3 +268,5 @@ int main() {
     
     return 0;
 }
+
+#endif  // FUNCTION_POINTERS_CALLBACKS_NO_MAIN
@@ -0,0 +1,782 @@
+// hwmon_uring_reader.c - 以 io_uring 批次讀取 hwmon 感測器檔案
+// 真實 BMC 上的感測器透過 hwmon 檔案讀取 (例如 /sys/class/hwmon/hwmon0/temp1_input)，
+// 像 temp_sensor_read() 那樣每個感測器一次阻塞讀取，就要付出一次系統呼叫往返。
+// 這裡為 BMCComponentV2 介面實作一個讀取後端：
+//   - 檔案描述子在 init 時開啟並保持開啟 (並註冊為 io_uring fixed files)
+//   - 每個通道一個預先分配的緩衝區，重複使用；同一通道同時只允許一個請求
+//   - 讀取請求先放入 SQ，poll() 時一次 io_uring_enter 送出整批
+//   - poll() 檢查在途讀取的 deadline_ns：過期的請求以 BMC_ERROR_TIMEOUT 完成
+//     (與 slow_device_poll 相同)，並送出 IORING_OP_ASYNC_CANCEL 取消核心中的讀取；
+//     通道的緩衝區要等讀取的 CQE 回來才釋放
+//   - 核心不支援 io_uring 時，自動退回 pread()
+
+#define BMC_COMPONENT_ASYNC_NO_MAIN
+#include "bmc_component_async.c"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#define HWMON_VALUE_BUF_SIZE    16U     // "-123456\n" 綽綽有餘
+#define HWMON_RING_ENTRIES      1024U
+#define HWMON_MAX_PENDING       16384U
+#define HWMON_CANCEL_TAG        0U      // 取消 SQE 的 user_data；讀取的 user_data 為通道 + 1
+
+// === 最小化的 io_uring 封裝 (不依賴 liburing) ===
+typedef struct {
+    int ring_fd;
+    unsigned sq_entries;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr;
+    void *cq_ptr;
+    size_t sq_len;
+    size_t cq_len;
+    size_t sqes_len;
+    unsigned sq_local_tail;   // 尚未發佈給核心的 tail
+    unsigned to_submit;
+} UringRing;
+
+static int uring_setup(UringRing *ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    ring->ring_fd = fd;
+    ring->sq_entries = params.sq_entries;
+    ring->sq_len = params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+    ring->cq_len = params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0U) {
+        if (ring->cq_len > ring->sq_len) {
+            ring->sq_len = ring->cq_len;
+        }
+        ring->cq_len = ring->sq_len;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        close(fd);
+        return -errno;
+    }
+
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0U) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            munmap(ring->sq_ptr, ring->sq_len);
+            close(fd);
+            return -errno;
+        }
+    }
+
+    ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (ring->cq_ptr != ring->sq_ptr) {
+            munmap(ring->cq_ptr, ring->cq_len);
+        }
+        munmap(ring->sq_ptr, ring->sq_len);
+        close(fd);
+        return -errno;
+    }
+
+    uint8_t *sq = (uint8_t *)ring->sq_ptr;
+    uint8_t *cq = (uint8_t *)ring->cq_ptr;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    ring->sq_local_tail = *ring->sq_tail;
+
+    return 0;
+}
+
+static void uring_teardown(UringRing *ring) {
+    munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_len);
+    }
+    munmap(ring->sq_ptr, ring->sq_len);
+    close(ring->ring_fd);
+}
+
+// 取得一個空的 SQE；SQ 已滿時回傳 NULL
+static struct io_uring_sqe *uring_get_sqe(UringRing *ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    struct io_uring_sqe *sqe = NULL;
+
+    if ((ring->sq_local_tail - head) < ring->sq_entries) {
+        unsigned idx = ring->sq_local_tail & *ring->sq_mask;
+        sqe = &ring->sqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        ring->sq_array[idx] = idx;
+        ring->sq_local_tail++;
+        ring->to_submit++;
+    }
+
+    return sqe;
+}
+
+static int uring_enter(UringRing *ring, unsigned min_complete, unsigned flags) {
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+    int ret = (int)syscall(__NR_io_uring_enter, ring->ring_fd, ring->to_submit,
+                           min_complete, flags, NULL, 0);
+    if (ret >= 0) {
+        ring->to_submit -= (unsigned)ret;
+    }
+    return ret;
+}
+
+// === hwmon 讀取後端 ===
+typedef struct {
+    uint32_t sensor_count;
+    int *fds;
+    char *buffers;                  // sensor_count * HWMON_VALUE_BUF_SIZE
+    BMCReadRequest **channel_req;   // 通道目前的請求；逾時完成後為 NULL
+    bool *channel_busy;             // 通道的緩衝區還在使用中 (等待、在途或等待取消)
+    uint32_t *inflight_channels;    // 已送進核心、尚未回來的讀取 (檢查期限用)
+    uint32_t *inflight_pos;         // 通道在 inflight_channels 中的位置
+    uint32_t inflight_reads;
+    bool use_uring;
+    bool fixed_files;
+    bool fixed_buffers;
+    UringRing ring;
+
+    // 等待進入 SQ 的請求 (環狀佇列)
+    BMCReadRequest *pending[HWMON_MAX_PENDING];
+    uint32_t pending_head;
+    uint32_t pending_count;
+    uint32_t inflight;              // 尚未收割的 CQE (讀取 + 取消)
+
+    // 統計
+    uint64_t syscalls;
+} HwmonReaderCtx;
+
+// 解析 hwmon 的十進位文字 (單位：毫度)，不使用 strtol 以避免 locale 與 errno 開銷
+static BMCStatus hwmon_parse_value(const char *buf, int32_t len, int32_t *value) {
+    BMCStatus status = BMC_ERROR_HARDWARE;
+    int32_t i = 0;
+    bool negative = false;
+    int64_t acc = 0;
+
+    if ((len > 0) && (buf[0] == '-')) {
+        negative = true;
+        i = 1;
+    }
+    for (; i < len; i++) {
+        char c = buf[i];
+        if ((c < '0') || (c > '9')) {
+            break;
+        }
+        acc = (acc * 10) + (c - '0');
+        status = BMC_OK;
+        if (acc > INT32_MAX) {
+            status = BMC_ERROR_HARDWARE;
+            break;
+        }
+    }
+    if (status == BMC_OK) {
+        *value = negative ? (int32_t)-acc : (int32_t)acc;
+    }
+
+    return status;
+}
+
+// 開啟所有感測器檔案；paths 由呼叫端擁有，只在 init 期間使用
+BMCStatus hwmon_reader_open(HwmonReaderCtx *ctx, const char *const *paths,
+                            uint32_t count, bool force_pread) {
+    BMCStatus status = BMC_OK;
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->fds = (int *)malloc(count * sizeof(int));
+    ctx->buffers = (char *)aligned_alloc(4096U,
+        ((count * HWMON_VALUE_BUF_SIZE) + 4095U) & ~(size_t)4095U);
+    ctx->channel_req = (BMCReadRequest **)calloc(count, sizeof(BMCReadRequest *));
+    ctx->channel_busy = (bool *)calloc(count, sizeof(bool));
+    ctx->inflight_channels = (uint32_t *)calloc(count, sizeof(uint32_t));
+    ctx->inflight_pos = (uint32_t *)calloc(count, sizeof(uint32_t));
+    if ((ctx->fds == NULL) || (ctx->buffers == NULL) || (ctx->channel_req == NULL) ||
+        (ctx->channel_busy == NULL) || (ctx->inflight_channels == NULL) || (ctx->inflight_pos == NULL)) {
+        free(ctx->fds);
+        free(ctx->buffers);
+        free(ctx->channel_req);
+        free(ctx->channel_busy);
+        free(ctx->inflight_channels);
+        free(ctx->inflight_pos);
+        memset(ctx, 0, sizeof(*ctx));
+        return BMC_ERROR_HARDWARE;
+    }
+
+    for (uint32_t i = 0U; i < count; i++) {
+        ctx->fds[i] = open(paths[i], O_RDONLY | O_CLOEXEC);
+        if (ctx->fds[i] < 0) {
+            // 保留 -1，讀取該通道時回報硬體錯誤
+            status = BMC_ERROR_HARDWARE;
+        }
+    }
+    ctx->sensor_count = count;
+
+    if (!force_pread && (uring_setup(&ctx->ring, HWMON_RING_ENTRIES) == 0)) {
+        ctx->use_uring = true;
+
+        // 註冊檔案與緩衝區可省去每次 I/O 的 fd 查找與頁面釘選；失敗時仍可正常運作
+        if (syscall(__NR_io_uring_register, ctx->ring.ring_fd,
+                    IORING_REGISTER_FILES, ctx->fds, count) == 0) {
+            ctx->fixed_files = true;
+        }
+        struct iovec iov = {
+            .iov_base = ctx->buffers,
+            .iov_len = count * HWMON_VALUE_BUF_SIZE
+        };
+        if (syscall(__NR_io_uring_register, ctx->ring.ring_fd,
+                    IORING_REGISTER_BUFFERS, &iov, 1U) == 0) {
+            ctx->fixed_buffers = true;
+        }
+    }
+
+    return status;
+}
+
+BMCStatus hwmon_reader_init(void *opaque) {
+    HwmonReaderCtx *ctx = (HwmonReaderCtx *)opaque;
+    return (ctx->fds != NULL) ? BMC_OK : BMC_ERROR_INVALID_PARAM;
+}
+
+BMCStatus hwmon_reader_submit(void *opaque, BMCReadRequest *req) {
+    HwmonReaderCtx *ctx = (HwmonReaderCtx *)opaque;
+    BMCStatus status = BMC_OK;
+
+    if (req->channel >= ctx->sensor_count) {
+        status = BMC_ERROR_INVALID_PARAM;
+    } else if ((ctx->pending_count >= HWMON_MAX_PENDING) || ctx->channel_busy[req->channel]) {
+        // 同一通道的第二個請求會與前一個共用緩衝區，互相覆寫
+        status = BMC_ERROR_BUSY;
+    } else {
+        uint32_t slot = (ctx->pending_head + ctx->pending_count) % HWMON_MAX_PENDING;
+        ctx->pending[slot] = req;
+        ctx->pending_count++;
+        ctx->channel_req[req->channel] = req;
+        ctx->channel_busy[req->channel] = true;
+    }
+
+    return status;
+}
+
+// 完成請求並交還通道 (緩衝區已不在核心手中)；res 為 -ETIME 表示逾時
+static void hwmon_complete_read(HwmonReaderCtx *ctx, BMCReadRequest *req,
+                                int32_t res, uint64_t now_ns) {
+    int32_t value = 0;
+    BMCStatus status = BMC_ERROR_HARDWARE;
+
+    if (res > 0) {
+        status = hwmon_parse_value(&ctx->buffers[req->channel * HWMON_VALUE_BUF_SIZE],
+                                   res, &value);
+    } else if (res == -ETIME) {
+        status = BMC_ERROR_TIMEOUT;
+    } else {
+        // 讀取失敗或檔案未開啟：硬體錯誤
+    }
+    ctx->channel_req[req->channel] = NULL;
+    ctx->channel_busy[req->channel] = false;
+    bmc_request_complete(req, status, value, now_ns);
+}
+
+// 退回模式：每個請求一次 pread (檔案保持開啟，仍比 open/read/close 省)。
+// pread 無法中途取消：輪到時已過期的請求不讀取，讀完才超過期限的也算逾時
+static uint32_t hwmon_poll_pread(HwmonReaderCtx *ctx, uint64_t now_ns) {
+    uint32_t done = 0U;
+
+    while (ctx->pending_count > 0U) {
+        BMCReadRequest *req = ctx->pending[ctx->pending_head];
+        ctx->pending_head = (ctx->pending_head + 1U) % HWMON_MAX_PENDING;
+        ctx->pending_count--;
+
+        int fd = ctx->fds[req->channel];
+        int32_t res = -EBADF;
+        uint64_t finished_ns = now_ns;
+        if (now_ns >= req->deadline_ns) {
+            res = -ETIME;
+        } else if (fd >= 0) {
+            ssize_t n = pread(fd, &ctx->buffers[req->channel * HWMON_VALUE_BUF_SIZE],
+                              HWMON_VALUE_BUF_SIZE, 0);
+            ctx->syscalls++;
+            finished_ns = bmc_now_ns();
+            res = (finished_ns >= req->deadline_ns) ? -ETIME : (int32_t)n;
+        } else {
+            // 檔案未開啟
+        }
+        hwmon_complete_read(ctx, req, res, finished_ns);
+        done++;
+    }
+
+    return done;
+}
+
+static void hwmon_inflight_add(HwmonReaderCtx *ctx, uint32_t channel) {
+    ctx->inflight_pos[channel] = ctx->inflight_reads;
+    ctx->inflight_channels[ctx->inflight_reads++] = channel;
+}
+
+static void hwmon_inflight_remove(HwmonReaderCtx *ctx, uint32_t channel) {
+    uint32_t pos = ctx->inflight_pos[channel];
+    uint32_t last = ctx->inflight_channels[--ctx->inflight_reads];
+
+    ctx->inflight_channels[pos] = last;
+    ctx->inflight_pos[last] = pos;
+}
+
+static uint32_t hwmon_poll_uring(HwmonReaderCtx *ctx, uint64_t now_ns) {
+    uint32_t done = 0U;
+
+    // 1. 把等待中的請求填入 SQ
+    while (ctx->pending_count > 0U) {
+        BMCReadRequest *req = ctx->pending[ctx->pending_head];
+        int fd = ctx->fds[req->channel];
+
+        if (fd < 0) {
+            hwmon_complete_read(ctx, req, -EBADF, now_ns);
+            done++;
+        } else if (now_ns >= req->deadline_ns) {
+            hwmon_complete_read(ctx, req, -ETIME, now_ns);
+            done++;
+        } else {
+            struct io_uring_sqe *sqe = uring_get_sqe(&ctx->ring);
+            if (sqe == NULL) {
+                break;  // SQ 已滿，下次 poll 再送
+            }
+            sqe->opcode = ctx->fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+            sqe->fd = ctx->fixed_files ? (int32_t)req->channel : fd;
+            sqe->flags = ctx->fixed_files ? IOSQE_FIXED_FILE : 0U;
+            sqe->off = 0U;
+            sqe->addr = (uint64_t)(uintptr_t)&ctx->buffers[req->channel * HWMON_VALUE_BUF_SIZE];
+            sqe->len = HWMON_VALUE_BUF_SIZE;
+            sqe->buf_index = 0U;
+            sqe->user_data = (uint64_t)req->channel + 1U;
+            hwmon_inflight_add(ctx, req->channel);
+            ctx->inflight++;
+        }
+        ctx->pending_head = (ctx->pending_head + 1U) % HWMON_MAX_PENDING;
+        ctx->pending_count--;
+    }
+
+    // 2. 一次系統呼叫送出整批；sysfs/tmpfs 讀取通常在送出時就已完成
+    if ((ctx->ring.to_submit > 0U) || (ctx->inflight > 0U)) {
+        int ret = uring_enter(&ctx->ring, 0U, IORING_ENTER_GETEVENTS);
+        ctx->syscalls++;
+        if ((ret < 0) && (errno != EAGAIN) && (errno != EBUSY) && (errno != EINTR)) {
+            perror("io_uring_enter");
+        }
+    }
+
+    // 3. 收割 CQE；已經逾時完成的通道只交還緩衝區
+    unsigned head = *ctx->ring.cq_head;
+    unsigned tail = __atomic_load_n(ctx->ring.cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &ctx->ring.cqes[head & *ctx->ring.cq_mask];
+        head++;
+        ctx->inflight--;
+        if (cqe->user_data != HWMON_CANCEL_TAG) {
+            uint32_t channel = (uint32_t)(cqe->user_data - 1U);
+            BMCReadRequest *req = ctx->channel_req[channel];
+            hwmon_inflight_remove(ctx, channel);
+            if (req != NULL) {
+                hwmon_complete_read(ctx, req, cqe->res, now_ns);
+                done++;
+            } else {
+                ctx->channel_busy[channel] = false;
+            }
+        }
+    }
+    __atomic_store_n(ctx->ring.cq_head, head, __ATOMIC_RELEASE);
+
+    // 4. 期限已過的在途讀取：立即以逾時完成，並要求核心取消 (下次 poll 送出)
+    for (uint32_t i = 0U; i < ctx->inflight_reads; i++) {
+        uint32_t channel = ctx->inflight_channels[i];
+        BMCReadRequest *req = ctx->channel_req[channel];
+        if ((req != NULL) && (now_ns >= req->deadline_ns)) {
+            struct io_uring_sqe *sqe = uring_get_sqe(&ctx->ring);
+            if (sqe == NULL) {
+                break;  // SQ 已滿，下次 poll 再取消，否則 cleanup 會一直等這個讀取
+            }
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = (uint64_t)channel + 1U;
+            sqe->user_data = HWMON_CANCEL_TAG;
+            ctx->inflight++;
+            ctx->channel_req[channel] = NULL;
+            bmc_request_complete(req, BMC_ERROR_TIMEOUT, 0, now_ns);
+            done++;
+        }
+    }
+
+    return done;
+}
+
+uint32_t hwmon_reader_poll(void *opaque, uint64_t now_ns) {
+    HwmonReaderCtx *ctx = (HwmonReaderCtx *)opaque;
+    return ctx->use_uring ? hwmon_poll_uring(ctx, now_ns) : hwmon_poll_pread(ctx, now_ns);
+}
+
+void hwmon_reader_cleanup(void *opaque) {
+    HwmonReaderCtx *ctx = (HwmonReaderCtx *)opaque;
+
+    if (ctx->use_uring) {
+        // 等待在途請求完成，避免核心寫入已釋放的緩衝區
+        while (ctx->inflight > 0U) {
+            (void)hwmon_poll_uring(ctx, bmc_now_ns());
+        }
+        uring_teardown(&ctx->ring);
+        ctx->use_uring = false;
+    }
+    for (uint32_t i = 0U; (ctx->fds != NULL) && (i < ctx->sensor_count); i++) {
+        if (ctx->fds[i] >= 0) {
+            close(ctx->fds[i]);
+        }
+    }
+    free(ctx->fds);
+    free(ctx->buffers);
+    free(ctx->channel_req);
+    free(ctx->channel_busy);
+    free(ctx->inflight_channels);
+    free(ctx->inflight_pos);
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+// 讀取所有感測器一次；reqs[i] 對應通道 i，結果留在每個請求中
+BMCStatus hwmon_reader_sweep(BMCComponentV2 *comp, BMCReadRequest *reqs,
+                             uint32_t count) {
+    BMCStatus status = BMC_OK;
+    uint32_t remaining = count;
+
+    for (uint32_t i = 0U; i < count; i++) {
+        reqs[i].channel = i;
+        reqs[i].on_complete = NULL;
+        if (bmc_component_submit(comp, &reqs[i]) != BMC_OK) {
+            status = BMC_ERROR_BUSY;
+            remaining--;
+        }
+    }
+    while (remaining > 0U) {
+        remaining -= bmc_component_poll(comp);
+    }
+
+    return status;
+}
+
+#ifndef HWMON_URING_READER_NO_MAIN
+
+// === 測試用的假 hwmon 目錄樹 ===
+// 結構與 /sys/class/hwmon 相同：<root>/hwmonN/tempM_input，數值單位為毫度
+#define FAKE_SENSORS_PER_CHIP   100U
+#define SWEEP_SENSOR_COUNT      10000U
+#define SWEEP_REPETITIONS       20U
+
+static int32_t fake_value_for(uint32_t index) {
+    return 25000 + (int32_t)((index * 37U) % 40000U);
+}
+
+static char **create_fake_hwmon_tree(const char *root, uint32_t count) {
+    char **paths = (char **)calloc(count, sizeof(char *));
+    char path[256];
+
+    if (paths == NULL) {
+        return NULL;
+    }
+    for (uint32_t i = 0U; i < count; i++) {
+        uint32_t chip = i / FAKE_SENSORS_PER_CHIP;
+        if ((i % FAKE_SENSORS_PER_CHIP) == 0U) {
+            snprintf(path, sizeof(path), "%s/hwmon%u", root, chip);
+            (void)mkdir(path, 0755);
+        }
+        snprintf(path, sizeof(path), "%s/hwmon%u/temp%u_input", root, chip,
+                 (i % FAKE_SENSORS_PER_CHIP) + 1U);
+        FILE *fp = fopen(path, "w");
+        if (fp != NULL) {
+            fprintf(fp, "%d\n", fake_value_for(i));
+            fclose(fp);
+        }
+        paths[i] = strdup(path);
+    }
+
+    return paths;
+}
+
+static void remove_fake_hwmon_tree(const char *root, char **paths, uint32_t count) {
+    char path[256];
+
+    for (uint32_t i = 0U; i < count; i++) {
+        (void)unlink(paths[i]);
+        free(paths[i]);
+    }
+    for (uint32_t chip = 0U; chip < ((count + FAKE_SENSORS_PER_CHIP - 1U) / FAKE_SENSORS_PER_CHIP); chip++) {
+        snprintf(path, sizeof(path), "%s/hwmon%u", root, chip);
+        (void)rmdir(path);
+    }
+    (void)rmdir(root);
+    free(paths);
+}
+
+// 舊作法：每次讀取都 open/read/close，等同於 temp_sensor_read() 的檔案版
+static int32_t naive_read_sensor(const char *path, uint64_t *syscalls) {
+    char buf[HWMON_VALUE_BUF_SIZE];
+    int32_t value = -1;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd >= 0) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n > 0) {
+            (void)hwmon_parse_value(buf, (int32_t)n, &value);
+        }
+        close(fd);
+        *syscalls += 3U;
+    }
+
+    return value;
+}
+
+static bool verify_sweep(const BMCReadRequest *reqs, uint32_t count) {
+    for (uint32_t i = 0U; i < count; i++) {
+        if ((reqs[i].status != BMC_OK) || (reqs[i].value != fake_value_for(i))) {
+            printf("  驗證失敗: 通道 %u 狀態 %d 數值 %d (預期 %d)\n",
+                   i, reqs[i].status, reqs[i].value, fake_value_for(i));
+            return false;
+        }
+    }
+    return true;
+}
+
+static void run_backend(const char *label, char **paths, uint32_t count,
+                        bool force_pread) {
+    static HwmonReaderCtx ctx;
+    static BMCReadRequest reqs[SWEEP_SENSOR_COUNT];
+
+    if (hwmon_reader_open(&ctx, (const char *const *)paths, count, force_pread) != BMC_OK) {
+        printf("%s: 開啟感測器檔案失敗\n", label);
+        hwmon_reader_cleanup(&ctx);
+        return;
+    }
+
+    BMCComponentV2 comp = {
+        .name = "hwmon",
+        .ctx = &ctx,
+        .timeout_us = 100000U,
+        .init = hwmon_reader_init,
+        .submit_read = hwmon_reader_submit,
+        .poll = hwmon_reader_poll,
+        .cleanup = hwmon_reader_cleanup
+    };
+    (void)comp.init(comp.ctx);
+
+    // 暖身並驗證數值正確
+    (void)hwmon_reader_sweep(&comp, reqs, count);
+    bool ok = verify_sweep(reqs, count);
+
+    ctx.syscalls = 0U;
+    uint64_t start = bmc_now_ns();
+    for (uint32_t r = 0U; r < SWEEP_REPETITIONS; r++) {
+        (void)hwmon_reader_sweep(&comp, reqs, count);
+    }
+    uint64_t elapsed = bmc_now_ns() - start;
+
+    printf("%-22s %10.2f ms/sweep  %8.1f syscalls/sweep  驗證:%s",
+           label,
+           ((double)elapsed / 1e6) / SWEEP_REPETITIONS,
+           (double)ctx.syscalls / SWEEP_REPETITIONS,
+           ok ? "通過" : "失敗");
+    if (ctx.use_uring) {
+        printf("  (fixed files:%s, fixed buffers:%s)",
+               ctx.fixed_files ? "是" : "否", ctx.fixed_buffers ? "是" : "否");
+    }
+    printf("\n");
+
+    comp.cleanup(comp.ctx);
+}
+
+// === 逾時與通道佔用檢查 ===
+// FIFO 有寫入端但永遠不寫，對 io_uring 而言就是一個卡住的感測器
+#define HANG_TIMEOUT_US         20000U
+#define HANG_POLL_LIMIT_NS      1000000000ULL
+
+static bool expect_status(const char *what, BMCStatus got, BMCStatus want) {
+    printf("  %-34s 狀態 %2d (預期 %2d) %s\n", what, got, want,
+           (got == want) ? "通過" : "失敗");
+    return got == want;
+}
+
+static bool run_pread_deadline_checks(char **paths) {
+    HwmonReaderCtx ctx;
+    BMCReadRequest reqs[2];
+    bool ok = true;
+
+    memset(reqs, 0, sizeof(reqs));
+    if (hwmon_reader_open(&ctx, (const char *const *)paths, 1U, true) != BMC_OK) {
+        hwmon_reader_cleanup(&ctx);
+        return false;
+    }
+    BMCComponentV2 comp = {
+        .name = "hwmon-pread",
+        .ctx = &ctx,
+        .timeout_us = 0U,    // 期限等於送出時間：輪到時一定已過期
+        .submit_read = hwmon_reader_submit,
+        .poll = hwmon_reader_poll,
+        .cleanup = hwmon_reader_cleanup
+    };
+    ok &= expect_status("pread: 第一個請求送出", bmc_component_submit(&comp, &reqs[0]), BMC_OK);
+    ok &= expect_status("pread: 同通道第二個請求", bmc_component_submit(&comp, &reqs[1]), BMC_ERROR_BUSY);
+    (void)bmc_component_poll(&comp);
+    ok &= expect_status("pread: 過期請求不讀取", reqs[0].status, BMC_ERROR_TIMEOUT);
+    ok &= expect_status("pread: 完成後通道可再送出", bmc_component_submit(&comp, &reqs[1]), BMC_OK);
+    (void)bmc_component_poll(&comp);
+    comp.cleanup(comp.ctx);
+
+    return ok;
+}
+
+static bool run_uring_deadline_checks(const char *root, char **paths) {
+    char fifo[256];
+    HwmonReaderCtx ctx;
+    BMCReadRequest reqs[3];
+    bool ok = true;
+
+    memset(&ctx, 0, sizeof(ctx));
+    snprintf(fifo, sizeof(fifo), "%s/hang_input", root);
+    if (mkfifo(fifo, 0600) != 0) {
+        perror("mkfifo");
+        return false;
+    }
+    int writer = open(fifo, O_RDWR | O_CLOEXEC);
+    const char *hang_paths[2] = { paths[0], fifo };
+    memset(reqs, 0, sizeof(reqs));
+
+    if ((writer < 0) || (hwmon_reader_open(&ctx, hang_paths, 2U, false) != BMC_OK)) {
+        printf("  開啟 FIFO 失敗\n");
+        ok = false;
+    } else if (!ctx.use_uring) {
+        printf("  核心不支援 io_uring，略過卡住感測器檢查\n");
+    } else {
+        BMCComponentV2 comp = {
+            .name = "hwmon-uring",
+            .ctx = &ctx,
+            .timeout_us = HANG_TIMEOUT_US,
+            .submit_read = hwmon_reader_submit,
+            .poll = hwmon_reader_poll,
+            .cleanup = hwmon_reader_cleanup
+        };
+        reqs[1].channel = 1U;
+        reqs[2].channel = 1U;
+        ok &= expect_status("io_uring: 正常感測器送出", bmc_component_submit(&comp, &reqs[0]), BMC_OK);
+        ok &= expect_status("io_uring: 卡住感測器送出", bmc_component_submit(&comp, &reqs[1]), BMC_OK);
+        ok &= expect_status("io_uring: 同通道第二個請求", bmc_component_submit(&comp, &reqs[2]), BMC_ERROR_BUSY);
+
+        uint32_t remaining = 2U;
+        uint64_t start = bmc_now_ns();
+        while ((remaining > 0U) && ((bmc_now_ns() - start) < HANG_POLL_LIMIT_NS)) {
+            remaining -= bmc_component_poll(&comp);
+        }
+        ok &= expect_status("io_uring: 正常感測器", reqs[0].status, BMC_OK);
+        ok &= expect_status("io_uring: 卡住感測器", reqs[1].status, BMC_ERROR_TIMEOUT);
+        uint64_t waited_us = (reqs[1].complete_ns - reqs[1].submit_ns) / 1000ULL;
+        bool on_time = reqs[1].completed && (waited_us >= HANG_TIMEOUT_US) &&
+                       (waited_us < (HANG_TIMEOUT_US * 10U));
+        printf("  %-34s %llu us (期限 %u us) %s\n", "io_uring: 逾時完成時間",
+               (unsigned long long)waited_us, HANG_TIMEOUT_US, on_time ? "通過" : "失敗");
+        ok &= on_time;
+        // cleanup 等取消的讀取回來才釋放緩衝區；取消失效時會卡在這裡
+        comp.cleanup(comp.ctx);
+    }
+    if (ctx.fds != NULL) {
+        hwmon_reader_cleanup(&ctx);
+    }
+    if (writer >= 0) {
+        close(writer);
+    }
+    (void)unlink(fifo);
+
+    return ok;
+}
+
+// 主程式
+int main(void) {
+    printf("=== OpenBMC hwmon 感測器批次讀取 (io_uring) ===\n");
+
+    // 一萬個檔案描述子可能超過預設軟上限，先提高到硬上限
+    struct rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0) {
+        lim.rlim_cur = lim.rlim_max;
+        (void)setrlimit(RLIMIT_NOFILE, &lim);
+    }
+
+    char root[] = "/tmp/hwmon_fake_XXXXXX";
+    if (mkdtemp(root) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    printf("建立 %u 個假 hwmon 感測器於 %s\n", SWEEP_SENSOR_COUNT, root);
+    char **paths = create_fake_hwmon_tree(root, SWEEP_SENSOR_COUNT);
+    if (paths == NULL) {
+        printf("記憶體分配失敗!\n");
+        return 1;
+    }
+
+    printf("\n=== 每次完整掃描 %u 個感測器 (平均 %u 次) ===\n",
+           SWEEP_SENSOR_COUNT, SWEEP_REPETITIONS);
+
+    uint64_t naive_syscalls = 0U;
+    uint64_t start = bmc_now_ns();
+    for (uint32_t r = 0U; r < SWEEP_REPETITIONS; r++) {
+        for (uint32_t i = 0U; i < SWEEP_SENSOR_COUNT; i++) {
+            (void)naive_read_sensor(paths[i], &naive_syscalls);
+        }
+    }
+    uint64_t elapsed = bmc_now_ns() - start;
+    printf("%-22s %10.2f ms/sweep  %8.1f syscalls/sweep\n", "open/read/close",
+           ((double)elapsed / 1e6) / SWEEP_REPETITIONS,
+           (double)naive_syscalls / SWEEP_REPETITIONS);
+
+    run_backend("pread (fd 保持開啟)", paths, SWEEP_SENSOR_COUNT, true);
+    run_backend("io_uring 批次", paths, SWEEP_SENSOR_COUNT, false);
+
+    printf("\n=== 讀取期限與通道佔用 ===\n");
+    bool deadline_ok = run_pread_deadline_checks(paths);
+    deadline_ok &= run_uring_deadline_checks(root, paths);
+    printf("結果: %s\n", deadline_ok ? "全部通過" : "有失敗");
+
+    remove_fake_hwmon_tree(root, paths, SWEEP_SENSOR_COUNT);
+
+    printf("\n=== 重點總結 ===\n");
+    printf("1. 檔案描述子與緩衝區在初始化時準備好，掃描時零分配\n");
+    printf("2. io_uring 以每批 %u 個讀取一次系統呼叫取代每感測器一次\n",
+           HWMON_RING_ENTRIES);
+    printf("3. 同一個 BMCComponentV2 介面，核心不支援時自動退回 pread\n");
+    printf("4. 卡住的讀取在期限到時以逾時完成並取消，不會拖住整個掃描\n");
+
+    return deadline_ok ? 0 : 1;
+}
+
+#endif  // HWMON_URING_READER_NO_MAIN
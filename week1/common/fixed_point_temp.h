@@ -0,0 +1,146 @@
+// fixed_point_temp.h - 毫度 (0.001°C) 定點溫度類型
+// 整數度太粗，float 在沒有快速 FPU 的 BMC SoC 上又慢，所以控制路徑統一使用
+// int32_t 毫度：±2,147,483°C 的範圍遠超過任何感測器，運算全部是整數指令。
+//
+// 規則：
+//   - 常數用 TEMP_MC_FROM_C() 在編譯期換算，例如 TEMP_MC_FROM_C(85U)
+//   - 加減乘一律使用 *_sat (飽和，不會溢位繞回) 或 *_checked (回報溢位)
+//   - float 只在邊界使用 (模擬器、顯示)，透過 temp_mc_from_float/temp_mc_to_float
+//   - 輸出：printf("溫度 " TEMP_MC_FMT "°C", TEMP_MC_ARGS(t))
+
+#ifndef FIXED_POINT_TEMP_H
+#define FIXED_POINT_TEMP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef int32_t TempMilliC;
+
+#define TEMP_MC_PER_C               1000
+#define TEMP_MC_MAX                 INT32_MAX
+#define TEMP_MC_MIN                 INT32_MIN
+
+// 編譯期常數換算；參數必須是不會溢位的整數度
+#define TEMP_MC_FROM_C(c)           ((TempMilliC)((int32_t)(c) * TEMP_MC_PER_C))
+
+// 顯示到 0.1°C；TEMP_MC_ARGS 會對參數求值多次，請傳入變數
+#define TEMP_MC_ABS(t)              (((t) < 0) ? (0U - (uint32_t)(t)) : (uint32_t)(t))
+#define TEMP_MC_FMT                 "%s%u.%u"
+#define TEMP_MC_ARGS(t)             (((t) < 0) ? "-" : ""), (TEMP_MC_ABS(t) / 1000U), \
+                                    ((TEMP_MC_ABS(t) % 1000U) / 100U)
+
+static inline TempMilliC temp_mc_saturate(int64_t value) {
+    TempMilliC result;
+
+    if (value > (int64_t)TEMP_MC_MAX) {
+        result = TEMP_MC_MAX;
+    } else if (value < (int64_t)TEMP_MC_MIN) {
+        result = TEMP_MC_MIN;
+    } else {
+        result = (TempMilliC)value;
+    }
+
+    return result;
+}
+
+// === 換算 ===
+static inline TempMilliC temp_mc_from_c(int32_t celsius) {
+    return temp_mc_saturate((int64_t)celsius * TEMP_MC_PER_C);
+}
+
+// 四捨五入到整數度 (遠離 0)
+static inline int32_t temp_mc_to_c(TempMilliC t) {
+    int64_t half = (t < 0) ? -(TEMP_MC_PER_C / 2) : (TEMP_MC_PER_C / 2);
+    return (int32_t)(((int64_t)t + half) / TEMP_MC_PER_C);
+}
+
+// NaN 視為 0；超出範圍時飽和
+static inline TempMilliC temp_mc_from_float(float celsius) {
+    TempMilliC result = 0;
+    float milli = celsius * (float)TEMP_MC_PER_C;
+
+    if (milli >= 2147483520.0f) {           // 小於 INT32_MAX 的最大 float
+        result = TEMP_MC_MAX;
+    } else if (milli <= -2147483648.0f) {
+        result = TEMP_MC_MIN;
+    } else if (milli == milli) {
+        result = (TempMilliC)((milli < 0.0f) ? (milli - 0.5f) : (milli + 0.5f));
+    }
+
+    return result;
+}
+
+static inline float temp_mc_to_float(TempMilliC t) {
+    return (float)t / (float)TEMP_MC_PER_C;
+}
+
+// === 飽和運算 ===
+static inline TempMilliC temp_mc_add_sat(TempMilliC a, TempMilliC b) {
+    return temp_mc_saturate((int64_t)a + (int64_t)b);
+}
+
+static inline TempMilliC temp_mc_sub_sat(TempMilliC a, TempMilliC b) {
+    return temp_mc_saturate((int64_t)a - (int64_t)b);
+}
+
+// 定點 x 定點 (兩者都是毫單位)，結果四捨五入
+static inline TempMilliC temp_mc_mul_sat(TempMilliC a, TempMilliC b) {
+    int64_t product = (int64_t)a * (int64_t)b;
+    int64_t half = (product < 0) ? -(TEMP_MC_PER_C / 2) : (TEMP_MC_PER_C / 2);
+    return temp_mc_saturate((product + half) / TEMP_MC_PER_C);
+}
+
+// t * num / den (整數比例，例如風扇斜率)；den 為 0 時依 t 的符號飽和
+static inline TempMilliC temp_mc_scale_sat(TempMilliC t, int32_t num, int32_t den) {
+    TempMilliC result;
+
+    if (den == 0) {
+        result = (t == 0) ? 0 : ((t > 0) ? TEMP_MC_MAX : TEMP_MC_MIN);
+    } else {
+        result = temp_mc_saturate(((int64_t)t * num) / den);
+    }
+
+    return result;
+}
+
+// 指數移動平均，alpha = 1 / 2^shift：avg + (sample - avg) / 2^shift
+// 濾波用 2 的冪次係數，避免在依賴鏈上做一般乘除法
+static inline TempMilliC temp_mc_ema(TempMilliC avg, TempMilliC sample, uint32_t shift) {
+    int64_t diff = (int64_t)sample - (int64_t)avg;
+    return temp_mc_saturate((int64_t)avg + (diff / ((int64_t)1 << shift)));
+}
+
+// === 溢位檢查版本：回傳 false 表示溢位，*out 不變 ===
+static inline bool temp_mc_add_checked(TempMilliC a, TempMilliC b, TempMilliC *out) {
+    TempMilliC sum;
+    bool ok = !__builtin_add_overflow(a, b, &sum);
+
+    if (ok) {
+        *out = sum;
+    }
+    return ok;
+}
+
+static inline bool temp_mc_sub_checked(TempMilliC a, TempMilliC b, TempMilliC *out) {
+    TempMilliC diff;
+    bool ok = !__builtin_sub_overflow(a, b, &diff);
+
+    if (ok) {
+        *out = diff;
+    }
+    return ok;
+}
+
+static inline bool temp_mc_mul_checked(TempMilliC a, TempMilliC b, TempMilliC *out) {
+    int64_t product = (int64_t)a * (int64_t)b;
+    int64_t half = (product < 0) ? -(TEMP_MC_PER_C / 2) : (TEMP_MC_PER_C / 2);
+    int64_t scaled = (product + half) / TEMP_MC_PER_C;
+    bool ok = (scaled <= (int64_t)TEMP_MC_MAX) && (scaled >= (int64_t)TEMP_MC_MIN);
+
+    if (ok) {
+        *out = (TempMilliC)scaled;
+    }
+    return ok;
+}
+
+#endif  // FIXED_POINT_TEMP_H
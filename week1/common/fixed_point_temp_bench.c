@@ -0,0 +1,183 @@
+// fixed_point_temp_bench.c - 控制路徑：毫度定點 vs float
+// 同一串 hwmon 原始讀值 (sysfs 本來就以毫度回報) 走完整的控制路徑：
+//   原始值 -> 溫度 -> 指數移動平均濾波 -> calculate_fan_speed() -> get_temperature_event()
+// 定點版本直接使用專案中的函數；float 版本是改成定點之前的寫法。
+// 注意：x86 有硬體 FPU，兩者差距不大；BMC SoC (例如沒有 VFP 或使用軟體浮點的 ARM)
+// 上 float 每次運算都是函式庫呼叫，請以 -mfloat-abi=soft 交叉編譯後在目標板上比較。
+
+#define _GNU_SOURCE
+#define MISRA_C_BASICS_NO_MAIN
+#include "../misra/misra_c_basics.c"
+#define SM_QUIET
+#define FAN_CONTROL_NO_MAIN
+#include "../state-machine/fan_control_state_machine.c"
+
+#define BENCH_SAMPLES       4000000U
+#define BENCH_ROUNDS        5U
+#define EMA_SHIFT           2U          // alpha = 1/4
+#define EMA_ALPHA_MC        250         // 0.25 (定點，毫單位)
+#define EMA_ALPHA_F         0.25f
+
+// === float 版本 (對照組) ===
+static uint16_t calculate_fan_speed_float(float temperature) {
+    uint16_t fan_speed;
+
+    if (temperature < (float)TEMPERATURE_WARNING_THRESHOLD_C) {
+        fan_speed = FAN_SPEED_MIN_RPM;
+    } else if (temperature >= (float)TEMPERATURE_CRITICAL_THRESHOLD_C) {
+        fan_speed = FAN_SPEED_MAX_RPM;
+    } else {
+        float temp_range = (float)(TEMPERATURE_CRITICAL_THRESHOLD_C - TEMPERATURE_WARNING_THRESHOLD_C);
+        float speed_range = (float)(FAN_SPEED_MAX_RPM - FAN_SPEED_MIN_RPM);
+        float temp_offset = temperature - (float)TEMPERATURE_WARNING_THRESHOLD_C;
+        fan_speed = (uint16_t)(FAN_SPEED_MIN_RPM + ((temp_offset * speed_range) / temp_range));
+    }
+
+    return fan_speed;
+}
+
+static SystemEvent get_temperature_event_float(float temperature) {
+    SystemEvent event;
+
+    if (temperature >= (float)MAX_TEMPERATURE_SHUTDOWN_C) {
+        event = EVENT_TEMP_EXTREME;
+    } else if (temperature >= (float)MAX_TEMPERATURE_CRITICAL_C) {
+        event = EVENT_TEMP_CRITICAL;
+    } else if (temperature >= (float)MAX_TEMPERATURE_WARNING_C) {
+        event = EVENT_TEMP_WARNING;
+    } else {
+        event = EVENT_TEMP_NORMAL;
+    }
+
+    return event;
+}
+
+// === 測試資料：模擬 hwmon 讀值 (毫度) ===
+static int32_t raw_samples[BENCH_SAMPLES];
+
+static void build_samples(void) {
+    uint32_t rng = 0xFEEDBEEFU;
+    int32_t t = 60000;
+
+    for (uint32_t i = 0U; i < BENCH_SAMPLES; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        // 隨機漫步，範圍 40-99°C，跨越所有閾值
+        t += (int32_t)(rng % 2001U) - 1000;
+        if (t < 40000) {
+            t = 40000;
+        } else if (t > 99000) {
+            t = 99000;
+        }
+        raw_samples[i] = t;
+    }
+}
+
+typedef struct {
+    uint64_t fan_sum;
+    uint32_t event_counts[EVENT_COUNT];
+} PathResult;
+
+// 一般定點乘法：filtered += alpha * (sample - filtered)
+static void run_fixed_mul(PathResult *out) {
+    TempMilliC filtered = raw_samples[0];
+
+    for (uint32_t i = 0U; i < BENCH_SAMPLES; i++) {
+        TempMilliC sample = (TempMilliC)raw_samples[i];
+        filtered = temp_mc_add_sat(filtered,
+                                   temp_mc_mul_sat(temp_mc_sub_sat(sample, filtered), EMA_ALPHA_MC));
+        out->fan_sum += calculate_fan_speed(filtered);
+        out->event_counts[get_temperature_event(filtered)]++;
+    }
+}
+
+// 2 的冪次係數：temp_mc_ema()
+static void run_fixed(PathResult *out) {
+    TempMilliC filtered = raw_samples[0];
+
+    for (uint32_t i = 0U; i < BENCH_SAMPLES; i++) {
+        filtered = temp_mc_ema(filtered, (TempMilliC)raw_samples[i], EMA_SHIFT);
+        out->fan_sum += calculate_fan_speed(filtered);
+        out->event_counts[get_temperature_event(filtered)]++;
+    }
+}
+
+static void run_float(PathResult *out) {
+    float filtered = (float)raw_samples[0] / 1000.0f;
+
+    for (uint32_t i = 0U; i < BENCH_SAMPLES; i++) {
+        float sample = (float)raw_samples[i] / 1000.0f;
+        filtered += EMA_ALPHA_F * (sample - filtered);
+        out->fan_sum += calculate_fan_speed_float(filtered);
+        out->event_counts[get_temperature_event_float(filtered)]++;
+    }
+}
+
+static double time_path(void (*path)(PathResult *), PathResult *result) {
+    double best = 1e30;
+
+    for (uint32_t round = 0U; round < BENCH_ROUNDS; round++) {
+        memset(result, 0, sizeof(*result));
+        uint64_t start = sm_stats_now_ns();
+        path(result);
+        uint64_t elapsed = sm_stats_now_ns() - start;
+        double per_sample = (double)elapsed / BENCH_SAMPLES;
+        if (per_sample < best) {
+            best = per_sample;
+        }
+    }
+
+    return best;
+}
+
+// === 飽和與溢位檢查的邊界 ===
+static bool check_saturation(void) {
+    TempMilliC out = 0;
+    bool ok = true;
+
+    ok = ok && (temp_mc_add_sat(TEMP_MC_MAX, 1) == TEMP_MC_MAX);
+    ok = ok && (temp_mc_sub_sat(TEMP_MC_MIN, 1) == TEMP_MC_MIN);
+    ok = ok && (temp_mc_mul_sat(TEMP_MC_FROM_C(100000), TEMP_MC_FROM_C(100000)) == TEMP_MC_MAX);
+    ok = ok && (temp_mc_mul_sat(TEMP_MC_FROM_C(-100000), TEMP_MC_FROM_C(100000)) == TEMP_MC_MIN);
+    ok = ok && (temp_mc_mul_sat(85500, 250) == 21375);
+    ok = ok && !temp_mc_add_checked(TEMP_MC_MAX, 1, &out);
+    ok = ok && temp_mc_add_checked(84999, 1, &out) && (out == TEMP_MC_FROM_C(85));
+    ok = ok && !temp_mc_mul_checked(TEMP_MC_MAX, TEMP_MC_FROM_C(2), &out);
+    ok = ok && (temp_mc_from_float(1e12f) == TEMP_MC_MAX);
+    ok = ok && (temp_mc_from_float(-42.5f) == -42500);
+    ok = ok && (temp_mc_to_c(84500) == 85) && (temp_mc_to_c(-84500) == -85);
+
+    return ok;
+}
+
+int main(void) {
+    PathResult fixed_result;
+    PathResult float_result;
+
+    printf("=== 控制路徑：毫度定點 vs float (%u 樣本 x %u 輪，取最快) ===\n",
+           BENCH_SAMPLES, BENCH_ROUNDS);
+    printf("飽和/溢位邊界檢查: %s\n", check_saturation() ? "通過" : "失敗!");
+
+    build_samples();
+    PathResult mul_result;
+    double mul_ns = time_path(run_fixed_mul, &mul_result);
+    double fixed_ns = time_path(run_fixed, &fixed_result);
+    double float_ns = time_path(run_float, &float_result);
+
+    printf("\n定點 temp_mc_ema (alpha=1/4): %6.2f ns/sample\n", fixed_ns);
+    printf("定點 temp_mc_mul_sat:        %6.2f ns/sample\n", mul_ns);
+    printf("float:                       %6.2f ns/sample\n", float_ns);
+    printf("比例 float/定點 (ema):       %6.2fx\n", float_ns / fixed_ns);
+
+    printf("\n結果比對 (濾波後捨入方式不同，允許極少數邊界差異):\n");
+    printf("  平均風扇轉速: 定點 %.2f RPM, float %.2f RPM\n",
+           (double)fixed_result.fan_sum / BENCH_SAMPLES,
+           (double)float_result.fan_sum / BENCH_SAMPLES);
+    for (uint32_t e = 0U; e < EVENT_TEMP_EXTREME + 1U; e++) {
+        printf("  事件 %u: 定點 %8u, float %8u\n", e,
+               fixed_result.event_counts[e], float_result.event_counts[e]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,262 @@
+// json_writer.h - 串流 JSON 寫入器 (不配置記憶體)
+// 寫入呼叫端提供的緩衝區；空間不足時設定 overflow 並忽略後續寫入，不會寫出界。
+// 大型輸出可以分段：
+//   1. json_writer_mark() 記下位置，寫一個完整的元素
+//   2. overflow 時 json_writer_rollback() 退回，把目前緩衝區送出
+//   3. json_writer_attach() 換上 (或清空) 緩衝區後繼續，巢狀層級與逗號狀態保留
+// 整數以每次兩位數的查表轉換，毫度溫度直接輸出成三位小數，不經過 printf 或 float。
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define JSON_MAX_DEPTH              32U
+
+typedef struct {
+    char *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;
+    bool after_key;                 // 下一個值緊接在 key 之後，不加逗號
+    uint32_t depth;
+    uint32_t need_comma;            // 每一層一個位元：該層已經有元素
+} JsonWriter;
+
+typedef struct {
+    size_t len;
+    bool after_key;
+    uint32_t depth;
+    uint32_t need_comma;
+} JsonMark;
+
+static const char json_digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static inline void json_writer_init(JsonWriter *w, char *buf, size_t cap) {
+    memset(w, 0, sizeof(*w));
+    w->buf = buf;
+    w->cap = cap;
+}
+
+// 換上新的 (或剛送出的) 緩衝區；巢狀狀態不變
+static inline void json_writer_attach(JsonWriter *w, char *buf, size_t cap) {
+    w->buf = buf;
+    w->cap = cap;
+    w->len = 0U;
+    w->overflow = false;
+}
+
+static inline JsonMark json_writer_mark(const JsonWriter *w) {
+    JsonMark mark = { w->len, w->after_key, w->depth, w->need_comma };
+    return mark;
+}
+
+static inline void json_writer_rollback(JsonWriter *w, JsonMark mark) {
+    w->len = mark.len;
+    w->after_key = mark.after_key;
+    w->depth = mark.depth;
+    w->need_comma = mark.need_comma;
+    w->overflow = false;
+}
+
+static inline void json_put(JsonWriter *w, const char *data, size_t n) {
+    if (!w->overflow) {
+        if (n > (w->cap - w->len)) {
+            w->overflow = true;
+        } else {
+            memcpy(&w->buf[w->len], data, n);
+            w->len += n;
+        }
+    }
+}
+
+static inline void json_put_char(JsonWriter *w, char c) {
+    if (!w->overflow) {
+        if (w->len >= w->cap) {
+            w->overflow = true;
+        } else {
+            w->buf[w->len++] = c;
+        }
+    }
+}
+
+#define json_put_literal(w, lit)    json_put((w), (lit), sizeof(lit) - 1U)
+
+// 值或 key 之前：同一層的第二個元素起加逗號
+static inline void json_prefix(JsonWriter *w) {
+    uint32_t bit = 1U << w->depth;
+
+    if (w->after_key) {
+        w->after_key = false;
+    } else {
+        if ((w->need_comma & bit) != 0U) {
+            json_put_char(w, ',');
+        }
+        w->need_comma |= bit;
+    }
+}
+
+// === 數字 ===
+// 由後往前每次轉兩位數；回傳寫入的字元數 (最多 20)
+static inline size_t json_format_u64(uint64_t value, char out[20]) {
+    char tmp[20];
+    size_t pos = sizeof(tmp);
+
+    while (value >= 100U) {
+        uint32_t pair = (uint32_t)(value % 100U) * 2U;
+        value /= 100U;
+        tmp[--pos] = json_digit_pairs[pair + 1U];
+        tmp[--pos] = json_digit_pairs[pair];
+    }
+    if (value >= 10U) {
+        uint32_t pair = (uint32_t)value * 2U;
+        tmp[--pos] = json_digit_pairs[pair + 1U];
+        tmp[--pos] = json_digit_pairs[pair];
+    } else {
+        tmp[--pos] = (char)('0' + value);
+    }
+    memcpy(out, &tmp[pos], sizeof(tmp) - pos);
+
+    return sizeof(tmp) - pos;
+}
+
+static inline void json_put_u64(JsonWriter *w, uint64_t value) {
+    char digits[20];
+    json_put(w, digits, json_format_u64(value, digits));
+}
+
+static inline void json_uint(JsonWriter *w, uint64_t value) {
+    json_prefix(w);
+    json_put_u64(w, value);
+}
+
+static inline void json_int(JsonWriter *w, int64_t value) {
+    json_prefix(w);
+    if (value < 0) {
+        json_put_char(w, '-');
+        json_put_u64(w, 0U - (uint64_t)value);
+    } else {
+        json_put_u64(w, (uint64_t)value);
+    }
+}
+
+// 千分之一單位的定點數 (例如毫度) 輸出成固定三位小數：85125 -> 85.125
+static inline void json_milli(JsonWriter *w, int32_t milli) {
+    uint32_t abs_value = (milli < 0) ? (0U - (uint32_t)milli) : (uint32_t)milli;
+    uint32_t frac = abs_value % 1000U;
+    char text[4];
+
+    json_prefix(w);
+    if (milli < 0) {
+        json_put_char(w, '-');
+    }
+    json_put_u64(w, abs_value / 1000U);
+    text[0] = '.';
+    text[1] = (char)('0' + (frac / 100U));
+    text[2] = json_digit_pairs[((frac % 100U) * 2U)];
+    text[3] = json_digit_pairs[((frac % 100U) * 2U) + 1U];
+    json_put(w, text, sizeof(text));
+}
+
+static inline void json_bool(JsonWriter *w, bool value) {
+    json_prefix(w);
+    if (value) {
+        json_put_literal(w, "true");
+    } else {
+        json_put_literal(w, "false");
+    }
+}
+
+// === 字串 ===
+static inline void json_put_escaped(JsonWriter *w, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+    const char *run = s;
+
+    // 連續不需跳脫的字元一次複製
+    for (; *s != '\0'; s++) {
+        unsigned char c = (unsigned char)*s;
+        if ((c >= 0x20U) && (c != (unsigned char)'"') && (c != (unsigned char)'\\')) {
+            continue;
+        }
+        json_put(w, run, (size_t)(s - run));
+        if ((c == (unsigned char)'"') || (c == (unsigned char)'\\')) {
+            char esc[2] = { '\\', (char)c };
+            json_put(w, esc, sizeof(esc));
+        } else {
+            char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0FU] };
+            json_put(w, esc, sizeof(esc));
+        }
+        run = s + 1;
+    }
+    json_put(w, run, (size_t)(s - run));
+}
+
+static inline void json_string(JsonWriter *w, const char *s) {
+    json_prefix(w);
+    json_put_char(w, '"');
+    json_put_escaped(w, s);
+    json_put_char(w, '"');
+}
+
+// "前綴 + 整數" 形式的字串，例如 "/redfish/v1/.../ThermalZones/12"；前綴不做跳脫
+static inline void json_string_uint(JsonWriter *w, const char *prefix, uint64_t value) {
+    json_prefix(w);
+    json_put_char(w, '"');
+    json_put(w, prefix, strlen(prefix));
+    json_put_u64(w, value);
+    json_put_char(w, '"');
+}
+
+// key 是程式中的常數字串，不做跳脫
+static inline void json_key(JsonWriter *w, const char *key) {
+    json_prefix(w);
+    json_put_char(w, '"');
+    json_put(w, key, strlen(key));
+    json_put_literal(w, "\":");
+    w->after_key = true;
+}
+
+// === 容器 ===
+static inline void json_begin_object(JsonWriter *w) {
+    json_prefix(w);
+    json_put_char(w, '{');
+    if (w->depth + 1U < JSON_MAX_DEPTH) {
+        w->depth++;
+        w->need_comma &= ~(1U << w->depth);
+    } else {
+        w->overflow = true;
+    }
+}
+
+static inline void json_end_object(JsonWriter *w) {
+    json_put_char(w, '}');
+    if (w->depth > 0U) {
+        w->depth--;
+    }
+}
+
+static inline void json_begin_array(JsonWriter *w) {
+    json_prefix(w);
+    json_put_char(w, '[');
+    if (w->depth + 1U < JSON_MAX_DEPTH) {
+        w->depth++;
+        w->need_comma &= ~(1U << w->depth);
+    } else {
+        w->overflow = true;
+    }
+}
+
+static inline void json_end_array(JsonWriter *w) {
+    json_put_char(w, ']');
+    if (w->depth > 0U) {
+        w->depth--;
+    }
+}
+
+#endif  // JSON_WRITER_H
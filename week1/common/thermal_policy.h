@@ -0,0 +1,445 @@
+// thermal_policy.h - 可熱重載的溫控政策 (閾值與風扇轉速)
+// 原本閾值與風扇轉速都是編譯期巨集，改政策就要重新編譯、重新啟動。
+// 這裡把它們收進不可變的 ThermalPolicy 物件，從文字檔載入，以 RCU 的方式發布：
+//   - 讀取端：thermal_policy_get() 只是一次 acquire 載入，不上鎖
+//   - 寫入端：建立新物件 -> 原子指標交換 -> 舊物件延後回收
+// 回收採 QSBR (靜止狀態)：讀取執行緒先登記，並在不持有政策指標的地方
+// (例如每輪控制迴圈結束) 呼叫 thermal_policy_quiescent()；所有登記的讀取者
+// 都經過交換後的靜止點，舊物件才會被 free。
+//
+// 規則：會與重載同時執行的讀取執行緒必須登記，且不可跨越靜止點保留指標。
+// 從未重載的程式 (或在同一執行緒中重載) 不需要登記；登記的讀取者自己重載時，
+// 要先呼叫 thermal_policy_quiescent()，否則被取代的政策等不到它而無法回收。
+// 下列巨集保留為編譯期預設值 (thermal_policy_defaults) 與報表用途。
+// 狀態以每個程式一份 (static)：week1 的程式都是單一編譯單元。
+
+#ifndef THERMAL_POLICY_H
+#define THERMAL_POLICY_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#include "fixed_point_temp.h"
+
+// === 編譯期預設值 ===
+// 狀態機事件閾值 (get_temperature_event)，整數度
+#define MAX_TEMPERATURE_NORMAL_C    50U
+#define MAX_TEMPERATURE_WARNING_C   70U
+#define MAX_TEMPERATURE_CRITICAL_C  85U
+#define MAX_TEMPERATURE_SHUTDOWN_C  95U
+
+// 各狀態的風扇轉速 (百分比)
+#define FAN_SPEED_OFF_PERCENT       0U
+#define FAN_SPEED_LOW_PERCENT       30U
+#define FAN_SPEED_MEDIUM_PERCENT    60U
+#define FAN_SPEED_HIGH_PERCENT      85U
+#define FAN_SPEED_MAX_PERCENT       100U
+
+// 轉速插值 (calculate_fan_speed)
+#define TEMPERATURE_WARNING_THRESHOLD_C  75U
+#define TEMPERATURE_CRITICAL_THRESHOLD_C 85U
+#define FAN_SPEED_MIN_RPM               1000U
+#define FAN_SPEED_MAX_RPM               5000U
+
+#define THERMAL_POLICY_MAX_READERS  64U
+#define THERMAL_POLICY_MAX_RETIRED  16U
+#define THERMAL_POLICY_PUBLISH_RETRIES 64U  // 待回收清單滿時放開寫入鎖重試的次數
+#define THERMAL_POLICY_BUSY         (-2)    // 有讀取者遲遲不經過靜止點，這次不發布
+#define THERMAL_POLICY_FILE_MAX     4096U
+
+// === 政策物件 (發布後不可修改) ===
+typedef struct {
+    uint64_t generation;            // 發布序號，預設值為 0
+    TempMilliC max_temperature_normal;
+    TempMilliC max_temperature_warning;
+    TempMilliC max_temperature_critical;
+    TempMilliC max_temperature_shutdown;
+    TempMilliC warning_threshold;
+    TempMilliC critical_threshold;
+    uint8_t fan_speed_off_percent;
+    uint8_t fan_speed_low_percent;
+    uint8_t fan_speed_medium_percent;
+    uint8_t fan_speed_high_percent;
+    uint8_t fan_speed_max_percent;
+    uint16_t fan_speed_min_rpm;
+    uint16_t fan_speed_max_rpm;
+} ThermalPolicy;
+
+static const ThermalPolicy thermal_policy_defaults = {
+    .generation = 0U,
+    .max_temperature_normal = TEMP_MC_FROM_C(MAX_TEMPERATURE_NORMAL_C),
+    .max_temperature_warning = TEMP_MC_FROM_C(MAX_TEMPERATURE_WARNING_C),
+    .max_temperature_critical = TEMP_MC_FROM_C(MAX_TEMPERATURE_CRITICAL_C),
+    .max_temperature_shutdown = TEMP_MC_FROM_C(MAX_TEMPERATURE_SHUTDOWN_C),
+    .warning_threshold = TEMP_MC_FROM_C(TEMPERATURE_WARNING_THRESHOLD_C),
+    .critical_threshold = TEMP_MC_FROM_C(TEMPERATURE_CRITICAL_THRESHOLD_C),
+    .fan_speed_off_percent = FAN_SPEED_OFF_PERCENT,
+    .fan_speed_low_percent = FAN_SPEED_LOW_PERCENT,
+    .fan_speed_medium_percent = FAN_SPEED_MEDIUM_PERCENT,
+    .fan_speed_high_percent = FAN_SPEED_HIGH_PERCENT,
+    .fan_speed_max_percent = FAN_SPEED_MAX_PERCENT,
+    .fan_speed_min_rpm = FAN_SPEED_MIN_RPM,
+    .fan_speed_max_rpm = FAN_SPEED_MAX_RPM
+};
+
+// === 讀取端 ===
+typedef struct {
+    _Atomic uint64_t seen_epoch;    // 最近一次靜止點看到的 epoch
+    _Atomic uint32_t online;        // 1 表示登記中
+} __attribute__((aligned(64))) ThermalPolicyReader;
+
+static _Atomic(const ThermalPolicy *) thermal_policy_current = &thermal_policy_defaults;
+static _Atomic uint64_t thermal_policy_epoch = 1U;
+static ThermalPolicyReader thermal_policy_readers[THERMAL_POLICY_MAX_READERS];
+
+static inline const ThermalPolicy *thermal_policy_get(void) {
+    return atomic_load_explicit(&thermal_policy_current, memory_order_acquire);
+}
+
+// 登記目前執行緒為讀取者；名額用完時回傳 NULL。
+// 先搶到名額才寫 seen_epoch：寫到別人的名額會把他的靜止點往前推，回收掉他還在用的政策。
+// 搶到後到寫入前，名額上是前一個使用者留下的較舊 epoch，只會讓回收延後
+static inline ThermalPolicyReader *thermal_policy_reader_register(void) {
+    ThermalPolicyReader *result = NULL;
+
+    for (uint32_t i = 0U; (i < THERMAL_POLICY_MAX_READERS) && (result == NULL); i++) {
+        uint32_t expected = 0U;
+        ThermalPolicyReader *r = &thermal_policy_readers[i];
+        if (atomic_compare_exchange_strong(&r->online, &expected, 1U)) {
+            atomic_store(&r->seen_epoch, atomic_load(&thermal_policy_epoch));
+            result = r;
+        }
+    }
+
+    return result;
+}
+
+static inline void thermal_policy_reader_unregister(ThermalPolicyReader *reader) {
+    atomic_store(&reader->online, 0U);
+}
+
+// 靜止點：呼叫者保證此後不再使用之前取得的政策指標。
+// release 讓先前對舊物件的讀取都排在宣告之前
+static inline void thermal_policy_quiescent(ThermalPolicyReader *reader) {
+    uint64_t epoch = atomic_load_explicit(&thermal_policy_epoch, memory_order_acquire);
+    atomic_store_explicit(&reader->seen_epoch, epoch, memory_order_release);
+}
+
+// === 寫入端 ===
+typedef struct {
+    const ThermalPolicy *policy;
+    uint64_t epoch;                 // 所有讀取者的 seen_epoch 都 >= epoch 時才可回收
+} ThermalPolicyRetired;
+
+static atomic_flag thermal_policy_writer_lock = ATOMIC_FLAG_INIT;
+static ThermalPolicyRetired thermal_policy_retired[THERMAL_POLICY_MAX_RETIRED];
+static uint32_t thermal_policy_retired_count;
+static uint64_t thermal_policy_generation;
+static uint64_t thermal_policy_reclaimed;
+
+static inline void thermal_policy_free(const ThermalPolicy *policy) {
+#ifdef THERMAL_POLICY_POISON
+    // 壓力測試用：回收前填入垃圾值，讀到已回收物件會被偵測到
+    memset((void *)policy, 0xA5, sizeof(*policy));
+#endif
+    free((void *)policy);
+}
+
+// 回收所有讀取者都已經過靜止點的舊物件；呼叫者需持有寫入鎖。回傳尚待回收的數量
+static inline uint32_t thermal_policy_reclaim_locked(void) {
+    uint64_t min_seen = UINT64_MAX;
+    uint32_t kept = 0U;
+
+    for (uint32_t i = 0U; i < THERMAL_POLICY_MAX_READERS; i++) {
+        ThermalPolicyReader *r = &thermal_policy_readers[i];
+        if (atomic_load(&r->online) != 0U) {
+            uint64_t seen = atomic_load_explicit(&r->seen_epoch, memory_order_acquire);
+            if (seen < min_seen) {
+                min_seen = seen;
+            }
+        }
+    }
+
+    for (uint32_t i = 0U; i < thermal_policy_retired_count; i++) {
+        if (thermal_policy_retired[i].epoch <= min_seen) {
+            thermal_policy_free(thermal_policy_retired[i].policy);
+            thermal_policy_reclaimed++;
+        } else {
+            thermal_policy_retired[kept++] = thermal_policy_retired[i];
+        }
+    }
+    thermal_policy_retired_count = kept;
+
+    return kept;
+}
+
+static inline void thermal_policy_writer_acquire(void) {
+    while (atomic_flag_test_and_set_explicit(&thermal_policy_writer_lock, memory_order_acquire)) {
+        sched_yield();
+    }
+}
+
+static inline void thermal_policy_writer_release(void) {
+    atomic_flag_clear_explicit(&thermal_policy_writer_lock, memory_order_release);
+}
+
+static inline uint32_t thermal_policy_reclaim(void) {
+    thermal_policy_writer_acquire();
+    uint32_t pending = thermal_policy_reclaim_locked();
+    thermal_policy_writer_release();
+    return pending;
+}
+
+// 發布 next (以 malloc 配置，擁有權交給這裡)；舊物件放進待回收清單。
+// 待回收清單滿時不持鎖等待：放開寫入鎖、讓出 CPU 後重試，有限次數內仍然滿
+// (某個讀取者一直沒經過靜止點，例如重載的執行緒自己就是登記的讀取者) 時
+// 釋放 next、保留目前政策並回傳 THERMAL_POLICY_BUSY
+static inline int thermal_policy_publish(ThermalPolicy *next) {
+    int result = THERMAL_POLICY_BUSY;
+
+    for (uint32_t attempt = 0U; (attempt < THERMAL_POLICY_PUBLISH_RETRIES) && (result != 0); attempt++) {
+        if (attempt > 0U) {
+            sched_yield();
+        }
+        thermal_policy_writer_acquire();
+        if (thermal_policy_reclaim_locked() < THERMAL_POLICY_MAX_RETIRED) {
+            next->generation = ++thermal_policy_generation;
+            const ThermalPolicy *old = atomic_exchange(&thermal_policy_current, (const ThermalPolicy *)next);
+            uint64_t epoch = atomic_fetch_add(&thermal_policy_epoch, 1U) + 1U;
+
+            if (old != &thermal_policy_defaults) {
+                thermal_policy_retired[thermal_policy_retired_count].policy = old;
+                thermal_policy_retired[thermal_policy_retired_count].epoch = epoch;
+                thermal_policy_retired_count++;
+            }
+            (void)thermal_policy_reclaim_locked();
+            result = 0;
+        }
+        thermal_policy_writer_release();
+    }
+    if (result != 0) {
+        free(next);
+    }
+
+    return result;
+}
+
+// === 檔案格式 ===
+// 每行 "key = value"，# 之後為註解；未列出的 key 沿用編譯期預設值。
+// 溫度以 °C 表示，可有最多三位小數 (例如 72.5)
+typedef enum {
+    POLICY_FIELD_TEMP,
+    POLICY_FIELD_PERCENT,
+    POLICY_FIELD_RPM
+} ThermalPolicyFieldKind;
+
+typedef struct {
+    const char *key;
+    size_t offset;
+    ThermalPolicyFieldKind kind;
+} ThermalPolicyField;
+
+static const ThermalPolicyField thermal_policy_fields[] = {
+    { "max_temperature_normal_c", offsetof(ThermalPolicy, max_temperature_normal), POLICY_FIELD_TEMP },
+    { "max_temperature_warning_c", offsetof(ThermalPolicy, max_temperature_warning), POLICY_FIELD_TEMP },
+    { "max_temperature_critical_c", offsetof(ThermalPolicy, max_temperature_critical), POLICY_FIELD_TEMP },
+    { "max_temperature_shutdown_c", offsetof(ThermalPolicy, max_temperature_shutdown), POLICY_FIELD_TEMP },
+    { "temperature_warning_threshold_c", offsetof(ThermalPolicy, warning_threshold), POLICY_FIELD_TEMP },
+    { "temperature_critical_threshold_c", offsetof(ThermalPolicy, critical_threshold), POLICY_FIELD_TEMP },
+    { "fan_speed_off_percent", offsetof(ThermalPolicy, fan_speed_off_percent), POLICY_FIELD_PERCENT },
+    { "fan_speed_low_percent", offsetof(ThermalPolicy, fan_speed_low_percent), POLICY_FIELD_PERCENT },
+    { "fan_speed_medium_percent", offsetof(ThermalPolicy, fan_speed_medium_percent), POLICY_FIELD_PERCENT },
+    { "fan_speed_high_percent", offsetof(ThermalPolicy, fan_speed_high_percent), POLICY_FIELD_PERCENT },
+    { "fan_speed_max_percent", offsetof(ThermalPolicy, fan_speed_max_percent), POLICY_FIELD_PERCENT },
+    { "fan_speed_min_rpm", offsetof(ThermalPolicy, fan_speed_min_rpm), POLICY_FIELD_RPM },
+    { "fan_speed_max_rpm", offsetof(ThermalPolicy, fan_speed_max_rpm), POLICY_FIELD_RPM }
+};
+
+#define THERMAL_POLICY_FIELD_COUNT  (sizeof(thermal_policy_fields) / sizeof(thermal_policy_fields[0]))
+
+// 解析 "[-]整數[.最多三位小數]" 為千分之一單位
+static inline bool thermal_policy_parse_milli(const char *s, const char **end, int64_t *out) {
+    int64_t whole = 0;
+    int64_t frac = 0;
+    int64_t scale = 100;
+    bool negative = (*s == '-');
+    bool digits = false;
+
+    if (negative) {
+        s++;
+    }
+    while ((*s >= '0') && (*s <= '9') && (whole < 1000000)) {
+        whole = (whole * 10) + (*s - '0');
+        s++;
+        digits = true;
+    }
+    if (*s == '.') {
+        s++;
+        while ((*s >= '0') && (*s <= '9') && (scale > 0)) {
+            frac += (*s - '0') * scale;
+            scale /= 10;
+            s++;
+        }
+    }
+    *out = negative ? -((whole * 1000) + frac) : ((whole * 1000) + frac);
+    *end = s;
+
+    return digits;
+}
+
+static inline bool thermal_policy_set_field(ThermalPolicy *policy, const ThermalPolicyField *field,
+                                            int64_t milli) {
+    uint8_t *base = (uint8_t *)policy;
+    bool ok = true;
+
+    if (field->kind == POLICY_FIELD_TEMP) {
+        TempMilliC value = temp_mc_saturate(milli);
+        memcpy(&base[field->offset], &value, sizeof(value));
+    } else if ((milli % 1000) != 0) {
+        ok = false;                 // 百分比與 RPM 必須是整數
+    } else if (field->kind == POLICY_FIELD_PERCENT) {
+        ok = (milli >= 0) && (milli <= 100000);
+        base[field->offset] = (uint8_t)(milli / 1000);
+    } else {
+        ok = (milli >= 0) && (milli <= 65535000);
+        uint16_t value = (uint16_t)(milli / 1000);
+        memcpy(&base[field->offset], &value, sizeof(value));
+    }
+
+    return ok;
+}
+
+// 閾值必須遞增、轉速必須不遞減，否則事件判斷與插值都會出錯
+static inline bool thermal_policy_validate(const ThermalPolicy *p) {
+    return (p->max_temperature_normal < p->max_temperature_warning) &&
+           (p->max_temperature_warning < p->max_temperature_critical) &&
+           (p->max_temperature_critical < p->max_temperature_shutdown) &&
+           (p->warning_threshold < p->critical_threshold) &&
+           (p->fan_speed_off_percent <= p->fan_speed_low_percent) &&
+           (p->fan_speed_low_percent <= p->fan_speed_medium_percent) &&
+           (p->fan_speed_medium_percent <= p->fan_speed_high_percent) &&
+           (p->fan_speed_high_percent <= p->fan_speed_max_percent) &&
+           (p->fan_speed_max_percent <= 100U) &&
+           (p->fan_speed_min_rpm < p->fan_speed_max_rpm);
+}
+
+// 解析文字內容 (以 '\0' 結尾)；成功時回傳 0，失敗時回傳 -1 並以 error_line 指出行號
+// (0 表示個別欄位都正確，但組合不合法)
+static inline int thermal_policy_parse(const char *text, ThermalPolicy *out, uint32_t *error_line) {
+    ThermalPolicy policy = thermal_policy_defaults;
+    uint32_t line = 1U;
+    int result = 0;
+
+    while ((*text != '\0') && (result == 0)) {
+        const char *p = text;
+        const char *eol = strchr(text, '\n');
+        if (eol == NULL) {
+            eol = text + strlen(text);
+        }
+
+        while ((*p == ' ') || (*p == '\t')) {
+            p++;
+        }
+        if ((p < eol) && (*p != '#') && (*p != '\r')) {
+            const char *key = p;
+            while ((p < eol) && (*p != ' ') && (*p != '\t') && (*p != '=')) {
+                p++;
+            }
+            size_t key_len = (size_t)(p - key);
+            const ThermalPolicyField *field = NULL;
+            for (uint32_t i = 0U; i < THERMAL_POLICY_FIELD_COUNT; i++) {
+                if ((strlen(thermal_policy_fields[i].key) == key_len) &&
+                    (strncmp(thermal_policy_fields[i].key, key, key_len) == 0)) {
+                    field = &thermal_policy_fields[i];
+                    break;
+                }
+            }
+            while ((p < eol) && ((*p == ' ') || (*p == '\t'))) {
+                p++;
+            }
+
+            int64_t milli = 0;
+            const char *end = p;
+            if ((field == NULL) || (p >= eol) || (*p != '=')) {
+                result = -1;
+            } else {
+                p++;
+                while ((p < eol) && ((*p == ' ') || (*p == '\t'))) {
+                    p++;
+                }
+                if (!thermal_policy_parse_milli(p, &end, &milli)) {
+                    result = -1;
+                }
+            }
+            while ((result == 0) && (end < eol) && ((*end == ' ') || (*end == '\t') || (*end == '\r'))) {
+                end++;
+            }
+            if ((result == 0) && (end < eol) && (*end != '#')) {
+                result = -1;        // 數值後面有多餘的字
+            }
+            if ((result == 0) && !thermal_policy_set_field(&policy, field, milli)) {
+                result = -1;
+            }
+            if (result != 0) {
+                *error_line = line;
+            }
+        }
+
+        text = (*eol == '\n') ? (eol + 1) : eol;
+        line++;
+    }
+
+    if ((result == 0) && !thermal_policy_validate(&policy)) {
+        *error_line = 0U;
+        result = -1;
+    }
+    if (result == 0) {
+        *out = policy;
+    }
+
+    return result;
+}
+
+static inline int thermal_policy_load(const char *path, ThermalPolicy *out, uint32_t *error_line) {
+    char text[THERMAL_POLICY_FILE_MAX];
+    int result = -1;
+    FILE *file = fopen(path, "r");
+
+    *error_line = 0U;
+    if (file != NULL) {
+        size_t n = fread(text, 1U, sizeof(text) - 1U, file);
+        if ((ferror(file) == 0) && (feof(file) != 0)) {
+            text[n] = '\0';
+            result = thermal_policy_parse(text, out, error_line);
+        }
+        fclose(file);
+    }
+
+    return result;
+}
+
+// 載入並發布；檔案有誤時保留目前政策並回傳 -1，無法回收舊政策時回傳 THERMAL_POLICY_BUSY。
+// 重載的執行緒若也是登記的讀取者，呼叫前要先經過 thermal_policy_quiescent()
+static inline int thermal_policy_reload(const char *path, uint32_t *error_line) {
+    ThermalPolicy loaded;
+    int result = thermal_policy_load(path, &loaded, error_line);
+
+    if (result == 0) {
+        ThermalPolicy *next = (ThermalPolicy *)malloc(sizeof(*next));
+        if (next == NULL) {
+            result = -1;
+        } else {
+            *next = loaded;
+            result = thermal_policy_publish(next);
+        }
+    }
+
+    return result;
+}
+
+#endif  // THERMAL_POLICY_H
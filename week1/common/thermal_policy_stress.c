@@ -0,0 +1,492 @@
+// thermal_policy_stress.c - 政策熱重載：正確性與讀取端壓力測試
+// 讀取執行緒不斷呼叫 get_temperature_event() 與 calculate_fan_speed()，
+// 寫入執行緒同時在兩個政策檔之間持續重載 (每次都重新讀檔、解析、發布)。
+// 回收前物件會被填入垃圾值 (THERMAL_POLICY_POISON)，讀到已回收的政策會被計為錯誤。
+// 比較：編譯期常數 (改動前的寫法)、RCU 無重載、RCU 持續重載、讀寫鎖持續重載。
+// 另有一項在重載期間讓其他執行緒不斷登記/取消登記讀取者，登記不可影響既有讀取者。
+//
+// 用法: thermal_policy_stress [政策檔]   (預設 thermal_policy.conf)
+
+#define _GNU_SOURCE
+#define THERMAL_POLICY_POISON
+#define MISRA_C_BASICS_NO_MAIN
+#include "../misra/misra_c_basics.c"
+#define SM_QUIET
+#define FAN_CONTROL_NO_MAIN
+#include "../state-machine/fan_control_state_machine.c"
+
+#include <pthread.h>
+#include <unistd.h>
+
+#define READER_THREADS          3U
+#define CHURN_THREADS           2U      // 不斷登記/取消登記的讀取執行緒
+#define RUN_SECONDS             1U
+#define QUIESCENT_INTERVAL      256U    // 每 256 次讀取經過一次靜止點
+#define POLICY_FILE_A           "/tmp/thermal_policy_stress_a.conf"
+#define POLICY_FILE_B           "/tmp/thermal_policy_stress_b.conf"
+#define WARNING_TO_CRITICAL_MC  15000   // 兩個測試政策都維持的不變量
+
+typedef enum {
+    MODE_CONSTANT,
+    MODE_RCU,
+    MODE_RWLOCK
+} ReadMode;
+
+typedef struct {
+    ReadMode mode;
+    bool reload;
+    _Atomic bool stop;
+    _Atomic uint64_t reads;
+    _Atomic uint64_t errors;
+    uint64_t reloads;
+    uint32_t max_pending;
+    uint64_t busy;                  // 讀取者落後太多、這次未發布的重載
+} StressRun;
+
+// === 對照組：編譯期常數 (改成政策物件之前的寫法) ===
+static SystemEvent constant_temperature_event(TempMilliC temperature) {
+    SystemEvent event = EVENT_TEMP_NORMAL;
+
+    if (temperature >= TEMP_MC_FROM_C(MAX_TEMPERATURE_SHUTDOWN_C)) {
+        event = EVENT_TEMP_EXTREME;
+    } else if (temperature >= TEMP_MC_FROM_C(MAX_TEMPERATURE_CRITICAL_C)) {
+        event = EVENT_TEMP_CRITICAL;
+    } else if (temperature >= TEMP_MC_FROM_C(MAX_TEMPERATURE_WARNING_C)) {
+        event = EVENT_TEMP_WARNING;
+    }
+
+    return event;
+}
+
+static uint16_t constant_fan_speed(TempMilliC temperature) {
+    uint16_t fan_speed;
+
+    if (temperature < TEMP_MC_FROM_C(TEMPERATURE_WARNING_THRESHOLD_C)) {
+        fan_speed = FAN_SPEED_MIN_RPM;
+    } else if (temperature >= TEMP_MC_FROM_C(TEMPERATURE_CRITICAL_THRESHOLD_C)) {
+        fan_speed = FAN_SPEED_MAX_RPM;
+    } else {
+        uint32_t temp_offset = (uint32_t)(temperature - TEMP_MC_FROM_C(TEMPERATURE_WARNING_THRESHOLD_C));
+        fan_speed = FAN_SPEED_MIN_RPM +
+                    (uint16_t)((temp_offset * (FAN_SPEED_MAX_RPM - FAN_SPEED_MIN_RPM)) /
+                               (uint32_t)TEMP_MC_FROM_C(TEMPERATURE_CRITICAL_THRESHOLD_C -
+                                                        TEMPERATURE_WARNING_THRESHOLD_C));
+    }
+
+    return fan_speed;
+}
+
+// === 對照組：讀寫鎖保護的可變政策 ===
+static pthread_rwlock_t locked_policy_lock = PTHREAD_RWLOCK_INITIALIZER;
+static ThermalPolicy locked_policy;
+
+static uint32_t locked_read(TempMilliC temperature, bool *consistent) {
+    uint32_t result;
+
+    pthread_rwlock_rdlock(&locked_policy_lock);
+    const ThermalPolicy *p = &locked_policy;
+    SystemEvent event = (temperature >= p->max_temperature_shutdown) ? EVENT_TEMP_EXTREME :
+                        (temperature >= p->max_temperature_critical) ? EVENT_TEMP_CRITICAL :
+                        (temperature >= p->max_temperature_warning) ? EVENT_TEMP_WARNING :
+                        EVENT_TEMP_NORMAL;
+    uint64_t speed = p->fan_speed_min_rpm;
+    if (temperature >= p->critical_threshold) {
+        speed = p->fan_speed_max_rpm;
+    } else if (temperature >= p->warning_threshold) {
+        speed += ((uint64_t)(temperature - p->warning_threshold) *
+                  (uint64_t)(p->fan_speed_max_rpm - p->fan_speed_min_rpm)) /
+                 (uint64_t)(p->critical_threshold - p->warning_threshold);
+    }
+    *consistent = ((p->max_temperature_critical - p->max_temperature_warning) == WARNING_TO_CRITICAL_MC);
+    result = (uint32_t)event + (uint32_t)speed;
+    pthread_rwlock_unlock(&locked_policy_lock);
+
+    return result;
+}
+
+// === 讀取執行緒 ===
+static void *reader_thread(void *arg) {
+    StressRun *run = (StressRun *)arg;
+    ThermalPolicyReader *reader = NULL;
+    uint32_t rng = (uint32_t)(uintptr_t)&reader | 1U;
+    uint64_t reads = 0U;
+    uint64_t errors = 0U;
+    uint64_t last_generation = 0U;
+    uint32_t acc = 0U;
+
+    if (run->mode == MODE_RCU) {
+        reader = thermal_policy_reader_register();
+        if (reader == NULL) {
+            atomic_fetch_add(&run->errors, 1U);
+            return NULL;
+        }
+    }
+
+    while (!atomic_load_explicit(&run->stop, memory_order_relaxed)) {
+        // 整個區間都持有同一個指標 (靜止點之間允許)，區間結束時它必須還沒被回收
+        const ThermalPolicy *held = (reader != NULL) ? thermal_policy_get() : NULL;
+        uint64_t held_generation = (held != NULL) ? held->generation : 0U;
+
+        for (uint32_t i = 0U; i < QUIESCENT_INTERVAL; i++) {
+            rng ^= rng << 13;
+            rng ^= rng >> 17;
+            rng ^= rng << 5;
+            TempMilliC temp = TEMP_MC_FROM_C(40) + (TempMilliC)(rng % 60000U);
+
+            if (run->mode == MODE_CONSTANT) {
+                acc += (uint32_t)constant_temperature_event(temp) + constant_fan_speed(temp);
+            } else if (run->mode == MODE_RCU) {
+                // 驗證讀到的是完整、尚未回收的物件，且序號不會倒退
+                const ThermalPolicy *p = thermal_policy_get();
+                if (((p->max_temperature_critical - p->max_temperature_warning) != WARNING_TO_CRITICAL_MC) ||
+                    (p->generation < last_generation)) {
+                    errors++;
+                }
+                last_generation = p->generation;
+                acc += (uint32_t)get_temperature_event(temp) + calculate_fan_speed(temp);
+            } else {
+                bool consistent = true;
+                acc += locked_read(temp, &consistent);
+                errors += consistent ? 0U : 1U;
+            }
+        }
+        reads += QUIESCENT_INTERVAL;
+        if (reader != NULL) {
+            if ((held->generation != held_generation) ||
+                ((held->max_temperature_critical - held->max_temperature_warning) != WARNING_TO_CRITICAL_MC)) {
+                errors++;
+            }
+            thermal_policy_quiescent(reader);
+        }
+    }
+
+    if (reader != NULL) {
+        thermal_policy_reader_unregister(reader);
+    }
+    atomic_fetch_add(&run->reads, reads);
+    atomic_fetch_add(&run->errors, errors + ((acc == 0xFFFFFFFFU) ? 1U : 0U));
+
+    return NULL;
+}
+
+// === 登記/取消登記不斷進出的讀取執行緒 ===
+// 登記時走過其他讀取者的名額；若把他們的 seen_epoch 往前推，
+// 他們持有的政策會被提早回收，由 reader_thread 的區間檢查計為錯誤
+static void *churn_thread(void *arg) {
+    StressRun *run = (StressRun *)arg;
+
+    while (!atomic_load_explicit(&run->stop, memory_order_relaxed)) {
+        ThermalPolicyReader *reader = thermal_policy_reader_register();
+        if (reader == NULL) {
+            atomic_fetch_add(&run->errors, 1U);
+            break;
+        }
+        const ThermalPolicy *p = thermal_policy_get();
+        if ((p->max_temperature_critical - p->max_temperature_warning) != WARNING_TO_CRITICAL_MC) {
+            atomic_fetch_add(&run->errors, 1U);
+        }
+        thermal_policy_quiescent(reader);
+        thermal_policy_reader_unregister(reader);
+    }
+
+    return NULL;
+}
+
+// === 寫入執行緒：交替重載兩個政策檔 ===
+static void *writer_thread(void *arg) {
+    StressRun *run = (StressRun *)arg;
+    uint32_t error_line = 0U;
+
+    while (!atomic_load_explicit(&run->stop, memory_order_relaxed)) {
+        const char *path = ((run->reloads & 1U) == 0U) ? POLICY_FILE_B : POLICY_FILE_A;
+
+        if (run->mode == MODE_RCU) {
+            int result = thermal_policy_reload(path, &error_line);
+            if (result == THERMAL_POLICY_BUSY) {
+                run->busy++;
+            } else if (result != 0) {
+                atomic_fetch_add(&run->errors, 1U);
+            }
+            uint32_t pending = thermal_policy_retired_count;
+            if (pending > run->max_pending) {
+                run->max_pending = pending;
+            }
+        } else {
+            ThermalPolicy loaded;
+            if (thermal_policy_load(path, &loaded, &error_line) == 0) {
+                pthread_rwlock_wrlock(&locked_policy_lock);
+                locked_policy = loaded;
+                pthread_rwlock_unlock(&locked_policy_lock);
+            } else {
+                atomic_fetch_add(&run->errors, 1U);
+            }
+        }
+        run->reloads++;
+    }
+
+    return NULL;
+}
+
+// 回傳讀取端偵測到的錯誤數
+static uint64_t stress_run(const char *label, ReadMode mode, bool reload, bool churn) {
+    static StressRun run;
+    pthread_t readers[READER_THREADS];
+    pthread_t churners[CHURN_THREADS];
+    pthread_t writer;
+
+    memset(&run, 0, sizeof(run));
+    run.mode = mode;
+    run.reload = reload;
+    locked_policy = thermal_policy_defaults;
+
+    uint64_t start = sm_stats_now_ns();
+    for (uint32_t i = 0U; i < READER_THREADS; i++) {
+        (void)pthread_create(&readers[i], NULL, reader_thread, &run);
+    }
+    if (reload) {
+        (void)pthread_create(&writer, NULL, writer_thread, &run);
+    }
+    if (churn) {
+        // 讓固定的讀取者先佔住前面的名額，進出的執行緒登記時才會走過它們
+        usleep(1000U);
+        for (uint32_t i = 0U; i < CHURN_THREADS; i++) {
+            (void)pthread_create(&churners[i], NULL, churn_thread, &run);
+        }
+    }
+    sleep(RUN_SECONDS);
+    atomic_store(&run.stop, true);
+    for (uint32_t i = 0U; i < READER_THREADS; i++) {
+        pthread_join(readers[i], NULL);
+    }
+    if (churn) {
+        for (uint32_t i = 0U; i < CHURN_THREADS; i++) {
+            pthread_join(churners[i], NULL);
+        }
+    }
+    if (reload) {
+        pthread_join(writer, NULL);
+    }
+    double seconds = (double)(sm_stats_now_ns() - start) / 1e9;
+
+    printf("  %-20s 讀取 %7.2f M/s  重載 %8.0f 次/s  錯誤 %lu",
+           label, ((double)atomic_load(&run.reads) / seconds) / 1e6,
+           (double)run.reloads / seconds, (unsigned long)atomic_load(&run.errors));
+    if ((mode == MODE_RCU) && reload) {
+        printf("  待回收最多 %u  忙碌 %lu", run.max_pending, (unsigned long)run.busy);
+    }
+    printf("\n");
+
+    return atomic_load(&run.errors);
+}
+
+// === 正確性 ===
+static bool write_file(const char *path, const char *text) {
+    FILE *file = fopen(path, "w");
+    bool ok = false;
+
+    if (file != NULL) {
+        ok = (fputs(text, file) >= 0);
+        ok = (fclose(file) == 0) && ok;
+    }
+
+    return ok;
+}
+
+// 逐欄位比較 (memcmp 會比到結構的填充位元組)，不比較 generation
+static bool policy_equal(const ThermalPolicy *a, const ThermalPolicy *b) {
+    return (a->max_temperature_normal == b->max_temperature_normal) &&
+           (a->max_temperature_warning == b->max_temperature_warning) &&
+           (a->max_temperature_critical == b->max_temperature_critical) &&
+           (a->max_temperature_shutdown == b->max_temperature_shutdown) &&
+           (a->warning_threshold == b->warning_threshold) &&
+           (a->critical_threshold == b->critical_threshold) &&
+           (a->fan_speed_off_percent == b->fan_speed_off_percent) &&
+           (a->fan_speed_low_percent == b->fan_speed_low_percent) &&
+           (a->fan_speed_medium_percent == b->fan_speed_medium_percent) &&
+           (a->fan_speed_high_percent == b->fan_speed_high_percent) &&
+           (a->fan_speed_max_percent == b->fan_speed_max_percent) &&
+           (a->fan_speed_min_rpm == b->fan_speed_min_rpm) &&
+           (a->fan_speed_max_rpm == b->fan_speed_max_rpm);
+}
+
+static uint32_t check_count;
+static uint32_t check_failures;
+
+static void check(bool condition, const char *description) {
+    check_count++;
+    if (!condition) {
+        check_failures++;
+    }
+    printf("  [%s] %s\n", condition ? "通過" : "失敗", description);
+}
+
+static void correctness_tests(const char *sample_path) {
+    ThermalPolicy parsed;
+    uint32_t line = 0U;
+
+    printf("\n=== 1. 解析與驗證 ===\n");
+    if (thermal_policy_load(sample_path, &parsed, &line) == 0) {
+        check(policy_equal(&parsed, &thermal_policy_defaults), "範例政策檔與編譯期預設值相同");
+    } else {
+        printf("  (找不到或無法解析 %s，略過)\n", sample_path);
+    }
+    check((thermal_policy_parse("max_temperature_warning_c = 72.5\n", &parsed, &line) == 0) &&
+          (parsed.max_temperature_warning == 72500), "小數溫度 72.5 -> 72500 毫度");
+    check((thermal_policy_parse("# x\n\nfan_speed_typo = 3\n", &parsed, &line) != 0) && (line == 3U),
+          "未知的 key 被拒絕並指出第 3 行");
+    check((thermal_policy_parse("fan_speed_low_percent = 30.5\n", &parsed, &line) != 0) && (line == 1U),
+          "百分比不接受小數");
+    check(thermal_policy_parse("fan_speed_max_percent = 101\n", &parsed, &line) != 0,
+          "百分比超過 100 被拒絕");
+    check(thermal_policy_parse("fan_speed_low_percent = 30 x\n", &parsed, &line) != 0,
+          "數值後的多餘字元被拒絕");
+    check((thermal_policy_parse("max_temperature_critical_c = 60\n", &parsed, &line) != 0) && (line == 0U),
+          "閾值不遞增 (critical < warning) 被拒絕");
+
+    printf("\n=== 2. 重載生效 ===\n");
+    const char *lowered =
+        "max_temperature_normal_c = 40\nmax_temperature_warning_c = 60\n"
+        "max_temperature_critical_c = 75\nmax_temperature_shutdown_c = 90\n"
+        "fan_speed_low_percent = 40\ntemperature_warning_threshold_c = 60\n"
+        "temperature_critical_threshold_c = 80\nfan_speed_max_rpm = 6000\n";
+    StateMachine sm;
+    sm_init(&sm);
+
+    SystemEvent before = get_temperature_event(TEMP_MC_FROM_C(65));
+    uint16_t rpm_before = calculate_fan_speed(TEMP_MC_FROM_C(80));
+    check(write_file(POLICY_FILE_B, lowered) && (thermal_policy_reload(POLICY_FILE_B, &line) == 0),
+          "重載較保守的政策");
+    check((before == EVENT_TEMP_NORMAL) && (get_temperature_event(TEMP_MC_FROM_C(65)) == EVENT_TEMP_WARNING),
+          "65°C: NORMAL -> WARNING");
+    check((rpm_before == 3000U) && (calculate_fan_speed(TEMP_MC_FROM_C(80)) == 6000U),
+          "80°C: 3000 RPM -> 6000 RPM");
+    sm_process_event(&sm, EVENT_SYSTEM_INIT);
+    check(sm.current_fan_speed == 40U, "進入 NORMAL 使用新的低速 40%");
+    check((write_file(POLICY_FILE_A, "max_temperature_warning_c = 99\n")) &&
+          (thermal_policy_reload(POLICY_FILE_A, &line) != 0) && (thermal_policy_get()->generation == 1U),
+          "錯誤的檔案不會發布，保留目前政策");
+    check((thermal_policy_reload(POLICY_FILE_B, &line) == 0) && (thermal_policy_retired_count == 0U) &&
+          (thermal_policy_reclaimed == 1U), "沒有登記讀取者時被取代的政策立即回收");
+}
+
+// === 登記的讀取者在自己的執行緒上重載 (例如 bmc_reactor 的 SIGHUP) ===
+#define SELF_RELOADS            ((2U * THERMAL_POLICY_MAX_RETIRED) + 4U)
+
+typedef struct {
+    uint32_t published_stalled;     // 沒經過靜止點時成功發布的次數
+    uint32_t busy_stalled;
+    bool kept_policy;               // 忙碌時目前政策不變
+    uint32_t published_quiescent;   // 每次重載前都經過靜止點
+    bool registered;
+} SelfReloadResult;
+
+static void *self_reload_thread(void *arg) {
+    SelfReloadResult *result = (SelfReloadResult *)arg;
+    ThermalPolicyReader *reader = thermal_policy_reader_register();
+    uint32_t line = 0U;
+
+    result->registered = (reader != NULL);
+    if (reader == NULL) {
+        return NULL;
+    }
+    result->kept_policy = true;
+    for (uint32_t i = 0U; i < SELF_RELOADS; i++) {
+        uint64_t before = thermal_policy_get()->generation;
+        int status = thermal_policy_reload(((i & 1U) == 0U) ? POLICY_FILE_A : POLICY_FILE_B, &line);
+        if (status == 0) {
+            result->published_stalled++;
+        } else if (status == THERMAL_POLICY_BUSY) {
+            result->busy_stalled++;
+            result->kept_policy = result->kept_policy && (thermal_policy_get()->generation == before);
+        } else {
+            // 解析錯誤：不計入任何一類
+        }
+    }
+    for (uint32_t i = 0U; i < SELF_RELOADS; i++) {
+        thermal_policy_quiescent(reader);
+        if (thermal_policy_reload(((i & 1U) == 0U) ? POLICY_FILE_A : POLICY_FILE_B, &line) == 0) {
+            result->published_quiescent++;
+        }
+    }
+    thermal_policy_reader_unregister(reader);
+
+    return NULL;
+}
+
+static void self_reload_tests(void) {
+    SelfReloadResult result;
+    pthread_t thread;
+    struct timespec deadline;
+
+    printf("\n=== 3. 登記的讀取者自己重載 ===\n");
+    memset(&result, 0, sizeof(result));
+    (void)clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += 10;
+    (void)pthread_create(&thread, NULL, self_reload_thread, &result);
+    if (pthread_timedjoin_np(thread, NULL, &deadline) != 0) {
+        check(false, "重載不會卡在等待自己經過靜止點");
+        printf("檢查: %u 項，失敗 %u 項\n", check_count, check_failures);
+        exit(1);
+    }
+    check(result.registered && (result.published_stalled == THERMAL_POLICY_MAX_RETIRED) &&
+          (result.busy_stalled == (SELF_RELOADS - THERMAL_POLICY_MAX_RETIRED)) && result.kept_policy,
+          "沒經過靜止點時，待回收清單滿後回傳忙碌並保留目前政策 (不卡住)");
+    check(result.published_quiescent == SELF_RELOADS, "每次重載前先經過靜止點，全部發布成功");
+    check(thermal_policy_reclaim() == 0U, "讀取者離開後，被取代的政策全部回收");
+}
+
+int main(int argc, char *argv[]) {
+    const char *sample_path = (argc > 1) ? argv[1] : "thermal_policy.conf";
+
+    printf("=== 溫控政策熱重載 (RCU 指標交換 + QSBR 延後回收) ===\n");
+    correctness_tests(sample_path);
+
+    // 兩個交替的壓力測試政策：都維持 critical - warning = 15°C
+    bool files_ok = write_file(POLICY_FILE_A, "") &&
+                    write_file(POLICY_FILE_B,
+                               "max_temperature_normal_c = 45\nmax_temperature_warning_c = 65\n"
+                               "max_temperature_critical_c = 80\nmax_temperature_shutdown_c = 90\n"
+                               "fan_speed_low_percent = 40\nfan_speed_medium_percent = 70\n"
+                               "temperature_warning_threshold_c = 65\nfan_speed_max_rpm = 6000\n");
+    if (!files_ok) {
+        printf("無法建立測試政策檔\n");
+        return 1;
+    }
+    self_reload_tests();
+
+    uint32_t line = 0U;
+    if (thermal_policy_reload(POLICY_FILE_A, &line) != 0) {  // 從預設值開始，與常數組相同
+        printf("無法載入測試政策檔\n");
+        return 1;
+    }
+
+    printf("\n=== 4. 讀取端壓力測試 (%u 讀取執行緒, 每項 %u 秒) ===\n", READER_THREADS, RUN_SECONDS);
+    uint64_t published_before = thermal_policy_generation;
+    uint64_t reclaimed_before = thermal_policy_reclaimed;
+    uint64_t stress_errors = stress_run("const/macros", MODE_CONSTANT, false, false);
+    stress_errors += stress_run("rcu/idle", MODE_RCU, false, false);
+    stress_errors += stress_run("rcu/reload", MODE_RCU, true, false);
+    stress_errors += stress_run("rcu/reload+register", MODE_RCU, true, true);
+    stress_errors += stress_run("rwlock/reload", MODE_RWLOCK, true, false);
+
+    uint32_t pending = thermal_policy_reclaim();
+    uint64_t published = thermal_policy_generation - published_before;
+    uint64_t reclaimed = thermal_policy_reclaimed - reclaimed_before;
+    printf("\n  發布 %lu 份，回收 %lu 份，尚待回收 %u，目前政策序號 %lu\n",
+           (unsigned long)published, (unsigned long)reclaimed, pending,
+           (unsigned long)thermal_policy_get()->generation);
+    check(stress_errors == 0U, "壓力測試中沒有讀到已回收或不一致的政策");
+    check((pending == 0U) && (reclaimed == published), "讀取者都離開後，所有被取代的政策都已回收");
+
+    unlink(POLICY_FILE_A);
+    unlink(POLICY_FILE_B);
+
+    printf("\n=== 重點總結 ===\n");
+    printf("1. 讀取端只有一次 acquire 載入，重載期間不等待、不上鎖\n");
+    printf("2. 舊政策在所有讀取者經過靜止點後才回收，不會讀到已釋放的記憶體\n");
+    printf("3. 檔案錯誤不會發布，控制迴圈繼續使用上一份有效政策\n");
+    printf("4. 寫入端不持鎖等待讀取者：舊政策無法回收時回傳忙碌，保留目前政策\n");
+    printf("檢查: %u 項，失敗 %u 項\n", check_count, check_failures);
+
+    return (check_failures == 0U) ? 0 : 1;
+}
@@ -0,0 +1,569 @@
+// bmc_reactor.c - 單執行緒事件迴圈 (epoll + timerfd + eventfd)
+// 原本四個程式都是線性的 main()，狀態機甚至沒有迴圈。
+// 這裡提供一個 reactor：感測器讀取、風扇狀態機與日誌刷新都註冊成處理器，
+// 兩次 tick 之間行程完全睡在 epoll_wait()，只被計時器或輸入喚醒 (閒置 0% CPU)。
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+// 狀態機內部的 printf 會在事件迴圈執行緒上直接寫 stdout，與批次刷新的日誌交錯；
+// 每次進入狀態都經由 reactor_log_message() 寫入記憶體日誌，不會少掉轉換紀錄
+#ifndef SM_QUIET
+#define SM_QUIET
+#endif
+#define FAN_CONTROL_NO_MAIN
+#include "../state-machine/fan_control_state_machine.c"
+
+#define REACTOR_MAX_SOURCES     16U
+#define REACTOR_MAX_EVENTS      16
+#define REACTOR_POLICY_PATH     "../common/thermal_policy.conf"
+
+// === Reactor 核心 ===
+typedef struct Reactor Reactor;
+
+// 處理器回調：fd 可讀時呼叫，events 為 epoll 事件位元
+typedef void (*ReactorHandler)(Reactor *reactor, int fd, uint32_t events, void *user_data);
+
+typedef struct {
+    int fd;
+    ReactorHandler handler;
+    void *user_data;
+    bool in_use;
+} ReactorSource;
+
+struct Reactor {
+    int epoll_fd;
+    bool running;
+    uint64_t wakeups;
+    ReactorSource sources[REACTOR_MAX_SOURCES];
+};
+
+static inline uint64_t reactor_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+int reactor_init(Reactor *reactor) {
+    memset(reactor, 0, sizeof(*reactor));
+    reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    return (reactor->epoll_fd >= 0) ? 0 : -1;
+}
+
+// 註冊一個 fd；成功時回傳 0，之後 fd 的擁有權交給 reactor
+int reactor_add_fd(Reactor *reactor, int fd, uint32_t events,
+                   ReactorHandler handler, void *user_data) {
+    int result = -1;
+
+    for (uint32_t i = 0U; i < REACTOR_MAX_SOURCES; i++) {
+        ReactorSource *src = &reactor->sources[i];
+        if (!src->in_use) {
+            struct epoll_event ev = {
+                .events = events,
+                .data.ptr = src
+            };
+            if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0) {
+                src->fd = fd;
+                src->handler = handler;
+                src->user_data = user_data;
+                src->in_use = true;
+                result = 0;
+            }
+            break;
+        }
+    }
+
+    return result;
+}
+
+// 變更 fd 關注的事件 (例如寫入被擋住時加上 EPOLLOUT)
+int reactor_modify_fd(Reactor *reactor, int fd, uint32_t events) {
+    int result = -1;
+
+    for (uint32_t i = 0U; i < REACTOR_MAX_SOURCES; i++) {
+        ReactorSource *src = &reactor->sources[i];
+        if (src->in_use && (src->fd == fd)) {
+            struct epoll_event ev = {
+                .events = events,
+                .data.ptr = src
+            };
+            result = epoll_ctl(reactor->epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+            break;
+        }
+    }
+
+    return result;
+}
+
+// 取消註冊並關閉 fd；可以在該 fd 自己的處理器中呼叫
+int reactor_remove_fd(Reactor *reactor, int fd) {
+    int result = -1;
+
+    for (uint32_t i = 0U; i < REACTOR_MAX_SOURCES; i++) {
+        ReactorSource *src = &reactor->sources[i];
+        if (src->in_use && (src->fd == fd)) {
+            (void)epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+            close(fd);
+            src->in_use = false;
+            result = 0;
+            break;
+        }
+    }
+
+    return result;
+}
+
+// 建立週期性計時器並註冊；回傳 timerfd，失敗時回傳 -1
+int reactor_add_timer(Reactor *reactor, uint64_t period_ns,
+                      ReactorHandler handler, void *user_data) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct itimerspec spec = {
+        .it_interval = {
+            .tv_sec = (time_t)(period_ns / 1000000000ULL),
+            .tv_nsec = (long)(period_ns % 1000000000ULL)
+        }
+    };
+    spec.it_value = spec.it_interval;
+
+    if ((timerfd_settime(fd, 0, &spec, NULL) != 0) ||
+        (reactor_add_fd(reactor, fd, EPOLLIN, handler, user_data) != 0)) {
+        close(fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+// 建立 eventfd 作為跨處理器通知；回傳 eventfd，失敗時回傳 -1
+int reactor_add_notifier(Reactor *reactor, ReactorHandler handler, void *user_data) {
+    int fd = eventfd(0U, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((fd >= 0) && (reactor_add_fd(reactor, fd, EPOLLIN, handler, user_data) != 0)) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+void reactor_notify(int event_fd) {
+    uint64_t one = 1U;
+    ssize_t n = write(event_fd, &one, sizeof(one));
+    (void)n;  // 計數器飽和時 write 失敗也無妨：對方本來就會被喚醒
+}
+
+// 讀出 timerfd/eventfd 的計數值 (到期次數或通知次數)
+uint64_t reactor_drain(int fd) {
+    uint64_t count = 0U;
+    if (read(fd, &count, sizeof(count)) != (ssize_t)sizeof(count)) {
+        count = 0U;
+    }
+    return count;
+}
+
+void reactor_run(Reactor *reactor) {
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+
+    reactor->running = true;
+    while (reactor->running) {
+        int n = epoll_wait(reactor->epoll_fd, events, REACTOR_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        reactor->wakeups++;
+        for (int i = 0; i < n; i++) {
+            ReactorSource *src = (ReactorSource *)events[i].data.ptr;
+            if (src->in_use) {      // 同一批次中先前的處理器可能已移除這個來源
+                src->handler(reactor, src->fd, events[i].events, src->user_data);
+            }
+        }
+    }
+}
+
+void reactor_stop(Reactor *reactor) {
+    reactor->running = false;
+}
+
+void reactor_cleanup(Reactor *reactor) {
+    for (uint32_t i = 0U; i < REACTOR_MAX_SOURCES; i++) {
+        if (reactor->sources[i].in_use) {
+            close(reactor->sources[i].fd);
+            reactor->sources[i].in_use = false;
+        }
+    }
+    close(reactor->epoll_fd);
+}
+
+// === 日誌緩衝：狀態機的 log_message 只寫入記憶體，由計時器批次刷新 ===
+#define LOG_BUFFER_SIZE         4096U
+#define LOG_FLUSH_HIGH_WATER    (LOG_BUFFER_SIZE / 2U)
+
+typedef struct {
+    char data[LOG_BUFFER_SIZE];
+    size_t length;
+    int notify_fd;      // 超過高水位時通知刷新處理器提早寫出
+    uint64_t flushes;
+} LogBuffer;
+
+static LogBuffer g_log_buffer;
+
+void log_buffer_flush(LogBuffer *log) {
+    if (log->length > 0U) {
+        fwrite(log->data, 1U, log->length, stdout);
+        fflush(stdout);
+        log->length = 0U;
+        log->flushes++;
+    }
+}
+
+void log_buffer_append(LogBuffer *log, const char *text, size_t len) {
+    if ((log->length + len) > LOG_BUFFER_SIZE) {
+        log_buffer_flush(log);
+    }
+    if (len <= LOG_BUFFER_SIZE) {
+        memcpy(&log->data[log->length], text, len);
+        log->length += len;
+    }
+    if ((log->length >= LOG_FLUSH_HIGH_WATER) && (log->notify_fd >= 0)) {
+        reactor_notify(log->notify_fd);
+    }
+}
+
+// 取代 action_log_message：格式相同，但不在熱路徑上做 I/O
+void reactor_log_message(StateMachine *sm, uint8_t severity) {
+    const char *severity_str[] = {"INFO", "WARNING", "ERROR", "CRITICAL"};
+    char line[160];
+    int len = snprintf(line, sizeof(line), "[日誌][%s] 狀態: %s, 溫度: " TEMP_MC_FMT "°C, 風扇: %u%%\n",
+                       severity_str[severity % 4],
+                       state_configs[sm->current_state].name,
+                       TEMP_MC_ARGS(sm->current_temperature),
+                       sm->current_fan_speed);
+    if (len > 0) {
+        log_buffer_append(&g_log_buffer, line, (size_t)len);
+    }
+}
+
+// === 處理器 ===
+typedef struct {
+    StateMachine sm;
+    int sample_notify_fd;       // 感測器 -> 狀態機
+    TempMilliC pending_temperature;
+    uint32_t rng;
+    uint64_t samples;
+    ThermalPolicyReader *policy_reader;     // 事件迴圈執行緒登記為政策讀取者
+} FanZone;
+
+// 感測器處理器：計時器到期時讀取溫度 (模擬)，交給狀態機處理器
+void sensor_tick_handler(Reactor *reactor, int fd, uint32_t events, void *user_data) {
+    FanZone *zone = (FanZone *)user_data;
+    (void)reactor;
+    (void)events;
+
+    if (reactor_drain(fd) == 0U) {
+        return;
+    }
+    // 每個 tick 開始時不持有任何政策指標：這裡是靜止點
+    if (zone->policy_reader != NULL) {
+        thermal_policy_quiescent(zone->policy_reader);
+    }
+
+    // 簡單的熱模型：發熱 0..4.999°C，風扇每 25% 帶走 1°C
+    zone->rng = (zone->rng * 1103515245U) + 12345U;
+    TempMilliC delta = (TempMilliC)((zone->rng >> 16) % 5000U) -
+                       TEMP_MC_FROM_C(zone->sm.current_fan_speed / 25U);
+    TempMilliC temp = temp_mc_add_sat(zone->sm.current_temperature, delta);
+    if (temp < TEMP_MC_FROM_C(20)) temp = TEMP_MC_FROM_C(20);
+    if (temp > TEMP_MC_FROM_C(100)) temp = TEMP_MC_FROM_C(100);
+
+    zone->pending_temperature = temp;
+    zone->samples++;
+    reactor_notify(zone->sample_notify_fd);
+}
+
+// 狀態機處理器：只在有新樣本時被喚醒
+void fan_state_machine_handler(Reactor *reactor, int fd, uint32_t events, void *user_data) {
+    FanZone *zone = (FanZone *)user_data;
+    (void)reactor;
+    (void)events;
+
+    if (reactor_drain(fd) > 0U) {
+        zone->sm.current_temperature = zone->pending_temperature;
+        sm_process_event(&zone->sm, get_temperature_event(zone->sm.current_temperature));
+    }
+}
+
+void log_flush_handler(Reactor *reactor, int fd, uint32_t events, void *user_data) {
+    (void)reactor;
+    (void)events;
+    (void)reactor_drain(fd);
+    log_buffer_flush((LogBuffer *)user_data);
+}
+
+// SIGHUP 重新載入所需的狀態 (signal_handler 的 user_data)
+typedef struct {
+    const char *path;
+    ThermalPolicyReader *reader;    // 事件迴圈執行緒的讀取者登記
+} ReactorPolicy;
+
+// 載入溫控政策；檔案不存在或有誤時保留目前政策。
+// 重載在事件迴圈執行緒上執行，而它本身是登記的讀取者：先宣告靜止點
+// (這裡不持有任何政策指標)，否則被取代的政策都等不到它，待回收清單會塞滿
+int reactor_load_policy(const ReactorPolicy *policy) {
+    uint32_t error_line = 0U;
+
+    if (policy->reader != NULL) {
+        thermal_policy_quiescent(policy->reader);
+    }
+    int result = thermal_policy_reload(policy->path, &error_line);
+    const char *path = policy->path;
+
+    if (result == 0) {
+        printf("[reactor] 載入政策 %s (序號 %lu)\n", path,
+               (unsigned long)thermal_policy_get()->generation);
+    } else if (result == THERMAL_POLICY_BUSY) {
+        printf("[reactor] 舊政策尚未能回收，暫不載入 %s，保留目前政策\n", path);
+    } else if (error_line > 0U) {
+        printf("[reactor] 政策 %s 第 %u 行有誤，保留目前政策\n", path, error_line);
+    } else {
+        printf("[reactor] 無法載入政策 %s (讀檔失敗或閾值不遞增)，保留目前政策\n", path);
+    }
+
+    return result;
+}
+
+// 收到 SIGHUP 時重新載入政策 (user_data 為 ReactorPolicy，NULL 表示不支援)，
+// 收到 SIGINT/SIGTERM 時結束迴圈
+void signal_handler(Reactor *reactor, int fd, uint32_t events, void *user_data) {
+    struct signalfd_siginfo info;
+    const ReactorPolicy *policy = (const ReactorPolicy *)user_data;
+    (void)events;
+
+    if (read(fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {
+        if ((info.ssi_signo == (uint32_t)SIGHUP) && (policy != NULL)) {
+            (void)reactor_load_policy(policy);
+        } else {
+            printf("\n[reactor] 收到訊號 %u，停止事件迴圈\n", info.ssi_signo);
+            reactor_stop(reactor);
+        }
+    }
+}
+
+// 示範時限：計時器到期即停止
+void deadline_handler(Reactor *reactor, int fd, uint32_t events, void *user_data) {
+    (void)events;
+    (void)user_data;
+    (void)reactor_drain(fd);
+    reactor_stop(reactor);
+}
+
+// 組裝風扇控制 daemon；run_seconds 為 0 表示執行到收到訊號 (SIGHUP 重新載入 policy_path)。
+// policy_path 為 NULL 時使用編譯期預設政策
+int run_fan_daemon(uint64_t sensor_period_ns, uint32_t run_seconds, const char *policy_path) {
+    Reactor reactor;
+    static FanZone zone;
+    static ReactorPolicy policy;
+
+    if (reactor_init(&reactor) != 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+    zone.policy_reader = thermal_policy_reader_register();
+    policy.path = policy_path;
+    policy.reader = zone.policy_reader;
+    if (policy_path != NULL) {
+        (void)reactor_load_policy(&policy);
+    }
+
+    sm_init(&zone.sm);
+    zone.sm.current_temperature = TEMP_MC_FROM_C(60);  // 模擬已在負載下的系統
+    zone.sm.log_message = reactor_log_message;
+    zone.rng = 12345U;
+    g_log_buffer.length = 0U;
+    g_log_buffer.notify_fd = -1;
+
+    zone.sample_notify_fd = reactor_add_notifier(&reactor, fan_state_machine_handler, &zone);
+    int log_fd = reactor_add_notifier(&reactor, log_flush_handler, &g_log_buffer);
+    int sensor_fd = reactor_add_timer(&reactor, sensor_period_ns, sensor_tick_handler, &zone);
+    int flush_fd = reactor_add_timer(&reactor, 1000000000ULL, log_flush_handler, &g_log_buffer);
+    if ((zone.sample_notify_fd < 0) || (log_fd < 0) || (sensor_fd < 0) || (flush_fd < 0) ||
+        (zone.policy_reader == NULL)) {
+        printf("註冊處理器失敗\n");
+        if (zone.policy_reader != NULL) {
+            thermal_policy_reader_unregister(zone.policy_reader);
+        }
+        reactor_cleanup(&reactor);
+        return -1;
+    }
+    g_log_buffer.notify_fd = log_fd;
+
+    if (run_seconds > 0U) {
+        (void)reactor_add_timer(&reactor, (uint64_t)run_seconds * 1000000000ULL,
+                                deadline_handler, NULL);
+    } else {
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        sigaddset(&mask, SIGHUP);
+        sigprocmask(SIG_BLOCK, &mask, NULL);
+        int sig_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        if ((sig_fd < 0) ||
+            (reactor_add_fd(&reactor, sig_fd, EPOLLIN, signal_handler,
+                            (policy_path != NULL) ? &policy : NULL) != 0)) {
+            printf("註冊訊號處理器失敗\n");
+        }
+    }
+
+    sm_process_event(&zone.sm, EVENT_SYSTEM_INIT);
+    reactor_run(&reactor);
+    log_buffer_flush(&g_log_buffer);
+
+    printf("\n=== daemon 統計 ===\n");
+    printf("感測器樣本: %lu, epoll 喚醒: %lu, 日誌刷新: %lu\n",
+           (unsigned long)zone.samples, (unsigned long)reactor.wakeups,
+           (unsigned long)g_log_buffer.flushes);
+    printf("狀態轉換次數: %u, 處理事件次數: %u, 最終狀態: %s\n",
+           zone.sm.state_transitions, zone.sm.events_processed,
+           state_configs[zone.sm.current_state].name);
+
+    thermal_policy_reader_unregister(zone.policy_reader);
+    reactor_cleanup(&reactor);
+    return 0;
+}
+
+#ifndef BMC_REACTOR_NO_MAIN
+
+// === 效能測試：喚醒延遲與 CPU 使用率 ===
+#define LATENCY_SAMPLES_MAX     20000U
+
+typedef struct {
+    uint64_t start_ns;
+    uint64_t period_ns;
+    uint64_t ticks;          // 已到期的 tick 數 (含漏掉的)
+    uint64_t target_ticks;
+    uint32_t sample_count;
+    uint64_t latency_ns[LATENCY_SAMPLES_MAX];
+} LatencyBench;
+
+void latency_tick_handler(Reactor *reactor, int fd, uint32_t events, void *user_data) {
+    LatencyBench *bench = (LatencyBench *)user_data;
+    uint64_t now = reactor_now_ns();
+    (void)events;
+
+    uint64_t expirations = reactor_drain(fd);
+    if (expirations == 0U) {
+        return;
+    }
+    bench->ticks += expirations;
+
+    // 最近一次到期的理論時間點，延遲 = 實際喚醒 - 理論到期
+    uint64_t expected = bench->start_ns + (bench->ticks * bench->period_ns);
+    if ((now >= expected) && (bench->sample_count < LATENCY_SAMPLES_MAX)) {
+        bench->latency_ns[bench->sample_count] = now - expected;
+        bench->sample_count++;
+    }
+    if (bench->ticks >= bench->target_ticks) {
+        reactor_stop(reactor);
+    }
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t cpu_time_ns(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return ((uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL) +
+           ((uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL);
+}
+
+void wakeup_latency_benchmark(uint32_t rate_hz, uint64_t target_ticks) {
+    static LatencyBench bench;
+    Reactor reactor;
+
+    memset(&bench, 0, sizeof(bench));
+    bench.period_ns = 1000000000ULL / rate_hz;
+    bench.target_ticks = target_ticks;
+
+    if (reactor_init(&reactor) != 0) {
+        return;
+    }
+
+    uint64_t cpu_start = cpu_time_ns();
+    bench.start_ns = reactor_now_ns();
+    if (reactor_add_timer(&reactor, bench.period_ns, latency_tick_handler, &bench) < 0) {
+        reactor_cleanup(&reactor);
+        return;
+    }
+    reactor_run(&reactor);
+    uint64_t wall = reactor_now_ns() - bench.start_ns;
+    uint64_t cpu = cpu_time_ns() - cpu_start;
+    reactor_cleanup(&reactor);
+
+    if (bench.sample_count == 0U) {
+        return;
+    }
+    qsort(bench.latency_ns, bench.sample_count, sizeof(uint64_t), compare_u64);
+    uint64_t sum = 0U;
+    for (uint32_t i = 0U; i < bench.sample_count; i++) {
+        sum += bench.latency_ns[i];
+    }
+    uint32_t p99_index = (uint32_t)(((uint64_t)bench.sample_count * 99U) / 100U);
+    if (p99_index >= bench.sample_count) {
+        p99_index = bench.sample_count - 1U;
+    }
+
+    printf("%6u Hz  %7lu ticks  延遲 平均 %7.1f us  p50 %7.1f us  p99 %7.1f us  最大 %7.1f us  CPU %5.2f%%  漏掉 %lu\n",
+           rate_hz, (unsigned long)bench.ticks,
+           ((double)sum / bench.sample_count) / 1e3,
+           (double)bench.latency_ns[bench.sample_count / 2U] / 1e3,
+           (double)bench.latency_ns[p99_index] / 1e3,
+           (double)bench.latency_ns[bench.sample_count - 1U] / 1e3,
+           (100.0 * (double)cpu) / (double)wall,
+           (unsigned long)(bench.ticks - bench.sample_count));
+}
+
+// 主程式
+// 用法: bmc_reactor                     示範 + 效能測試
+//       bmc_reactor --daemon [政策檔]    1 Hz daemon 模式，SIGHUP 重新載入政策，Ctrl-C 結束
+//                                        (預設 ../common/thermal_policy.conf)
+int main(int argc, char *argv[]) {
+    if ((argc > 1) && (strcmp(argv[1], "--daemon") == 0)) {
+        const char *policy_path = (argc > 2) ? argv[2] : REACTOR_POLICY_PATH;
+        return (run_fan_daemon(1000000000ULL, 0U, policy_path) == 0) ? 0 : 1;
+    }
+
+    printf("=== OpenBMC 事件迴圈 (epoll + timerfd + eventfd) ===\n");
+    printf("\n=== 1. 風扇控制 daemon 示範 (10 Hz 感測器，執行 3 秒) ===\n");
+    (void)run_fan_daemon(100000000ULL, 3U, REACTOR_POLICY_PATH);
+
+    printf("\n=== 2. 喚醒延遲與 CPU 使用率 ===\n");
+    wakeup_latency_benchmark(1U, 3U);
+    wakeup_latency_benchmark(100U, 200U);
+    wakeup_latency_benchmark(10000U, 20000U);
+
+    printf("\n=== 重點總結 ===\n");
+    printf("1. 所有工作都是 reactor 上的處理器，tick 之間行程睡在 epoll_wait()\n");
+    printf("2. timerfd 提供週期 tick，eventfd 串接處理器 (感測器 -> 狀態機 -> 日誌)\n");
+    printf("3. 日誌先寫入記憶體，批次刷新，熱路徑上沒有阻塞 I/O\n");
+
+    return 0;
+}
+
+#endif  // BMC_REACTOR_NO_MAIN
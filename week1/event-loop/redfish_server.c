@@ -0,0 +1,995 @@
+// redfish_server.c - 溫控區快照的串流 JSON 序列化 + 最小 HTTP 端點
+// 把所有區的狀態 (state_configs 名稱、溫度、風扇轉速、計數器) 輸出成 Redfish 風格的
+// ThermalZones 集合。序列化寫入呼叫端提供的緩衝區 (common/json_writer.h)，不配置記憶體：
+//   - thermal_snapshot_capture() 把各區要輸出的欄位複製成 ThermalZoneReading 陣列
+//   - thermal_snapshot_write()   整份快照寫進一個夠大的緩衝區
+//   - thermal_snapshot_fill()    分段輸出，每次只寫完整的區，10k 區以 16 KB 區塊送出
+// HTTP 端點跑在 bmc_reactor 上，以 chunked transfer encoding 邊序列化邊送出，
+// 一份回應會跨越多個 reactor tick，期間其他處理器 (例如 zone_drift_handler) 仍會更新區域。
+// 因此回應開始時先把所有區複製到該連線自己的讀值陣列 (init 時配置，10k 區約 160 KB)，
+// 之後的區塊都從這份複本輸出，整份文件是同一個時間點的狀態。連線池是固定陣列。
+//
+// 用法: redfish_server                    效能測試 + loopback 自我測試
+//       redfish_server --serve PORT SECS   在 127.0.0.1:PORT 提供服務 (SECS 為 0 時 Ctrl-C 結束)
+//       curl http://127.0.0.1:PORT/redfish/v1/Chassis/1/ThermalSubsystem/ThermalZones
+
+#ifndef REDFISH_SERVER_NO_MAIN
+#define SM_QUIET                    // 10k 區的狀態機不輸出逐筆訊息
+#endif
+#define BMC_REACTOR_NO_MAIN
+#include "bmc_reactor.c"
+#include "../common/json_writer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define REDFISH_ZONES_PATH          "/redfish/v1/Chassis/1/ThermalSubsystem/ThermalZones"
+#define REDFISH_MAX_CONNECTIONS     8U
+#define REDFISH_REQUEST_MAX         2048U
+#define REDFISH_CHUNK_SIZE          16384U
+#define REDFISH_CHUNK_HEADER        8U      // "xxxx\r\n" 靠右對齊，最多 6 位 16 進位
+#define REDFISH_CHUNK_TRAILER       2U      // "\r\n"
+
+// === 快照序列化 ===
+typedef enum {
+    SNAPSHOT_HEADER,
+    SNAPSHOT_ZONES,
+    SNAPSHOT_FOOTER,
+    SNAPSHOT_DONE
+} SnapshotPhase;
+
+// 序列化用到的欄位 (16 bytes，比整個 StateMachine 小得多)
+typedef struct {
+    TempMilliC temperature;
+    uint32_t state_transitions;
+    uint32_t events_processed;
+    uint8_t state;
+    uint8_t previous_state;
+    uint8_t fan_speed;
+    bool emergency_cooling_active;
+} ThermalZoneReading;
+
+typedef struct {
+    const ThermalZoneReading *zones;
+    uint32_t count;
+    uint32_t next;                  // 下一個要寫的區
+    SnapshotPhase phase;
+    JsonWriter writer;              // 跨區塊保留巢狀與逗號狀態
+} ThermalSnapshot;
+
+// Redfish Status.State / Status.Health 對應
+static const char *const zone_status_state[STATE_COUNT] = {
+    [STATE_IDLE] = "Starting",
+    [STATE_NORMAL] = "Enabled",
+    [STATE_WARNING] = "Enabled",
+    [STATE_CRITICAL] = "Enabled",
+    [STATE_EMERGENCY_COOLING] = "Enabled",
+    [STATE_SHUTDOWN] = "Disabled"
+};
+
+static const char *const zone_health[STATE_COUNT] = {
+    [STATE_IDLE] = "OK",
+    [STATE_NORMAL] = "OK",
+    [STATE_WARNING] = "Warning",
+    [STATE_CRITICAL] = "Critical",
+    [STATE_EMERGENCY_COOLING] = "Critical",
+    [STATE_SHUTDOWN] = "Critical"
+};
+
+static void thermal_snapshot_header(JsonWriter *w, uint32_t count) {
+    json_begin_object(w);
+    json_key(w, "@odata.type");
+    json_string(w, "#ThermalZoneCollection.ThermalZoneCollection");
+    json_key(w, "@odata.id");
+    json_string(w, REDFISH_ZONES_PATH);
+    json_key(w, "Name");
+    json_string(w, "Thermal Zone Collection");
+    json_key(w, "Members@odata.count");
+    json_uint(w, count);
+    json_key(w, "Members");
+    json_begin_array(w);
+}
+
+static void thermal_zone_write(JsonWriter *w, const ThermalZoneReading *zone, uint32_t index) {
+    json_begin_object(w);
+    json_key(w, "@odata.id");
+    json_string_uint(w, REDFISH_ZONES_PATH "/", index);
+    json_key(w, "Id");
+    json_string_uint(w, "", index);
+    json_key(w, "Name");
+    json_string_uint(w, "Zone ", index);
+    json_key(w, "Status");
+    json_begin_object(w);
+    json_key(w, "State");
+    json_string(w, zone_status_state[zone->state]);
+    json_key(w, "Health");
+    json_string(w, zone_health[zone->state]);
+    json_end_object(w);
+    json_key(w, "ReadingCelsius");
+    json_milli(w, zone->temperature);
+    json_key(w, "FanSpeedPercent");
+    json_uint(w, zone->fan_speed);
+    json_key(w, "Oem");
+    json_begin_object(w);
+    json_key(w, "OpenBMCTraining");
+    json_begin_object(w);
+    json_key(w, "State");
+    json_string(w, state_configs[zone->state].name);
+    json_key(w, "PreviousState");
+    json_string(w, state_configs[zone->previous_state].name);
+    json_key(w, "EmergencyCoolingActive");
+    json_bool(w, zone->emergency_cooling_active);
+    json_key(w, "StateTransitions");
+    json_uint(w, zone->state_transitions);
+    json_key(w, "EventsProcessed");
+    json_uint(w, zone->events_processed);
+    json_end_object(w);
+    json_end_object(w);
+    json_end_object(w);
+}
+
+// 複製目前的狀態；之後區域怎麼更新都不影響用這份讀值輸出的快照
+void thermal_snapshot_capture(const StateMachine *zones, uint32_t count, ThermalZoneReading *out) {
+    for (uint32_t i = 0U; i < count; i++) {
+        const StateMachine *sm = &zones[i];
+        out[i].temperature = sm->current_temperature;
+        out[i].state_transitions = sm->state_transitions;
+        out[i].events_processed = sm->events_processed;
+        out[i].state = (uint8_t)sm->current_state;
+        out[i].previous_state = (uint8_t)sm->previous_state;
+        out[i].fan_speed = sm->current_fan_speed;
+        out[i].emergency_cooling_active = sm->emergency_cooling_active;
+    }
+}
+
+void thermal_snapshot_begin(ThermalSnapshot *snap, const ThermalZoneReading *zones, uint32_t count) {
+    snap->zones = zones;
+    snap->count = count;
+    snap->next = 0U;
+    snap->phase = SNAPSHOT_HEADER;
+    json_writer_init(&snap->writer, NULL, 0U);
+}
+
+bool thermal_snapshot_done(const ThermalSnapshot *snap) {
+    return snap->phase == SNAPSHOT_DONE;
+}
+
+// 寫入下一段；只寫完整的元素，寫到一半放不下的會退回，下次從那裡繼續。
+// 回傳寫入的位元組數；尚未完成卻回傳 0 表示 cap 連一個區都放不下。
+size_t thermal_snapshot_fill(ThermalSnapshot *snap, char *buf, size_t cap) {
+    JsonWriter *w = &snap->writer;
+    JsonMark mark;
+    bool full = false;
+
+    json_writer_attach(w, buf, cap);
+
+    if (snap->phase == SNAPSHOT_HEADER) {
+        mark = json_writer_mark(w);
+        thermal_snapshot_header(w, snap->count);
+        if (w->overflow) {
+            json_writer_rollback(w, mark);
+            full = true;
+        } else {
+            snap->phase = SNAPSHOT_ZONES;
+        }
+    }
+
+    while (!full && (snap->phase == SNAPSHOT_ZONES)) {
+        if (snap->next >= snap->count) {
+            snap->phase = SNAPSHOT_FOOTER;
+        } else {
+            mark = json_writer_mark(w);
+            thermal_zone_write(w, &snap->zones[snap->next], snap->next);
+            if (w->overflow) {
+                json_writer_rollback(w, mark);
+                full = true;
+            } else {
+                snap->next++;
+            }
+        }
+    }
+
+    if (!full && (snap->phase == SNAPSHOT_FOOTER)) {
+        mark = json_writer_mark(w);
+        json_end_array(w);
+        json_end_object(w);
+        if (w->overflow) {
+            json_writer_rollback(w, mark);
+        } else {
+            snap->phase = SNAPSHOT_DONE;
+        }
+    }
+
+    return w->len;
+}
+
+// 整份快照寫進 buf；放不下時回傳 0
+size_t thermal_snapshot_write(const ThermalZoneReading *zones, uint32_t count, char *buf, size_t cap) {
+    ThermalSnapshot snap;
+
+    thermal_snapshot_begin(&snap, zones, count);
+    size_t len = thermal_snapshot_fill(&snap, buf, cap);
+
+    return thermal_snapshot_done(&snap) ? len : 0U;
+}
+
+// === HTTP 端點 ===
+typedef enum {
+    CONN_FREE,
+    CONN_READING,
+    CONN_WRITING
+} ConnectionState;
+
+typedef struct RedfishServer RedfishServer;
+
+typedef struct {
+    RedfishServer *server;
+    int fd;
+    ConnectionState state;
+    bool streaming;                 // 回應本體是分段的快照
+    bool last_chunk_sent;
+    char request[REDFISH_REQUEST_MAX];
+    size_t request_len;
+    ThermalSnapshot snapshot;
+    ThermalZoneReading *readings;   // 回應開始時的區域複本，server->zone_count 筆
+    char out[REDFISH_CHUNK_HEADER + REDFISH_CHUNK_SIZE + REDFISH_CHUNK_TRAILER];
+    size_t out_off;
+    size_t out_len;
+} RedfishConnection;
+
+struct RedfishServer {
+    Reactor *reactor;
+    int listen_fd;
+    uint16_t port;
+    const StateMachine *zones;
+    uint32_t zone_count;
+    uint64_t responses;
+    uint64_t stop_after;            // 完成這麼多個回應後停止 reactor，0 表示不限
+    uint64_t bytes_sent;
+    uint64_t rejected;
+    RedfishConnection connections[REDFISH_MAX_CONNECTIONS];
+};
+
+static void redfish_close(RedfishConnection *conn) {
+    RedfishServer *server = conn->server;
+
+    (void)reactor_remove_fd(server->reactor, conn->fd);
+    conn->state = CONN_FREE;
+    conn->fd = -1;
+}
+
+// 把 JSON 區塊包成 chunked 格式：資料直接寫在 out[REDFISH_CHUNK_HEADER] 之後，
+// 長度標頭靠右寫進前面保留的空間，不需要再複製一次
+static bool redfish_next_chunk(RedfishConnection *conn) {
+    static const char hex[] = "0123456789abcdef";
+    bool produced = true;
+
+    if (!thermal_snapshot_done(&conn->snapshot)) {
+        char *data = &conn->out[REDFISH_CHUNK_HEADER];
+        size_t n = thermal_snapshot_fill(&conn->snapshot, data, REDFISH_CHUNK_SIZE);
+        size_t pos = REDFISH_CHUNK_HEADER;
+
+        if (n == 0U) {
+            produced = false;       // 單一區超過區塊大小
+        } else {
+            conn->out[--pos] = '\n';
+            conn->out[--pos] = '\r';
+            for (size_t v = n; v > 0U; v >>= 4) {
+                conn->out[--pos] = hex[v & 0x0FU];
+            }
+            memcpy(&data[n], "\r\n", REDFISH_CHUNK_TRAILER);
+            conn->out_off = pos;
+            conn->out_len = REDFISH_CHUNK_HEADER + n + REDFISH_CHUNK_TRAILER;
+        }
+    } else if (!conn->last_chunk_sent) {
+        memcpy(conn->out, "0\r\n\r\n", 5U);
+        conn->out_off = 0U;
+        conn->out_len = 5U;
+        conn->last_chunk_sent = true;
+    } else {
+        produced = false;
+    }
+
+    return produced;
+}
+
+// 盡量寫出；socket 滿了就改等 EPOLLOUT，回應結束後關閉連線
+static void redfish_flush(RedfishConnection *conn) {
+    RedfishServer *server = conn->server;
+    bool finished = false;
+    bool blocked = false;
+
+    while (!finished && !blocked) {
+        if (conn->out_off == conn->out_len) {
+            if (!conn->streaming || !redfish_next_chunk(conn)) {
+                finished = true;
+                continue;
+            }
+        }
+        ssize_t n = send(conn->fd, &conn->out[conn->out_off], conn->out_len - conn->out_off,
+                         MSG_NOSIGNAL);
+        if (n > 0) {
+            conn->out_off += (size_t)n;
+            server->bytes_sent += (uint64_t)n;
+        } else if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+            blocked = true;
+        } else if ((n < 0) && (errno == EINTR)) {
+            continue;
+        } else {
+            break;                  // 對方已關閉
+        }
+    }
+
+    if (blocked) {
+        (void)reactor_modify_fd(server->reactor, conn->fd, EPOLLOUT);
+    } else {
+        if (finished) {
+            server->responses++;
+        }
+        redfish_close(conn);
+        if ((server->stop_after > 0U) && (server->responses >= server->stop_after)) {
+            reactor_stop(server->reactor);
+        }
+    }
+}
+
+static void redfish_respond_error(RedfishConnection *conn, uint32_t status, const char *reason,
+                                  const char *message) {
+    char body[256];
+    JsonWriter w;
+
+    json_writer_init(&w, body, sizeof(body));
+    json_begin_object(&w);
+    json_key(&w, "error");
+    json_begin_object(&w);
+    json_key(&w, "code");
+    json_string(&w, "Base.1.0.GeneralError");
+    json_key(&w, "message");
+    json_string(&w, message);
+    json_end_object(&w);
+    json_end_object(&w);
+
+    int len = snprintf(conn->out, sizeof(conn->out),
+                       "HTTP/1.1 %u %s\r\nContent-Type: application/json\r\n"
+                       "Content-Length: %zu\r\nConnection: close\r\n\r\n%.*s",
+                       status, reason, w.len, (int)w.len, body);
+    conn->out_off = 0U;
+    conn->out_len = ((len > 0) && ((size_t)len < sizeof(conn->out))) ? (size_t)len : 0U;
+    conn->streaming = false;
+}
+
+// 解析請求列並準備回應標頭；只支援 GET 與一個資源
+static void redfish_handle_request(RedfishConnection *conn) {
+    RedfishServer *server = conn->server;
+    static const char path[] = REDFISH_ZONES_PATH;
+    static const char header[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/json\r\n"
+        "OData-Version: 4.0\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Connection: close\r\n\r\n";
+
+    conn->state = CONN_WRITING;
+    if (strncmp(conn->request, "GET ", 4U) != 0) {
+        redfish_respond_error(conn, 405U, "Method Not Allowed", "Only GET is supported");
+    } else if ((strncmp(&conn->request[4], path, sizeof(path) - 1U) != 0) ||
+               (conn->request[4U + sizeof(path) - 1U] != ' ')) {
+        redfish_respond_error(conn, 404U, "Not Found", "Resource not found");
+    } else {
+        memcpy(conn->out, header, sizeof(header) - 1U);
+        conn->out_off = 0U;
+        conn->out_len = sizeof(header) - 1U;
+        conn->streaming = true;
+        conn->last_chunk_sent = false;
+        thermal_snapshot_capture(server->zones, server->zone_count, conn->readings);
+        thermal_snapshot_begin(&conn->snapshot, conn->readings, server->zone_count);
+    }
+}
+
+void redfish_connection_handler(Reactor *reactor, int fd, uint32_t events, void *user_data) {
+    RedfishConnection *conn = (RedfishConnection *)user_data;
+    (void)reactor;
+
+    if (conn->state == CONN_WRITING) {
+        redfish_flush(conn);
+        return;
+    }
+    if ((events & (EPOLLERR | EPOLLHUP)) != 0U) {
+        redfish_close(conn);
+        return;
+    }
+
+    ssize_t n = recv(fd, &conn->request[conn->request_len],
+                     sizeof(conn->request) - 1U - conn->request_len, 0);
+    if (n <= 0) {
+        if ((n == 0) || ((errno != EAGAIN) && (errno != EINTR))) {
+            redfish_close(conn);
+        }
+        return;
+    }
+    conn->request_len += (size_t)n;
+    conn->request[conn->request_len] = '\0';
+
+    if (strstr(conn->request, "\r\n\r\n") != NULL) {
+        redfish_handle_request(conn);
+        redfish_flush(conn);
+    } else if (conn->request_len >= (sizeof(conn->request) - 1U)) {
+        redfish_close(conn);        // 標頭過大
+    }
+}
+
+void redfish_accept_handler(Reactor *reactor, int fd, uint32_t events, void *user_data) {
+    RedfishServer *server = (RedfishServer *)user_data;
+    (void)events;
+
+    for (;;) {
+        int client = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client < 0) {
+            break;
+        }
+
+        RedfishConnection *conn = NULL;
+        for (uint32_t i = 0U; i < REDFISH_MAX_CONNECTIONS; i++) {
+            if (server->connections[i].state == CONN_FREE) {
+                conn = &server->connections[i];
+                break;
+            }
+        }
+        if ((conn == NULL) ||
+            (reactor_add_fd(reactor, client, EPOLLIN, redfish_connection_handler, conn) != 0)) {
+            server->rejected++;
+            close(client);
+            continue;
+        }
+        conn->server = server;
+        conn->fd = client;
+        conn->state = CONN_READING;
+        conn->request_len = 0U;
+    }
+}
+
+// 釋放各連線的讀值陣列；socket 已註冊在 reactor，由 reactor_cleanup 關閉
+void redfish_server_cleanup(RedfishServer *server) {
+    for (uint32_t i = 0U; i < REDFISH_MAX_CONNECTIONS; i++) {
+        free(server->connections[i].readings);
+        server->connections[i].readings = NULL;
+    }
+}
+
+// 在 127.0.0.1:port 監聽；port 為 0 時由系統挑選，實際埠號寫回 server->port。
+// 每個連線的讀值陣列在這裡一次配置好，處理請求時不再配置記憶體
+int redfish_server_init(RedfishServer *server, Reactor *reactor, uint16_t port,
+                        const StateMachine *zones, uint32_t zone_count) {
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+    };
+    socklen_t addr_len = sizeof(addr);
+    int one = 1;
+
+    memset(server, 0, sizeof(*server));
+    server->reactor = reactor;
+    server->zones = zones;
+    server->zone_count = zone_count;
+    server->listen_fd = -1;
+    for (uint32_t i = 0U; i < REDFISH_MAX_CONNECTIONS; i++) {
+        server->connections[i].fd = -1;
+        server->connections[i].readings = (ThermalZoneReading *)calloc(zone_count, sizeof(ThermalZoneReading));
+        if (server->connections[i].readings == NULL) {
+            redfish_server_cleanup(server);
+            return -1;
+        }
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        redfish_server_cleanup(server);
+        return -1;
+    }
+    (void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if ((bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+        (listen(fd, 16) != 0) ||
+        (getsockname(fd, (struct sockaddr *)&addr, &addr_len) != 0) ||
+        (reactor_add_fd(reactor, fd, EPOLLIN, redfish_accept_handler, server) != 0)) {
+        close(fd);
+        redfish_server_cleanup(server);
+        return -1;
+    }
+    server->listen_fd = fd;
+    server->port = ntohs(addr.sin_port);
+
+    return 0;
+}
+
+#ifndef REDFISH_SERVER_NO_MAIN
+#include <malloc.h>
+#include <pthread.h>
+
+#define BENCH_ZONES                 10000U
+#define SNAPSHOT_BUFFER_SIZE        (8U * 1024U * 1024U)
+#define BENCH_MIN_NS                500000000ULL
+#define LOOPBACK_ROUNDS             20U
+#define DRIFT_TEST_PERIOD_NS        5000000ULL      // 一致性測試中每 5 ms 更新全部區域
+#define DRIFT_TEST_RECV_BYTES       4096U           // 慢速客戶端每次只讀 4 KB
+#define DRIFT_TEST_RECV_PAUSE_US    200U
+
+static StateMachine zones[BENCH_ZONES];
+static ThermalZoneReading readings[BENCH_ZONES];
+static ThermalZoneReading reference_readings[BENCH_ZONES];
+static char snapshot_buffer[SNAPSHOT_BUFFER_SIZE];
+static char reference_buffer[SNAPSHOT_BUFFER_SIZE];
+
+// 各區餵入不同的溫度序列，讓狀態、計數器與溫度都有變化
+static void zones_init(uint32_t count) {
+    uint32_t rng = 0x2545F491U;
+
+    for (uint32_t i = 0U; i < count; i++) {
+        sm_init(&zones[i]);
+        sm_process_event(&zones[i], EVENT_SYSTEM_INIT);
+        uint32_t steps = 1U + (i % 7U);
+        for (uint32_t s = 0U; s < steps; s++) {
+            rng ^= rng << 13;
+            rng ^= rng >> 17;
+            rng ^= rng << 5;
+            TempMilliC temp = TEMP_MC_FROM_C(35) + (TempMilliC)(rng % 65000U);
+            zones[i].current_temperature = temp;
+            sm_process_event(&zones[i], get_temperature_event(temp));
+        }
+    }
+}
+
+// 對照組：同樣的輸出以 snprintf 逐欄位格式化
+static size_t snapshot_write_snprintf(const StateMachine *sms, uint32_t count, char *buf, size_t cap) {
+    size_t len = 0U;
+    int n = snprintf(buf, cap,
+                     "{\"@odata.type\":\"#ThermalZoneCollection.ThermalZoneCollection\","
+                     "\"@odata.id\":\"" REDFISH_ZONES_PATH "\",\"Name\":\"Thermal Zone Collection\","
+                     "\"Members@odata.count\":%u,\"Members\":[", count);
+
+    for (uint32_t i = 0U; (i <= count) && (n > 0) && ((size_t)n < (cap - len)); i++) {
+        len += (size_t)n;
+        if (i == count) {
+            n = snprintf(&buf[len], cap - len, "]}");
+        } else {
+            const StateMachine *sm = &sms[i];
+            TempMilliC t = sm->current_temperature;
+            n = snprintf(&buf[len], cap - len,
+                         "%s{\"@odata.id\":\"" REDFISH_ZONES_PATH "/%u\",\"Id\":\"%u\",\"Name\":\"Zone %u\","
+                         "\"Status\":{\"State\":\"%s\",\"Health\":\"%s\"},"
+                         "\"ReadingCelsius\":%s%d.%03d,\"FanSpeedPercent\":%u,"
+                         "\"Oem\":{\"OpenBMCTraining\":{\"State\":\"%s\",\"PreviousState\":\"%s\","
+                         "\"EmergencyCoolingActive\":%s,\"StateTransitions\":%u,\"EventsProcessed\":%u}}}",
+                         (i == 0U) ? "" : ",", i, i, i,
+                         zone_status_state[sm->current_state], zone_health[sm->current_state],
+                         (t < 0) ? "-" : "", abs(t / 1000), abs(t % 1000), sm->current_fan_speed,
+                         state_configs[sm->current_state].name, state_configs[sm->previous_state].name,
+                         sm->emergency_cooling_active ? "true" : "false",
+                         sm->state_transitions, sm->events_processed);
+        }
+    }
+    if ((n > 0) && ((size_t)n < (cap - len))) {
+        len += (size_t)n;
+    } else {
+        len = 0U;
+    }
+
+    return len;
+}
+
+typedef enum {
+    SERIALIZE_FULL,
+    SERIALIZE_CHUNKED,
+    SERIALIZE_SNPRINTF
+} SerializeMode;
+
+static size_t serialize_once(SerializeMode mode) {
+    size_t total = 0U;
+
+    // 與 HTTP 端點相同，每份快照都先複製區域狀態
+    if (mode == SERIALIZE_FULL) {
+        thermal_snapshot_capture(zones, BENCH_ZONES, readings);
+        total = thermal_snapshot_write(readings, BENCH_ZONES, snapshot_buffer, sizeof(snapshot_buffer));
+    } else if (mode == SERIALIZE_CHUNKED) {
+        ThermalSnapshot snap;
+        thermal_snapshot_capture(zones, BENCH_ZONES, readings);
+        thermal_snapshot_begin(&snap, readings, BENCH_ZONES);
+        while (!thermal_snapshot_done(&snap)) {
+            size_t n = thermal_snapshot_fill(&snap, snapshot_buffer, REDFISH_CHUNK_SIZE);
+            if (n == 0U) {
+                break;
+            }
+            total += n;
+        }
+    } else {
+        total = snapshot_write_snprintf(zones, BENCH_ZONES, snapshot_buffer, sizeof(snapshot_buffer));
+    }
+
+    return total;
+}
+
+static void serialize_benchmark(const char *label, SerializeMode mode) {
+    uint64_t rounds = 0U;
+    uint64_t bytes = 0U;
+    size_t heap_before = mallinfo2().uordblks;
+    uint64_t start = sm_stats_now_ns();
+    uint64_t elapsed;
+
+    do {
+        bytes += serialize_once(mode);
+        rounds++;
+        elapsed = sm_stats_now_ns() - start;
+    } while (elapsed < BENCH_MIN_NS);
+
+    size_t heap_after = mallinfo2().uordblks;
+    double seconds = (double)elapsed / 1e9;
+    printf("  %-22s %8.1f 快照/s  %8.1f MB/s  %6.1f ns/區  堆積變化 %zd bytes\n",
+           label, (double)rounds / seconds, ((double)bytes / seconds) / 1e6,
+           (double)elapsed / ((double)rounds * BENCH_ZONES),
+           (ssize_t)(heap_after - heap_before));
+}
+
+// === loopback 自我測試 ===
+typedef struct {
+    uint16_t port;
+    uint32_t rounds;
+    bool ok;
+    uint64_t elapsed_ns;
+    uint64_t body_bytes;
+    int not_found_status;
+} LoopbackClient;
+
+static char client_raw[SNAPSHOT_BUFFER_SIZE + (SNAPSHOT_BUFFER_SIZE / 8U)];
+static char client_body[SNAPSHOT_BUFFER_SIZE];
+
+// 送出 GET 並讀到連線關閉；回傳 HTTP 狀態碼，失敗時回傳 -1
+static int http_get(uint16_t port, const char *path, size_t *raw_len) {
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+    };
+    char request[256];
+    int status = -1;
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", path);
+    if ((connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) &&
+        (send(fd, request, (size_t)len, MSG_NOSIGNAL) == (ssize_t)len)) {
+        size_t total = 0U;
+        ssize_t n;
+        while ((total < sizeof(client_raw)) &&
+               ((n = recv(fd, &client_raw[total], sizeof(client_raw) - total, 0)) > 0)) {
+            total += (size_t)n;
+        }
+        *raw_len = total;
+        if ((total > 12U) && (strncmp(client_raw, "HTTP/1.1 ", 9U) == 0)) {
+            status = atoi(&client_raw[9]);
+        }
+    }
+    close(fd);
+
+    return status;
+}
+
+// 去掉 HTTP 標頭與 chunked 編碼，本體放進 client_body；格式錯誤時回傳 false
+static bool http_dechunk(size_t raw_len, size_t *body_len) {
+    const char *end = &client_raw[raw_len];
+    const char *p = memmem(client_raw, raw_len, "\r\n\r\n", 4U);
+    size_t len = 0U;
+    bool ok = false;
+
+    if (p == NULL) {
+        return false;
+    }
+    p += 4;
+    while (p < end) {
+        char *next;
+        unsigned long size = strtoul(p, &next, 16);
+        if ((next + 2 > end) || (next[0] != '\r') || (next[1] != '\n')) {
+            break;
+        }
+        p = next + 2;
+        if (size == 0UL) {
+            ok = true;
+            break;
+        }
+        if ((p + size + 2U > end) || ((len + size) > sizeof(client_body))) {
+            break;
+        }
+        memcpy(&client_body[len], p, size);
+        len += size;
+        p += size + 2U;
+    }
+    *body_len = len;
+
+    return ok;
+}
+
+static void *loopback_client_thread(void *arg) {
+    LoopbackClient *client = (LoopbackClient *)arg;
+    size_t raw_len = 0U;
+    size_t body_len = 0U;
+    size_t expected;
+
+    thermal_snapshot_capture(zones, BENCH_ZONES, reference_readings);
+    expected = thermal_snapshot_write(reference_readings, BENCH_ZONES, reference_buffer,
+                                      sizeof(reference_buffer));
+
+    client->ok = (expected > 0U);
+    uint64_t start = sm_stats_now_ns();
+    for (uint32_t r = 0U; client->ok && (r < client->rounds); r++) {
+        client->ok = (http_get(client->port, REDFISH_ZONES_PATH, &raw_len) == 200) &&
+                     http_dechunk(raw_len, &body_len) &&
+                     (body_len == expected) &&
+                     (memcmp(client_body, reference_buffer, expected) == 0);
+        client->body_bytes += body_len;
+    }
+    client->elapsed_ns = sm_stats_now_ns() - start;
+    client->not_found_status = http_get(client->port, "/redfish/v1/Nope", &raw_len);
+
+    return NULL;
+}
+
+static void loopback_self_test(void) {
+    static RedfishServer server;
+    static LoopbackClient client;
+    Reactor reactor;
+    pthread_t thread;
+
+    if ((reactor_init(&reactor) != 0) ||
+        (redfish_server_init(&server, &reactor, 0U, zones, BENCH_ZONES) != 0)) {
+        printf("  [失敗] 無法建立 HTTP 端點\n");
+        return;
+    }
+    server.stop_after = LOOPBACK_ROUNDS + 1U;
+    (void)reactor_add_timer(&reactor, 10000000000ULL, deadline_handler, NULL);  // 保險：10 秒
+
+    client.port = server.port;
+    client.rounds = LOOPBACK_ROUNDS;
+    if (pthread_create(&thread, NULL, loopback_client_thread, &client) != 0) {
+        reactor_cleanup(&reactor);
+        return;
+    }
+    reactor_run(&reactor);
+    pthread_join(thread, NULL);
+    reactor_cleanup(&reactor);
+    redfish_server_cleanup(&server);
+
+    double seconds = (double)client.elapsed_ns / 1e9;
+    printf("  %u 次 GET (chunked, %u KB 區塊): %.1f 快照/s  %.1f MB/s\n",
+           LOOPBACK_ROUNDS, REDFISH_CHUNK_SIZE / 1024U,
+           (double)LOOPBACK_ROUNDS / seconds, ((double)client.body_bytes / seconds) / 1e6);
+    printf("  本體與 thermal_snapshot_write() 完全相同: %s\n", client.ok ? "是" : "否");
+    printf("  未知路徑回應: %d (預期 404)\n", client.not_found_status);
+    printf("  伺服器: 回應 %lu, 送出 %lu bytes, 拒絕連線 %lu\n",
+           (unsigned long)server.responses, (unsigned long)server.bytes_sent,
+           (unsigned long)server.rejected);
+    printf("  [%s] loopback 自我測試\n",
+           (client.ok && (client.not_found_status == 404)) ? "通過" : "失敗");
+}
+
+// 服務模式：每秒讓每個區的溫度小幅漂移，快照內容會跟著變
+typedef struct {
+    uint32_t rng;
+    uint64_t ticks;
+} DriftState;
+
+void zone_drift_handler(Reactor *reactor, int fd, uint32_t events, void *user_data) {
+    DriftState *drift = (DriftState *)user_data;
+    (void)reactor;
+    (void)events;
+
+    if (reactor_drain(fd) == 0U) {
+        return;
+    }
+    for (uint32_t i = 0U; i < BENCH_ZONES; i++) {
+        drift->rng = (drift->rng * 1103515245U) + 12345U;
+        TempMilliC delta = (TempMilliC)((drift->rng >> 16) % 2001U) - 1000;
+        TempMilliC temp = temp_mc_add_sat(zones[i].current_temperature, delta);
+        zones[i].current_temperature = temp;
+        sm_process_event(&zones[i], get_temperature_event(temp));
+    }
+    drift->ticks++;
+}
+
+// === 回應期間區域持續更新：整份文件仍須是同一個時間點 ===
+// 每次 zone_drift_handler 都讓每個區處理一個事件，所以一致的快照中
+// 每個區的 EventsProcessed 相對於開始時都多出同一個數字
+typedef struct {
+    uint16_t port;
+    int status;
+    size_t body_bytes;
+} SlowClient;
+
+static uint32_t drift_base_events[BENCH_ZONES];
+
+static void *slow_client_thread(void *arg) {
+    SlowClient *client = (SlowClient *)arg;
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(client->port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+    };
+    static const char request[] = "GET " REDFISH_ZONES_PATH " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    int rcvbuf = (int)DRIFT_TEST_RECV_BYTES;
+    size_t total = 0U;
+
+    client->status = -1;
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    (void)setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    if ((connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) &&
+        (send(fd, request, sizeof(request) - 1U, MSG_NOSIGNAL) == (ssize_t)(sizeof(request) - 1U))) {
+        ssize_t n;
+        while ((total < sizeof(client_raw)) &&
+               ((n = recv(fd, &client_raw[total],
+                          ((sizeof(client_raw) - total) < DRIFT_TEST_RECV_BYTES) ?
+                          (sizeof(client_raw) - total) : DRIFT_TEST_RECV_BYTES, 0)) > 0)) {
+            total += (size_t)n;
+            (void)usleep(DRIFT_TEST_RECV_PAUSE_US);
+        }
+        if ((total > 12U) && (strncmp(client_raw, "HTTP/1.1 ", 9U) == 0)) {
+            client->status = atoi(&client_raw[9]);
+        }
+    }
+    close(fd);
+    if ((client->status == 200) && !http_dechunk(total, &client->body_bytes)) {
+        client->status = -1;
+    }
+
+    return NULL;
+}
+
+// 回傳所有區共同的 EventsProcessed 增量；不一致或解析失敗時回傳 -1
+static int64_t snapshot_event_offset(size_t body_len, uint32_t *mismatched) {
+    static const char key[] = "\"EventsProcessed\":";
+    const char *p = client_body;
+    const char *end = &client_body[body_len];
+    int64_t offset = -1;
+    uint32_t zone = 0U;
+
+    *mismatched = 0U;
+    while ((p < end) && (zone < BENCH_ZONES)) {
+        const char *hit = memmem(p, (size_t)(end - p), key, sizeof(key) - 1U);
+        if (hit == NULL) {
+            break;
+        }
+        char *next;
+        int64_t delta = (int64_t)strtoul(hit + sizeof(key) - 1U, &next, 10) - drift_base_events[zone];
+        if (zone == 0U) {
+            offset = delta;
+        } else if (delta != offset) {
+            (*mismatched)++;
+        }
+        p = next;
+        zone++;
+    }
+
+    return ((zone == BENCH_ZONES) && (*mismatched == 0U)) ? offset : -1;
+}
+
+static void drift_consistency_test(void) {
+    static RedfishServer server;
+    static SlowClient client;
+    static DriftState drift = { 777U, 0U };
+    Reactor reactor;
+    pthread_t thread;
+
+    for (uint32_t i = 0U; i < BENCH_ZONES; i++) {
+        drift_base_events[i] = zones[i].events_processed;
+    }
+    if ((reactor_init(&reactor) != 0) ||
+        (redfish_server_init(&server, &reactor, 0U, zones, BENCH_ZONES) != 0)) {
+        printf("  [失敗] 無法建立 HTTP 端點\n");
+        return;
+    }
+    server.stop_after = 1U;
+    (void)reactor_add_timer(&reactor, DRIFT_TEST_PERIOD_NS, zone_drift_handler, &drift);
+    (void)reactor_add_timer(&reactor, 10000000000ULL, deadline_handler, NULL);  // 保險：10 秒
+
+    client.port = server.port;
+    if (pthread_create(&thread, NULL, slow_client_thread, &client) != 0) {
+        reactor_cleanup(&reactor);
+        redfish_server_cleanup(&server);
+        return;
+    }
+    reactor_run(&reactor);
+    pthread_join(thread, NULL);
+    reactor_cleanup(&reactor);
+    redfish_server_cleanup(&server);
+
+    uint32_t mismatched = 0U;
+    int64_t offset = (client.status == 200) ? snapshot_event_offset(client.body_bytes, &mismatched) : -1;
+    printf("  慢速客戶端讀完 %zu bytes 期間，區域更新 %lu 次\n", client.body_bytes,
+           (unsigned long)drift.ticks);
+    printf("  快照中各區 EventsProcessed 增量: %s%ld (不一致的區 %u)\n",
+           (offset >= 0) ? "全部為 " : "", (long)offset, mismatched);
+    printf("  [%s] 串流回應是單一時間點的快照\n",
+           ((offset >= 0) && (drift.ticks > 0U)) ? "通過" : "失敗");
+}
+
+static int serve(uint16_t port, uint32_t seconds) {
+    static RedfishServer server;
+    static DriftState drift = { 12345U, 0U };
+    Reactor reactor;
+
+    if ((reactor_init(&reactor) != 0) ||
+        (redfish_server_init(&server, &reactor, port, zones, BENCH_ZONES) != 0)) {
+        perror("redfish_server_init");
+        return 1;
+    }
+    (void)reactor_add_timer(&reactor, 1000000000ULL, zone_drift_handler, &drift);
+    if (seconds > 0U) {
+        (void)reactor_add_timer(&reactor, (uint64_t)seconds * 1000000000ULL, deadline_handler, NULL);
+    } else {
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        sigprocmask(SIG_BLOCK, &mask, NULL);
+        int sig_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        if ((sig_fd < 0) || (reactor_add_fd(&reactor, sig_fd, EPOLLIN, signal_handler, NULL) != 0)) {
+            printf("註冊訊號處理器失敗\n");
+        }
+    }
+
+    printf("服務中: http://127.0.0.1:%u" REDFISH_ZONES_PATH " (%u 區)\n", server.port, BENCH_ZONES);
+    fflush(stdout);
+    reactor_run(&reactor);
+    printf("回應 %lu, 送出 %lu bytes, 溫度更新 %lu 次\n", (unsigned long)server.responses,
+           (unsigned long)server.bytes_sent, (unsigned long)drift.ticks);
+    reactor_cleanup(&reactor);
+    redfish_server_cleanup(&server);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    zones_init(BENCH_ZONES);
+
+    if ((argc > 3) && (strcmp(argv[1], "--serve") == 0)) {
+        return serve((uint16_t)atoi(argv[2]), (uint32_t)atoi(argv[3]));
+    }
+
+    printf("=== Redfish 快照串流序列化 (%u 區) ===\n", BENCH_ZONES);
+
+    thermal_snapshot_capture(zones, BENCH_ZONES, readings);
+    size_t full = thermal_snapshot_write(readings, BENCH_ZONES, snapshot_buffer, sizeof(snapshot_buffer));
+    size_t reference = snapshot_write_snprintf(zones, BENCH_ZONES, reference_buffer,
+                                               sizeof(reference_buffer));
+    printf("\n=== 1. 正確性 ===\n");
+    printf("  快照大小 %zu bytes (%.1f bytes/區)\n", full, (double)full / BENCH_ZONES);
+    printf("  與 snprintf 版本逐位元組相同: %s\n",
+           ((full == reference) && (memcmp(snapshot_buffer, reference_buffer, full) == 0)) ? "是" : "否");
+    printf("  4 KB 緩衝區放不下整份快照: 回傳 %zu (預期 0)\n",
+           thermal_snapshot_write(readings, BENCH_ZONES, snapshot_buffer, 4096U));
+    printf("  最前面: %.150s...\n", snapshot_buffer);
+
+    printf("\n=== 2. 序列化吞吐量 ===\n");
+    serialize_benchmark("json_writer/full", SERIALIZE_FULL);
+    serialize_benchmark("json_writer/16KB-chunks", SERIALIZE_CHUNKED);
+    serialize_benchmark("snprintf (對照)", SERIALIZE_SNPRINTF);
+
+    printf("\n=== 3. HTTP loopback ===\n");
+    loopback_self_test();
+
+    printf("\n=== 4. 回應期間區域持續更新 ===\n");
+    drift_consistency_test();
+
+    printf("\n=== 重點總結 ===\n");
+    printf("1. 寫入呼叫端的緩衝區，序列化路徑上沒有 malloc\n");
+    printf("2. 整數每次轉兩位數，溫度直接由毫度輸出三位小數，不經過 printf\n");
+    printf("3. 分段輸出只寫完整的區，HTTP 以 chunked 編碼邊序列化邊送出\n");
+    printf("4. 回應開始時複製區域狀態，跨 tick 送出的文件仍是同一個時間點\n");
+
+    return 0;
+}
+
+#endif  // REDFISH_SERVER_NO_MAIN
@@ -0,0 +1,378 @@
+// rt_control_loop.c - 即時控制迴圈：風扇狀態機的週期執行器與截止時間量測
+// 風扇迴圈必須每 TEMPERATURE_CHECK_INTERVAL 執行一次，即使 BMC 同時忙著處理 web 與 IPMI。
+// 這裡的執行器可以逐項啟用即時化設定：
+//   - SCHED_FIFO 優先權、綁定 CPU
+//   - mlockall(MCL_CURRENT | MCL_FUTURE)、預先觸碰堆疊、關閉 malloc 歸還記憶體
+//   - clock_nanosleep(TIMER_ABSTIME) 以絕對時間排程，誤差不會累積
+// 每個 tick 記錄喚醒抖動 (實際喚醒 - 排定時間)、執行時間，以及截止時間錯過次數。
+// 效能測試在合成的 CPU 與記憶體負載下，比較即時迴圈與 "工作後 usleep(週期)" 的簡單迴圈。
+//
+// 用法: rt_control_loop                     效能測試 (1 kHz，各情境 2 秒)
+//       rt_control_loop --run SECONDS       以 TEMPERATURE_CHECK_INTERVAL 週期執行風扇迴圈
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define SM_QUIET
+#ifndef FAN_CONTROL_NO_MAIN
+#define FAN_CONTROL_NO_MAIN
+#endif
+#include "../state-machine/fan_control_state_machine.c"
+
+#define RT_LOOP_ZONES               64U
+#define RT_LOOP_STACK_PREFAULT      (256U * 1024U)
+
+// === 執行器 ===
+typedef enum {
+    RT_SLEEP_RELATIVE,              // 工作完成後 usleep(週期)：誤差累積，執行時間算進週期
+    RT_SLEEP_ABSOLUTE               // clock_nanosleep(TIMER_ABSTIME) 到下一個排定時間
+} RtSleepMode;
+
+typedef struct {
+    uint64_t period_ns;
+    RtSleepMode sleep_mode;
+    int cpu;                        // 綁定的 CPU，-1 表示不綁定
+    int fifo_priority;              // 1..99 使用 SCHED_FIFO，0 表示維持 SCHED_OTHER
+    bool lock_memory;
+} RtLoopConfig;
+
+typedef struct {
+    SmHistogram jitter;             // 實際喚醒 - 排定時間
+    SmHistogram exec;               // tick 工作的執行時間
+    uint64_t ticks;
+    uint64_t deadline_misses;       // 工作在下一個 tick 排定時間之後才完成
+    uint64_t skipped_ticks;         // 喚醒時已經錯過的整個週期 (不補跑)
+    uint64_t elapsed_ns;
+} RtLoopStats;
+
+// 每個 tick 呼叫一次；tick 從 0 開始
+typedef void (*RtTickFn)(void *ctx, uint64_t tick);
+
+static inline uint64_t rt_timespec_ns(const struct timespec *ts) {
+    return ((uint64_t)ts->tv_sec * 1000000000ULL) + (uint64_t)ts->tv_nsec;
+}
+
+static inline struct timespec rt_ns_timespec(uint64_t ns) {
+    struct timespec ts = {
+        .tv_sec = (time_t)(ns / 1000000000ULL),
+        .tv_nsec = (long)(ns % 1000000000ULL)
+    };
+    return ts;
+}
+
+// 觸碰一段堆疊，讓 mlockall 之後的堆疊成長不會在迴圈中觸發缺頁
+static void __attribute__((noinline)) rt_prefault_stack(void) {
+    uint8_t stack[RT_LOOP_STACK_PREFAULT];
+    memset(stack, 0, sizeof(stack));
+    __asm__ volatile("" : : "r"(stack) : "memory");     // 不讓編譯器省略寫入
+}
+
+// 套用即時化設定；每一項各自可能失敗 (例如沒有 CAP_SYS_NICE)，
+// 失敗時印出原因並繼續，回傳成功套用的項目數
+int rt_loop_setup(const RtLoopConfig *cfg, bool verbose) {
+    int applied = 0;
+
+    if (cfg->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cfg->cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+            applied++;
+        } else if (verbose) {
+            printf("  [設定] 綁定 CPU %d 失敗\n", cfg->cpu);
+        }
+    }
+    if (cfg->lock_memory) {
+        // 不把釋放的記憶體還給系統，也不以 mmap 配置大區塊，避免迴圈中缺頁
+        (void)mallopt(M_TRIM_THRESHOLD, -1);
+        (void)mallopt(M_MMAP_MAX, 0);
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+            rt_prefault_stack();
+            applied++;
+        } else if (verbose) {
+            printf("  [設定] mlockall 失敗: %s\n", strerror(errno));
+        }
+    }
+    if (cfg->fifo_priority > 0) {
+        struct sched_param param = { .sched_priority = cfg->fifo_priority };
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err == 0) {
+            applied++;
+        } else if (verbose) {
+            printf("  [設定] SCHED_FIFO 失敗: %s\n", strerror(err));
+        }
+    }
+
+    return applied;
+}
+
+// 恢復一般排程與記憶體設定 (效能測試在同一行程中切換情境)
+void rt_loop_teardown(const RtLoopConfig *cfg) {
+    if (cfg->fifo_priority > 0) {
+        struct sched_param param = { .sched_priority = 0 };
+        (void)pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+    }
+    if (cfg->lock_memory) {
+        (void)munlockall();
+    }
+}
+
+// 執行 ticks 個週期；統計寫入 stats (呼叫前清零)
+void rt_loop_run(const RtLoopConfig *cfg, uint64_t ticks, RtTickFn tick_fn, void *ctx,
+                 RtLoopStats *stats) {
+    struct timespec now_ts;
+    clock_gettime(CLOCK_MONOTONIC, &now_ts);
+    uint64_t start = rt_timespec_ns(&now_ts);
+    uint64_t scheduled = start + cfg->period_ns;
+
+    for (uint64_t tick = 0U; tick < ticks; tick++) {
+        if (cfg->sleep_mode == RT_SLEEP_ABSOLUTE) {
+            struct timespec target = rt_ns_timespec(scheduled);
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, NULL) == EINTR) {
+            }
+        } else {
+            usleep((useconds_t)(cfg->period_ns / 1000U));
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now_ts);
+        uint64_t wake = rt_timespec_ns(&now_ts);
+        sm_hist_record(&stats->jitter, (wake > scheduled) ? (wake - scheduled) : 0U);
+
+        tick_fn(ctx, tick);
+
+        clock_gettime(CLOCK_MONOTONIC, &now_ts);
+        uint64_t done = rt_timespec_ns(&now_ts);
+        sm_hist_record(&stats->exec, done - wake);
+        stats->ticks++;
+
+        uint64_t deadline = scheduled + cfg->period_ns;
+        if (done > deadline) {
+            stats->deadline_misses++;
+        }
+        if (cfg->sleep_mode == RT_SLEEP_ABSOLUTE) {
+            // 落後超過一個週期時跳到下一個未來的排定時間，不連續補跑
+            scheduled = deadline;
+            if (done >= scheduled) {
+                uint64_t behind = ((done - scheduled) / cfg->period_ns) + 1U;
+                stats->skipped_ticks += behind;
+                scheduled += behind * cfg->period_ns;
+            }
+        } else {
+            // 簡單迴圈作者預期的下一次喚醒：這次喚醒加一個週期。
+            // 實際上 usleep 從工作結束才開始算，執行時間全部變成抖動
+            scheduled = wake + cfg->period_ns;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now_ts);
+    stats->elapsed_ns = rt_timespec_ns(&now_ts) - start;
+}
+
+// === 風扇控制工作：每個 tick 讀取 (模擬) 所有區的溫度並處理事件 ===
+typedef struct {
+    StateMachine zones[RT_LOOP_ZONES];
+    uint32_t rng;
+    uint64_t transitions;
+} FanLoopWork;
+
+static void fan_loop_init(FanLoopWork *work) {
+    memset(work, 0, sizeof(*work));
+    work->rng = 0x12345678U;
+    for (uint32_t i = 0U; i < RT_LOOP_ZONES; i++) {
+        sm_init(&work->zones[i]);
+        work->zones[i].current_temperature = TEMP_MC_FROM_C(60);
+        sm_process_event(&work->zones[i], EVENT_SYSTEM_INIT);
+    }
+}
+
+void fan_loop_tick(void *ctx, uint64_t tick) {
+    FanLoopWork *work = (FanLoopWork *)ctx;
+    (void)tick;
+
+    for (uint32_t i = 0U; i < RT_LOOP_ZONES; i++) {
+        StateMachine *sm = &work->zones[i];
+        uint32_t before = sm->state_transitions;
+
+        // 發熱 0..2.999°C，風扇每 25% 帶走 0.5°C，溫度在閾值附近來回
+        work->rng = (work->rng * 1103515245U) + 12345U;
+        TempMilliC delta = (TempMilliC)((work->rng >> 16) % 3000U) -
+                           (TempMilliC)(sm->current_fan_speed * 20U);
+        TempMilliC temp = temp_mc_add_sat(sm->current_temperature, delta);
+        if (temp < TEMP_MC_FROM_C(30)) {
+            temp = TEMP_MC_FROM_C(30);
+        }
+        if (temp > TEMP_MC_FROM_C(94)) {
+            temp = TEMP_MC_FROM_C(94);
+        }
+        sm->current_temperature = temp;
+        sm_process_event(sm, get_temperature_event(temp));
+        work->transitions += sm->state_transitions - before;
+    }
+}
+
+void rt_loop_report(const char *label, const RtLoopConfig *cfg, const RtLoopStats *stats) {
+    uint64_t ideal = stats->ticks * cfg->period_ns;
+    double drift_ms = ((double)stats->elapsed_ns - (double)ideal) / 1e6;
+
+    printf("  %s\n", label);
+    sm_stats_print_hist(stdout, "喚醒抖動", &stats->jitter);
+    sm_stats_print_hist(stdout, "執行時間", &stats->exec);
+    printf("    錯過截止 %lu / %lu tick  跳過週期 %lu  總時間偏移 %+.2f ms\n",
+           (unsigned long)stats->deadline_misses, (unsigned long)stats->ticks,
+           (unsigned long)stats->skipped_ticks, drift_ms);
+}
+
+#ifndef RT_CONTROL_LOOP_NO_MAIN
+
+#define BENCH_PERIOD_NS             1000000ULL      // 1 kHz
+#define BENCH_TICKS                 2000U
+#define RT_PRIORITY                 80
+#define STRESS_CPU_THREADS          2U
+#define STRESS_MEMORY_BYTES         (64U * 1024U * 1024U)
+
+// === 合成負載：CPU 忙迴圈 + 記憶體掃描/配置 ===
+static _Atomic bool stress_stop;
+
+static void *cpu_stress_thread(void *arg) {
+    volatile uint64_t x = (uint64_t)(uintptr_t)arg;
+    while (!atomic_load_explicit(&stress_stop, memory_order_relaxed)) {
+        for (uint32_t i = 0U; i < 100000U; i++) {
+            x = (x * 6364136223846793005ULL) + 1442695040888963407ULL;
+        }
+    }
+    return NULL;
+}
+
+// 反覆配置、寫滿、釋放大區塊：快取/TLB 污染與缺頁
+static void *memory_stress_thread(void *arg) {
+    (void)arg;
+    while (!atomic_load_explicit(&stress_stop, memory_order_relaxed)) {
+        uint8_t *block = (uint8_t *)malloc(STRESS_MEMORY_BYTES / 4U);
+        if (block != NULL) {
+            memset(block, 0x5A, STRESS_MEMORY_BYTES / 4U);
+            free(block);
+        }
+    }
+    return NULL;
+}
+
+typedef struct {
+    pthread_t threads[STRESS_CPU_THREADS + 1U];
+    uint32_t count;
+} StressLoad;
+
+static void stress_start(StressLoad *load) {
+    atomic_store(&stress_stop, false);
+    load->count = 0U;
+    for (uint32_t i = 0U; i < STRESS_CPU_THREADS; i++) {
+        if (pthread_create(&load->threads[load->count], NULL, cpu_stress_thread,
+                           (void *)(uintptr_t)(i + 1U)) == 0) {
+            load->count++;
+        }
+    }
+    if (pthread_create(&load->threads[load->count], NULL, memory_stress_thread, NULL) == 0) {
+        load->count++;
+    }
+}
+
+static void stress_stop_all(StressLoad *load) {
+    atomic_store(&stress_stop, true);
+    for (uint32_t i = 0U; i < load->count; i++) {
+        pthread_join(load->threads[i], NULL);
+    }
+}
+
+static FanLoopWork bench_work;
+static RtLoopStats bench_stats;
+
+static void bench_scenario(const char *label, const RtLoopConfig *cfg, bool stressed) {
+    StressLoad load;
+
+    fan_loop_init(&bench_work);
+    memset(&bench_stats, 0, sizeof(bench_stats));
+    if (stressed) {
+        stress_start(&load);
+        usleep(100000U);            // 讓負載先跑起來
+    }
+    (void)rt_loop_setup(cfg, true);
+    rt_loop_run(cfg, BENCH_TICKS, fan_loop_tick, &bench_work, &bench_stats);
+    rt_loop_teardown(cfg);
+    if (stressed) {
+        stress_stop_all(&load);
+    }
+    rt_loop_report(label, cfg, &bench_stats);
+}
+
+// 以 TEMPERATURE_CHECK_INTERVAL 週期執行風扇迴圈 (完整即時化設定)
+static int run_control_loop(uint32_t seconds) {
+    static FanLoopWork work;
+    static RtLoopStats stats;
+    RtLoopConfig cfg = {
+        .period_ns = (uint64_t)TEMPERATURE_CHECK_INTERVAL * 1000000ULL,
+        .sleep_mode = RT_SLEEP_ABSOLUTE,
+        .cpu = 0,
+        .fifo_priority = RT_PRIORITY,
+        .lock_memory = true
+    };
+    uint64_t ticks = ((uint64_t)seconds * 1000U) / TEMPERATURE_CHECK_INTERVAL;
+
+    fan_loop_init(&work);
+    printf("執行 %lu 個 tick (週期 %d ms, %u 區)\n", (unsigned long)ticks,
+           TEMPERATURE_CHECK_INTERVAL, RT_LOOP_ZONES);
+    int applied = rt_loop_setup(&cfg, true);
+    printf("即時化設定套用 %d/3 項\n", applied);
+    rt_loop_run(&cfg, ticks, fan_loop_tick, &work, &stats);
+    rt_loop_teardown(&cfg);
+    rt_loop_report("風扇控制迴圈", &cfg, &stats);
+    printf("    狀態轉換 %lu 次\n", (unsigned long)work.transitions);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if ((argc > 2) && (strcmp(argv[1], "--run") == 0)) {
+        return run_control_loop((uint32_t)atoi(argv[2]));
+    }
+
+    const RtLoopConfig naive = {
+        .period_ns = BENCH_PERIOD_NS, .sleep_mode = RT_SLEEP_RELATIVE,
+        .cpu = -1, .fifo_priority = 0, .lock_memory = false
+    };
+    const RtLoopConfig absolute_only = {
+        .period_ns = BENCH_PERIOD_NS, .sleep_mode = RT_SLEEP_ABSOLUTE,
+        .cpu = -1, .fifo_priority = 0, .lock_memory = false
+    };
+    const RtLoopConfig realtime = {
+        .period_ns = BENCH_PERIOD_NS, .sleep_mode = RT_SLEEP_ABSOLUTE,
+        .cpu = 0, .fifo_priority = RT_PRIORITY, .lock_memory = true
+    };
+
+    printf("=== 即時控制迴圈 (%u 區風扇狀態機, 1 kHz, 每情境 %u tick) ===\n",
+           RT_LOOP_ZONES, BENCH_TICKS);
+    printf("負載: %u 個 CPU 忙迴圈執行緒 + 1 個記憶體配置/寫入執行緒 (%u MB 區塊)\n",
+           STRESS_CPU_THREADS, (STRESS_MEMORY_BYTES / 4U) / (1024U * 1024U));
+
+    printf("\n=== 1. 閒置系統 ===\n");
+    bench_scenario("簡單迴圈 (工作 + usleep)", &naive, false);
+    bench_scenario("即時迴圈 (絕對時間 + SCHED_FIFO + CPU 綁定 + mlockall)", &realtime, false);
+
+    printf("\n=== 2. CPU + 記憶體負載 ===\n");
+    bench_scenario("簡單迴圈 (工作 + usleep)", &naive, true);
+    bench_scenario("只用絕對時間 (SCHED_OTHER)", &absolute_only, true);
+    bench_scenario("即時迴圈 (絕對時間 + SCHED_FIFO + CPU 綁定 + mlockall)", &realtime, true);
+
+    printf("\n=== 重點總結 ===\n");
+    printf("1. 絕對時間排程讓誤差不累積：執行時間不會被加進週期\n");
+    printf("2. 負載下決定抖動的是排程類別：SCHED_FIFO 會搶占一般執行緒\n");
+    printf("3. mlockall + 預先觸碰堆疊，迴圈中不會因缺頁而延遲\n");
+    printf("4. 錯過截止時間時跳到下一個週期，不連續補跑造成突發負載\n");
+
+    return 0;
+}
+
+#endif  // RT_CONTROL_LOOP_NO_MAIN
@@ -0,0 +1,88 @@
+// sensor_query.h - 批次感測器查詢協定 (Unix domain socket, SOCK_SEQPACKET)
+// 伺服器 (sensor_query_server.c) 與外部客戶端共用此檔案。
+// 一個請求帶最多 SENSOR_QUERY_MAX_IDS 個感測器編號，回應是一個封包：
+//   請求: SensorQueryRequest + uint32_t ids[count]
+//   回應: SensorQueryResponse + TempMilliC values[count] + int8_t status[count]
+// 回應的值與狀態依請求中的順序排列，不重複帶編號 (每個感測器 5 bytes)。
+// SOCK_SEQPACKET 保留訊息邊界，一次 send/recv 就是一個完整的請求或回應，不需要另外分框。
+// 只在同一台機器上使用，欄位為本機位元組順序；版本或 magic 不符時回應 BMC_ERROR_INVALID_PARAM。
+
+#ifndef SENSOR_QUERY_H
+#define SENSOR_QUERY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "../common/fixed_point_temp.h"
+
+#define SENSOR_QUERY_SOCKET_PATH    "/run/bmc_sensor_query.sock"
+#define SENSOR_QUERY_REQUEST_MAGIC  0x51524E53U  // "SNRQ"
+#define SENSOR_QUERY_RESPONSE_MAGIC 0x53524E53U  // "SNRS"
+#define SENSOR_QUERY_VERSION        1U
+#define SENSOR_QUERY_MAX_IDS        1024U
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;                 // 後面跟著的感測器編號個數
+    uint32_t sequence;              // 原樣回傳，客戶端用來配對請求與回應
+} SensorQueryRequest;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;                 // 請求無效時為 0
+    uint32_t sequence;
+    int32_t status;                 // 整個請求的 BMCStatus
+    uint64_t snapshot_ns;           // 快照讀取時間 (CLOCK_MONOTONIC)
+    uint32_t generation;            // 快照版本，每次重新讀取加 1
+    uint32_t reserved;
+} SensorQueryResponse;
+
+_Static_assert(sizeof(SensorQueryRequest) == 12U, "請求標頭為 12 bytes");
+_Static_assert(sizeof(SensorQueryResponse) == 32U, "回應標頭為 32 bytes");
+
+#define SENSOR_QUERY_REQUEST_MAX    (sizeof(SensorQueryRequest) + (SENSOR_QUERY_MAX_IDS * sizeof(uint32_t)))
+#define SENSOR_QUERY_RESPONSE_MAX   (sizeof(SensorQueryResponse) + \
+                                     (SENSOR_QUERY_MAX_IDS * (sizeof(TempMilliC) + sizeof(int8_t))))
+
+static inline size_t sensor_query_request_size(uint32_t count) {
+    return sizeof(SensorQueryRequest) + ((size_t)count * sizeof(uint32_t));
+}
+
+static inline size_t sensor_query_response_size(uint32_t count) {
+    return sizeof(SensorQueryResponse) + ((size_t)count * (sizeof(TempMilliC) + sizeof(int8_t)));
+}
+
+// 緩衝區須以 4 bytes 對齊；標頭大小都是 4 的倍數，值陣列因此也對齊
+static inline uint32_t *sensor_query_request_ids(void *buf) {
+    return (uint32_t *)((uint8_t *)buf + sizeof(SensorQueryRequest));
+}
+
+static inline TempMilliC *sensor_query_response_values(void *buf) {
+    return (TempMilliC *)((uint8_t *)buf + sizeof(SensorQueryResponse));
+}
+
+static inline int8_t *sensor_query_response_status(void *buf, uint32_t count) {
+    return (int8_t *)((uint8_t *)buf + sizeof(SensorQueryResponse) + ((size_t)count * sizeof(TempMilliC)));
+}
+
+// 在 buf 組出請求，回傳要送出的長度 (count 超過上限時回傳 0)
+static inline size_t sensor_query_encode(void *buf, uint32_t sequence, const uint32_t *ids, uint32_t count) {
+    size_t len = 0U;
+
+    if (count <= SENSOR_QUERY_MAX_IDS) {
+        SensorQueryRequest *req = (SensorQueryRequest *)buf;
+        req->magic = SENSOR_QUERY_REQUEST_MAGIC;
+        req->version = SENSOR_QUERY_VERSION;
+        req->count = (uint16_t)count;
+        req->sequence = sequence;
+        memcpy(sensor_query_request_ids(buf), ids, (size_t)count * sizeof(uint32_t));
+        len = sensor_query_request_size(count);
+    }
+
+    return len;
+}
+
+#endif  // SENSOR_QUERY_H
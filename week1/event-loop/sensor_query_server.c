@@ -0,0 +1,625 @@
+// sensor_query_server.c - 批次二進位感測器查詢服務 (Unix domain socket)
+// 外部程式原本只能連結原始碼才拿得到讀值；IPMI 風格的客戶端又習慣一次問一個感測器。
+// 這裡在 bmc_reactor 上提供 sensor_query.h 的協定：
+//   - 計時器定期以 read_sensor() 讀取所有感測器，存成快照 (SensorSnapshot)
+//   - 請求只從快照回答，客戶端再多也不會觸發裝置讀取
+//   - 一個請求可以帶上百個編號，回應是一個緊湊封包 (每個感測器 5 bytes)
+// reactor 是單執行緒，快照更新與回應不會交錯，客戶端永遠拿到同一個 generation 的讀值。
+//
+// 用法: sensor_query_server                       正確性檢查 + 批次大小效能比較
+//       sensor_query_server --serve PATH SECS     在 PATH 提供服務 (SECS 為 0 時 Ctrl-C 結束)
+//       sensor_query_server --query PATH ID...    查詢並列出讀值
+
+#ifndef SENSOR_QUERY_SERVER_NO_MAIN
+#define SM_QUIET
+#endif
+#define BMC_REACTOR_NO_MAIN
+#include "bmc_reactor.c"
+#define MISRA_C_BASICS_NO_MAIN
+#include "../misra/misra_c_basics.c"
+#include "sensor_query.h"
+
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define SENSOR_QUERY_SENSORS        1024U   // 感測器編號 0..1023 (0 號模擬故障)
+#define SENSOR_QUERY_MAX_CONNECTIONS 8U
+#define SENSOR_REFRESH_PERIOD_NS    1000000000ULL
+
+// === 感測器快照 ===
+typedef struct {
+    uint32_t generation;
+    uint64_t taken_ns;
+    uint64_t device_reads;
+    TempMilliC value[SENSOR_QUERY_SENSORS];
+    int8_t status[SENSOR_QUERY_SENSORS];    // BMCStatus
+} SensorSnapshot;
+
+void sensor_snapshot_refresh(SensorSnapshot *snap) {
+    for (uint32_t id = 0U; id < SENSOR_QUERY_SENSORS; id++) {
+        TempMilliC value = 0;
+        BMCStatus status = read_sensor(id, &value);
+        snap->value[id] = (status == BMC_OK) ? value : 0;
+        snap->status[id] = (int8_t)status;
+    }
+    snap->device_reads += SENSOR_QUERY_SENSORS;
+    snap->taken_ns = sm_stats_now_ns();
+    snap->generation++;
+}
+
+// 依請求組出回應，回傳回應長度；請求無效時回應只有標頭，status 為 BMC_ERROR_INVALID_PARAM
+size_t sensor_query_respond(const SensorSnapshot *snap, const void *request, size_t request_len,
+                            void *out) {
+    const SensorQueryRequest *req = (const SensorQueryRequest *)request;
+    SensorQueryResponse *resp = (SensorQueryResponse *)out;
+    uint32_t count = 0U;
+
+    memset(resp, 0, sizeof(*resp));
+    resp->magic = SENSOR_QUERY_RESPONSE_MAGIC;
+    resp->version = SENSOR_QUERY_VERSION;
+    resp->status = BMC_OK;
+    resp->snapshot_ns = snap->taken_ns;
+    resp->generation = snap->generation;
+
+    if (request_len < sizeof(SensorQueryRequest)) {
+        resp->status = BMC_ERROR_INVALID_PARAM;
+    } else {
+        resp->sequence = req->sequence;
+        if ((req->magic != SENSOR_QUERY_REQUEST_MAGIC) || (req->version != SENSOR_QUERY_VERSION) ||
+            (req->count > SENSOR_QUERY_MAX_IDS) || (request_len != sensor_query_request_size(req->count))) {
+            resp->status = BMC_ERROR_INVALID_PARAM;
+        } else {
+            count = req->count;
+        }
+    }
+
+    const uint32_t *ids = sensor_query_request_ids((void *)(uintptr_t)request);
+    TempMilliC *values = sensor_query_response_values(out);
+    int8_t *status = sensor_query_response_status(out, count);
+    for (uint32_t i = 0U; i < count; i++) {
+        uint32_t id = ids[i];
+        if (id < SENSOR_QUERY_SENSORS) {
+            values[i] = snap->value[id];
+            status[i] = snap->status[id];
+        } else {
+            values[i] = 0;
+            status[i] = (int8_t)BMC_ERROR_INVALID_PARAM;
+        }
+    }
+    resp->count = (uint16_t)count;
+
+    return sensor_query_response_size(count);
+}
+
+// === 服務端 ===
+typedef struct SensorQueryServer SensorQueryServer;
+
+typedef struct {
+    SensorQueryServer *server;
+    int fd;
+    bool in_use;
+    size_t out_len;                 // 尚未送出的回應 (對方沒在收時才會有)
+    _Alignas(8) uint8_t in[SENSOR_QUERY_REQUEST_MAX];
+    _Alignas(8) uint8_t out[SENSOR_QUERY_RESPONSE_MAX];
+} SensorQueryConnection;
+
+struct SensorQueryServer {
+    Reactor *reactor;
+    int listen_fd;
+    SensorSnapshot *snapshot;
+    uint64_t requests;
+    uint64_t sensors_served;
+    uint64_t bad_requests;
+    uint64_t rejected;
+    SensorQueryConnection connections[SENSOR_QUERY_MAX_CONNECTIONS];
+};
+
+static void sensor_query_close(SensorQueryConnection *conn) {
+    (void)reactor_remove_fd(conn->server->reactor, conn->fd);
+    conn->in_use = false;
+    conn->fd = -1;
+}
+
+// 送出待送的回應；送不出去時改等 EPOLLOUT，回傳是否已送完
+static bool sensor_query_flush(SensorQueryConnection *conn) {
+    bool sent = true;
+
+    if (conn->out_len > 0U) {
+        ssize_t n = send(conn->fd, conn->out, conn->out_len, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n == (ssize_t)conn->out_len) {
+            conn->out_len = 0U;
+        } else if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+            sent = false;
+        } else {
+            conn->out_len = 0U;     // 對方已關閉，之後的 recv 會回報
+        }
+    }
+
+    return sent;
+}
+
+// 一次喚醒處理所有已到的請求，直到 socket 沒有資料或回應送不出去
+void sensor_query_connection_handler(Reactor *reactor, int fd, uint32_t events, void *user_data) {
+    SensorQueryConnection *conn = (SensorQueryConnection *)user_data;
+    SensorQueryServer *server = conn->server;
+    bool open = true;
+
+    if ((events & EPOLLOUT) != 0U) {
+        if (!sensor_query_flush(conn)) {
+            return;
+        }
+        (void)reactor_modify_fd(reactor, fd, EPOLLIN);
+    }
+
+    while (open && (conn->out_len == 0U)) {
+        // MSG_TRUNC 讓過長的請求回報實際長度，而不是被截斷後當成合法請求
+        ssize_t n = recv(fd, conn->in, sizeof(conn->in), MSG_DONTWAIT | MSG_TRUNC);
+        if (n == 0) {
+            open = false;
+        } else if (n < 0) {
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+                open = false;
+            }
+            break;
+        } else {
+            size_t len = ((size_t)n > sizeof(conn->in)) ? 0U : (size_t)n;
+            conn->out_len = sensor_query_respond(server->snapshot, conn->in, len, conn->out);
+            const SensorQueryResponse *resp = (const SensorQueryResponse *)conn->out;
+            server->requests++;
+            server->sensors_served += resp->count;
+            if (resp->status != BMC_OK) {
+                server->bad_requests++;
+            }
+            if (!sensor_query_flush(conn)) {
+                (void)reactor_modify_fd(reactor, fd, EPOLLOUT);
+            }
+        }
+    }
+
+    if (!open || ((events & (EPOLLERR | EPOLLHUP)) != 0U)) {
+        sensor_query_close(conn);
+    }
+}
+
+void sensor_query_accept_handler(Reactor *reactor, int fd, uint32_t events, void *user_data) {
+    SensorQueryServer *server = (SensorQueryServer *)user_data;
+    (void)events;
+
+    for (;;) {
+        int client = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client < 0) {
+            break;
+        }
+
+        SensorQueryConnection *conn = NULL;
+        for (uint32_t i = 0U; i < SENSOR_QUERY_MAX_CONNECTIONS; i++) {
+            if (!server->connections[i].in_use) {
+                conn = &server->connections[i];
+                break;
+            }
+        }
+        if ((conn == NULL) ||
+            (reactor_add_fd(reactor, client, EPOLLIN, sensor_query_connection_handler, conn) != 0)) {
+            server->rejected++;
+            close(client);
+            continue;
+        }
+        conn->server = server;
+        conn->fd = client;
+        conn->in_use = true;
+        conn->out_len = 0U;
+    }
+}
+
+void sensor_refresh_handler(Reactor *reactor, int fd, uint32_t events, void *user_data) {
+    (void)reactor;
+    (void)events;
+
+    if (reactor_drain(fd) > 0U) {
+        sensor_snapshot_refresh((SensorSnapshot *)user_data);
+    }
+}
+
+// path 以 '@' 開頭時使用 Linux 抽象命名空間 (不留下檔案)
+static socklen_t sensor_query_address(const char *path, struct sockaddr_un *addr) {
+    size_t len = strlen(path);
+    socklen_t addr_len = 0U;
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if ((len > 0U) && (len < sizeof(addr->sun_path))) {
+        memcpy(addr->sun_path, path, len);
+        if (path[0] == '@') {
+            addr->sun_path[0] = '\0';
+        }
+        addr_len = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + len + ((path[0] == '@') ? 0U : 1U));
+    }
+
+    return addr_len;
+}
+
+// 讀取第一份快照、監聽 path，並註冊定期更新的計時器
+int sensor_query_server_init(SensorQueryServer *server, Reactor *reactor, const char *path,
+                             SensorSnapshot *snapshot, uint64_t refresh_ns) {
+    struct sockaddr_un addr;
+    socklen_t addr_len = sensor_query_address(path, &addr);
+
+    memset(server, 0, sizeof(*server));
+    server->reactor = reactor;
+    server->snapshot = snapshot;
+    sensor_snapshot_refresh(snapshot);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (path[0] != '@') {
+        (void)unlink(path);
+    }
+    if ((addr_len == 0U) ||
+        (bind(fd, (struct sockaddr *)&addr, addr_len) != 0) ||
+        (listen(fd, 16) != 0) ||
+        (reactor_add_fd(reactor, fd, EPOLLIN, sensor_query_accept_handler, server) != 0) ||
+        (reactor_add_timer(reactor, refresh_ns, sensor_refresh_handler, snapshot) < 0)) {
+        close(fd);
+        return -1;
+    }
+    server->listen_fd = fd;
+
+    return 0;
+}
+
+// === 客戶端 ===
+int sensor_query_connect(const char *path) {
+    struct sockaddr_un addr;
+    socklen_t addr_len = sensor_query_address(path, &addr);
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+    if ((fd >= 0) && ((addr_len == 0U) || (connect(fd, (struct sockaddr *)&addr, addr_len) != 0))) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+// 一次送出 count 個編號並等待回應；response 至少 SENSOR_QUERY_RESPONSE_MAX bytes、4 bytes 對齊
+BMCStatus sensor_query_request(int fd, uint32_t sequence, const uint32_t *ids, uint32_t count,
+                               void *request_buf, void *response) {
+    BMCStatus status = BMC_OK;
+    size_t len = sensor_query_encode(request_buf, sequence, ids, count);
+    const SensorQueryResponse *resp = (const SensorQueryResponse *)response;
+
+    if (len == 0U) {
+        status = BMC_ERROR_INVALID_PARAM;
+    } else if (send(fd, request_buf, len, MSG_NOSIGNAL) != (ssize_t)len) {
+        status = BMC_ERROR_HARDWARE;
+    } else {
+        ssize_t n = recv(fd, response, SENSOR_QUERY_RESPONSE_MAX, 0);
+        if ((n < (ssize_t)sizeof(SensorQueryResponse)) ||
+            (resp->magic != SENSOR_QUERY_RESPONSE_MAGIC) || (resp->sequence != sequence) ||
+            ((size_t)n != sensor_query_response_size(resp->count))) {
+            status = BMC_ERROR_HARDWARE;
+        } else if (resp->status != BMC_OK) {
+            status = (BMCStatus)resp->status;
+        } else if (resp->count != count) {
+            status = BMC_ERROR_HARDWARE;
+        }
+    }
+
+    return status;
+}
+
+#ifndef SENSOR_QUERY_SERVER_NO_MAIN
+#include <pthread.h>
+
+#define BENCH_SOCKET_PATH           "@bmc_sensor_query_bench"
+#define BENCH_DURATION_NS           400000000ULL    // 每種批次大小 0.4 秒
+#define BENCH_QUERY_SENSORS         256U            // 客戶端想要的感測器數 (一輪)
+
+static SensorSnapshot snapshot;
+static _Alignas(8) uint8_t client_request[SENSOR_QUERY_REQUEST_MAX];
+static _Alignas(8) uint8_t client_response[SENSOR_QUERY_RESPONSE_MAX];
+
+// === 正確性檢查 (客戶端執行緒) ===
+typedef struct {
+    uint32_t passed;
+    uint32_t failed;
+} CheckResult;
+
+static void check(CheckResult *result, bool ok, const char *what) {
+    printf("  [%s] %s\n", ok ? "通過" : "失敗", what);
+    if (ok) {
+        result->passed++;
+    } else {
+        result->failed++;
+    }
+}
+
+static void run_checks(int fd, CheckResult *result) {
+    uint32_t ids[SENSOR_QUERY_MAX_IDS];
+    const SensorQueryResponse *resp = (const SensorQueryResponse *)client_response;
+
+    for (uint32_t i = 0U; i < SENSOR_QUERY_MAX_IDS; i++) {
+        ids[i] = (i * 37U) % SENSOR_QUERY_SENSORS;      // 打亂順序，包含 0 號
+    }
+    BMCStatus status = sensor_query_request(fd, 1U, ids, SENSOR_QUERY_MAX_IDS, client_request, client_response);
+    bool same = (status == BMC_OK);
+    const TempMilliC *values = sensor_query_response_values(client_response);
+    const int8_t *st = sensor_query_response_status(client_response, SENSOR_QUERY_MAX_IDS);
+    for (uint32_t i = 0U; same && (i < SENSOR_QUERY_MAX_IDS); i++) {
+        same = (values[i] == snapshot.value[ids[i]]) && (st[i] == snapshot.status[ids[i]]);
+    }
+    check(result, same, "1024 個編號一次查詢，值與狀態依請求順序與快照相同");
+    check(result, (status == BMC_OK) && (st[0] == (int8_t)BMC_ERROR_HARDWARE),
+          "0 號感測器回報 BMC_ERROR_HARDWARE (read_sensor 的故障路徑)");
+
+    uint32_t unknown[2] = { 5U, SENSOR_QUERY_SENSORS + 7U };
+    status = sensor_query_request(fd, 2U, unknown, 2U, client_request, client_response);
+    st = sensor_query_response_status(client_response, 2U);
+    check(result, (status == BMC_OK) && (st[0] == (int8_t)BMC_OK) &&
+                  (st[1] == (int8_t)BMC_ERROR_INVALID_PARAM), "不存在的編號只影響自己那一格");
+
+    SensorQueryRequest bad = { 0xDEADBEEFU, SENSOR_QUERY_VERSION, 0U, 3U };
+    ssize_t n = -1;
+    if (send(fd, &bad, sizeof(bad), MSG_NOSIGNAL) == (ssize_t)sizeof(bad)) {
+        n = recv(fd, client_response, sizeof(client_response), 0);
+    }
+    check(result, (n == (ssize_t)sizeof(SensorQueryResponse)) && (resp->sequence == 3U) &&
+                  (resp->status == BMC_ERROR_INVALID_PARAM), "magic 錯誤回應 BMC_ERROR_INVALID_PARAM");
+
+    // 宣告 4 個編號卻只送 2 個
+    size_t len = sensor_query_encode(client_request, 4U, ids, 4U) - (2U * sizeof(uint32_t));
+    n = -1;
+    if (send(fd, client_request, len, MSG_NOSIGNAL) == (ssize_t)len) {
+        n = recv(fd, client_response, sizeof(client_response), 0);
+    }
+    check(result, (n == (ssize_t)sizeof(SensorQueryResponse)) && (resp->status == BMC_ERROR_INVALID_PARAM),
+          "長度與 count 不符時拒絕");
+
+    static uint8_t oversized[SENSOR_QUERY_REQUEST_MAX + 64U];
+    (void)sensor_query_encode(oversized, 5U, ids, SENSOR_QUERY_MAX_IDS);
+    n = -1;
+    if (send(fd, oversized, sizeof(oversized), MSG_NOSIGNAL) == (ssize_t)sizeof(oversized)) {
+        n = recv(fd, client_response, sizeof(client_response), 0);
+    }
+    check(result, (n == (ssize_t)sizeof(SensorQueryResponse)) && (resp->status == BMC_ERROR_INVALID_PARAM),
+          "超過上限的封包不會被截斷後當成合法請求");
+
+    // 期間計時器可能剛好更新快照；裝置讀取次數必須正好是更新次數 x 感測器數
+    uint64_t reads_before = __atomic_load_n(&snapshot.device_reads, __ATOMIC_RELAXED);
+    uint32_t generation_before = __atomic_load_n(&snapshot.generation, __ATOMIC_RELAXED);
+    for (uint32_t r = 0U; r < 100U; r++) {
+        (void)sensor_query_request(fd, 10U + r, ids, 256U, client_request, client_response);
+    }
+    uint64_t reads = __atomic_load_n(&snapshot.device_reads, __ATOMIC_RELAXED) - reads_before;
+    uint32_t refreshes = __atomic_load_n(&snapshot.generation, __ATOMIC_RELAXED) - generation_before;
+    check(result, reads == ((uint64_t)refreshes * SENSOR_QUERY_SENSORS),
+          "100 個請求沒有觸發裝置讀取 (只有定期更新會讀取)");
+}
+
+// === 效能比較 ===
+typedef struct {
+    uint32_t batch;                 // 每個請求帶的編號數
+    uint64_t requests;
+    uint64_t sensors;
+    uint64_t elapsed_ns;
+    SmHistogram latency;            // 每個請求的來回時間
+    SmHistogram round;              // 取得全部 BENCH_QUERY_SENSORS 個讀值的時間
+    bool ok;
+} BatchBench;
+
+static void run_batch_bench(int fd, BatchBench *bench) {
+    uint32_t ids[BENCH_QUERY_SENSORS];
+    uint32_t sequence = 1000U;
+
+    for (uint32_t i = 0U; i < BENCH_QUERY_SENSORS; i++) {
+        ids[i] = 1U + i;
+    }
+    bench->ok = true;
+    uint64_t start = sm_stats_now_ns();
+    uint64_t now = start;
+    while (bench->ok && ((now - start) < BENCH_DURATION_NS)) {
+        uint64_t round_start = now;
+        for (uint32_t off = 0U; bench->ok && (off < BENCH_QUERY_SENSORS); off += bench->batch) {
+            uint64_t t0 = sm_stats_now_ns();
+            bench->ok = (sensor_query_request(fd, sequence++, &ids[off], bench->batch,
+                                              client_request, client_response) == BMC_OK);
+            now = sm_stats_now_ns();
+            sm_hist_record(&bench->latency, now - t0);
+            bench->requests++;
+            bench->sensors += bench->batch;
+        }
+        sm_hist_record(&bench->round, now - round_start);
+    }
+    bench->elapsed_ns = now - start;
+}
+
+typedef struct {
+    CheckResult checks;
+    BatchBench benches[4];
+    uint32_t bench_count;
+    int done_fd;                    // 客戶端結束時通知 reactor
+    bool connected;
+} ClientWork;
+
+static void *client_thread(void *arg) {
+    ClientWork *work = (ClientWork *)arg;
+    int fd = sensor_query_connect(BENCH_SOCKET_PATH);
+
+    work->connected = (fd >= 0);
+    if (work->connected) {
+        run_checks(fd, &work->checks);
+        for (uint32_t i = 0U; i < work->bench_count; i++) {
+            run_batch_bench(fd, &work->benches[i]);
+        }
+        close(fd);
+    }
+    reactor_notify(work->done_fd);
+
+    return NULL;
+}
+
+void client_done_handler(Reactor *reactor, int fd, uint32_t events, void *user_data) {
+    (void)events;
+    (void)user_data;
+    (void)reactor_drain(fd);
+    reactor_stop(reactor);
+}
+
+static void print_batch_bench(const BatchBench *bench, const BatchBench *single) {
+    double seconds = (double)bench->elapsed_ns / 1e9;
+    double round_us = (double)sm_hist_percentile(&bench->round, 50U) / 1e3;
+    double single_us = (double)sm_hist_percentile(&single->round, 50U) / 1e3;
+
+    printf("  %6u %12.0f %14.0f %12.1f %12.1f %14.1f %9.1fx%s\n", bench->batch,
+           (double)bench->requests / seconds, (double)bench->sensors / seconds,
+           (double)sm_hist_percentile(&bench->latency, 50U) / 1e3,
+           (double)sm_hist_percentile(&bench->latency, 99U) / 1e3,
+           round_us, single_us / round_us, bench->ok ? "" : "  (錯誤)");
+}
+
+static int run_benchmark(void) {
+    static SensorQueryServer server;
+    static ClientWork work = {
+        .benches = { { .batch = 1U }, { .batch = 16U }, { .batch = 64U }, { .batch = 256U } },
+        .bench_count = 4U
+    };
+    Reactor reactor;
+    pthread_t thread;
+
+    printf("=== 批次感測器查詢 (SOCK_SEQPACKET, %u 個感測器) ===\n", SENSOR_QUERY_SENSORS);
+    if ((reactor_init(&reactor) != 0) ||
+        (sensor_query_server_init(&server, &reactor, BENCH_SOCKET_PATH, &snapshot,
+                                  SENSOR_REFRESH_PERIOD_NS) != 0)) {
+        perror("sensor_query_server_init");
+        return 1;
+    }
+    work.done_fd = reactor_add_notifier(&reactor, client_done_handler, NULL);
+    (void)reactor_add_timer(&reactor, 30000000000ULL, deadline_handler, NULL);     // 保險：30 秒
+
+    printf("\n=== 1. 協定正確性 ===\n");
+    fflush(stdout);
+    if ((work.done_fd < 0) || (pthread_create(&thread, NULL, client_thread, &work) != 0)) {
+        reactor_cleanup(&reactor);
+        return 1;
+    }
+    reactor_run(&reactor);
+    pthread_join(thread, NULL);
+    reactor_cleanup(&reactor);
+    if (!work.connected) {
+        printf("  [失敗] 無法連線到 %s\n", BENCH_SOCKET_PATH);
+        return 1;
+    }
+
+    printf("\n=== 2. 批次大小 (每輪取得 %u 個感測器) ===\n", BENCH_QUERY_SENSORS);
+    printf("  %6s %12s %14s %12s %12s %14s %10s\n", "batch", "req/s", "sensors/s",
+           "p50 us", "p99 us", "round p50 us", "speedup");
+    for (uint32_t i = 0U; i < work.bench_count; i++) {
+        print_batch_bench(&work.benches[i], &work.benches[0]);
+    }
+    printf("  (round = 取得 %u 個讀值的時間；speedup 相對於一次一個感測器)\n", BENCH_QUERY_SENSORS);
+    printf("  伺服器: 請求 %lu, 回應感測器 %lu, 無效請求 %lu, 拒絕連線 %lu, 裝置讀取 %lu\n",
+           (unsigned long)server.requests, (unsigned long)server.sensors_served,
+           (unsigned long)server.bad_requests, (unsigned long)server.rejected,
+           (unsigned long)snapshot.device_reads);
+
+    bool all_ok = (work.checks.failed == 0U);
+    for (uint32_t i = 0U; i < work.bench_count; i++) {
+        all_ok = all_ok && work.benches[i].ok;
+    }
+    printf("\n[%s] 檢查 %u 項通過, %u 項失敗\n", all_ok ? "通過" : "失敗",
+           work.checks.passed, work.checks.failed);
+
+    return all_ok ? 0 : 1;
+}
+
+// 服務模式：每秒重新讀取一次快照
+static int serve(const char *path, uint32_t seconds) {
+    static SensorQueryServer server;
+    Reactor reactor;
+
+    if ((reactor_init(&reactor) != 0) ||
+        (sensor_query_server_init(&server, &reactor, path, &snapshot, SENSOR_REFRESH_PERIOD_NS) != 0)) {
+        perror("sensor_query_server_init");
+        return 1;
+    }
+    if (seconds > 0U) {
+        (void)reactor_add_timer(&reactor, (uint64_t)seconds * 1000000000ULL, deadline_handler, NULL);
+    } else {
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        sigprocmask(SIG_BLOCK, &mask, NULL);
+        int sig_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        if ((sig_fd < 0) || (reactor_add_fd(&reactor, sig_fd, EPOLLIN, signal_handler, NULL) != 0)) {
+            printf("註冊訊號處理器失敗\n");
+        }
+    }
+
+    printf("服務中: %s (%u 個感測器, 每 %llu ms 更新快照)\n", path, SENSOR_QUERY_SENSORS,
+           SENSOR_REFRESH_PERIOD_NS / 1000000ULL);
+    fflush(stdout);
+    reactor_run(&reactor);
+    printf("請求 %lu, 回應感測器 %lu, 無效請求 %lu, 快照 %u 次\n", (unsigned long)server.requests,
+           (unsigned long)server.sensors_served, (unsigned long)server.bad_requests,
+           snapshot.generation);
+    reactor_cleanup(&reactor);
+    if (path[0] != '@') {
+        (void)unlink(path);
+    }
+
+    return 0;
+}
+
+static int query(const char *path, int count, char *argv[]) {
+    uint32_t ids[SENSOR_QUERY_MAX_IDS];
+    uint32_t n = 0U;
+    int fd = sensor_query_connect(path);
+
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+    for (int i = 0; (i < count) && (n < SENSOR_QUERY_MAX_IDS); i++) {
+        ids[n++] = (uint32_t)strtoul(argv[i], NULL, 0);
+    }
+
+    BMCStatus status = sensor_query_request(fd, 1U, ids, n, client_request, client_response);
+    const SensorQueryResponse *resp = (const SensorQueryResponse *)client_response;
+    if (status != BMC_OK) {
+        printf("查詢失敗: %d\n", (int)status);
+    } else {
+        const TempMilliC *values = sensor_query_response_values(client_response);
+        const int8_t *st = sensor_query_response_status(client_response, n);
+        printf("快照 #%u (%.1f ms 前)\n", resp->generation,
+               (double)(sm_stats_now_ns() - resp->snapshot_ns) / 1e6);
+        for (uint32_t i = 0U; i < n; i++) {
+            if (st[i] == (int8_t)BMC_OK) {
+                printf("  感測器 %4u: " TEMP_MC_FMT "°C\n", ids[i], TEMP_MC_ARGS(values[i]));
+            } else {
+                printf("  感測器 %4u: 錯誤 %d\n", ids[i], st[i]);
+            }
+        }
+    }
+    close(fd);
+
+    return (status == BMC_OK) ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    int result;
+
+    if ((argc > 3) && (strcmp(argv[1], "--serve") == 0)) {
+        result = serve(argv[2], (uint32_t)atoi(argv[3]));
+    } else if ((argc > 3) && (strcmp(argv[1], "--query") == 0)) {
+        result = query(argv[2], argc - 3, &argv[3]);
+    } else {
+        result = run_benchmark();
+    }
+
+    return result;
+}
+
+#endif  // SENSOR_QUERY_SERVER_NO_MAIN
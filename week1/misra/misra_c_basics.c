@@ -7,6 +7,9 @@
 #include <stdbool.h> // MISRA 建議使用 bool 而非 int 表示布林值
 #include <string.h>
 
+#include "../common/fixed_point_temp.h"
+#include "../common/thermal_policy.h"
+
 // === MISRA-C 核心原則 ===
 // 1. 避免未定義行為
 // 2. 避免實作定義行為
@@ -19,7 +22,7 @@
 
 // 正確：使用固定大小類型
 typedef struct {
-    uint16_t temperature;  // 明確的 16 位元無符號整數
+    TempMilliC temperature; // 毫度定點 (int32_t，0.001°C)，見 fixed_point_temp.h
     int32_t  pressure;     // 明確的 32 位元有符號整數
     uint8_t  status;       // 明確的 8 位元無符號整數
 } SensorData;
@@ -78,11 +81,11 @@ void initialization_demo(void) {
     
     // 正確：總是初始化
     uint32_t sensor_count = 0U;
-    float temperature = 0.0f;
+    TempMilliC temperature = 0;  // 控制路徑不用 float (BMC SoC 沒有快速 FPU)
     char buffer[100] = {0};  // 初始化整個陣列
     
-    printf("已初始化的變數: count=%u, temp=%.1f\n", 
-           sensor_count, temperature);
+    printf("已初始化的變數: count=%u, temp=" TEMP_MC_FMT "\n", 
+           sensor_count, TEMP_MC_ARGS(temperature));
 }
 
 // === 規則示範 5: 避免使用動態記憶體分配 ===
@@ -140,14 +143,18 @@ void operator_precedence_demo(void) {
 }
 
 // === 規則示範 7: 檢查函數返回值 ===
+#ifndef BMC_STATUS_DEFINED
+#define BMC_STATUS_DEFINED
 typedef enum {
     BMC_OK = 0,
     BMC_ERROR_INVALID_PARAM = -1,
     BMC_ERROR_TIMEOUT = -2,
-    BMC_ERROR_HARDWARE = -3
+    BMC_ERROR_HARDWARE = -3,
+    BMC_ERROR_BUSY = -4
 } BMCStatus;
+#endif
 
-BMCStatus read_sensor(uint32_t sensor_id, uint16_t *value) {
+BMCStatus read_sensor(uint32_t sensor_id, TempMilliC *value) {
     // 參數檢查
     if (value == NULL) {
         return BMC_ERROR_INVALID_PARAM;
@@ -158,20 +165,20 @@ BMCStatus read_sensor(uint32_t sensor_id, uint16_t *value) {
         return BMC_ERROR_HARDWARE;
     }
     
-    *value = 25U;  // 模擬溫度值
+    *value = 25375;  // 模擬溫度值 25.375°C (hwmon 本來就以毫度回報)
     return BMC_OK;
 }
 
 void return_value_check_demo(void) {
     printf("\n=== MISRA 規則: 檢查函數返回值 ===\n");
     
-    uint16_t temperature = 0U;
+    TempMilliC temperature = 0;
     BMCStatus status;
     
     // 總是檢查返回值
     status = read_sensor(1U, &temperature);
     if (status == BMC_OK) {
-        printf("成功讀取溫度: %u°C\n", temperature);
+        printf("成功讀取溫度: " TEMP_MC_FMT "°C\n", TEMP_MC_ARGS(temperature));
     } else {
         printf("讀取失敗，錯誤碼: %d\n", status);
     }
@@ -192,24 +199,22 @@ if (temperature > 75) {  // 75 是什麼？
 */
 
 // 正確：使用具名常數
-#define TEMPERATURE_WARNING_THRESHOLD_C  75U
-#define TEMPERATURE_CRITICAL_THRESHOLD_C 85U
-#define FAN_SPEED_MIN_RPM               1000U
-#define FAN_SPEED_MAX_RPM               5000U
+// TEMPERATURE_*_THRESHOLD_C 與 FAN_SPEED_MIN/MAX_RPM 定義在 thermal_policy.h，
+// 是執行期政策的預設值；calculate_fan_speed() 讀取目前發布的政策
 
 void named_constants_demo(void) {
     printf("\n=== MISRA 規則: 使用具名常數 ===\n");
     
-    uint16_t cpu_temp = 80U;
+    TempMilliC cpu_temp = TEMP_MC_FROM_C(80);
     
-    if (cpu_temp > TEMPERATURE_WARNING_THRESHOLD_C) {
-        printf("溫度警告: %u°C 超過警告閾值 %u°C\n", 
-               cpu_temp, TEMPERATURE_WARNING_THRESHOLD_C);
+    if (cpu_temp > TEMP_MC_FROM_C(TEMPERATURE_WARNING_THRESHOLD_C)) {
+        printf("溫度警告: " TEMP_MC_FMT "°C 超過警告閾值 %u°C\n", 
+               TEMP_MC_ARGS(cpu_temp), TEMPERATURE_WARNING_THRESHOLD_C);
     }
     
-    if (cpu_temp > TEMPERATURE_CRITICAL_THRESHOLD_C) {
-        printf("溫度危急: %u°C 超過危急閾值 %u°C\n", 
-               cpu_temp, TEMPERATURE_CRITICAL_THRESHOLD_C);
+    if (cpu_temp > TEMP_MC_FROM_C(TEMPERATURE_CRITICAL_THRESHOLD_C)) {
+        printf("溫度危急: " TEMP_MC_FMT "°C 超過危急閾值 %u°C\n", 
+               TEMP_MC_ARGS(cpu_temp), TEMPERATURE_CRITICAL_THRESHOLD_C);
     }
 }
 
@@ -220,34 +225,38 @@ void named_constants_demo(void) {
  * 根據溫度計算適當的風扇轉速。
  * 使用線性插值在最小和最大轉速之間。
  * 
- * @param temperature 當前溫度 (攝氏度)
+ * @param temperature 當前溫度 (毫度定點，0.001°C)
  * @return uint16_t 目標風扇轉速 (RPM)
  */
-uint16_t calculate_fan_speed(uint16_t temperature) {
+uint16_t calculate_fan_speed(TempMilliC temperature) {
+    const ThermalPolicy *policy = thermal_policy_get();  /* 整個計算使用同一份政策 */
     uint16_t fan_speed;
     
     /* 溫度低於警告閾值，使用最小轉速 */
-    if (temperature < TEMPERATURE_WARNING_THRESHOLD_C) {
-        fan_speed = FAN_SPEED_MIN_RPM;
+    if (temperature < policy->warning_threshold) {
+        fan_speed = policy->fan_speed_min_rpm;
     }
     /* 溫度高於危急閾值，使用最大轉速 */
-    else if (temperature >= TEMPERATURE_CRITICAL_THRESHOLD_C) {
-        fan_speed = FAN_SPEED_MAX_RPM;
+    else if (temperature >= policy->critical_threshold) {
+        fan_speed = policy->fan_speed_max_rpm;
     }
-    /* 在警告和危急之間，線性插值 */
+    /* 在警告和危急之間，以毫度線性插值 (閾值可重載，乘積以 uint64_t 計算) */
     else {
-        uint32_t temp_range = TEMPERATURE_CRITICAL_THRESHOLD_C - 
-                             TEMPERATURE_WARNING_THRESHOLD_C;
-        uint32_t speed_range = FAN_SPEED_MAX_RPM - FAN_SPEED_MIN_RPM;
-        uint32_t temp_offset = temperature - TEMPERATURE_WARNING_THRESHOLD_C;
+        uint64_t temp_range = (uint64_t)((int64_t)policy->critical_threshold - 
+                                         (int64_t)policy->warning_threshold);
+        uint64_t speed_range = (uint64_t)policy->fan_speed_max_rpm - policy->fan_speed_min_rpm;
+        uint64_t temp_offset = (uint64_t)((int64_t)temperature - 
+                                          (int64_t)policy->warning_threshold);
         
-        fan_speed = FAN_SPEED_MIN_RPM + 
+        fan_speed = policy->fan_speed_min_rpm + 
                    (uint16_t)((temp_offset * speed_range) / temp_range);
     }
     
     return fan_speed;
 }
 
+#ifndef MISRA_C_BASICS_NO_MAIN
+
 // === 主程式 ===
 int main(void) {
     printf("=== MISRA-C 編碼標準基礎教學 ===\n");
@@ -263,12 +272,12 @@ int main(void) {
     
     // 示範風扇控制邏輯
     printf("\n=== 風扇控制邏輯示範 ===\n");
-    uint16_t test_temps[] = {60U, 75U, 80U, 85U, 90U};
+    TempMilliC test_temps[] = {60000, 75000, 80500, 84999, 85000, 90000};
     
     for (uint32_t i = 0U; i < (sizeof(test_temps) / sizeof(test_temps[0])); i++) {
-        uint16_t temp = test_temps[i];
+        TempMilliC temp = test_temps[i];
         uint16_t fan_speed = calculate_fan_speed(temp);
-        printf("溫度: %u°C -> 風扇轉速: %u RPM\n", temp, fan_speed);
+        printf("溫度: " TEMP_MC_FMT "°C -> 風扇轉速: %u RPM\n", TEMP_MC_ARGS(temp), fan_speed);
     }
     
     printf("\n=== MISRA-C 重點總結 ===\n");
@@ -282,3 +291,5 @@ int main(void) {
     
     return 0;
 }
+
+#endif  // MISRA_C_BASICS_NO_MAIN
@@ -0,0 +1,372 @@
+// sensor_table_packed.c - 緊湊的欄位式感測器表 (大量 SensorData 快照用)
+// SensorData (溫度 + 壓力 + 狀態) 因對齊補齊佔 12 bytes，機群快照動輒上百萬筆。
+// 這裡改成三個獨立欄位：
+//   - temperature: TempMilliC 陣列 (4 bytes)
+//   - pressure:    int32_t 陣列 (4 bytes)
+//   - status:      每筆 4 bits，16 筆擠進一個 uint64_t (0.5 byte)
+// 每筆 8.5 bytes，且「狀態 X 且溫度高於 Y」的查詢可以先用 SWAR 一次比對 16 筆狀態，
+// 只有狀態符合的列才去讀溫度欄位。
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <time.h>
+
+#define MISRA_C_BASICS_NO_MAIN
+#include "misra_c_basics.c"
+
+#define SENSOR_STATUS_BITS          4U
+#define SENSOR_STATUS_MAX           ((1U << SENSOR_STATUS_BITS) - 1U)
+#define SENSOR_STATUS_PER_WORD      (64U / SENSOR_STATUS_BITS)
+#define SENSOR_NIBBLE_LOW_BITS      0x1111111111111111ULL
+
+// === 欄位式感測器表 ===
+typedef struct {
+    uint32_t count;
+    uint32_t capacity;
+    TempMilliC *temperature;
+    int32_t *pressure;
+    uint64_t *status_words;         // 第 i 筆位於 words[i / 16] 的第 (i % 16) * 4 位元
+} SensorTable;
+
+static inline uint32_t sensor_table_status_words(uint32_t capacity) {
+    return (capacity + SENSOR_STATUS_PER_WORD - 1U) / SENSOR_STATUS_PER_WORD;
+}
+
+void sensor_table_free(SensorTable *table) {
+    if (table != NULL) {
+        free(table->temperature);
+        free(table->pressure);
+        free(table->status_words);
+        memset(table, 0, sizeof(*table));
+    }
+}
+
+BMCStatus sensor_table_init(SensorTable *table, uint32_t capacity) {
+    BMCStatus status = BMC_OK;
+
+    if ((table == NULL) || (capacity == 0U)) {
+        status = BMC_ERROR_INVALID_PARAM;
+    } else {
+        memset(table, 0, sizeof(*table));
+        table->capacity = capacity;
+        table->temperature = calloc(capacity, sizeof(TempMilliC));
+        table->pressure = calloc(capacity, sizeof(int32_t));
+        table->status_words = calloc(sensor_table_status_words(capacity), sizeof(uint64_t));
+        if ((table->temperature == NULL) || (table->pressure == NULL) ||
+            (table->status_words == NULL)) {
+            sensor_table_free(table);
+            status = BMC_ERROR_HARDWARE;    // 記憶體不足
+        }
+    }
+
+    return status;
+}
+
+// 實際佔用的位元組數 (不含 SensorTable 本身)
+size_t sensor_table_bytes(const SensorTable *table) {
+    return ((size_t)table->capacity * (sizeof(TempMilliC) + sizeof(int32_t))) +
+           ((size_t)sensor_table_status_words(table->capacity) * sizeof(uint64_t));
+}
+
+// === 狀態位元存取 ===
+static inline uint8_t sensor_table_get_status(const SensorTable *table, uint32_t index) {
+    uint64_t word = table->status_words[index / SENSOR_STATUS_PER_WORD];
+    uint32_t shift = (index % SENSOR_STATUS_PER_WORD) * SENSOR_STATUS_BITS;
+    return (uint8_t)((word >> shift) & SENSOR_STATUS_MAX);
+}
+
+static inline void sensor_table_set_status(SensorTable *table, uint32_t index, uint8_t status) {
+    uint64_t *word = &table->status_words[index / SENSOR_STATUS_PER_WORD];
+    uint32_t shift = (index % SENSOR_STATUS_PER_WORD) * SENSOR_STATUS_BITS;
+    *word = (*word & ~((uint64_t)SENSOR_STATUS_MAX << shift)) |
+            ((uint64_t)(status & SENSOR_STATUS_MAX) << shift);
+}
+
+// === 與列結構 SensorData 互轉 ===
+// 狀態超過 4 bits 時拒絕寫入，不做截斷
+BMCStatus sensor_table_set(SensorTable *table, uint32_t index, const SensorData *row) {
+    BMCStatus status = BMC_OK;
+
+    if ((table == NULL) || (row == NULL) || (index >= table->capacity) ||
+        (row->status > SENSOR_STATUS_MAX)) {
+        status = BMC_ERROR_INVALID_PARAM;
+    } else {
+        table->temperature[index] = row->temperature;
+        table->pressure[index] = row->pressure;
+        sensor_table_set_status(table, index, row->status);
+        if (index >= table->count) {
+            table->count = index + 1U;
+        }
+    }
+
+    return status;
+}
+
+BMCStatus sensor_table_get(const SensorTable *table, uint32_t index, SensorData *row) {
+    BMCStatus status = BMC_OK;
+
+    if ((table == NULL) || (row == NULL) || (index >= table->count)) {
+        status = BMC_ERROR_INVALID_PARAM;
+    } else {
+        row->temperature = table->temperature[index];
+        row->pressure = table->pressure[index];
+        row->status = sensor_table_get_status(table, index);
+    }
+
+    return status;
+}
+
+BMCStatus sensor_table_append(SensorTable *table, const SensorData *row) {
+    BMCStatus status = BMC_ERROR_BUSY;      // 表已滿
+
+    if ((table != NULL) && (table->count < table->capacity)) {
+        status = sensor_table_set(table, table->count, row);
+    }
+
+    return status;
+}
+
+BMCStatus sensor_table_from_rows(SensorTable *table, const SensorData *rows, uint32_t n) {
+    BMCStatus status = BMC_OK;
+
+    if ((table == NULL) || (rows == NULL) || (n > table->capacity)) {
+        status = BMC_ERROR_INVALID_PARAM;
+    } else {
+        table->count = 0U;
+        for (uint32_t i = 0U; (i < n) && (status == BMC_OK); i++) {
+            status = sensor_table_set(table, i, &rows[i]);
+        }
+    }
+
+    return status;
+}
+
+BMCStatus sensor_table_to_rows(const SensorTable *table, SensorData *rows, uint32_t n) {
+    BMCStatus status = BMC_OK;
+
+    if ((table == NULL) || (rows == NULL) || (n < table->count)) {
+        status = BMC_ERROR_INVALID_PARAM;
+    } else {
+        for (uint32_t i = 0U; i < table->count; i++) {
+            (void)sensor_table_get(table, i, &rows[i]);
+        }
+    }
+
+    return status;
+}
+
+// === 查詢：狀態等於 want_status 且溫度高於 over 的感測器 ===
+// 每次處理一個狀態字組 (16 筆)：XOR 後為 0 的 nibble 即狀態相符，
+// 整個字組都不相符時跳過，不讀溫度欄位。
+// out_index 可為 NULL (只計數)；回傳相符總數，最多寫入 max_out 筆索引。
+uint32_t sensor_table_find(const SensorTable *table, uint8_t want_status, TempMilliC over,
+                           uint32_t *out_index, uint32_t max_out) {
+    uint32_t matches = 0U;
+    uint32_t words = sensor_table_status_words(table->count);
+    uint64_t pattern = (uint64_t)(want_status & SENSOR_STATUS_MAX) * SENSOR_NIBBLE_LOW_BITS;
+
+    for (uint32_t w = 0U; w < words; w++) {
+        uint64_t diff = table->status_words[w] ^ pattern;
+        // 每個 nibble 的最低位元：1 表示該 nibble 不為 0 (狀態不同)
+        uint64_t nonzero = diff | (diff >> 1);
+        nonzero |= nonzero >> 2;
+        uint64_t hit = ~nonzero & SENSOR_NIBBLE_LOW_BITS;
+
+        // 最後一個字組可能含有超出 count 的空槽位
+        uint32_t base = w * SENSOR_STATUS_PER_WORD;
+        if ((base + SENSOR_STATUS_PER_WORD) > table->count) {
+            uint32_t valid = table->count - base;
+            hit &= (1ULL << (valid * SENSOR_STATUS_BITS)) - 1ULL;
+        }
+
+        while (hit != 0U) {
+            uint32_t index = base + ((uint32_t)__builtin_ctzll(hit) / SENSOR_STATUS_BITS);
+            if (table->temperature[index] > over) {
+                if ((out_index != NULL) && (matches < max_out)) {
+                    out_index[matches] = index;
+                }
+                matches++;
+            }
+            hit &= hit - 1U;
+        }
+    }
+
+    return matches;
+}
+
+#ifndef SENSOR_TABLE_PACKED_NO_MAIN
+
+// === 效能測試 ===
+#define BENCH_SENSORS           4000000U
+#define BENCH_ROUNDS            5U
+
+// 感測器狀態：大部分正常，少數警告/故障
+enum {
+    SENSOR_STATUS_OK = 0U,
+    SENSOR_STATUS_WARNING = 1U,
+    SENSOR_STATUS_FAULT = 2U,
+    SENSOR_STATUS_UNKNOWN = 3U
+};
+
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+// 對照組：逐列掃描 SensorData 陣列
+static uint32_t rows_find(const SensorData *rows, uint32_t n, uint8_t want_status, TempMilliC over,
+                          uint32_t *out_index, uint32_t max_out) {
+    uint32_t matches = 0U;
+
+    for (uint32_t i = 0U; i < n; i++) {
+        if ((rows[i].status == want_status) && (rows[i].temperature > over)) {
+            if ((out_index != NULL) && (matches < max_out)) {
+                out_index[matches] = i;
+            }
+            matches++;
+        }
+    }
+
+    return matches;
+}
+
+static void build_rows(SensorData *rows, uint32_t n, uint32_t fault_per_mille) {
+    uint32_t rng = 0x2468ACE1U;
+
+    for (uint32_t i = 0U; i < n; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        uint32_t r = rng % 1000U;
+        rows[i].temperature = TEMP_MC_FROM_C(30) + (TempMilliC)((rng >> 8) % 70000U);
+        rows[i].pressure = 101325 + (int32_t)((rng >> 4) % 2000U) - 1000;
+        if (r < fault_per_mille) {
+            rows[i].status = SENSOR_STATUS_FAULT;
+        } else if (r < (fault_per_mille + 50U)) {
+            rows[i].status = SENSOR_STATUS_WARNING;
+        } else {
+            rows[i].status = SENSOR_STATUS_OK;
+        }
+    }
+}
+
+static double time_rows(const SensorData *rows, uint8_t want, TempMilliC over,
+                        uint32_t *out, uint32_t max_out, uint32_t *matches) {
+    double best = 1e30;
+
+    for (uint32_t r = 0U; r < BENCH_ROUNDS; r++) {
+        uint64_t start = bench_now_ns();
+        *matches = rows_find(rows, BENCH_SENSORS, want, over, out, max_out);
+        double ns = (double)(bench_now_ns() - start);
+        if (ns < best) {
+            best = ns;
+        }
+    }
+
+    return best;
+}
+
+static double time_table(const SensorTable *table, uint8_t want, TempMilliC over,
+                         uint32_t *out, uint32_t max_out, uint32_t *matches) {
+    double best = 1e30;
+
+    for (uint32_t r = 0U; r < BENCH_ROUNDS; r++) {
+        uint64_t start = bench_now_ns();
+        *matches = sensor_table_find(table, want, over, out, max_out);
+        double ns = (double)(bench_now_ns() - start);
+        if (ns < best) {
+            best = ns;
+        }
+    }
+
+    return best;
+}
+
+int main(void) {
+    SensorData *rows = malloc((size_t)BENCH_SENSORS * sizeof(SensorData));
+    SensorData *back = malloc((size_t)BENCH_SENSORS * sizeof(SensorData));
+    uint32_t *out = malloc((size_t)BENCH_SENSORS * sizeof(uint32_t));
+    SensorTable table;
+    int result = 0;
+
+    if ((rows == NULL) || (back == NULL) || (out == NULL) ||
+        (sensor_table_init(&table, BENCH_SENSORS) != BMC_OK)) {
+        printf("記憶體配置失敗\n");
+        free(rows);
+        free(back);
+        free(out);
+        return 1;
+    }
+
+    printf("=== 欄位式感測器表 vs SensorData 陣列 (%u 筆) ===\n", BENCH_SENSORS);
+
+    printf("\n--- 每百萬筆記憶體 ---\n");
+    double row_mb = ((double)sizeof(SensorData) * 1e6) / (1024.0 * 1024.0);
+    double col_mb = (((double)sensor_table_bytes(&table) / BENCH_SENSORS) * 1e6) / (1024.0 * 1024.0);
+    printf("SensorData 陣列: %2zu bytes/筆, %6.2f MiB\n", sizeof(SensorData), row_mb);
+    printf("欄位式表:        %.1f bytes/筆, %6.2f MiB (節省 %.0f%%)\n",
+           (double)sensor_table_bytes(&table) / BENCH_SENSORS, col_mb,
+           100.0 * (1.0 - (col_mb / row_mb)));
+
+    // 轉換往返與錯誤處理
+    build_rows(rows, BENCH_SENSORS, 5U);
+    bool round_trip = (sensor_table_from_rows(&table, rows, BENCH_SENSORS) == BMC_OK) &&
+                      (sensor_table_to_rows(&table, back, BENCH_SENSORS) == BMC_OK);
+    for (uint32_t i = 0U; (i < BENCH_SENSORS) && round_trip; i++) {
+        round_trip = (rows[i].temperature == back[i].temperature) &&
+                     (rows[i].pressure == back[i].pressure) && (rows[i].status == back[i].status);
+    }
+    SensorData bad = { .temperature = 0, .pressure = 0, .status = 16U };
+    printf("\n列 -> 欄 -> 列 往返: %s, 狀態 16 (超過 4 bits) 寫入被拒: %s\n",
+           round_trip ? "完全一致" : "不一致!",
+           (sensor_table_set(&table, 0U, &bad) == BMC_ERROR_INVALID_PARAM) ? "是" : "否!");
+    if (!round_trip) {
+        result = 1;
+    }
+
+    printf("\n--- 查詢：狀態 X 且溫度 > 80°C (取 %u 輪最快) ---\n", BENCH_ROUNDS);
+    printf("%-20s %8s   %12s %12s   %12s %12s\n", "情境", "符合數",
+           "列 ms", "欄 ms", "列 M筆/s", "欄 M筆/s");
+
+    static const struct {
+        const char *label;
+        uint32_t fault_per_mille;
+        uint8_t want;
+        bool collect;
+    } cases[] = {
+        { "FAULT 0.5% 只計數", 5U, SENSOR_STATUS_FAULT, false },
+        { "FAULT 0.5% 取索引", 5U, SENSOR_STATUS_FAULT, true },
+        { "FAULT 5% 取索引", 50U, SENSOR_STATUS_FAULT, true },
+        { "OK ~90% 取索引", 50U, SENSOR_STATUS_OK, true }
+    };
+
+    for (uint32_t c = 0U; c < (sizeof(cases) / sizeof(cases[0])); c++) {
+        uint32_t row_matches = 0U;
+        uint32_t col_matches = 0U;
+        uint32_t *dest = cases[c].collect ? out : NULL;
+
+        build_rows(rows, BENCH_SENSORS, cases[c].fault_per_mille);
+        (void)sensor_table_from_rows(&table, rows, BENCH_SENSORS);
+
+        double row_ns = time_rows(rows, cases[c].want, TEMP_MC_FROM_C(80), dest, BENCH_SENSORS,
+                                  &row_matches);
+        double col_ns = time_table(&table, cases[c].want, TEMP_MC_FROM_C(80), dest, BENCH_SENSORS,
+                                   &col_matches);
+        printf("%-20s %8u   %12.2f %12.2f   %12.0f %12.0f%s\n", cases[c].label, col_matches,
+               row_ns / 1e6, col_ns / 1e6,
+               (BENCH_SENSORS / row_ns) * 1e3, (BENCH_SENSORS / col_ns) * 1e3,
+               (row_matches == col_matches) ? "" : "  (結果不一致!)");
+        if (row_matches != col_matches) {
+            result = 1;
+        }
+    }
+
+    sensor_table_free(&table);
+    free(rows);
+    free(back);
+    free(out);
+    return result;
+}
+
+#endif  // SENSOR_TABLE_PACKED_NO_MAIN
@@ -194,6 +194,8 @@ int main() {
     printf("建議：\n");
     printf("1. 使用 valgrind 檢查記憶體洩漏\n");
     printf("   valgrind --leak-check=full ./advanced_pointers\n");
+    printf("   長時間執行的程式可用 LD_PRELOAD 配置追蹤器 (alloc_tracker.c)\n");
+    printf("   LD_PRELOAD=./liballoc_tracker.so ./advanced_pointers\n");
     printf("2. 編譯時加入 -Wall -Wextra 顯示所有警告\n");
     printf("   gcc -Wall -Wextra -g advanced_pointers.c -o advanced_pointers\n");
     
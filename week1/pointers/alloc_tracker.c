@@ -0,0 +1,707 @@
+// alloc_tracker.c - 低開銷的配置追蹤器 (LD_PRELOAD 替換 malloc 系列)
+// valgrind --leak-check=full 慢 20-50 倍，不可能在有負載的線上控制器上執行。
+// 這個共享函式庫取代 malloc/calloc/realloc/free 與對齊配置函數，轉呼叫 glibc 的 __libc_*：
+//   - 每個區塊前面加 16 bytes 標頭 (大小 + 呼叫點)，free 時才知道要記到哪個呼叫點
+//   - 每個執行緒一張呼叫點表 (mmap 配置，開放定址)，只有擁有者寫入，熱路徑沒有鎖也沒有原子 RMW
+//   - 執行緒結束時 (pthread key 解構子) 歸還執行緒表，下一個新執行緒沿用同一張表與其統計
+//   - 每配置約 ALLOC_TRACKER_SAMPLE_BYTES bytes 取樣一次 backtrace，記在該呼叫點
+//   - 結束時或收到 ALLOC_TRACKER_SIGNAL 時輸出報表 (依存活 bytes 排序)
+// 跨執行緒釋放記在釋放端的表，報表時依呼叫點合併；單一執行緒的呼叫點峰值是精確值，
+// 跨執行緒使用的呼叫點峰值為各執行緒峰值的總和 (上限)。
+//
+// 編譯: gcc -Wall -Wextra -std=gnu11 -O2 -shared -fPIC -o liballoc_tracker.so alloc_tracker.c -ldl -pthread
+// 使用: LD_PRELOAD=./liballoc_tracker.so ./advanced_pointers
+//       kill -USR2 <pid>                      執行中輸出報表
+// 環境變數:
+//   ALLOC_TRACKER_SAMPLE_BYTES  取樣間隔 (預設 524288，0 表示不取 backtrace)
+//   ALLOC_TRACKER_SIGNAL        觸發報表的訊號編號 (預設 SIGUSR2，0 表示停用)
+//   ALLOC_TRACKER_OUT           報表檔案 (附加寫入，預設 stderr)
+//   ALLOC_TRACKER_TOP           列出的呼叫點數 (預設 20)
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+extern void *__libc_malloc(size_t size);
+extern void __libc_free(void *ptr);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+#define TRACKER_EXPORT              __attribute__((visibility("default")))
+#define TRACKER_TLS                 __thread __attribute__((tls_model("initial-exec")))
+
+#define TRACKER_HEADER_SIZE         16U
+#define TRACKER_SHIFT_POS           56U     // 標頭大小欄位的高 8 位元存 log2(區塊起點到使用者指標的距離)
+#define TRACKER_SIZE_MASK           ((1ULL << TRACKER_SHIFT_POS) - 1ULL)
+#define TRACKER_SITES               1024U   // 每執行緒呼叫點數 (2 的冪次)
+#define TRACKER_MAX_THREADS         256U
+#define TRACKER_STACK_DEPTH         8U
+#define TRACKER_MERGED_SITES        8192U
+#define TRACKER_DEFAULT_SAMPLE      (512U * 1024U)
+#define TRACKER_DEFAULT_TOP         20U
+#define TRACKER_UNTRACKED_BATCH     64U     // 沒有執行緒表時，每累積這麼多次才更新共享計數器
+
+// === 資料結構 ===
+typedef struct {
+    uint64_t size_shift;            // 要求的大小 | (log2 偏移 << 56)
+    struct TrackerSite *entry;      // 配置端執行緒表中的呼叫點，NULL 表示未記帳
+} TrackerHeader;
+
+_Static_assert(sizeof(TrackerHeader) == TRACKER_HEADER_SIZE, "標頭必須維持 16 bytes 對齊");
+
+typedef struct TrackerSite {
+    uintptr_t site;                 // 0 表示空槽，寫入後不再改變
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t alloc_bytes;
+    uint64_t free_bytes;            // 存活 = alloc_bytes - free_bytes (本執行緒的觀點)
+    int64_t peak_bytes;
+    uint32_t samples;
+    uint32_t depth;
+    void *stack[TRACKER_STACK_DEPTH];
+} TrackerSite;
+
+typedef struct ThreadTable {
+    struct ThreadTable *next;       // 執行緒表只加入串列，不會移除或 munmap (標頭仍指向其中的項目)
+    _Atomic uint32_t owned;         // 1 表示有執行緒使用中
+    pid_t tid;                      // 目前 (或最後一個) 擁有者
+    uint64_t sample_countdown;
+    uint64_t overflow;              // 表滿時無法記錄的次數
+    TrackerSite sites[TRACKER_SITES];
+} ThreadTable;
+
+// 擁有者用一般讀取 + relaxed 寫入更新，報表執行緒以 relaxed 讀取 (無資料競爭，x86 上就是 mov)
+#define TRACKER_LOAD(field)         __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define TRACKER_STORE(field, v)     __atomic_store_n(&(field), (v), __ATOMIC_RELAXED)
+#define TRACKER_ADD(field, v)       TRACKER_STORE(field, (field) + (v))
+
+static _Atomic(ThreadTable *) tracker_threads;
+static _Atomic uint32_t tracker_thread_count;
+static _Atomic uint64_t tracker_untracked;      // 沒有執行緒表時的配置次數
+static uint64_t tracker_sample_bytes = TRACKER_DEFAULT_SAMPLE;
+static uint32_t tracker_top = TRACKER_DEFAULT_TOP;
+static int tracker_out_fd = STDERR_FILENO;
+static int tracker_pipe[2] = { -1, -1 };
+static void *tracker_self_base;                 // 本函式庫的載入位址，取樣時略過自己的堆疊框
+
+static pthread_key_t tracker_key;               // 執行緒結束時歸還執行緒表
+static bool tracker_key_ready;
+
+static TRACKER_TLS ThreadTable *tls_table;
+static TRACKER_TLS ThreadTable *tls_active;     // 記帳中為 tls_table，忙碌或尚未建立時為 NULL
+static TRACKER_TLS uint32_t tls_busy;           // 非 0 時不記帳 (backtrace/報表內部的配置)
+static TRACKER_TLS bool tls_claimed;            // 每個執行緒只嘗試取得一次執行緒表
+static TRACKER_TLS uint32_t tls_untracked;      // 尚未加到 tracker_untracked 的次數
+
+// === 執行緒表 ===
+static inline void tracker_busy_enter(void) {
+    tls_busy++;
+    tls_active = NULL;
+}
+
+static inline void tracker_busy_exit(void) {
+    tls_busy--;
+    if (tls_busy == 0U) {
+        tls_active = tls_table;
+    }
+}
+
+// 沿用已結束執行緒歸還的表；acquire 與歸還時的 release 配對，前一個擁有者的寫入都已可見
+static ThreadTable *tracker_table_adopt(void) {
+    ThreadTable *table = NULL;
+
+    for (ThreadTable *t = atomic_load(&tracker_threads); (t != NULL) && (table == NULL); t = t->next) {
+        uint32_t expected = 0U;
+        if ((atomic_load_explicit(&t->owned, memory_order_relaxed) == 0U) &&
+            atomic_compare_exchange_strong_explicit(&t->owned, &expected, 1U,
+                                                    memory_order_acquire, memory_order_relaxed)) {
+            table = t;
+        }
+    }
+
+    return table;
+}
+
+static ThreadTable *tracker_table_create(void) {
+    ThreadTable *table = NULL;
+    uint32_t count = atomic_load(&tracker_thread_count);
+
+    // 達到上限後不再遞增計數，避免每個後來的執行緒都對它做原子 RMW
+    do {
+        if (count >= TRACKER_MAX_THREADS) {
+            return NULL;
+        }
+    } while (!atomic_compare_exchange_weak(&tracker_thread_count, &count, count + 1U));
+
+    void *mem = mmap(NULL, sizeof(ThreadTable), PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        atomic_fetch_sub(&tracker_thread_count, 1U);
+    } else {
+        table = (ThreadTable *)mem;
+        atomic_init(&table->owned, 1U);
+        table->sample_countdown = tracker_sample_bytes;
+        ThreadTable *head = atomic_load(&tracker_threads);
+        do {
+            table->next = head;
+        } while (!atomic_compare_exchange_weak(&tracker_threads, &head, table));
+    }
+
+    return table;
+}
+
+// 每個執行緒第一次配置時執行一次；沒拿到表的執行緒之後只走 tls_claimed 的檢查
+static ThreadTable * __attribute__((noinline)) tracker_table_slow(void) {
+    ThreadTable *table = NULL;
+
+    if ((tls_table == NULL) && (tls_busy == 0U) && !tls_claimed) {
+        tls_claimed = true;
+        table = tracker_table_adopt();
+        if (table == NULL) {
+            table = tracker_table_create();
+        }
+        if (table != NULL) {
+            TRACKER_STORE(table->tid, (pid_t)syscall(SYS_gettid));
+            tls_table = table;
+            tls_active = table;
+            if (tracker_key_ready) {
+                // pthread_setspecific 可能配置記憶體
+                tracker_busy_enter();
+                (void)pthread_setspecific(tracker_key, table);
+                tracker_busy_exit();
+            }
+        }
+    }
+
+    return table;
+}
+
+// pthread key 解構子：執行緒結束時歸還執行緒表。之後 (其他 TLS 解構子) 的配置與釋放不再記帳，
+// 已歸還的表由下一個擁有者獨佔寫入
+static void tracker_thread_exit(void *arg) {
+    ThreadTable *table = (ThreadTable *)arg;
+
+    tls_busy++;
+    tls_table = NULL;
+    tls_active = NULL;
+    if (tls_untracked > 0U) {
+        atomic_fetch_add_explicit(&tracker_untracked, tls_untracked, memory_order_relaxed);
+        tls_untracked = 0U;
+    }
+    atomic_store_explicit(&table->owned, 0U, memory_order_release);
+}
+
+// 沒有執行緒表的配置：批次累加到共享計數器
+static inline void tracker_count_untracked(void) {
+    tls_untracked++;
+    if (tls_untracked >= TRACKER_UNTRACKED_BATCH) {
+        atomic_fetch_add_explicit(&tracker_untracked, tls_untracked, memory_order_relaxed);
+        tls_untracked = 0U;
+    }
+}
+
+// 熱路徑只讀一個 TLS 變數
+static inline ThreadTable *tracker_table(void) {
+    ThreadTable *table = tls_active;
+
+    if (__builtin_expect(table == NULL, 0)) {
+        table = tracker_table_slow();
+    }
+    return table;
+}
+
+static inline bool tracker_owns(const ThreadTable *table, const TrackerSite *entry) {
+    return ((uintptr_t)entry - (uintptr_t)table->sites) < sizeof(table->sites);
+}
+
+static inline uint32_t tracker_hash(uintptr_t site) {
+    return (uint32_t)(((uint64_t)site * 0x9E3779B97F4A7C15ULL) >> 54) & (TRACKER_SITES - 1U);
+}
+
+static TrackerSite *tracker_site(ThreadTable *table, uintptr_t site) {
+    uint32_t index = tracker_hash(site);
+    TrackerSite *result = NULL;
+
+    for (uint32_t probe = 0U; probe < TRACKER_SITES; probe++) {
+        TrackerSite *s = &table->sites[(index + probe) & (TRACKER_SITES - 1U)];
+        if (s->site == site) {
+            result = s;
+            break;
+        }
+        if (s->site == 0U) {
+            TRACKER_STORE(s->site, site);
+            result = s;
+            break;
+        }
+    }
+    if (result == NULL) {
+        table->overflow++;
+    }
+
+    return result;
+}
+
+// 取樣：記下第一份 backtrace，略過本函式庫自己的堆疊框
+static void __attribute__((noinline)) tracker_sample(TrackerSite *site) {
+    void *frames[TRACKER_STACK_DEPTH + 4U];
+    uint32_t depth = 0U;
+
+    TRACKER_ADD(site->samples, 1U);
+    if (site->depth == 0U) {
+        tracker_busy_enter();
+        int n = backtrace(frames, (int)(sizeof(frames) / sizeof(frames[0])));
+        for (int i = 0; (i < n) && (depth < TRACKER_STACK_DEPTH); i++) {
+            Dl_info info;
+            if ((dladdr(frames[i], &info) != 0) && (info.dli_fbase == tracker_self_base)) {
+                continue;
+            }
+            site->stack[depth++] = frames[i];
+        }
+        tracker_busy_exit();
+        TRACKER_STORE(site->depth, depth);
+    }
+}
+
+static inline TrackerSite *tracker_record_alloc(uintptr_t site, size_t size) {
+    ThreadTable *table = tracker_table();
+    TrackerSite *s = NULL;
+
+    if (table == NULL) {
+        tracker_count_untracked();
+    } else {
+        s = tracker_site(table, site);
+    }
+    if (s != NULL) {
+        uint64_t alloc_bytes = s->alloc_bytes + size;
+        int64_t live = (int64_t)(alloc_bytes - s->free_bytes);
+        TRACKER_ADD(s->allocs, 1U);
+        TRACKER_STORE(s->alloc_bytes, alloc_bytes);
+        if (live > s->peak_bytes) {
+            TRACKER_STORE(s->peak_bytes, live);
+        }
+        if (size < table->sample_countdown) {
+            table->sample_countdown -= size;
+        } else if (tracker_sample_bytes > 0U) {
+            table->sample_countdown = tracker_sample_bytes;
+            tracker_sample(s);
+        } else {
+            table->sample_countdown = UINT64_MAX;
+        }
+    }
+
+    return s;
+}
+
+// 同執行緒釋放直接更新標頭指向的項目；跨執行緒釋放記在釋放端自己的表
+static inline void tracker_record_free(TrackerSite *entry, size_t size) {
+    ThreadTable *table = tracker_table();
+
+    if ((table != NULL) && (entry != NULL)) {
+        TrackerSite *s = tracker_owns(table, entry) ? entry : tracker_site(table, TRACKER_LOAD(entry->site));
+        if (s != NULL) {
+            TRACKER_ADD(s->frees, 1U);
+            TRACKER_ADD(s->free_bytes, size);
+        }
+    }
+}
+
+// === 標頭 ===
+static inline TrackerHeader *tracker_header(void *user) {
+    return (TrackerHeader *)((uint8_t *)user - TRACKER_HEADER_SIZE);
+}
+
+static inline void *tracker_base(void *user, const TrackerHeader *header) {
+    return (uint8_t *)user - (1ULL << (header->size_shift >> TRACKER_SHIFT_POS));
+}
+
+static inline void *tracker_finish(void *base, size_t size, uint32_t shift, uintptr_t site) {
+    void *user = NULL;
+
+    if (base != NULL) {
+        user = (uint8_t *)base + (1ULL << shift);
+        TrackerHeader *header = tracker_header(user);
+        header->size_shift = (uint64_t)size | ((uint64_t)shift << TRACKER_SHIFT_POS);
+        header->entry = tracker_record_alloc(site, size);
+    }
+
+    return user;
+}
+
+static void *tracker_malloc(size_t size, uintptr_t site) {
+    if (size > (TRACKER_SIZE_MASK - TRACKER_HEADER_SIZE)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return tracker_finish(__libc_malloc(size + TRACKER_HEADER_SIZE), size, 4U, site);
+}
+
+// alignment 必須是 2 的冪次；大於 16 時使用者指標放在 base + alignment
+static void *tracker_memalign(size_t alignment, size_t size, uintptr_t site) {
+    void *result;
+
+    if (alignment <= TRACKER_HEADER_SIZE) {
+        result = tracker_malloc(size, site);
+    } else if ((size > (TRACKER_SIZE_MASK - alignment)) || (alignment > (1ULL << 40))) {
+        errno = ENOMEM;
+        result = NULL;
+    } else {
+        uint32_t shift = (uint32_t)__builtin_ctzll((unsigned long long)alignment);
+        result = tracker_finish(__libc_memalign(alignment, size + alignment), size, shift, site);
+    }
+
+    return result;
+}
+
+static void tracker_free(void *ptr) {
+    if (ptr != NULL) {
+        TrackerHeader *header = tracker_header(ptr);
+        tracker_record_free(header->entry, (size_t)(header->size_shift & TRACKER_SIZE_MASK));
+        __libc_free(tracker_base(ptr, header));
+    }
+}
+
+// === 對外介面 (取代 glibc 的同名函數) ===
+#define CALLER_SITE()               ((uintptr_t)__builtin_extract_return_addr(__builtin_return_address(0)))
+
+TRACKER_EXPORT void *malloc(size_t size) {
+    return tracker_malloc(size, CALLER_SITE());
+}
+
+TRACKER_EXPORT void free(void *ptr) {
+    tracker_free(ptr);
+}
+
+TRACKER_EXPORT void *calloc(size_t count, size_t size) {
+    size_t total;
+    void *result = NULL;
+
+    if (__builtin_mul_overflow(count, size, &total) ||
+        (total > (TRACKER_SIZE_MASK - TRACKER_HEADER_SIZE))) {
+        errno = ENOMEM;
+    } else {
+        result = tracker_finish(__libc_calloc(1U, total + TRACKER_HEADER_SIZE), total, 4U, CALLER_SITE());
+    }
+
+    return result;
+}
+
+// 視為在新的呼叫點釋放舊區塊並配置新區塊
+static void *tracker_realloc(void *ptr, size_t size, uintptr_t site) {
+    void *result = NULL;
+
+    if (ptr == NULL) {
+        result = tracker_malloc(size, site);
+    } else if (size == 0U) {
+        tracker_free(ptr);
+    } else if (size > (TRACKER_SIZE_MASK - TRACKER_HEADER_SIZE)) {
+        errno = ENOMEM;
+    } else {
+        TrackerHeader *header = tracker_header(ptr);
+        size_t old_size = (size_t)(header->size_shift & TRACKER_SIZE_MASK);
+        TrackerSite *old_entry = header->entry;
+
+        if ((header->size_shift >> TRACKER_SHIFT_POS) == 4U) {
+            void *base = __libc_realloc(tracker_base(ptr, header), size + TRACKER_HEADER_SIZE);
+            if (base != NULL) {
+                tracker_record_free(old_entry, old_size);
+                result = tracker_finish(base, size, 4U, site);
+            }
+        } else {
+            // 對齊配置的區塊：新配置 + 複製 (realloc 不保證維持對齊)
+            result = tracker_malloc(size, site);
+            if (result != NULL) {
+                memcpy(result, ptr, (old_size < size) ? old_size : size);
+                tracker_free(ptr);
+            }
+        }
+    }
+
+    return result;
+}
+
+TRACKER_EXPORT void *realloc(void *ptr, size_t size) {
+    return tracker_realloc(ptr, size, CALLER_SITE());
+}
+
+TRACKER_EXPORT void *reallocarray(void *ptr, size_t count, size_t size) {
+    size_t total;
+    void *result = NULL;
+
+    if (__builtin_mul_overflow(count, size, &total)) {
+        errno = ENOMEM;
+    } else {
+        result = tracker_realloc(ptr, total, CALLER_SITE());
+    }
+
+    return result;
+}
+
+TRACKER_EXPORT void *memalign(size_t alignment, size_t size) {
+    return tracker_memalign(alignment, size, CALLER_SITE());
+}
+
+TRACKER_EXPORT void *aligned_alloc(size_t alignment, size_t size) {
+    return tracker_memalign(alignment, size, CALLER_SITE());
+}
+
+TRACKER_EXPORT int posix_memalign(void **out, size_t alignment, size_t size) {
+    int result = 0;
+
+    if ((alignment < sizeof(void *)) || ((alignment & (alignment - 1U)) != 0U)) {
+        result = EINVAL;
+    } else {
+        void *ptr = tracker_memalign(alignment, size, CALLER_SITE());
+        if (ptr == NULL) {
+            result = ENOMEM;
+        } else {
+            *out = ptr;
+        }
+    }
+
+    return result;
+}
+
+TRACKER_EXPORT void *valloc(size_t size) {
+    return tracker_memalign((size_t)sysconf(_SC_PAGESIZE), size, CALLER_SITE());
+}
+
+TRACKER_EXPORT void *pvalloc(size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return tracker_memalign(page, (size + page - 1U) & ~(page - 1U), CALLER_SITE());
+}
+
+// 回傳要求的大小：不大於實際可用大小，呼叫者依此使用一定安全
+TRACKER_EXPORT size_t malloc_usable_size(void *ptr) {
+    return (ptr == NULL) ? 0U : (size_t)(tracker_header(ptr)->size_shift & TRACKER_SIZE_MASK);
+}
+
+// === 報表 ===
+typedef struct {
+    uintptr_t site;
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t alloc_bytes;
+    uint64_t free_bytes;
+    int64_t peak_bytes;
+    uint64_t samples;
+    uint32_t threads;
+    uint32_t depth;
+    void *stack[TRACKER_STACK_DEPTH];
+} MergedSite;
+
+static int merged_compare(const void *a, const void *b) {
+    const MergedSite *x = *(const MergedSite *const *)a;
+    const MergedSite *y = *(const MergedSite *const *)b;
+    int64_t live_x = (int64_t)(x->alloc_bytes - x->free_bytes);
+    int64_t live_y = (int64_t)(y->alloc_bytes - y->free_bytes);
+    int result = (live_y > live_x) - (live_y < live_x);
+
+    if (result == 0) {
+        result = (y->alloc_bytes > x->alloc_bytes) - (y->alloc_bytes < x->alloc_bytes);
+    }
+    return result;
+}
+
+// "符號+位移 (模組+位移)"，沒有匯出符號時可用 addr2line -e 模組 位移 查詢
+static void tracker_describe(uintptr_t addr, char *out, size_t cap) {
+    Dl_info info;
+
+    if ((dladdr((void *)addr, &info) == 0) || (info.dli_fname == NULL)) {
+        snprintf(out, cap, "%#lx", (unsigned long)addr);
+    } else {
+        const char *module = strrchr(info.dli_fname, '/');
+        module = (module != NULL) ? (module + 1) : info.dli_fname;
+        if (info.dli_sname != NULL) {
+            snprintf(out, cap, "%s+%#lx (%s+%#lx)", info.dli_sname,
+                     (unsigned long)(addr - (uintptr_t)info.dli_saddr), module,
+                     (unsigned long)(addr - (uintptr_t)info.dli_fbase));
+        } else {
+            snprintf(out, cap, "%s+%#lx", module, (unsigned long)(addr - (uintptr_t)info.dli_fbase));
+        }
+    }
+}
+
+static void tracker_report(const char *reason) {
+    size_t merged_bytes = sizeof(MergedSite) * TRACKER_MERGED_SITES;
+    size_t order_bytes = sizeof(MergedSite *) * TRACKER_MERGED_SITES;
+    MergedSite *merged = mmap(NULL, merged_bytes + order_bytes, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    uint32_t site_count = 0U;
+    uint32_t thread_count = 0U;
+    uint64_t overflow = 0U;
+
+    if (merged == MAP_FAILED) {
+        return;
+    }
+    tracker_busy_enter();
+    MergedSite **order = (MergedSite **)((uint8_t *)merged + merged_bytes);
+
+    // 依呼叫點合併所有執行緒的表
+    for (ThreadTable *t = atomic_load(&tracker_threads); t != NULL; t = t->next) {
+        thread_count++;
+        overflow += TRACKER_LOAD(t->overflow);
+        for (uint32_t i = 0U; i < TRACKER_SITES; i++) {
+            TrackerSite *s = &t->sites[i];
+            uintptr_t site = TRACKER_LOAD(s->site);
+            if (site == 0U) {
+                continue;
+            }
+            uint32_t index = tracker_hash(site) * (TRACKER_MERGED_SITES / TRACKER_SITES);
+            MergedSite *m = NULL;
+            for (uint32_t probe = 0U; probe < TRACKER_MERGED_SITES; probe++) {
+                MergedSite *c = &merged[(index + probe) & (TRACKER_MERGED_SITES - 1U)];
+                if ((c->site == site) || (c->site == 0U)) {
+                    m = c;
+                    break;
+                }
+            }
+            if (m == NULL) {
+                overflow++;
+                continue;
+            }
+            if (m->site == 0U) {
+                m->site = site;
+                order[site_count++] = m;
+            }
+            m->allocs += TRACKER_LOAD(s->allocs);
+            m->frees += TRACKER_LOAD(s->frees);
+            m->alloc_bytes += TRACKER_LOAD(s->alloc_bytes);
+            m->free_bytes += TRACKER_LOAD(s->free_bytes);
+            m->peak_bytes += TRACKER_LOAD(s->peak_bytes);
+            m->samples += TRACKER_LOAD(s->samples);
+            m->threads++;
+            uint32_t depth = TRACKER_LOAD(s->depth);
+            if ((m->depth == 0U) && (depth > 0U)) {
+                memcpy(m->stack, s->stack, sizeof(m->stack));
+                m->depth = depth;
+            }
+        }
+    }
+    qsort(order, site_count, sizeof(order[0]), merged_compare);
+
+    uint64_t live_objects = 0U;
+    int64_t live_bytes = 0;
+    uint64_t total_allocs = 0U;
+    for (uint32_t i = 0U; i < site_count; i++) {
+        live_objects += order[i]->allocs - order[i]->frees;
+        live_bytes += (int64_t)(order[i]->alloc_bytes - order[i]->free_bytes);
+        total_allocs += order[i]->allocs;
+    }
+
+    char desc[256];
+    int fd = tracker_out_fd;
+    dprintf(fd, "\n=== alloc_tracker 報表 (pid %d, %s) ===\n", (int)getpid(), reason);
+    dprintf(fd, "執行緒表 %u, 呼叫點 %u, 配置 %lu 次, 存活 %lu 個物件 / %ld bytes",
+            thread_count, site_count, (unsigned long)total_allocs,
+            (unsigned long)live_objects, (long)live_bytes);
+    dprintf(fd, ", 未記錄 %lu 次\n", (unsigned long)(atomic_load(&tracker_untracked) + overflow));
+    dprintf(fd, "%10s %10s %9s %12s %14s %12s  %6s  %s\n",
+            "allocs", "frees", "live", "live_bytes", "total_bytes", "peak_bytes", "sample", "site");
+    for (uint32_t i = 0U; (i < site_count) && (i < tracker_top); i++) {
+        const MergedSite *m = order[i];
+        tracker_describe(m->site, desc, sizeof(desc));
+        dprintf(fd, "%10lu %10lu %9ld %12ld %14lu %12ld%s %6lu  %s\n",
+                (unsigned long)m->allocs, (unsigned long)m->frees, (long)(m->allocs - m->frees),
+                (long)(m->alloc_bytes - m->free_bytes), (unsigned long)m->alloc_bytes,
+                (long)m->peak_bytes, (m->threads > 1U) ? "+" : " ",
+                (unsigned long)m->samples, desc);
+        for (uint32_t f = 0U; f < m->depth; f++) {
+            tracker_describe((uintptr_t)m->stack[f], desc, sizeof(desc));
+            dprintf(fd, "%12s#%u %s\n", "", f, desc);
+        }
+    }
+    dprintf(fd, "(peak_bytes 後的 + 表示跨執行緒使用，為各執行緒峰值總和)\n");
+
+    tracker_busy_exit();
+    munmap(merged, merged_bytes + order_bytes);
+}
+
+// === 訊號觸發：處理器只寫入 pipe，由報表執行緒輸出 ===
+static void tracker_signal_handler(int signo) {
+    int saved = errno;
+    uint8_t byte = (uint8_t)signo;
+    ssize_t n = write(tracker_pipe[1], &byte, 1U);
+    (void)n;
+    errno = saved;
+}
+
+static void *tracker_reporter_thread(void *arg) {
+    sigset_t all;
+    uint8_t byte;
+    (void)arg;
+
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, NULL);
+    tracker_busy_enter();           // 報表執行緒自己的配置不記帳
+
+    while (read(tracker_pipe[0], &byte, 1U) == 1) {
+        char reason[32];
+        snprintf(reason, sizeof(reason), "訊號 %u", byte);
+        tracker_report(reason);
+    }
+
+    return NULL;
+}
+
+static uint64_t tracker_env_u64(const char *name, uint64_t fallback) {
+    const char *value = getenv(name);
+    return ((value != NULL) && (*value != '\0')) ? strtoull(value, NULL, 0) : fallback;
+}
+
+__attribute__((constructor)) static void tracker_init(void) {
+    Dl_info self;
+    void *warmup[2];
+
+    tracker_busy_enter();
+    if (dladdr((void *)tracker_init, &self) != 0) {
+        tracker_self_base = self.dli_fbase;
+    }
+    (void)backtrace(warmup, 2);     // 第一次呼叫會載入 libgcc_s (內部會配置記憶體)
+
+    tracker_sample_bytes = tracker_env_u64("ALLOC_TRACKER_SAMPLE_BYTES", TRACKER_DEFAULT_SAMPLE);
+    tracker_top = (uint32_t)tracker_env_u64("ALLOC_TRACKER_TOP", TRACKER_DEFAULT_TOP);
+    const char *out = getenv("ALLOC_TRACKER_OUT");
+    if ((out != NULL) && (*out != '\0')) {
+        int fd = open(out, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd >= 0) {
+            tracker_out_fd = fd;
+        }
+    }
+
+    tracker_key_ready = pthread_key_create(&tracker_key, tracker_thread_exit) == 0;
+
+    int signo = (int)tracker_env_u64("ALLOC_TRACKER_SIGNAL", SIGUSR2);
+    if ((signo > 0) && (pipe2(tracker_pipe, O_CLOEXEC) == 0)) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, tracker_reporter_thread, NULL) == 0) {
+            struct sigaction sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sa_handler = tracker_signal_handler;
+            sa.sa_flags = SA_RESTART;
+            sigemptyset(&sa.sa_mask);
+            (void)sigaction(signo, &sa, NULL);
+            (void)pthread_detach(thread);
+        }
+    }
+    tracker_busy_exit();
+}
+
+__attribute__((destructor)) static void tracker_fini(void) {
+    atomic_fetch_add_explicit(&tracker_untracked, tls_untracked, memory_order_relaxed);
+    tls_untracked = 0U;
+    tracker_report("結束");
+}
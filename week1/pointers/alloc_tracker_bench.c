@@ -0,0 +1,274 @@
+// alloc_tracker_bench.c - 配置追蹤器的開銷量測與控制迴圈示範
+// 三個工作負載，各自以 bench_harness.h 量測，分別在有/沒有 LD_PRELOAD 下執行再比較：
+//   pointers/pattern     advanced_pointers.c 的配置模式 (malloc/calloc/realloc/Person)
+//   pointers/new_thread  同上，但在 300 個執行緒建立又結束之後的新執行緒中執行
+//   controller/tick      64 區風扇控制 tick，加上每 tick 的讀值緩衝區與轉換紀錄字串
+// 開銷以「每次配置多花的 ns」判定 (--budget)：配置密集的迴圈相對變慢 90% 是正常的
+// (glibc 的 malloc 本身只要十幾 ns)，用百分比門檻只會永遠失敗或永遠通過。
+// --controller 模式以 100 ms 週期長時間執行控制迴圈，並刻意每 10 個 tick 洩漏一筆
+// 區域快取，用來驗證 kill -USR2 的報表能找出洩漏的呼叫點。
+//
+// 用法: alloc_tracker_bench [bench_harness 參數]
+//       alloc_tracker_bench --budget 未追蹤.json 追蹤.json 每次配置的 ns 上限
+//       alloc_tracker_bench --controller SECONDS
+// 建議透過 bench/Makefile：make alloc-tracker-overhead (每次配置的開銷超過 ALLOC_BUDGET_NS 時失敗)
+
+#define _GNU_SOURCE
+#define RT_CONTROL_LOOP_NO_MAIN
+#include "../event-loop/rt_control_loop.c"
+
+#include "../bench/bench_harness.h"
+
+#define LOG_RING_SIZE               64U
+#define CONTROLLER_PERIOD_NS        100000000ULL    // 100 ms
+#define LEAK_EVERY_TICKS            10U
+#define CHURN_THREADS               300U            // 超過追蹤器的 256 張執行緒表
+
+// === advanced_pointers.c 的配置模式 ===
+typedef struct {
+    int id;
+    char name[50];
+} Person;
+
+#define POINTERS_ALLOCS_PER_OP      4U              // malloc + calloc + realloc + malloc
+
+static void bench_pointers_pattern(void *arg, uint64_t iters) {
+    (void)arg;
+
+    for (uint64_t i = 0U; i < iters; i++) {
+        int *single_int = (int *)malloc(sizeof(int));
+        int *array = (int *)calloc(5U, sizeof(int));
+        int *grown = (int *)realloc(array, 10U * sizeof(int));
+        Person *person = (Person *)malloc(sizeof(Person));
+
+        // 編譯器可以刪除未使用的 malloc/free 配對，指標必須逸出
+        BENCH_KEEP(single_int);
+        BENCH_KEEP(grown);
+        BENCH_KEEP(person);
+        if (person != NULL) {
+            person->id = (int)i;
+            strncpy(person->name, "OpenBMC Developer", sizeof(person->name) - 1U);
+            person->name[sizeof(person->name) - 1U] = '\0';
+        }
+        free(person);
+        free((grown != NULL) ? grown : array);
+        free(single_int);
+    }
+}
+
+// === 執行緒汰換：短命執行緒結束後，新執行緒仍要拿到追蹤器的執行緒表 ===
+typedef struct {
+    uint64_t iters;
+} ChurnJob;
+
+static void *churn_thread(void *arg) {
+    ChurnJob *job = (ChurnJob *)arg;
+    bench_pointers_pattern(NULL, job->iters);
+    return NULL;
+}
+
+static bool run_in_new_thread(uint64_t iters) {
+    pthread_t thread;
+    ChurnJob job = { .iters = iters };
+    bool ok = pthread_create(&thread, NULL, churn_thread, &job) == 0;
+
+    if (ok) {
+        (void)pthread_join(thread, NULL);
+    }
+    return ok;
+}
+
+static void churn_threads(void) {
+    for (uint32_t i = 0U; i < CHURN_THREADS; i++) {
+        (void)run_in_new_thread(1U);
+    }
+}
+
+// 每個樣本都在新執行緒中執行；建立執行緒的成本在有/沒有追蹤器時相同，比較時互相抵銷
+static void bench_new_thread_pattern(void *arg, uint64_t iters) {
+    (void)arg;
+    (void)run_in_new_thread(iters);
+}
+
+// === 開銷判定：每個案例 (新 - 基準) / 每 op 的配置次數 ===
+typedef struct {
+    const char *name;
+    uint32_t allocs_per_op;         // 0 表示只列出：每 tick 一兩次配置，tick 本身的雜訊就超過上限
+} AllocBudgetCase;
+
+static const AllocBudgetCase budget_cases[] = {
+    { "pointers/pattern", POINTERS_ALLOCS_PER_OP },
+    { "pointers/new_thread", POINTERS_ALLOCS_PER_OP },
+    { "controller/tick", 0U }
+};
+
+static int run_budget(const char *base_path, const char *new_path, double budget_ns) {
+    static BenchResult base[BENCH_MAX_CASES];
+    static BenchResult next[BENCH_MAX_CASES];
+    uint32_t base_count = bench_load_json(base_path, base, BENCH_MAX_CASES);
+    uint32_t next_count = bench_load_json(new_path, next, BENCH_MAX_CASES);
+    uint32_t checked = 0U;
+    uint32_t failures = 0U;
+
+    printf("%-24s %12s %12s %9s %14s  %s\n", "案例", "未追蹤 ns/op", "追蹤 ns/op", "變化",
+           "每次配置 +ns", "判定");
+    for (uint32_t c = 0U; c < (uint32_t)(sizeof(budget_cases) / sizeof(budget_cases[0])); c++) {
+        const BenchResult *b = NULL;
+        const BenchResult *n = NULL;
+        for (uint32_t i = 0U; i < base_count; i++) {
+            b = (strcmp(base[i].name, budget_cases[c].name) == 0) ? &base[i] : b;
+        }
+        for (uint32_t i = 0U; i < next_count; i++) {
+            n = (strcmp(next[i].name, budget_cases[c].name) == 0) ? &next[i] : n;
+        }
+        if ((b == NULL) || (n == NULL) || (b->median_ns <= 0.0)) {
+            continue;
+        }
+        double change = 100.0 * ((n->median_ns - b->median_ns) / b->median_ns);
+        if (budget_cases[c].allocs_per_op == 0U) {
+            printf("%-24s %12.2f %12.2f %+8.1f%% %14s  參考\n", budget_cases[c].name, b->median_ns,
+                   n->median_ns, change, "-");
+            continue;
+        }
+        double per_alloc = (n->median_ns - b->median_ns) / (double)budget_cases[c].allocs_per_op;
+        bool over = per_alloc > budget_ns;
+        printf("%-24s %12.2f %12.2f %+8.1f%% %14.2f  %s\n", budget_cases[c].name, b->median_ns,
+               n->median_ns, change, per_alloc, over ? "超過!" : "通過");
+        failures += over ? 1U : 0U;
+        checked++;
+    }
+    printf("\n每次配置的開銷上限 %.1f ns，檢查 %u 個案例，超過 %u 個\n", budget_ns, checked, failures);
+
+    // 沒有任何案例可比較 (檔案讀不到或名稱不符) 不能當成通過
+    return ((checked > 0U) && (failures == 0U)) ? 0 : 1;
+}
+
+// === 控制迴圈：風扇 tick + 典型 daemon 的暫存配置 ===
+typedef struct {
+    FanLoopWork fan;
+    char *log_ring[LOG_RING_SIZE];  // 最近的轉換紀錄，滿了就釋放最舊的一筆
+    uint32_t log_next;
+    uint64_t tick;
+    bool leak;
+} ControllerWork;
+
+typedef struct {
+    uint32_t zone;
+    TempMilliC temperature;
+    uint64_t tick;
+} ZoneCacheEntry;
+
+static void controller_init(ControllerWork *work, bool leak) {
+    memset(work, 0, sizeof(*work));
+    fan_loop_init(&work->fan);
+    work->leak = leak;
+}
+
+static void controller_cleanup(ControllerWork *work) {
+    for (uint32_t i = 0U; i < LOG_RING_SIZE; i++) {
+        free(work->log_ring[i]);
+        work->log_ring[i] = NULL;
+    }
+}
+
+// 刻意的洩漏：快取項目配置後從未釋放 (模擬忘記 free 的錯誤)
+static void __attribute__((noinline)) leaky_zone_cache(const ControllerWork *work, uint32_t zone) {
+    ZoneCacheEntry *entry = (ZoneCacheEntry *)malloc(sizeof(ZoneCacheEntry));
+
+    if (entry != NULL) {
+        entry->zone = zone;
+        entry->temperature = work->fan.zones[zone].current_temperature;
+        entry->tick = work->tick;
+        BENCH_KEEP(entry);
+    }
+}
+
+static void controller_tick(void *ctx, uint64_t tick) {
+    ControllerWork *work = (ControllerWork *)ctx;
+    uint64_t before = work->fan.transitions;
+    TempMilliC *readings = (TempMilliC *)malloc(RT_LOOP_ZONES * sizeof(TempMilliC));
+
+    fan_loop_tick(&work->fan, tick);
+    if (readings != NULL) {
+        TempMilliC hottest = TEMP_MC_FROM_C(0);
+        for (uint32_t i = 0U; i < RT_LOOP_ZONES; i++) {
+            readings[i] = work->fan.zones[i].current_temperature;
+            if (readings[i] > hottest) {
+                hottest = readings[i];
+            }
+        }
+        if (work->fan.transitions != before) {
+            char *line = NULL;
+            if (asprintf(&line, "tick %lu: %lu 次轉換, 最高 " TEMP_MC_FMT " C",
+                         (unsigned long)work->tick, (unsigned long)(work->fan.transitions - before),
+                         TEMP_MC_ARGS(hottest)) >= 0) {
+                free(work->log_ring[work->log_next]);
+                work->log_ring[work->log_next] = line;
+                work->log_next = (work->log_next + 1U) % LOG_RING_SIZE;
+            }
+        }
+        free(readings);
+    }
+    if (work->leak && ((work->tick % LEAK_EVERY_TICKS) == 0U)) {
+        leaky_zone_cache(work, (uint32_t)(work->tick / LEAK_EVERY_TICKS) % RT_LOOP_ZONES);
+    }
+    work->tick++;
+}
+
+static void bench_controller_tick(void *arg, uint64_t iters) {
+    for (uint64_t i = 0U; i < iters; i++) {
+        controller_tick(arg, i);
+    }
+}
+
+static int run_controller(uint32_t seconds) {
+    static ControllerWork work;
+    static RtLoopStats stats;
+    RtLoopConfig cfg = {
+        .period_ns = CONTROLLER_PERIOD_NS,
+        .sleep_mode = RT_SLEEP_ABSOLUTE,
+        .cpu = -1,
+        .fifo_priority = 0,
+        .lock_memory = false
+    };
+    uint64_t ticks = ((uint64_t)seconds * 1000000000ULL) / CONTROLLER_PERIOD_NS;
+
+    controller_init(&work, true);
+    printf("控制迴圈 pid %d: %lu 個 tick (週期 %lu ms, %u 區，每 %u tick 洩漏一筆 %zu bytes)\n",
+           (int)getpid(), (unsigned long)ticks, (unsigned long)(CONTROLLER_PERIOD_NS / 1000000ULL),
+           RT_LOOP_ZONES, LEAK_EVERY_TICKS, sizeof(ZoneCacheEntry));
+    printf("以 LD_PRELOAD 執行時可用 kill -USR2 %d 取得即時報表\n", (int)getpid());
+    fflush(stdout);
+    rt_loop_run(&cfg, ticks, controller_tick, &work, &stats);
+    controller_cleanup(&work);
+    rt_loop_report("控制迴圈", &cfg, &stats);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    static ControllerWork controller;
+    int result;
+
+    if ((argc >= 3) && (strcmp(argv[1], "--controller") == 0)) {
+        result = run_controller((uint32_t)strtoul(argv[2], NULL, 10));
+    } else if ((argc >= 5) && (strcmp(argv[1], "--budget") == 0)) {
+        result = run_budget(argv[2], argv[3], strtod(argv[4], NULL));
+    } else {
+        const BenchCase cases[] = {
+            { "pointers/pattern", "pointers", bench_pointers_pattern, NULL },
+            { "pointers/new_thread", "pointers", bench_new_thread_pattern, NULL },
+            { "controller/tick", "event-loop", bench_controller_tick, &controller }
+        };
+        const char *preload = getenv("LD_PRELOAD");
+
+        controller_init(&controller, false);
+        churn_threads();
+        printf("=== 配置追蹤器開銷量測 (LD_PRELOAD=%s) ===\n",
+               ((preload != NULL) && (*preload != '\0')) ? preload : "無");
+        result = bench_main(argc, argv, cases, (uint32_t)(sizeof(cases) / sizeof(cases[0])));
+        controller_cleanup(&controller);
+    }
+
+    return result;
+}
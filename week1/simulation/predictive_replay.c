@@ -0,0 +1,212 @@
+// predictive_replay.c - 以重播比較「目前值」與「變化率預測」兩種溫度事件
+// 先錄下一段機群負載軌跡 (每個區域不定時出現負載尖峰) 與感測器雜訊，
+// 再把同一段軌跡分別重播給兩種控制器，熱模型與狀態機都沿用 thermal_sim.c：
+//   - 目前值：get_temperature_event(讀值)
+//   - 預測：  slope_predictor_update() + predictive_temperature_event()
+// 比較每個區域的峰值溫度、超過危急/極限閾值的累計時間與平均風扇轉速。
+//
+// 用法: predictive_replay [區域數] [秒數] [預測秒數]
+
+#define THERMAL_SIM_NO_MAIN
+#include "thermal_sim.c"
+#define SLOPE_PREDICTOR_NO_MAIN
+#include "../state-machine/slope_predictor.c"
+
+#define REPLAY_DEFAULT_ZONES        2000U
+#define REPLAY_DEFAULT_SECONDS      1800U
+#define REPLAY_DEFAULT_HORIZON      30U
+#define REPLAY_DECAY_SHIFT          4U      // 有效窗口約 16 秒
+#define REPLAY_BASE_LOAD            0.7f
+#define REPLAY_NOISE_MC             300     // 感測器雜訊 ±0.3°C
+
+// === 錄製的軌跡 ===
+typedef struct {
+    uint32_t zones;
+    uint32_t seconds;
+    uint16_t *load_permille;        // [秒][區域]，負載倍率 x1000
+    int16_t *noise_mc;              // [秒][區域]，讀值雜訊
+} ReplayTrace;
+
+static bool trace_record(ReplayTrace *trace, uint32_t zones, uint32_t seconds) {
+    size_t cells = (size_t)zones * seconds;
+    uint32_t rng = 0x5A17E5EDU;
+
+    trace->zones = zones;
+    trace->seconds = seconds;
+    trace->load_permille = malloc(cells * sizeof(uint16_t));
+    trace->noise_mc = malloc(cells * sizeof(int16_t));
+    if ((trace->load_permille == NULL) || (trace->noise_mc == NULL)) {
+        free(trace->load_permille);
+        free(trace->noise_mc);
+        return false;
+    }
+
+    // 每個區域：平時 0.7x，每隔 200-600 秒出現一次 60-180 秒、1.8-2.8x 的尖峰
+    for (uint32_t z = 0U; z < zones; z++) {
+        uint32_t next_spike = 60U + (uint32_t)(sim_rand01(&rng) * 400.0f);
+        uint32_t spike_end = 0U;
+        float spike_load = REPLAY_BASE_LOAD;
+
+        for (uint32_t s = 0U; s < seconds; s++) {
+            if (s == next_spike) {
+                spike_end = s + 60U + (uint32_t)(sim_rand01(&rng) * 120.0f);
+                spike_load = 1.8f + sim_rand01(&rng);
+                next_spike = spike_end + 200U + (uint32_t)(sim_rand01(&rng) * 400.0f);
+            }
+            float load = (s < spike_end) ? spike_load : REPLAY_BASE_LOAD;
+            size_t cell = ((size_t)s * zones) + z;
+            trace->load_permille[cell] = (uint16_t)(load * 1000.0f);
+            trace->noise_mc[cell] = (int16_t)(sim_rand01(&rng) * (2.0f * REPLAY_NOISE_MC)) -
+                                    (int16_t)REPLAY_NOISE_MC;
+        }
+    }
+
+    return true;
+}
+
+static void trace_free(ReplayTrace *trace) {
+    free(trace->load_permille);
+    free(trace->noise_mc);
+    memset(trace, 0, sizeof(*trace));
+}
+
+// === 重播 ===
+typedef struct {
+    float peak_max;                 // 整個機群的最高溫度
+    double peak_mean;               // 各區域峰值的平均
+    uint64_t critical_zone_s;       // 溫度 >= MAX_TEMPERATURE_CRITICAL_C 的區域秒數
+    uint64_t extreme_zone_s;        // 溫度 >= MAX_TEMPERATURE_SHUTDOWN_C 的區域秒數
+    double fan_mean;                // 平均風扇轉速 (%)
+    uint64_t transitions;
+    uint64_t early_events;
+} ReplayResult;
+
+static bool replay_run(const ReplayTrace *trace, bool predictive, uint16_t horizon,
+                       ReplayResult *result) {
+    ThermalSim sim;
+    uint32_t zones = trace->zones;
+    uint64_t fan_sum = 0U;
+
+    memset(result, 0, sizeof(*result));
+    if (!sim_init(&sim, zones, 0.0f)) {
+        return false;
+    }
+    SlopePredictor *predictors = calloc(zones, sizeof(SlopePredictor));
+    float *peak = calloc(zones, sizeof(float));
+    if ((predictors == NULL) || (peak == NULL)) {
+        free(predictors);
+        free(peak);
+        sim_free(&sim);
+        return false;
+    }
+    for (uint32_t z = 0U; z < zones; z++) {
+        (void)slope_predictor_init(&predictors[z], REPLAY_DECAY_SHIFT, horizon);
+    }
+
+    for (uint32_t s = 0U; s < trace->seconds; s++) {
+        const uint16_t *load = &trace->load_permille[(size_t)s * zones];
+        const int16_t *noise = &trace->noise_mc[(size_t)s * zones];
+
+        for (uint32_t z = 0U; z < zones; z++) {
+            StateMachine *sm = &sim.zones[z];
+            sim_physics_step(&sim, z, z + 1U, (float)load[z] / 1000.0f);
+
+            TempMilliC reading = temp_mc_add_sat(temp_mc_from_float(sim.temp_c[z]), noise[z]);
+            SystemEvent event;
+            sm->current_temperature = reading;
+            if (predictive) {
+                slope_predictor_update(&predictors[z], reading);
+                event = predictive_temperature_event(&predictors[z], reading);
+            } else {
+                event = get_temperature_event(reading);
+            }
+            sm_process_event(sm, event);
+            sim.fan_frac[z] = (float)sm->current_fan_speed / 100.0f;
+
+            float temp = sim.temp_c[z];
+            if (temp > peak[z]) {
+                peak[z] = temp;
+            }
+            if (temp >= (float)MAX_TEMPERATURE_CRITICAL_C) {
+                result->critical_zone_s++;
+            }
+            if (temp >= (float)MAX_TEMPERATURE_SHUTDOWN_C) {
+                result->extreme_zone_s++;
+            }
+            fan_sum += sm->current_fan_speed;
+        }
+    }
+
+    for (uint32_t z = 0U; z < zones; z++) {
+        if (peak[z] > result->peak_max) {
+            result->peak_max = peak[z];
+        }
+        result->peak_mean += peak[z];
+        result->transitions += sim.zones[z].state_transitions;
+        result->early_events += predictors[z].early_events;
+    }
+    result->peak_mean /= zones;
+    result->fan_mean = (double)fan_sum / ((double)zones * trace->seconds);
+
+    free(predictors);
+    free(peak);
+    sim_free(&sim);
+    return true;
+}
+
+static void replay_print(const char *label, const ReplayResult *r) {
+    printf("%-8s 最高 %6.2f°C  峰值平均 %6.2f°C  >=%u°C %8lu 區域秒  >=%u°C %7lu 區域秒  "
+           "風扇 %5.1f%%  轉換 %7lu  提前事件 %7lu\n",
+           label, r->peak_max, r->peak_mean,
+           MAX_TEMPERATURE_CRITICAL_C, (unsigned long)r->critical_zone_s,
+           MAX_TEMPERATURE_SHUTDOWN_C, (unsigned long)r->extreme_zone_s,
+           r->fan_mean, (unsigned long)r->transitions, (unsigned long)r->early_events);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t zones = REPLAY_DEFAULT_ZONES;
+    uint32_t seconds = REPLAY_DEFAULT_SECONDS;
+    uint32_t horizon = REPLAY_DEFAULT_HORIZON;
+    ReplayTrace trace;
+    ReplayResult reactive;
+    ReplayResult predictive;
+
+    if (argc > 1) {
+        zones = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        seconds = (uint32_t)strtoul(argv[2], NULL, 10);
+    }
+    if (argc > 3) {
+        horizon = (uint32_t)strtoul(argv[3], NULL, 10);
+    }
+    if ((zones == 0U) || (seconds == 0U) || (horizon > UINT16_MAX)) {
+        printf("參數錯誤\n");
+        return 1;
+    }
+
+    if (!trace_record(&trace, zones, seconds)) {
+        printf("記憶體配置失敗\n");
+        return 1;
+    }
+
+    printf("=== 負載尖峰重播：目前值 vs 變化率預測 (%u 區域 x %u 秒，預測 %u 秒後) ===\n",
+           zones, seconds, horizon);
+    if (!replay_run(&trace, false, (uint16_t)horizon, &reactive) ||
+        !replay_run(&trace, true, (uint16_t)horizon, &predictive)) {
+        printf("記憶體配置失敗\n");
+        trace_free(&trace);
+        return 1;
+    }
+    replay_print("目前值", &reactive);
+    replay_print("預測", &predictive);
+
+    printf("\n峰值平均降低 %.2f°C，最高溫度降低 %.2f°C，危急時間減少 %.1f%%，風扇平均多 %.1f 個百分點\n",
+           reactive.peak_mean - predictive.peak_mean, reactive.peak_max - predictive.peak_max,
+           (reactive.critical_zone_s > 0U) ?
+               (100.0 * (1.0 - ((double)predictive.critical_zone_s / (double)reactive.critical_zone_s))) : 0.0,
+           predictive.fan_mean - reactive.fan_mean);
+
+    trace_free(&trace);
+    return 0;
+}
@@ -0,0 +1,330 @@
+// thermal_sim.c - 機群規模的熱模型模擬器 (一階 RC 模型)
+// simulate_temperature_change() 只是加上手動指定的變化量；這裡改用物理模型：
+//   C * dT/dt = P_work - (T - T_ambient) * (G_base + G_fan * fan%)
+// 每個區域有自己的熱容 C、散熱係數與工作負載功率，風扇速度來自該區域的
+// 風扇控制狀態機，溫度再回饋給狀態機，形成閉迴路。
+//
+// 資料以欄位 (SoA) 排列，物理步驟是可向量化的 float 迴圈；
+// 區域彼此獨立，因此每個執行緒負責一段區域，整段時間都不需要同步。
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <unistd.h>
+
+#define SM_QUIET
+#define FAN_CONTROL_NO_MAIN
+#include "../state-machine/fan_control_state_machine.c"
+
+#define SIM_DEFAULT_ZONES       100000U
+#define SIM_DEFAULT_TICKS       600U        // 每個 tick 代表 1 秒
+#define SIM_DT_S                1.0f
+#define SIM_MAX_THREADS         64U
+#define SIM_ALIGN               64U
+
+// === 模擬資料 (欄位式排列) ===
+typedef struct {
+    uint32_t zone_count;
+    float ambient_offset_c;         // what-if：整體環境溫度偏移
+
+    float *temp_c;                  // 目前溫度
+    float *ambient_c;               // 進風溫度
+    float *inv_capacity;            // 1 / C (K/J)
+    float *g_base;                  // 風扇停止時的散熱係數 (W/K)
+    float *g_fan;                   // 風扇 100% 時額外的散熱係數 (W/K)
+    float *power_w;                 // 工作負載基準功率 (W)
+    float *fan_frac;                // 風扇速度 0.0-1.0 (來自狀態機)
+
+    StateMachine *zones;
+} ThermalSim;
+
+static void *sim_alloc(size_t bytes) {
+    size_t rounded = ((bytes + SIM_ALIGN - 1U) / SIM_ALIGN) * SIM_ALIGN;
+    return aligned_alloc(SIM_ALIGN, rounded);
+}
+
+static void sim_free(ThermalSim *sim) {
+    free(sim->temp_c);
+    free(sim->ambient_c);
+    free(sim->inv_capacity);
+    free(sim->g_base);
+    free(sim->g_fan);
+    free(sim->power_w);
+    free(sim->fan_frac);
+    free(sim->zones);
+    memset(sim, 0, sizeof(*sim));
+}
+
+static inline float sim_rand01(uint32_t *rng) {
+    *rng ^= *rng << 13;
+    *rng ^= *rng >> 17;
+    *rng ^= *rng << 5;
+    return (float)(*rng >> 8) / 16777216.0f;
+}
+
+// 產生隨機但可重現的機群：每個區域的硬體參數與負載都不同
+static bool sim_init(ThermalSim *sim, uint32_t zone_count, float ambient_offset_c) {
+    memset(sim, 0, sizeof(*sim));
+    sim->zone_count = zone_count;
+    sim->ambient_offset_c = ambient_offset_c;
+
+    size_t col = (size_t)zone_count * sizeof(float);
+    sim->temp_c = sim_alloc(col);
+    sim->ambient_c = sim_alloc(col);
+    sim->inv_capacity = sim_alloc(col);
+    sim->g_base = sim_alloc(col);
+    sim->g_fan = sim_alloc(col);
+    sim->power_w = sim_alloc(col);
+    sim->fan_frac = sim_alloc(col);
+    sim->zones = sim_alloc((size_t)zone_count * sizeof(StateMachine));
+
+    if ((sim->temp_c == NULL) || (sim->ambient_c == NULL) || (sim->inv_capacity == NULL) ||
+        (sim->g_base == NULL) || (sim->g_fan == NULL) || (sim->power_w == NULL) ||
+        (sim->fan_frac == NULL) || (sim->zones == NULL)) {
+        sim_free(sim);
+        return false;
+    }
+
+    uint32_t rng = 0x7E3A1C05U;
+    for (uint32_t i = 0U; i < zone_count; i++) {
+        sim->ambient_c[i] = 22.0f + (6.0f * sim_rand01(&rng)) + ambient_offset_c;
+        sim->temp_c[i] = sim->ambient_c[i];
+        sim->inv_capacity[i] = 1.0f / (200.0f + (400.0f * sim_rand01(&rng)));
+        sim->g_base[i] = 0.4f + (0.3f * sim_rand01(&rng));
+        sim->g_fan[i] = 8.0f + (8.0f * sim_rand01(&rng));
+        sim->power_w[i] = 60.0f + (140.0f * sim_rand01(&rng));
+
+        sm_init(&sim->zones[i]);
+        sim->zones[i].current_temperature = temp_mc_from_float(sim->temp_c[i]);
+        sm_process_event(&sim->zones[i], EVENT_SYSTEM_INIT);
+        sim->fan_frac[i] = (float)sim->zones[i].current_fan_speed / 100.0f;
+    }
+
+    return true;
+}
+
+// 整個機群共用的負載曲線：每 5 分鐘一個週期，在 0.6x 與 1.5x 之間變化
+static inline float sim_load_factor(uint32_t tick) {
+    uint32_t phase = tick % 300U;
+    float ramp = (phase < 150U) ? ((float)phase / 150.0f) : ((float)(300U - phase) / 150.0f);
+    return 0.6f + (0.9f * ramp);
+}
+
+// === 物理步驟 (可向量化) ===
+static void sim_physics_step(ThermalSim *sim, uint32_t begin, uint32_t end, float load) {
+    float *restrict temp = sim->temp_c;
+    const float *restrict ambient = sim->ambient_c;
+    const float *restrict inv_c = sim->inv_capacity;
+    const float *restrict g_base = sim->g_base;
+    const float *restrict g_fan = sim->g_fan;
+    const float *restrict power = sim->power_w;
+    const float *restrict fan = sim->fan_frac;
+
+    for (uint32_t i = begin; i < end; i++) {
+        float g = g_base[i] + (g_fan[i] * fan[i]);
+        float heat = (power[i] * load) - ((temp[i] - ambient[i]) * g);
+        temp[i] += heat * inv_c[i] * SIM_DT_S;
+    }
+}
+
+// === 控制步驟：溫度送進狀態機，風扇決策寫回欄位 ===
+static inline void sim_control_step(ThermalSim *sim, uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+        StateMachine *sm = &sim->zones[i];
+
+        // 物理模型用 float，進入控制路徑前換成毫度定點
+        sm->current_temperature = temp_mc_from_float(sim->temp_c[i]);
+        sm_process_event(sm, get_temperature_event(sm->current_temperature));
+        sim->fan_frac[i] = (float)sm->current_fan_speed / 100.0f;
+        // 關機中的區域沒有工作負載，只剩散熱
+        if (sm->current_state == STATE_SHUTDOWN) {
+            sim->power_w[i] = 0.0f;
+        }
+    }
+}
+
+// 以下的平行執行與報告只有本程式的 main() 使用
+#ifndef THERMAL_SIM_NO_MAIN
+
+// === 多執行緒執行 ===
+typedef struct {
+    ThermalSim *sim;
+    uint32_t begin;
+    uint32_t end;
+    uint32_t ticks;
+    uint32_t first_tick;
+    uint64_t physics_ns;
+    uint64_t control_ns;
+} SimWorker;
+
+static void *sim_worker(void *arg) {
+    SimWorker *w = (SimWorker *)arg;
+
+    for (uint32_t t = 0U; t < w->ticks; t++) {
+        uint64_t t0 = sm_stats_now_ns();
+        sim_physics_step(w->sim, w->begin, w->end, sim_load_factor(w->first_tick + t));
+        uint64_t t1 = sm_stats_now_ns();
+        sim_control_step(w->sim, w->begin, w->end);
+        uint64_t t2 = sm_stats_now_ns();
+        w->physics_ns += t1 - t0;
+        w->control_ns += t2 - t1;
+    }
+
+    return NULL;
+}
+
+typedef struct {
+    double zone_ticks_per_sec;
+    double physics_ns_per_zone;
+    double control_ns_per_zone;
+} SimRunStats;
+
+static SimRunStats sim_run(ThermalSim *sim, uint32_t threads, uint32_t first_tick, uint32_t ticks) {
+    SimWorker workers[SIM_MAX_THREADS];
+    pthread_t tids[SIM_MAX_THREADS];
+    SimRunStats stats = { 0 };
+    uint32_t per = (sim->zone_count + threads - 1U) / threads;
+
+    // 每段切在 16 個區域 (一條快取線的 float) 的邊界，避免相鄰執行緒寫同一條快取線
+    per = (per + 15U) & ~15U;
+
+    uint64_t start = sm_stats_now_ns();
+    uint32_t started = 0U;
+    for (uint32_t k = 0U; k < threads; k++) {
+        uint32_t begin = k * per;
+        if (begin >= sim->zone_count) {
+            break;
+        }
+        workers[k] = (SimWorker){
+            .sim = sim,
+            .begin = begin,
+            .end = ((begin + per) < sim->zone_count) ? (begin + per) : sim->zone_count,
+            .ticks = ticks,
+            .first_tick = first_tick
+        };
+        if (pthread_create(&tids[k], NULL, sim_worker, &workers[k]) != 0) {
+            // 建立失敗時由目前執行緒自己跑這一段
+            sim_worker(&workers[k]);
+            tids[k] = pthread_self();
+        }
+        started++;
+    }
+    for (uint32_t k = 0U; k < started; k++) {
+        if (!pthread_equal(tids[k], pthread_self())) {
+            pthread_join(tids[k], NULL);
+        }
+    }
+    uint64_t elapsed = sm_stats_now_ns() - start;
+
+    uint64_t physics = 0U;
+    uint64_t control = 0U;
+    for (uint32_t k = 0U; k < started; k++) {
+        physics += workers[k].physics_ns;
+        control += workers[k].control_ns;
+    }
+    double zone_ticks = (double)sim->zone_count * ticks;
+    stats.zone_ticks_per_sec = zone_ticks / ((double)elapsed / 1e9);
+    stats.physics_ns_per_zone = (double)physics / zone_ticks;
+    stats.control_ns_per_zone = (double)control / zone_ticks;
+
+    return stats;
+}
+
+// === 機群摘要 ===
+static void sim_report(const ThermalSim *sim) {
+    uint32_t per_state[STATE_COUNT] = { 0 };
+    double sum = 0.0;
+    float hottest = 0.0f;
+    uint64_t transitions = 0U;
+
+    for (uint32_t i = 0U; i < sim->zone_count; i++) {
+        per_state[sim->zones[i].current_state]++;
+        transitions += sim->zones[i].state_transitions;
+        sum += sim->temp_c[i];
+        if (sim->temp_c[i] > hottest) {
+            hottest = sim->temp_c[i];
+        }
+    }
+
+    printf("  平均溫度 %.1f°C, 最高 %.1f°C, 累計狀態轉換 %lu\n",
+           sum / sim->zone_count, hottest, (unsigned long)transitions);
+    for (uint32_t s = 0U; s < STATE_COUNT; s++) {
+        if (per_state[s] > 0U) {
+            printf("  %-18s %7u 區域 (%5.1f%%)\n", state_configs[s].name, per_state[s],
+                   (100.0 * per_state[s]) / sim->zone_count);
+        }
+    }
+}
+
+// 主程式
+// 用法: thermal_sim [區域數] [tick 數] [環境溫度偏移°C] [執行緒上限]
+//   例: thermal_sim 100000 600 8   模擬機房進風溫度上升 8°C 的情境
+//   執行緒上限預設為線上 CPU 數
+int main(int argc, char *argv[]) {
+    uint32_t zone_count = SIM_DEFAULT_ZONES;
+    uint32_t ticks = SIM_DEFAULT_TICKS;
+    float ambient_offset = 0.0f;
+
+    if (argc > 1) {
+        zone_count = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        ticks = (uint32_t)strtoul(argv[2], NULL, 10);
+    }
+    if (argc > 3) {
+        ambient_offset = strtof(argv[3], NULL);
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t max_threads = (cpus > 0) ? (uint32_t)cpus : 1U;
+    if (argc > 4) {
+        max_threads = (uint32_t)strtoul(argv[4], NULL, 10);
+    }
+    if (max_threads > SIM_MAX_THREADS) {
+        max_threads = SIM_MAX_THREADS;
+    }
+    if ((zone_count == 0U) || (ticks == 0U) || (max_threads == 0U)) {
+        printf("用法: %s [區域數] [tick 數] [環境溫度偏移°C] [執行緒上限]\n", argv[0]);
+        return 1;
+    }
+
+    printf("=== 機群熱模擬 (一階 RC 模型 + 風扇狀態機閉迴路) ===\n");
+    printf("區域數 %u, 每輪 %u tick (1 tick = %.0f 秒), 環境溫度偏移 %+.1f°C, 執行緒上限 %u\n",
+           zone_count, ticks, (double)SIM_DT_S, (double)ambient_offset, max_threads);
+
+    printf("\n=== 核心數擴展性 (每次從相同初始狀態開始) ===\n");
+    printf("執行緒   zone-ticks/sec   物理 ns/zone   控制 ns/zone   加速比\n");
+    double base_rate = 0.0;
+    for (uint32_t threads = 1U; ; ) {
+        ThermalSim sim;
+        if (!sim_init(&sim, zone_count, ambient_offset)) {
+            printf("記憶體配置失敗\n");
+            return 1;
+        }
+        SimRunStats st = sim_run(&sim, threads, 0U, ticks);
+        if (threads == 1U) {
+            base_rate = st.zone_ticks_per_sec;
+        }
+        printf("%6u   %14.0f   %12.2f   %12.2f   %6.2fx\n", threads, st.zone_ticks_per_sec,
+               st.physics_ns_per_zone, st.control_ns_per_zone, st.zone_ticks_per_sec / base_rate);
+        sim_free(&sim);
+        if (threads == max_threads) {
+            break;
+        }
+        // 1, 2, 4, ... 最後一次用滿全部核心
+        threads = ((threads * 2U) < max_threads) ? (threads * 2U) : max_threads;
+    }
+
+    printf("\n=== 模擬結果 (%u 執行緒, %u 秒) ===\n", max_threads, ticks);
+    ThermalSim sim;
+    if (!sim_init(&sim, zone_count, ambient_offset)) {
+        printf("記憶體配置失敗\n");
+        return 1;
+    }
+    (void)sim_run(&sim, max_threads, 0U, ticks);
+    sim_report(&sim);
+    sim_free(&sim);
+
+    return 0;
+}
+
+#endif  // THERMAL_SIM_NO_MAIN
@@ -1,6 +1,15 @@
 // fan_control_state_machine.c - 基於回調的 BMC 風扇控制狀態機
 // 這是一個完整的狀態機實作，模擬 OpenBMC 中的風扇控制邏輯
 
+// 其他程式會 #include 本檔；同一個程式經由兩條路徑引入時只展開一次
+#ifndef FAN_CONTROL_STATE_MACHINE_C
+#define FAN_CONTROL_STATE_MACHINE_C
+
+// clock_gettime() 在 -std=c99 下需要 POSIX 功能巨集
+#if !defined(_GNU_SOURCE) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -8,21 +17,23 @@
 #include <stdlib.h>
 #include <time.h>
 
-// === 常數定義 (遵循 MISRA-C) ===
-#define MAX_TEMPERATURE_NORMAL_C    50U
-#define MAX_TEMPERATURE_WARNING_C   70U
-#define MAX_TEMPERATURE_CRITICAL_C  85U
-#define MAX_TEMPERATURE_SHUTDOWN_C  95U
-
-#define FAN_SPEED_OFF_PERCENT       0U
-#define FAN_SPEED_LOW_PERCENT       30U
-#define FAN_SPEED_MEDIUM_PERCENT    60U
-#define FAN_SPEED_HIGH_PERCENT      85U
-#define FAN_SPEED_MAX_PERCENT       100U
+#include "sm_engine.h"
+#include "../common/fixed_point_temp.h"
+#include "../common/thermal_policy.h"
 
+// === 常數定義 (遵循 MISRA-C) ===
+// 溫度閾值與各狀態風扇轉速來自執行期政策 thermal_policy_get()，可熱重載；
+// MAX_TEMPERATURE_*_C、FAN_SPEED_*_PERCENT 為其編譯期預設值 (見 thermal_policy.h)
 #define MAX_EVENT_NAME_LENGTH       50
 #define TEMPERATURE_CHECK_INTERVAL  1000  // 毫秒
 
+// 定義 SM_QUIET 可關閉狀態機內部的輸出 (效能測試、大量區域時使用)
+#ifdef SM_QUIET
+#define SM_PRINTF(...)              do { if (0) { printf(__VA_ARGS__); } } while (0)
+#else
+#define SM_PRINTF(...)              printf(__VA_ARGS__)
+#endif
+
 // === 狀態定義 ===
 typedef enum {
     STATE_IDLE,
@@ -54,18 +65,125 @@ typedef struct StateMachine StateMachine;
 typedef void (*StateCallback)(StateMachine *sm);
 
 // 事件處理回調
+// 回傳 STATE_UNHANDLED 表示交給父狀態處理。處理器必須只依事件決定結果
+// (不讀取 sm)，因為轉換表在初始化時就以 sm = NULL 預先展開。
 typedef SystemState (*EventHandler)(StateMachine *sm, SystemEvent event);
 
+// 「未處理」哨兵值：不是合法狀態，只會出現在處理器的回傳值
+#define STATE_UNHANDLED             ((SystemState)STATE_COUNT)
+
 // 動作回調
 typedef void (*ActionCallback)(StateMachine *sm, uint8_t parameter);
 
+// 轉換觀察者：離開舊狀態之後、進入新狀態之前呼叫 (例如寫入轉換日誌)。
+// event 為觸發轉換的事件；直接呼叫 sm_transition() 時為 EVENT_COUNT
+typedef void (*TransitionObserver)(void *ctx, const StateMachine *sm, SystemState from,
+                                   SystemState to, SystemEvent event);
+
 // === 狀態配置結構 ===
+// 由通用引擎 (sm_engine.h) 產生，欄位與 StateCallback/EventHandler 相容。
+// parent 指向父狀態 (可巢狀)；子狀態未處理的事件往上交給父狀態，
+// 最上層也未處理時保持目前狀態。父狀態只提供 handle_event。
+SM_ENGINE_DECLARE(fan_sm, SystemState, SystemEvent, StateMachine)
+typedef fan_sm_StateConfig StateConfig;
+
+// === 狀態統計 (可選的儀表) ===
+// 對數-線性直方圖 (HDR 風格)：每個 2 的冪次區間再切成 8 個子桶，
+// 相對誤差約 12.5%，記錄一次只需要一次 clz 與一次陣列遞增。
+#define SM_HIST_SUB_BITS            3U
+#define SM_HIST_SUB_COUNT           (1U << SM_HIST_SUB_BITS)
+#define SM_HIST_MAX_BITS            48U     // 2^48 ns ≈ 78 小時
+#define SM_HIST_BUCKETS             ((SM_HIST_MAX_BITS - SM_HIST_SUB_BITS + 1U) * SM_HIST_SUB_COUNT)
+
+typedef struct {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint32_t buckets[SM_HIST_BUCKETS];
+} SmHistogram;
+
+typedef struct {
+    uint64_t entries;
+    SmHistogram residency;          // 每次停留在此狀態的時間
+    SmHistogram enter_latency;      // on_enter 回調耗時
+    SmHistogram exit_latency;       // on_exit 回調耗時
+} SmStateStats;
+
 typedef struct {
-    const char *name;
-    StateCallback on_enter;
-    StateCallback on_exit;
-    EventHandler handle_event;
-} StateConfig;
+    uint64_t state_entry_ns;        // 目前狀態的進入時間 (CLOCK_MONOTONIC)
+    SmStateStats states[STATE_COUNT];
+} SmStats;
+
+static inline uint64_t sm_stats_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint32_t sm_hist_index(uint64_t value) {
+    uint32_t index;
+
+    if (value < SM_HIST_SUB_COUNT) {
+        index = (uint32_t)value;
+    } else {
+        uint32_t msb = 63U - (uint32_t)__builtin_clzll(value);
+        if (msb >= SM_HIST_MAX_BITS) {
+            index = SM_HIST_BUCKETS - 1U;
+        } else {
+            uint32_t group = msb - SM_HIST_SUB_BITS + 1U;
+            uint32_t sub = (uint32_t)(value >> (msb - SM_HIST_SUB_BITS)) & (SM_HIST_SUB_COUNT - 1U);
+            index = (group * SM_HIST_SUB_COUNT) + sub;
+        }
+    }
+
+    return index;
+}
+
+// 桶的下界，用於從桶索引還原近似值
+static inline uint64_t sm_hist_bucket_value(uint32_t index) {
+    uint32_t group = index / SM_HIST_SUB_COUNT;
+    uint64_t sub = index % SM_HIST_SUB_COUNT;
+    uint64_t value;
+
+    if (group == 0U) {
+        value = sub;
+    } else {
+        value = (SM_HIST_SUB_COUNT + sub) << (group - 1U);
+    }
+
+    return value;
+}
+
+static inline void sm_hist_record(SmHistogram *hist, uint64_t value_ns) {
+    hist->count++;
+    hist->total_ns += value_ns;
+    if (value_ns > hist->max_ns) {
+        hist->max_ns = value_ns;
+    }
+    hist->buckets[sm_hist_index(value_ns)]++;
+}
+
+// 回傳第 percentile 百分位的近似值 (桶下界)
+uint64_t sm_hist_percentile(const SmHistogram *hist, uint32_t percentile) {
+    uint64_t result = 0U;
+
+    if (hist->count > 0U) {
+        uint64_t target = ((hist->count * percentile) + 99U) / 100U;
+        uint64_t seen = 0U;
+        if (target == 0U) {
+            target = 1U;
+        }
+        for (uint32_t i = 0U; i < SM_HIST_BUCKETS; i++) {
+            seen += hist->buckets[i];
+            if (seen >= target) {
+                result = sm_hist_bucket_value(i);
+                break;
+            }
+        }
+    }
+
+    return result;
+}
 
 // === 狀態機結構 ===
 struct StateMachine {
@@ -73,7 +191,7 @@ struct StateMachine {
     SystemState previous_state;
     
     // 系統數據
-    uint16_t current_temperature;
+    TempMilliC current_temperature;     // 毫度 (0.001°C)
     uint8_t current_fan_speed;
     uint32_t state_entry_time;
     bool emergency_cooling_active;
@@ -85,32 +203,38 @@ struct StateMachine {
     // 統計資訊
     uint32_t state_transitions;
     uint32_t events_processed;
+    SmStats *stats;                 // NULL 表示停用儀表 (預設)
+
+    // 轉換觀察者 (可選，NULL 表示停用)
+    TransitionObserver observer;
+    void *observer_ctx;
+    SystemEvent last_event;         // 目前正在處理的事件
 };
 
 // === 動作回調實作 ===
 void action_set_fan_speed(StateMachine *sm, uint8_t speed_percent) {
     sm->current_fan_speed = speed_percent;
-    printf("[動作] 設定風扇速度: %u%%\n", speed_percent);
+    SM_PRINTF("[動作] 設定風扇速度: %u%%\n", speed_percent);
 }
 
 void action_log_message(StateMachine *sm, uint8_t severity) {
     const char *severity_str[] = {"INFO", "WARNING", "ERROR", "CRITICAL"};
-    printf("[日誌][%s] 狀態: %d, 溫度: %u°C, 風扇: %u%%\n",
+    SM_PRINTF("[日誌][%s] 狀態: %d, 溫度: " TEMP_MC_FMT "°C, 風扇: %u%%\n",
            severity_str[severity % 4],
            sm->current_state,
-           sm->current_temperature,
+           TEMP_MC_ARGS(sm->current_temperature),
            sm->current_fan_speed);
 }
 
 // === IDLE 狀態處理 ===
 void state_idle_enter(StateMachine *sm) {
-    printf("\n[狀態] 進入 IDLE (閒置)\n");
-    sm->set_fan_speed(sm, FAN_SPEED_OFF_PERCENT);
+    SM_PRINTF("\n[狀態] 進入 IDLE (閒置)\n");
+    sm->set_fan_speed(sm, thermal_policy_get()->fan_speed_off_percent);
     sm->log_message(sm, 0);  // INFO
 }
 
 void state_idle_exit(StateMachine *sm) {
-    printf("[狀態] 離開 IDLE\n");
+    SM_PRINTF("[狀態] 離開 IDLE\n");
 }
 
 SystemState state_idle_event(StateMachine *sm, SystemEvent event) {
@@ -126,90 +250,72 @@ SystemState state_idle_event(StateMachine *sm, SystemEvent event) {
 
 // === NORMAL 狀態處理 ===
 void state_normal_enter(StateMachine *sm) {
-    printf("\n[狀態] 進入 NORMAL (正常運行)\n");
-    sm->set_fan_speed(sm, FAN_SPEED_LOW_PERCENT);
+    SM_PRINTF("\n[狀態] 進入 NORMAL (正常運行)\n");
+    sm->set_fan_speed(sm, thermal_policy_get()->fan_speed_low_percent);
     sm->log_message(sm, 0);  // INFO
 }
 
 void state_normal_exit(StateMachine *sm) {
-    printf("[狀態] 離開 NORMAL\n");
+    SM_PRINTF("[狀態] 離開 NORMAL\n");
 }
 
 SystemState state_normal_event(StateMachine *sm, SystemEvent event) {
-    switch (event) {
-        case EVENT_TEMP_WARNING:
-            return STATE_WARNING;
-        case EVENT_TEMP_CRITICAL:
-            return STATE_CRITICAL;
-        case EVENT_TEMP_EXTREME:
-            return STATE_EMERGENCY_COOLING;
-        default:
-            return STATE_NORMAL;
-    }
+    (void)sm;
+    (void)event;
+    // 溫度事件全部由父狀態 THERMAL_MONITORING 處理
+    return STATE_UNHANDLED;
 }
 
 // === WARNING 狀態處理 ===
 void state_warning_enter(StateMachine *sm) {
-    printf("\n[狀態] 進入 WARNING (溫度警告)\n");
-    sm->set_fan_speed(sm, FAN_SPEED_MEDIUM_PERCENT);
+    SM_PRINTF("\n[狀態] 進入 WARNING (溫度警告)\n");
+    sm->set_fan_speed(sm, thermal_policy_get()->fan_speed_medium_percent);
     sm->log_message(sm, 1);  // WARNING
 }
 
 void state_warning_exit(StateMachine *sm) {
-    printf("[狀態] 離開 WARNING\n");
+    SM_PRINTF("[狀態] 離開 WARNING\n");
 }
 
 SystemState state_warning_event(StateMachine *sm, SystemEvent event) {
     switch (event) {
-        case EVENT_TEMP_NORMAL:
-            return STATE_NORMAL;
-        case EVENT_TEMP_CRITICAL:
-            return STATE_CRITICAL;
-        case EVENT_TEMP_EXTREME:
-            return STATE_EMERGENCY_COOLING;
         case EVENT_COOLING_SUCCESS:
             return STATE_NORMAL;
         default:
-            return STATE_WARNING;
+            return STATE_UNHANDLED;
     }
 }
 
 // === CRITICAL 狀態處理 ===
 void state_critical_enter(StateMachine *sm) {
-    printf("\n[狀態] 進入 CRITICAL (溫度危急)\n");
-    sm->set_fan_speed(sm, FAN_SPEED_HIGH_PERCENT);
+    SM_PRINTF("\n[狀態] 進入 CRITICAL (溫度危急)\n");
+    sm->set_fan_speed(sm, thermal_policy_get()->fan_speed_high_percent);
     sm->log_message(sm, 2);  // ERROR
 }
 
 void state_critical_exit(StateMachine *sm) {
-    printf("[狀態] 離開 CRITICAL\n");
+    SM_PRINTF("[狀態] 離開 CRITICAL\n");
 }
 
 SystemState state_critical_event(StateMachine *sm, SystemEvent event) {
     switch (event) {
-        case EVENT_TEMP_NORMAL:
-            return STATE_NORMAL;
-        case EVENT_TEMP_WARNING:
-            return STATE_WARNING;
-        case EVENT_TEMP_EXTREME:
-            return STATE_EMERGENCY_COOLING;
         case EVENT_COOLING_SUCCESS:
             return STATE_WARNING;
         default:
-            return STATE_CRITICAL;
+            return STATE_UNHANDLED;
     }
 }
 
 // === EMERGENCY_COOLING 狀態處理 ===
 void state_emergency_enter(StateMachine *sm) {
-    printf("\n[狀態] 進入 EMERGENCY_COOLING (緊急冷卻)\n");
-    sm->set_fan_speed(sm, FAN_SPEED_MAX_PERCENT);
+    SM_PRINTF("\n[狀態] 進入 EMERGENCY_COOLING (緊急冷卻)\n");
+    sm->set_fan_speed(sm, thermal_policy_get()->fan_speed_max_percent);
     sm->emergency_cooling_active = true;
     sm->log_message(sm, 3);  // CRITICAL
 }
 
 void state_emergency_exit(StateMachine *sm) {
-    printf("[狀態] 離開 EMERGENCY_COOLING\n");
+    SM_PRINTF("[狀態] 離開 EMERGENCY_COOLING\n");
     sm->emergency_cooling_active = false;
 }
 
@@ -219,26 +325,25 @@ SystemState state_emergency_event(StateMachine *sm, SystemEvent event) {
             return STATE_WARNING;
         case EVENT_COOLING_FAILURE:
             return STATE_SHUTDOWN;
-        case EVENT_TEMP_NORMAL:
-            return STATE_NORMAL;
-        case EVENT_TEMP_WARNING:
-            return STATE_WARNING;
-        default:
+        case EVENT_TEMP_CRITICAL:
+            // 緊急冷卻中降到危急溫度仍維持全速，不退回 CRITICAL
             return STATE_EMERGENCY_COOLING;
+        default:
+            return STATE_UNHANDLED;
     }
 }
 
 // === SHUTDOWN 狀態處理 ===
 void state_shutdown_enter(StateMachine *sm) {
-    printf("\n[狀態] 進入 SHUTDOWN (系統關機)\n");
-    printf("!!! 系統因過熱而關機 !!!\n");
-    sm->set_fan_speed(sm, FAN_SPEED_MAX_PERCENT);  // 保持最大風扇
+    SM_PRINTF("\n[狀態] 進入 SHUTDOWN (系統關機)\n");
+    SM_PRINTF("!!! 系統因過熱而關機 !!!\n");
+    sm->set_fan_speed(sm, thermal_policy_get()->fan_speed_max_percent);  // 保持最大風扇
     sm->log_message(sm, 3);  // CRITICAL
 }
 
 void state_shutdown_exit(StateMachine *sm) {
     // 通常不會離開關機狀態
-    printf("[狀態] 離開 SHUTDOWN\n");
+    SM_PRINTF("[狀態] 離開 SHUTDOWN\n");
 }
 
 SystemState state_shutdown_event(StateMachine *sm, SystemEvent event) {
@@ -249,6 +354,30 @@ SystemState state_shutdown_event(StateMachine *sm, SystemEvent event) {
     return STATE_SHUTDOWN;
 }
 
+// === 父狀態：THERMAL_MONITORING ===
+// NORMAL/WARNING/CRITICAL/EMERGENCY_COOLING 共用的溫度事件處理
+SystemState state_thermal_event(StateMachine *sm, SystemEvent event) {
+    (void)sm;
+    switch (event) {
+        case EVENT_TEMP_NORMAL:
+            return STATE_NORMAL;
+        case EVENT_TEMP_WARNING:
+            return STATE_WARNING;
+        case EVENT_TEMP_CRITICAL:
+            return STATE_CRITICAL;
+        case EVENT_TEMP_EXTREME:
+            return STATE_EMERGENCY_COOLING;
+        default:
+            return STATE_UNHANDLED;
+    }
+}
+
+static const StateConfig thermal_monitoring_config = {
+    .name = "THERMAL_MONITORING",
+    .handle_event = state_thermal_event,
+    .parent = NULL
+};
+
 // === 狀態配置表 ===
 static const StateConfig state_configs[STATE_COUNT] = {
     [STATE_IDLE] = {
@@ -261,25 +390,29 @@ static const StateConfig state_configs[STATE_COUNT] = {
         .name = "NORMAL",
         .on_enter = state_normal_enter,
         .on_exit = state_normal_exit,
-        .handle_event = state_normal_event
+        .handle_event = state_normal_event,
+        .parent = &thermal_monitoring_config
     },
     [STATE_WARNING] = {
         .name = "WARNING",
         .on_enter = state_warning_enter,
         .on_exit = state_warning_exit,
-        .handle_event = state_warning_event
+        .handle_event = state_warning_event,
+        .parent = &thermal_monitoring_config
     },
     [STATE_CRITICAL] = {
         .name = "CRITICAL",
         .on_enter = state_critical_enter,
         .on_exit = state_critical_exit,
-        .handle_event = state_critical_event
+        .handle_event = state_critical_event,
+        .parent = &thermal_monitoring_config
     },
     [STATE_EMERGENCY_COOLING] = {
         .name = "EMERGENCY_COOLING",
         .on_enter = state_emergency_enter,
         .on_exit = state_emergency_exit,
-        .handle_event = state_emergency_event
+        .handle_event = state_emergency_event,
+        .parent = &thermal_monitoring_config
     },
     [STATE_SHUTDOWN] = {
         .name = "SHUTDOWN",
@@ -289,76 +422,146 @@ static const StateConfig state_configs[STATE_COUNT] = {
     }
 };
 
+// === 狀態統計 API ===
+// 掛上統計緩衝區後，sm_transition() 會以奈秒解析度記錄每個狀態的
+// 進入次數、停留時間與 enter/exit 回調延遲；stats 為 NULL 時只多一個分支。
+void sm_attach_stats(StateMachine *sm, SmStats *stats) {
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(*stats));
+        stats->state_entry_ns = sm_stats_now_ns();
+    }
+    sm->stats = stats;
+}
+
+static void sm_stats_print_hist(FILE *out, const char *label, const SmHistogram *hist) {
+    if (hist->count == 0U) {
+        return;
+    }
+    fprintf(out, "    %-10s 次數 %8lu  平均 %10.1f us  p50 %10.1f us  p99 %10.1f us  最大 %10.1f us\n",
+            label, (unsigned long)hist->count,
+            ((double)hist->total_ns / (double)hist->count) / 1e3,
+            (double)sm_hist_percentile(hist, 50U) / 1e3,
+            (double)sm_hist_percentile(hist, 99U) / 1e3,
+            (double)hist->max_ns / 1e3);
+}
+
+// 輸出每個狀態的統計；目前狀態尚未結束的停留時間不列入
+void sm_stats_dump(const SmStats *stats, FILE *out) {
+    if (stats == NULL) {
+        return;
+    }
+    for (uint32_t s = 0U; s < STATE_COUNT; s++) {
+        const SmStateStats *st = &stats->states[s];
+        if ((st->entries == 0U) && (st->exit_latency.count == 0U)) {
+            continue;
+        }
+        fprintf(out, "  %-18s 進入 %lu 次, 累計停留 %.3f ms\n",
+                state_configs[s].name, (unsigned long)st->entries,
+                (double)st->residency.total_ns / 1e6);
+        sm_stats_print_hist(out, "停留時間", &st->residency);
+        sm_stats_print_hist(out, "進入回調", &st->enter_latency);
+        sm_stats_print_hist(out, "退出回調", &st->exit_latency);
+    }
+}
+
+// === 轉換掛鉤 ===
+// 引擎在 on_exit 之前、狀態更新後 (on_enter 之前)、on_enter 之後呼叫；
+// 統計儀表與轉換日誌都放在這裡，引擎本身不知道它們存在。
+static inline void fan_sm_hook_begin(StateMachine *sm, SystemState from, SystemState to) {
+    SmStats *stats = sm->stats;
+    (void)to;
+    if (stats != NULL) {
+        uint64_t now = sm_stats_now_ns();
+        sm_hist_record(&stats->states[from].residency, now - stats->state_entry_ns);
+        stats->state_entry_ns = now;    // 暫存 on_exit 開始時間
+    }
+}
+
+static inline void fan_sm_hook_exited(StateMachine *sm, SystemState from, SystemState to) {
+    SmStats *stats = sm->stats;
+    if (stats != NULL) {
+        uint64_t now = sm_stats_now_ns();
+        sm_hist_record(&stats->states[from].exit_latency, now - stats->state_entry_ns);
+        stats->states[to].entries++;
+        stats->state_entry_ns = now;
+    }
+
+    sm->state_entry_time = (uint32_t)time(NULL);
+    if (sm->observer != NULL) {
+        sm->observer(sm->observer_ctx, sm, from, to, sm->last_event);
+    }
+
+    SM_PRINTF("[轉換] %s -> %s\n", state_configs[from].name, state_configs[to].name);
+}
+
+static inline void fan_sm_hook_entered(StateMachine *sm, SystemState from, SystemState to) {
+    SmStats *stats = sm->stats;
+    (void)from;
+    if (stats != NULL) {
+        uint64_t now = sm_stats_now_ns();
+        sm_hist_record(&stats->states[to].enter_latency, now - stats->state_entry_ns);
+        // 停留時間從進入回調完成後起算
+        stats->state_entry_ns = now;
+    }
+}
+
+// === 展開後的轉換表與分派 (由引擎產生) ===
+// 階層只存在於設定中：初始化時沿著 parent 鏈把每個 (狀態, 事件) 解析成目標狀態
+// (fan_sm_dispatch_table)，執行期只做一次查表，成本與階層深度無關。
+SM_ENGINE_DEFINE(fan_sm, SystemState, SystemEvent, StateMachine, STATE_COUNT, EVENT_COUNT,
+                 STATE_UNHANDLED, state_configs,
+                 fan_sm_hook_begin, fan_sm_hook_exited, fan_sm_hook_entered)
+
 // === 狀態機核心函數 ===
 void sm_init(StateMachine *sm) {
     memset(sm, 0, sizeof(StateMachine));
     
     sm->current_state = STATE_IDLE;
     sm->previous_state = STATE_IDLE;
-    sm->current_temperature = 25U;  // 室溫
+    sm->current_temperature = TEMP_MC_FROM_C(25);  // 室溫
     sm->current_fan_speed = 0U;
     
     // 設定動作回調
     sm->set_fan_speed = action_set_fan_speed;
     sm->log_message = action_log_message;
     
-    printf("=== BMC 風扇控制狀態機初始化 ===\n");
+    if (!fan_sm_dispatch_ready) {
+        fan_sm_build_dispatch_table();
+    }
+    
+    SM_PRINTF("=== BMC 風扇控制狀態機初始化 ===\n");
 }
 
+// 對外 API 保持不變：只在引擎產生的函數外加上參數檢查
 void sm_transition(StateMachine *sm, SystemState new_state) {
     if (new_state >= STATE_COUNT) {
-        printf("[錯誤] 無效的狀態: %d\n", new_state);
+        SM_PRINTF("[錯誤] 無效的狀態: %d\n", new_state);
         return;
     }
     
-    // 執行當前狀態的退出回調
-    if (state_configs[sm->current_state].on_exit) {
-        state_configs[sm->current_state].on_exit(sm);
-    }
-    
-    // 更新狀態
-    sm->previous_state = sm->current_state;
-    sm->current_state = new_state;
-    sm->state_entry_time = (uint32_t)time(NULL);
-    sm->state_transitions++;
-    
-    printf("[轉換] %s -> %s\n", 
-           state_configs[sm->previous_state].name,
-           state_configs[sm->current_state].name);
-    
-    // 執行新狀態的進入回調
-    if (state_configs[sm->current_state].on_enter) {
-        state_configs[sm->current_state].on_enter(sm);
-    }
+    sm->last_event = EVENT_COUNT;
+    fan_sm_transition(sm, new_state);
 }
 
 void sm_process_event(StateMachine *sm, SystemEvent event) {
     if (event >= EVENT_COUNT) {
-        printf("[錯誤] 無效的事件: %d\n", event);
+        SM_PRINTF("[錯誤] 無效的事件: %d\n", event);
         return;
     }
     
-    sm->events_processed++;
-    
-    // 使用當前狀態的事件處理器
-    EventHandler handler = state_configs[sm->current_state].handle_event;
-    if (handler) {
-        SystemState new_state = handler(sm, event);
-        
-        // 如果需要轉換狀態
-        if (new_state != sm->current_state) {
-            sm_transition(sm, new_state);
-        }
-    }
+    sm->last_event = event;
+    fan_sm_process_event(sm, event);
 }
 
 // === 溫度監控函數 ===
-SystemEvent get_temperature_event(uint16_t temperature) {
-    if (temperature >= MAX_TEMPERATURE_SHUTDOWN_C) {
+SystemEvent get_temperature_event(TempMilliC temperature) {
+    const ThermalPolicy *policy = thermal_policy_get();
+
+    if (temperature >= policy->max_temperature_shutdown) {
         return EVENT_TEMP_EXTREME;
-    } else if (temperature >= MAX_TEMPERATURE_CRITICAL_C) {
+    } else if (temperature >= policy->max_temperature_critical) {
         return EVENT_TEMP_CRITICAL;
-    } else if (temperature >= MAX_TEMPERATURE_WARNING_C) {
+    } else if (temperature >= policy->max_temperature_warning) {
         return EVENT_TEMP_WARNING;
     } else {
         return EVENT_TEMP_NORMAL;
@@ -366,25 +569,30 @@ SystemEvent get_temperature_event(uint16_t temperature) {
 }
 
 // === 模擬溫度變化 ===
-void simulate_temperature_change(StateMachine *sm, int change) {
-    int new_temp = (int)sm->current_temperature + change;
+void simulate_temperature_change(StateMachine *sm, TempMilliC change) {
+    TempMilliC old_temp = sm->current_temperature;
+    TempMilliC new_temp = temp_mc_add_sat(old_temp, change);
     
     // 限制溫度範圍
-    if (new_temp < 20) new_temp = 20;
-    if (new_temp > 100) new_temp = 100;
+    if (new_temp < TEMP_MC_FROM_C(20)) new_temp = TEMP_MC_FROM_C(20);
+    if (new_temp > TEMP_MC_FROM_C(100)) new_temp = TEMP_MC_FROM_C(100);
     
-    sm->current_temperature = (uint16_t)new_temp;
+    sm->current_temperature = new_temp;
     
-    printf("\n[感測器] 溫度變化: %d°C %s %u°C\n", 
-           sm->current_temperature - change,
+    SM_PRINTF("\n[感測器] 溫度變化: " TEMP_MC_FMT "°C %s " TEMP_MC_FMT "°C\n", 
+           TEMP_MC_ARGS(old_temp),
            (change > 0) ? "->" : "<-",
-           sm->current_temperature);
+           TEMP_MC_ARGS(new_temp));
 }
 
+#ifndef FAN_CONTROL_NO_MAIN
+
 // === 主程式：狀態機演示 ===
 int main(void) {
     StateMachine sm;
+    static SmStats stats;
     sm_init(&sm);
+    sm_attach_stats(&sm, &stats);
     
     printf("\n=== 開始狀態機模擬 ===\n");
     
@@ -393,27 +601,27 @@ int main(void) {
     
     // 模擬場景
     printf("\n--- 場景 1: 正常運行 ---\n");
-    simulate_temperature_change(&sm, 20);  // 45°C
+    simulate_temperature_change(&sm, TEMP_MC_FROM_C(20));  // 45°C
     sm_process_event(&sm, get_temperature_event(sm.current_temperature));
     
     printf("\n--- 場景 2: 溫度上升至警告 ---\n");
-    simulate_temperature_change(&sm, 30);  // 75°C
+    simulate_temperature_change(&sm, TEMP_MC_FROM_C(30));  // 75°C
     sm_process_event(&sm, get_temperature_event(sm.current_temperature));
     
     printf("\n--- 場景 3: 溫度繼續上升至危急 ---\n");
-    simulate_temperature_change(&sm, 15);  // 90°C
+    simulate_temperature_change(&sm, TEMP_MC_FROM_C(15));  // 90°C
     sm_process_event(&sm, get_temperature_event(sm.current_temperature));
     
     printf("\n--- 場景 4: 極端溫度，觸發緊急冷卻 ---\n");
-    simulate_temperature_change(&sm, 8);   // 98°C
+    simulate_temperature_change(&sm, TEMP_MC_FROM_C(8));   // 98°C
     sm_process_event(&sm, get_temperature_event(sm.current_temperature));
     
     printf("\n--- 場景 5: 冷卻成功 ---\n");
-    simulate_temperature_change(&sm, -30); // 68°C
+    simulate_temperature_change(&sm, TEMP_MC_FROM_C(-30)); // 68°C
     sm_process_event(&sm, EVENT_COOLING_SUCCESS);
     
     printf("\n--- 場景 6: 溫度回到正常 ---\n");
-    simulate_temperature_change(&sm, -25); // 43°C
+    simulate_temperature_change(&sm, TEMP_MC_FROM_C(-25)); // 43°C
     sm_process_event(&sm, get_temperature_event(sm.current_temperature));
     
     // 顯示統計
@@ -421,8 +629,15 @@ int main(void) {
     printf("狀態轉換次數: %u\n", sm.state_transitions);
     printf("處理事件次數: %u\n", sm.events_processed);
     printf("最終狀態: %s\n", state_configs[sm.current_state].name);
-    printf("最終溫度: %u°C\n", sm.current_temperature);
+    printf("最終溫度: " TEMP_MC_FMT "°C\n", TEMP_MC_ARGS(sm.current_temperature));
     printf("最終風扇速度: %u%%\n", sm.current_fan_speed);
     
+    printf("\n=== 各狀態停留時間與回調延遲 ===\n");
+    sm_stats_dump(&stats, stdout);
+    
     return 0;
 }
+
+#endif  // FAN_CONTROL_NO_MAIN
+
+#endif  // FAN_CONTROL_STATE_MACHINE_C
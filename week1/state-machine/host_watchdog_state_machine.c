@@ -0,0 +1,218 @@
+// host_watchdog_state_machine.c - 以通用引擎實作的主機看門狗狀態機
+// 示範 sm_engine.h 不綁定風扇控制：只要提供狀態/事件列舉、context 結構與設定表，
+// 就能得到與 fan_control_state_machine.c 相同的階層分派與 enter/exit 流程。
+// 行為參考 IPMI Watchdog：ARM 後主機必須定期 KICK，逾時先預警，再逾時則重置主機。
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "sm_engine.h"
+
+#define WDT_TIMEOUT_TICKS           5U      // 未收到 KICK 的節拍數上限
+#define WDT_PRETIMEOUT_TICKS        3U      // 進入預警的節拍數
+
+// === 狀態定義 ===
+typedef enum {
+    WDT_STATE_DISARMED,
+    WDT_STATE_RUNNING,
+    WDT_STATE_PRETIMEOUT,
+    WDT_STATE_EXPIRED,
+    WDT_STATE_COUNT
+} WdtState;
+
+#define WDT_STATE_UNHANDLED         ((WdtState)WDT_STATE_COUNT)
+
+// === 事件定義 ===
+typedef enum {
+    WDT_EVENT_ARM,
+    WDT_EVENT_DISARM,
+    WDT_EVENT_KICK,
+    WDT_EVENT_PRETIMEOUT,
+    WDT_EVENT_TIMEOUT,
+    WDT_EVENT_HOST_RESET_DONE,
+    WDT_EVENT_COUNT
+} WdtEvent;
+
+// === 看門狗 context (引擎要求的四個欄位 + 自己的資料) ===
+typedef struct {
+    WdtState current_state;
+    WdtState previous_state;
+    uint32_t state_transitions;
+    uint32_t events_processed;
+
+    uint32_t ticks_since_kick;
+    uint32_t host_resets;
+    bool pretimeout_irq;
+} HostWatchdog;
+
+SM_ENGINE_DECLARE(wdt_sm, WdtState, WdtEvent, HostWatchdog)
+
+// === 狀態回調 ===
+static void wdt_running_enter(HostWatchdog *wdt) {
+    wdt->ticks_since_kick = 0U;
+    printf("[看門狗] 計時中 (逾時 %u 節拍)\n", WDT_TIMEOUT_TICKS);
+}
+
+static void wdt_pretimeout_enter(HostWatchdog *wdt) {
+    wdt->pretimeout_irq = true;
+    printf("[看門狗] 預警：已 %u 節拍未收到 KICK\n", wdt->ticks_since_kick);
+}
+
+static void wdt_pretimeout_exit(HostWatchdog *wdt) {
+    wdt->pretimeout_irq = false;
+}
+
+static void wdt_expired_enter(HostWatchdog *wdt) {
+    wdt->host_resets++;
+    printf("[看門狗] 逾時！重置主機 (第 %u 次)\n", wdt->host_resets);
+}
+
+static void wdt_disarmed_enter(HostWatchdog *wdt) {
+    wdt->ticks_since_kick = 0U;
+    printf("[看門狗] 停用\n");
+}
+
+// === 事件處理 (只依事件決定結果) ===
+static WdtState wdt_disarmed_event(HostWatchdog *wdt, WdtEvent event) {
+    (void)wdt;
+    return (event == WDT_EVENT_ARM) ? WDT_STATE_RUNNING : WDT_STATE_UNHANDLED;
+}
+
+static WdtState wdt_running_event(HostWatchdog *wdt, WdtEvent event) {
+    (void)wdt;
+    return (event == WDT_EVENT_PRETIMEOUT) ? WDT_STATE_PRETIMEOUT : WDT_STATE_UNHANDLED;
+}
+
+static WdtState wdt_pretimeout_event(HostWatchdog *wdt, WdtEvent event) {
+    (void)wdt;
+    return (event == WDT_EVENT_KICK) ? WDT_STATE_RUNNING : WDT_STATE_UNHANDLED;
+}
+
+static WdtState wdt_expired_event(HostWatchdog *wdt, WdtEvent event) {
+    (void)wdt;
+    return (event == WDT_EVENT_HOST_RESET_DONE) ? WDT_STATE_RUNNING : WDT_STATE_UNHANDLED;
+}
+
+// 父狀態 ARMED：RUNNING/PRETIMEOUT 共用的 DISARM 與 TIMEOUT 處理
+static WdtState wdt_armed_event(HostWatchdog *wdt, WdtEvent event) {
+    (void)wdt;
+    switch (event) {
+        case WDT_EVENT_DISARM:
+            return WDT_STATE_DISARMED;
+        case WDT_EVENT_TIMEOUT:
+            return WDT_STATE_EXPIRED;
+        default:
+            return WDT_STATE_UNHANDLED;
+    }
+}
+
+static const wdt_sm_StateConfig wdt_armed_config = {
+    .name = "ARMED",
+    .handle_event = wdt_armed_event
+};
+
+static const wdt_sm_StateConfig wdt_state_configs[WDT_STATE_COUNT] = {
+    [WDT_STATE_DISARMED] = {
+        .name = "DISARMED",
+        .on_enter = wdt_disarmed_enter,
+        .handle_event = wdt_disarmed_event
+    },
+    [WDT_STATE_RUNNING] = {
+        .name = "RUNNING",
+        .on_enter = wdt_running_enter,
+        .handle_event = wdt_running_event,
+        .parent = &wdt_armed_config
+    },
+    [WDT_STATE_PRETIMEOUT] = {
+        .name = "PRETIMEOUT",
+        .on_enter = wdt_pretimeout_enter,
+        .on_exit = wdt_pretimeout_exit,
+        .handle_event = wdt_pretimeout_event,
+        .parent = &wdt_armed_config
+    },
+    [WDT_STATE_EXPIRED] = {
+        .name = "EXPIRED",
+        .on_enter = wdt_expired_enter,
+        .handle_event = wdt_expired_event
+    }
+};
+
+static inline void wdt_hook_exited(HostWatchdog *wdt, WdtState from, WdtState to) {
+    (void)wdt;
+    printf("[轉換] %s -> %s\n", wdt_state_configs[from].name, wdt_state_configs[to].name);
+}
+
+SM_ENGINE_DEFINE(wdt_sm, WdtState, WdtEvent, HostWatchdog, WDT_STATE_COUNT, WDT_EVENT_COUNT,
+                 WDT_STATE_UNHANDLED, wdt_state_configs,
+                 SM_ENGINE_NO_HOOK, wdt_hook_exited, SM_ENGINE_NO_HOOK)
+
+// === 看門狗 API ===
+void wdt_init(HostWatchdog *wdt) {
+    memset(wdt, 0, sizeof(*wdt));
+    wdt->current_state = WDT_STATE_DISARMED;
+    wdt->previous_state = WDT_STATE_DISARMED;
+    if (!wdt_sm_dispatch_ready) {
+        wdt_sm_build_dispatch_table();
+    }
+}
+
+// KICK 直接重設計數 (RUNNING 狀態下不需要轉換)，再交給狀態機
+void wdt_kick(HostWatchdog *wdt) {
+    wdt->ticks_since_kick = 0U;
+    wdt_sm_process_event(wdt, WDT_EVENT_KICK);
+}
+
+// 每個計時節拍呼叫一次，依累積節拍數產生 PRETIMEOUT/TIMEOUT 事件
+void wdt_tick(HostWatchdog *wdt) {
+    if ((wdt->current_state == WDT_STATE_RUNNING) ||
+        (wdt->current_state == WDT_STATE_PRETIMEOUT)) {
+        wdt->ticks_since_kick++;
+        if (wdt->ticks_since_kick >= WDT_TIMEOUT_TICKS) {
+            wdt_sm_process_event(wdt, WDT_EVENT_TIMEOUT);
+        } else if (wdt->ticks_since_kick >= WDT_PRETIMEOUT_TICKS) {
+            wdt_sm_process_event(wdt, WDT_EVENT_PRETIMEOUT);
+        }
+    }
+}
+
+// === 主程式：看門狗演示 ===
+int main(void) {
+    HostWatchdog wdt;
+    wdt_init(&wdt);
+
+    printf("=== 主機看門狗狀態機 (sm_engine.h) ===\n");
+
+    printf("\n--- 場景 1: 啟用後主機正常 KICK ---\n");
+    wdt_sm_process_event(&wdt, WDT_EVENT_ARM);
+    for (uint32_t i = 0U; i < 6U; i++) {
+        wdt_tick(&wdt);
+        wdt_tick(&wdt);
+        wdt_kick(&wdt);
+    }
+
+    printf("\n--- 場景 2: 主機延遲 KICK，進入預警後恢復 ---\n");
+    for (uint32_t i = 0U; i < WDT_PRETIMEOUT_TICKS; i++) {
+        wdt_tick(&wdt);
+    }
+    wdt_kick(&wdt);
+
+    printf("\n--- 場景 3: 主機當機，逾時重置 ---\n");
+    for (uint32_t i = 0U; i < WDT_TIMEOUT_TICKS; i++) {
+        wdt_tick(&wdt);
+    }
+    wdt_sm_process_event(&wdt, WDT_EVENT_HOST_RESET_DONE);
+
+    printf("\n--- 場景 4: 停用 ---\n");
+    wdt_sm_process_event(&wdt, WDT_EVENT_DISARM);
+    wdt_tick(&wdt);
+
+    printf("\n=== 看門狗統計 ===\n");
+    printf("狀態轉換次數: %u\n", wdt.state_transitions);
+    printf("處理事件次數: %u\n", wdt.events_processed);
+    printf("主機重置次數: %u\n", wdt.host_resets);
+    printf("最終狀態: %s\n", wdt_state_configs[wdt.current_state].name);
+
+    return 0;
+}
@@ -0,0 +1,570 @@
+// sensor_fusion.c - 區域內多感測器融合 (最大值/平均/加權/最差餘裕)
+// StateMachine 只有一個 current_temperature，但實際區域有 CPU、DIMM、VR、進風等多顆感測器。
+// 這裡在 get_temperature_event() 之前加一層聚合，每次單一感測器更新都以 O(1) 維護：
+//   - 平均、加權平均：累加和，更新時減舊值加新值
+//   - 最大溫度、最差餘裕 (距離各自危急閾值最近者)：以 1°C 為桶的計數陣列 + 非空桶位元圖，
+//     找最高/最低的非空桶只需掃 4 個 64-bit 字組並做一次 clz/ctz，與感測器數量無關
+// 溫度都是毫度 (TempMilliC)，閾值可以是小數度 (見 thermal_policy.h)。
+//   - 平均、加權平均保留完整精度
+//   - 最大值回傳精確的毫度值，不會把 84.9°C 取整成 84°C 而漏掉 84.5°C 的閾值：
+//     每個溫度桶記住桶內最大值與等於最大值的感測器數，加入/移除時 O(1) 更新。
+//     唯一的例外是桶內最後一個等於最大值的感測器離開：該桶標記為待重算，
+//     等它成為最熱桶被查詢時才走一次該桶的感測器串列 (O(桶內感測器數))。
+//     讀值隨機更新時，k 顆感測器的區域每次更新平均只重算約 1/k 次，攤銷後仍是 O(1)
+//   - 最差餘裕以 1°C 向下取整：餘裕變小、等效溫度變高，偏向安全側
+// 區域危急閾值來自 thermal_policy_get()；沒有自己閾值的感測器跟隨區域閾值，
+// 政策重載後第一次查詢時重新計算這些感測器的餘裕 (只在序號改變時，O(感測器數))。
+
+#ifndef FAN_CONTROL_NO_MAIN
+#define FAN_CONTROL_NO_MAIN
+#endif
+#include "fan_control_state_machine.c"
+
+#define FUSION_BUCKETS              256U
+#define FUSION_WORDS                (FUSION_BUCKETS / 64U)
+#define FUSION_MARGIN_BIAS          128     // 餘裕 -128..+127°C 對應桶 0..255
+#define FUSION_MAX_SENSORS          4096U
+#define FUSION_NONE                 0xFFFFU // 桶串列的結尾
+#define FUSION_ZONE_CRITICAL        TEMP_MC_MIN // 感測器閾值跟隨區域政策
+
+// === 聚合策略 ===
+typedef enum {
+    FUSION_MAX,                     // 最熱的感測器
+    FUSION_MEAN,                    // 算術平均
+    FUSION_WEIGHTED,                // 依權重平均 (例如 CPU 權重高於進風)
+    FUSION_WORST_MARGIN,            // 距離自己閾值最近的感測器
+    FUSION_POLICY_COUNT
+} FusionPolicy;
+
+// 桶計數 + 非空位元圖：插入/移除 O(1)，最大/最小值 O(FUSION_WORDS)
+typedef struct {
+    uint16_t counts[FUSION_BUCKETS];
+    uint64_t bitmap[FUSION_WORDS];
+} FusionBucketSet;
+
+typedef struct {
+    TempMilliC temperature;
+    TempMilliC critical;            // 此感測器自己的危急閾值，或 FUSION_ZONE_CRITICAL
+    uint16_t weight;
+    bool valid;                     // false：尚無讀值或感測器故障
+    uint16_t next;                  // 同一溫度桶的感測器串列 (索引，FUSION_NONE 結尾)
+    uint16_t prev;
+} FusionSensor;
+
+typedef struct {
+    FusionSensor *sensors;
+    uint32_t sensor_count;
+    uint32_t valid_count;
+    int64_t sum;
+    int64_t weighted_sum;
+    int64_t weight_total;
+    FusionBucketSet temps;
+    FusionBucketSet margins;
+    uint16_t temp_heads[FUSION_BUCKETS];    // 每個溫度桶的串列開頭
+    TempMilliC temp_max[FUSION_BUCKETS];    // 桶內最大值
+    uint16_t temp_max_count[FUSION_BUCKETS];// 等於 temp_max 的感測器數；桶非空而為 0 表示待重算
+    uint64_t max_rescans;                   // 待重算的桶被查詢而重走串列的次數
+    TempMilliC zone_critical;               // 目前 margins 所依據的區域危急閾值
+    uint64_t policy_generation;             // zone_critical 取自哪一份政策
+} ZoneFusion;
+
+// === 桶集合 ===
+static inline void fusion_set_add(FusionBucketSet *set, uint32_t bucket) {
+    if (set->counts[bucket]++ == 0U) {
+        set->bitmap[bucket / 64U] |= (1ULL << (bucket % 64U));
+    }
+}
+
+static inline void fusion_set_remove(FusionBucketSet *set, uint32_t bucket) {
+    if (--set->counts[bucket] == 0U) {
+        set->bitmap[bucket / 64U] &= ~(1ULL << (bucket % 64U));
+    }
+}
+
+// 回傳最高的非空桶；集合為空時回傳 0
+static inline uint32_t fusion_set_highest(const FusionBucketSet *set) {
+    for (uint32_t w = FUSION_WORDS; w > 0U; w--) {
+        uint64_t bits = set->bitmap[w - 1U];
+        if (bits != 0U) {
+            return ((w - 1U) * 64U) + (63U - (uint32_t)__builtin_clzll(bits));
+        }
+    }
+    return 0U;
+}
+
+// 回傳最低的非空桶；集合為空時回傳 FUSION_BUCKETS - 1
+static inline uint32_t fusion_set_lowest(const FusionBucketSet *set) {
+    for (uint32_t w = 0U; w < FUSION_WORDS; w++) {
+        uint64_t bits = set->bitmap[w];
+        if (bits != 0U) {
+            return (w * 64U) + (uint32_t)__builtin_ctzll(bits);
+        }
+    }
+    return FUSION_BUCKETS - 1U;
+}
+
+// 毫度向下取整到整數度 (負數也向下)
+static inline int32_t fusion_floor_c(int64_t milli) {
+    int64_t c = milli / TEMP_MC_PER_C;
+    if (((milli % TEMP_MC_PER_C) != 0) && (milli < 0)) {
+        c--;
+    }
+    return (int32_t)c;
+}
+
+// 四捨五入除法 (den > 0)
+static inline TempMilliC fusion_div_round(int64_t num, int64_t den) {
+    int64_t q = (num >= 0) ? ((num + (den / 2)) / den) : -((-num + (den / 2)) / den);
+    return temp_mc_saturate(q);
+}
+
+static inline uint32_t fusion_temp_bucket(TempMilliC temperature) {
+    int32_t c = fusion_floor_c(temperature);
+    if (c < 0) {
+        c = 0;
+    } else if (c >= (int32_t)FUSION_BUCKETS) {
+        c = (int32_t)FUSION_BUCKETS - 1;
+    }
+    return (uint32_t)c;
+}
+
+static inline TempMilliC fusion_sensor_critical(const FusionSensor *s, TempMilliC zone_critical) {
+    return (s->critical == FUSION_ZONE_CRITICAL) ? zone_critical : s->critical;
+}
+
+static inline uint32_t fusion_margin_bucket(const ZoneFusion *zf, const FusionSensor *s) {
+    TempMilliC critical = fusion_sensor_critical(s, zf->zone_critical);
+    int32_t bucket = fusion_floor_c((int64_t)critical - s->temperature) + FUSION_MARGIN_BIAS;
+    if (bucket < 0) {
+        bucket = 0;
+    } else if (bucket >= (int32_t)FUSION_BUCKETS) {
+        bucket = (int32_t)FUSION_BUCKETS - 1;
+    }
+    return (uint32_t)bucket;
+}
+
+// === 內部：加入/移除一個感測器的貢獻 ===
+static inline void fusion_add(ZoneFusion *zf, FusionSensor *s) {
+    uint32_t bucket = fusion_temp_bucket(s->temperature);
+    uint16_t index = (uint16_t)(s - zf->sensors);
+
+    zf->valid_count++;
+    zf->sum += s->temperature;
+    zf->weighted_sum += (int64_t)s->temperature * s->weight;
+    zf->weight_total += s->weight;
+    fusion_set_add(&zf->temps, bucket);
+    fusion_set_add(&zf->margins, fusion_margin_bucket(zf, s));
+
+    if (zf->temps.counts[bucket] == 1U) {
+        zf->temp_max[bucket] = s->temperature;
+        zf->temp_max_count[bucket] = 1U;
+    } else if (zf->temp_max_count[bucket] == 0U) {
+        // 待重算：下次查詢時會一併掃到這個感測器
+    } else if (s->temperature > zf->temp_max[bucket]) {
+        zf->temp_max[bucket] = s->temperature;
+        zf->temp_max_count[bucket] = 1U;
+    } else if (s->temperature == zf->temp_max[bucket]) {
+        zf->temp_max_count[bucket]++;
+    } else {
+        // 低於桶內最大值，不影響
+    }
+
+    s->prev = FUSION_NONE;
+    s->next = zf->temp_heads[bucket];
+    if (s->next != FUSION_NONE) {
+        zf->sensors[s->next].prev = index;
+    }
+    zf->temp_heads[bucket] = index;
+}
+
+static inline void fusion_remove(ZoneFusion *zf, FusionSensor *s) {
+    uint32_t bucket = fusion_temp_bucket(s->temperature);
+
+    zf->valid_count--;
+    zf->sum -= s->temperature;
+    zf->weighted_sum -= (int64_t)s->temperature * s->weight;
+    zf->weight_total -= s->weight;
+    fusion_set_remove(&zf->temps, bucket);
+    fusion_set_remove(&zf->margins, fusion_margin_bucket(zf, s));
+    if ((zf->temp_max_count[bucket] != 0U) && (s->temperature == zf->temp_max[bucket])) {
+        zf->temp_max_count[bucket]--;
+    }
+
+    if (s->prev != FUSION_NONE) {
+        zf->sensors[s->prev].next = s->next;
+    } else {
+        zf->temp_heads[bucket] = s->next;
+    }
+    if (s->next != FUSION_NONE) {
+        zf->sensors[s->next].prev = s->prev;
+    }
+}
+
+// 最熱非空桶的精確最大值；該桶待重算時才走一次桶內串列
+static inline TempMilliC fusion_exact_max(ZoneFusion *zf) {
+    uint32_t bucket = fusion_set_highest(&zf->temps);
+
+    if (zf->temp_max_count[bucket] == 0U) {
+        TempMilliC max_t = TEMP_MC_MIN;
+        uint16_t count = 0U;
+        for (uint16_t i = zf->temp_heads[bucket]; i != FUSION_NONE; i = zf->sensors[i].next) {
+            if (zf->sensors[i].temperature > max_t) {
+                max_t = zf->sensors[i].temperature;
+                count = 1U;
+            } else if (zf->sensors[i].temperature == max_t) {
+                count++;
+            } else {
+                // 較低的讀值
+            }
+        }
+        zf->temp_max[bucket] = max_t;
+        zf->temp_max_count[bucket] = count;
+        zf->max_rescans++;
+    }
+    return zf->temp_max[bucket];
+}
+
+// 政策重載後，跟隨區域閾值的感測器換到新閾值重新計算餘裕
+static inline void fusion_sync_policy(ZoneFusion *zf, const ThermalPolicy *thermal) {
+    if (thermal->generation != zf->policy_generation) {
+        for (uint32_t i = 0U; i < zf->sensor_count; i++) {
+            const FusionSensor *s = &zf->sensors[i];
+            if (s->valid && (s->critical == FUSION_ZONE_CRITICAL)) {
+                fusion_set_remove(&zf->margins, fusion_margin_bucket(zf, s));
+            }
+        }
+        zf->zone_critical = thermal->max_temperature_critical;
+        zf->policy_generation = thermal->generation;
+        for (uint32_t i = 0U; i < zf->sensor_count; i++) {
+            const FusionSensor *s = &zf->sensors[i];
+            if (s->valid && (s->critical == FUSION_ZONE_CRITICAL)) {
+                fusion_set_add(&zf->margins, fusion_margin_bucket(zf, s));
+            }
+        }
+    }
+}
+
+// === 公開 API ===
+// sensors 由呼叫端提供 (可放在大陣列中)，初始時全部無效且跟隨區域閾值
+bool zone_fusion_init(ZoneFusion *zf, FusionSensor *sensors, uint32_t sensor_count) {
+    if ((zf == NULL) || (sensors == NULL) || (sensor_count == 0U) ||
+        (sensor_count > FUSION_MAX_SENSORS)) {
+        return false;
+    }
+    const ThermalPolicy *thermal = thermal_policy_get();
+    memset(zf, 0, sizeof(*zf));
+    memset(sensors, 0, sensor_count * sizeof(FusionSensor));
+    zf->sensors = sensors;
+    zf->sensor_count = sensor_count;
+    zf->zone_critical = thermal->max_temperature_critical;
+    zf->policy_generation = thermal->generation;
+    for (uint32_t b = 0U; b < FUSION_BUCKETS; b++) {
+        zf->temp_heads[b] = FUSION_NONE;
+    }
+    for (uint32_t i = 0U; i < sensor_count; i++) {
+        sensors[i].critical = FUSION_ZONE_CRITICAL;
+        sensors[i].weight = 1U;
+    }
+    return true;
+}
+
+// 設定感測器的閾值 (FUSION_ZONE_CRITICAL 表示跟隨區域政策) 與權重
+// (有效的感測器會先移除再以新設定加入)
+bool zone_fusion_configure(ZoneFusion *zf, uint32_t index, TempMilliC critical, uint16_t weight) {
+    if (index >= zf->sensor_count) {
+        return false;
+    }
+    FusionSensor *s = &zf->sensors[index];
+    if (s->valid) {
+        fusion_remove(zf, s);
+    }
+    s->critical = critical;
+    s->weight = weight;
+    if (s->valid) {
+        fusion_add(zf, s);
+    }
+    return true;
+}
+
+// 單一感測器新讀值：O(1)
+static inline bool zone_fusion_update(ZoneFusion *zf, uint32_t index, TempMilliC temperature) {
+    if (index >= zf->sensor_count) {
+        return false;
+    }
+    FusionSensor *s = &zf->sensors[index];
+    if (s->valid) {
+        fusion_remove(zf, s);
+    }
+    s->temperature = temperature;
+    s->valid = true;
+    fusion_add(zf, s);
+    return true;
+}
+
+// 感測器故障或移除：不再參與聚合
+bool zone_fusion_invalidate(ZoneFusion *zf, uint32_t index) {
+    if (index >= zf->sensor_count) {
+        return false;
+    }
+    FusionSensor *s = &zf->sensors[index];
+    if (s->valid) {
+        fusion_remove(zf, s);
+        s->valid = false;
+    }
+    return true;
+}
+
+// 依策略回傳區域溫度，可直接交給 get_temperature_event()。
+// 最差餘裕換算成「等效溫度」：感測器剛好在自己的危急閾值時，等同目前政策的區域 CRITICAL 閾值。
+// 沒有任何有效感測器時回傳 CRITICAL 閾值，讓風扇偏向安全側。
+static inline TempMilliC zone_fusion_temperature(ZoneFusion *zf, FusionPolicy policy) {
+    fusion_sync_policy(zf, thermal_policy_get());
+    TempMilliC result = zf->zone_critical;
+
+    if (zf->valid_count > 0U) {
+        switch (policy) {
+            case FUSION_MAX:
+                result = fusion_exact_max(zf);
+                break;
+            case FUSION_MEAN:
+                result = fusion_div_round(zf->sum, (int64_t)zf->valid_count);
+                break;
+            case FUSION_WEIGHTED:
+                if (zf->weight_total > 0) {
+                    result = fusion_div_round(zf->weighted_sum, zf->weight_total);
+                }
+                break;
+            case FUSION_WORST_MARGIN: {
+                int32_t margin_c = (int32_t)fusion_set_lowest(&zf->margins) - FUSION_MARGIN_BIAS;
+                result = temp_mc_saturate((int64_t)zf->zone_critical - ((int64_t)margin_c * TEMP_MC_PER_C));
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    return result;
+}
+
+static inline SystemEvent zone_fusion_event(ZoneFusion *zf, FusionPolicy policy) {
+    return get_temperature_event(zone_fusion_temperature(zf, policy));
+}
+
+#ifndef SENSOR_FUSION_NO_MAIN
+
+static const char *const fusion_policy_names[FUSION_POLICY_COUNT] = {
+    "最大值", "平均", "加權平均", "最差餘裕"
+};
+
+// === 對照組：每次更新後重新掃描全部感測器 ===
+// 與增量版本相同的語意：最大值精確，最差餘裕以 1°C 向下取整 (並限制在桶範圍內)
+static TempMilliC fusion_rescan(const ZoneFusion *zf, FusionPolicy policy) {
+    TempMilliC zone_critical = thermal_policy_get()->max_temperature_critical;
+    TempMilliC max_t = TEMP_MC_MIN;
+    int64_t sum = 0;
+    int64_t wsum = 0;
+    int64_t wtotal = 0;
+    int64_t worst = INT64_MAX;
+    uint32_t valid = 0U;
+
+    for (uint32_t i = 0U; i < zf->sensor_count; i++) {
+        const FusionSensor *s = &zf->sensors[i];
+        if (!s->valid) {
+            continue;
+        }
+        valid++;
+        if (s->temperature > max_t) {
+            max_t = s->temperature;
+        }
+        sum += s->temperature;
+        wsum += (int64_t)s->temperature * s->weight;
+        wtotal += s->weight;
+        int64_t margin = (int64_t)fusion_sensor_critical(s, zone_critical) - s->temperature;
+        if (margin < worst) {
+            worst = margin;
+        }
+    }
+
+    TempMilliC result = zone_critical;
+    if (valid > 0U) {
+        switch (policy) {
+            case FUSION_MAX:
+                result = max_t;
+                break;
+            case FUSION_MEAN:
+                result = fusion_div_round(sum, (int64_t)valid);
+                break;
+            case FUSION_WEIGHTED:
+                result = fusion_div_round(wsum, wtotal);
+                break;
+            default: {
+                int32_t margin_c = fusion_floor_c(worst);
+                if (margin_c < -FUSION_MARGIN_BIAS) {
+                    margin_c = -FUSION_MARGIN_BIAS;
+                } else if (margin_c > (FUSION_MARGIN_BIAS - 1)) {
+                    margin_c = FUSION_MARGIN_BIAS - 1;
+                }
+                result = temp_mc_saturate((int64_t)zone_critical - ((int64_t)margin_c * TEMP_MC_PER_C));
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+// === 示範：一個伺服器區域 ===
+typedef struct {
+    const char *name;
+    TempMilliC critical;
+    uint16_t weight;
+} SensorKind;
+
+static const SensorKind demo_sensors[] = {
+    { "CPU0",  TEMP_MC_FROM_C(95), 4U }, { "CPU1", TEMP_MC_FROM_C(95), 4U },
+    { "DIMM0", TEMP_MC_FROM_C(85), 1U }, { "DIMM1", TEMP_MC_FROM_C(85), 1U },
+    { "DIMM2", TEMP_MC_FROM_C(85), 1U }, { "DIMM3", TEMP_MC_FROM_C(85), 1U },
+    { "VR0",  TEMP_MC_FROM_C(105), 2U }, { "VR1", TEMP_MC_FROM_C(105), 2U },
+    { "INLET", TEMP_MC_FROM_C(40), 1U }
+};
+#define DEMO_SENSOR_COUNT   (sizeof(demo_sensors) / sizeof(demo_sensors[0]))
+
+static void print_fusion(ZoneFusion *zf) {
+    for (uint32_t p = 0U; p < FUSION_POLICY_COUNT; p++) {
+        TempMilliC t = zone_fusion_temperature(zf, (FusionPolicy)p);
+        printf("  %-8s " TEMP_MC_FMT "°C -> 事件 %d%s\n", fusion_policy_names[p], TEMP_MC_ARGS(t),
+               get_temperature_event(t), (t == fusion_rescan(zf, (FusionPolicy)p)) ? "" : " (與重掃不一致!)");
+    }
+}
+
+static void demo(void) {
+    static FusionSensor sensors[DEMO_SENSOR_COUNT];
+    ZoneFusion zf;
+    StateMachine sm;
+    static const TempMilliC readings[DEMO_SENSOR_COUNT] = {
+        72250, 68125, 60500, 61000, 63375, 59750, 80125, 78000, 27500
+    };
+
+    zone_fusion_init(&zf, sensors, DEMO_SENSOR_COUNT);
+    for (uint32_t i = 0U; i < DEMO_SENSOR_COUNT; i++) {
+        zone_fusion_configure(&zf, i, demo_sensors[i].critical, demo_sensors[i].weight);
+        zone_fusion_update(&zf, i, readings[i]);
+    }
+
+    printf("=== 區域感測器融合示範 (%zu 顆感測器) ===\n", DEMO_SENSOR_COUNT);
+    printf("\n--- 正常負載 ---\n");
+    print_fusion(&zf);
+
+    printf("\n--- DIMM2 升到 80.5°C (自己的閾值 85°C) ---\n");
+    zone_fusion_update(&zf, 4U, 80500);
+    print_fusion(&zf);
+
+    printf("\n--- 進風升到 38.2°C (閾值 40°C)，VR1 故障移除 ---\n");
+    zone_fusion_update(&zf, 8U, 38200);
+    zone_fusion_invalidate(&zf, 7U);
+    print_fusion(&zf);
+
+    // 以最差餘裕驅動狀態機
+    printf("\n--- 以最差餘裕驅動風扇狀態機 ---\n");
+    sm_init(&sm);
+    sm_process_event(&sm, EVENT_SYSTEM_INIT);
+    sm.current_temperature = zone_fusion_temperature(&zf, FUSION_WORST_MARGIN);
+    sm_process_event(&sm, zone_fusion_event(&zf, FUSION_WORST_MARGIN));
+    printf("最終狀態: %s, 風扇 %u%%\n", state_configs[sm.current_state].name, sm.current_fan_speed);
+}
+
+// === 效能測試：每次更新的成本 (含查詢全部四種聚合) ===
+#define BENCH_TOTAL_SENSORS     65536U
+#define BENCH_UPDATES           2000000U
+
+static double bench_updates(ZoneFusion *zones, uint32_t zone_count, uint32_t per_zone,
+                            bool incremental, int64_t *checksum) {
+    uint32_t rng = 0xA5A5F00DU;
+    int64_t sink = 0;
+    uint32_t updates = incremental ? BENCH_UPDATES : (BENCH_UPDATES / (1U + (per_zone / 16U)));
+
+    uint64_t start = sm_stats_now_ns();
+    for (uint32_t n = 0U; n < updates; n++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        ZoneFusion *zf = &zones[rng % zone_count];
+        uint32_t idx = (rng >> 16) % per_zone;
+        TempMilliC t = TEMP_MC_FROM_C(40) + (TempMilliC)((rng >> 4) % 50000U);
+
+        zone_fusion_update(zf, idx, t);
+        for (uint32_t p = 0U; p < FUSION_POLICY_COUNT; p++) {
+            sink += incremental ? zone_fusion_temperature(zf, (FusionPolicy)p)
+                                : fusion_rescan(zf, (FusionPolicy)p);
+        }
+    }
+    uint64_t elapsed = sm_stats_now_ns() - start;
+
+    *checksum = sink;
+    return (double)elapsed / updates;
+}
+
+static void bench(void) {
+    static FusionSensor sensors[BENCH_TOTAL_SENSORS];
+    static const uint32_t sizes[] = { 4U, 64U, 1024U };
+
+    printf("\n=== 效能測試：單一感測器更新 + 查詢四種聚合 (共 %u 顆感測器) ===\n",
+           BENCH_TOTAL_SENSORS);
+    printf("每區域感測器   區域數   增量 ns/update   重掃 ns/update   加速比   桶重算/update\n");
+
+    for (uint32_t k = 0U; k < (sizeof(sizes) / sizeof(sizes[0])); k++) {
+        uint32_t per_zone = sizes[k];
+        uint32_t zone_count = BENCH_TOTAL_SENSORS / per_zone;
+        ZoneFusion *zones = calloc(zone_count, sizeof(ZoneFusion));
+        if (zones == NULL) {
+            printf("記憶體配置失敗\n");
+            return;
+        }
+
+        uint32_t rng = 0x1234567U;
+        for (uint32_t z = 0U; z < zone_count; z++) {
+            zone_fusion_init(&zones[z], &sensors[z * per_zone], per_zone);
+            for (uint32_t i = 0U; i < per_zone; i++) {
+                rng ^= rng << 13;
+                rng ^= rng >> 17;
+                rng ^= rng << 5;
+                zone_fusion_configure(&zones[z], i, TEMP_MC_FROM_C(80U + (rng % 30U)),
+                                      (uint16_t)(1U + (rng % 4U)));
+                zone_fusion_update(&zones[z], i,
+                                   TEMP_MC_FROM_C(40) + (TempMilliC)((rng >> 8) % 50000U));
+            }
+        }
+
+        // 先確認兩種方法結果相同
+        bool same = true;
+        for (uint32_t z = 0U; (z < zone_count) && same; z++) {
+            for (uint32_t p = 0U; p < FUSION_POLICY_COUNT; p++) {
+                same = same && (zone_fusion_temperature(&zones[z], (FusionPolicy)p) ==
+                                fusion_rescan(&zones[z], (FusionPolicy)p));
+            }
+        }
+
+        int64_t sum_inc = 0;
+        int64_t sum_scan = 0;
+        uint64_t rescans = 0U;
+        for (uint32_t z = 0U; z < zone_count; z++) {
+            zones[z].max_rescans = 0U;
+        }
+        double inc = bench_updates(zones, zone_count, per_zone, true, &sum_inc);
+        for (uint32_t z = 0U; z < zone_count; z++) {
+            rescans += zones[z].max_rescans;
+        }
+        double scan = bench_updates(zones, zone_count, per_zone, false, &sum_scan);
+        printf("%12u   %6u   %14.2f   %14.2f   %6.1fx   %13.4f%s\n", per_zone, zone_count, inc, scan,
+               scan / inc, (double)rescans / BENCH_UPDATES, same ? "" : "  (結果不一致!)");
+        free(zones);
+    }
+}
+
+int main(void) {
+    demo();
+    bench();
+    return 0;
+}
+
+#endif  // SENSOR_FUSION_NO_MAIN
@@ -0,0 +1,241 @@
+// slope_predictor.c - 溫度變化率預測，提前送出溫度事件
+// get_temperature_event() 只看目前的值：區域已經越過 MAX_TEMPERATURE_CRITICAL_C，
+// 狀態機才開始提高風扇轉速，而散熱有延遲，溫度還會再往上衝一段。
+// 這裡為每個區域維護指數加權線性迴歸 (越新的樣本權重越高)，估計斜率與平滑後的
+// 目前溫度；當 N 個樣本後的預測溫度越過閾值，就提前送出較高等級的事件。
+//
+// 實作重點 (全部整數運算，沿用毫度定點)：
+//   - 樣本等間隔，時間軸以最新樣本為 t=0，舊樣本每次往 -1 平移，
+//     五個加權和都能以「平移 + 衰減」O(1) 更新，不需要保存歷史
+//   - 衰減係數 lambda = 1 - 1/2^shift，乘法換成減去除以 2 的冪次
+//   - 只在溫度上升時提前升級；下降時仍以目前溫度為準，不會提早降低風扇
+
+#ifndef FAN_CONTROL_NO_MAIN
+#define FAN_CONTROL_NO_MAIN
+#endif
+#include "fan_control_state_machine.c"
+
+#define SLOPE_FRAC_BITS             12U     // 權重的定點小數位數
+#define SLOPE_ONE                   ((int64_t)1 << SLOPE_FRAC_BITS)
+#define SLOPE_MIN_SHIFT             2U
+#define SLOPE_MAX_SHIFT             6U      // 有效窗口最多 64 個樣本，保證中間值不溢位
+#define SLOPE_SAMPLE_LIMIT          TEMP_MC_FROM_C(200)     // 感測器合理範圍 ±200°C
+#define SLOPE_MIN_RISE_MC           20      // 每個樣本至少上升 0.02°C 才視為上升趨勢
+
+// === 每個區域的預測器 ===
+typedef struct {
+    int64_t s0;                     // sum(w)
+    int64_t st;                     // sum(w * t)，t <= 0
+    int64_t stt;                    // sum(w * t^2)
+    int64_t sy;                     // sum(w * y)
+    int64_t sty;                    // sum(w * t * y)
+    uint32_t samples;
+    uint32_t min_samples;           // 暖機：樣本不足時不預測
+    uint32_t early_events;          // 預測造成的提前升級次數
+    uint16_t horizon_samples;       // 預測多少個樣本之後
+    uint8_t decay_shift;
+    TempMilliC level;               // 迴歸在 t=0 的值 (平滑後的目前溫度)
+    int32_t slope;                  // 毫度 / 樣本
+} SlopePredictor;
+
+static inline int64_t slope_decay(int64_t value, uint32_t shift) {
+    return value - (value / ((int64_t)1 << shift));
+}
+
+bool slope_predictor_init(SlopePredictor *p, uint8_t decay_shift, uint16_t horizon_samples) {
+    if ((p == NULL) || (decay_shift < SLOPE_MIN_SHIFT) || (decay_shift > SLOPE_MAX_SHIFT)) {
+        return false;
+    }
+
+    memset(p, 0, sizeof(*p));
+    p->decay_shift = decay_shift;
+    p->horizon_samples = horizon_samples;
+    p->min_samples = (1U << decay_shift) / 2U;
+    if (p->min_samples < 3U) {
+        p->min_samples = 3U;
+    }
+
+    return true;
+}
+
+static inline bool slope_predictor_ready(const SlopePredictor *p) {
+    return p->samples >= p->min_samples;
+}
+
+// 加入一個新樣本並重新估計斜率與目前溫度；每個樣本兩次 64-bit 除法
+void slope_predictor_update(SlopePredictor *p, TempMilliC sample) {
+    uint32_t k = p->decay_shift;
+    int64_t y = sample;
+
+    if (y > SLOPE_SAMPLE_LIMIT) {
+        y = SLOPE_SAMPLE_LIMIT;
+    } else if (y < -SLOPE_SAMPLE_LIMIT) {
+        y = -SLOPE_SAMPLE_LIMIT;
+    }
+
+    // 舊樣本平移到 t-1 再衰減，新樣本放在 t=0 (只貢獻 s0 與 sy)
+    int64_t s0 = p->s0;
+    int64_t st = p->st;
+    int64_t sy = p->sy;
+    p->stt = slope_decay(p->stt - (2 * st) + s0, k);
+    p->st = slope_decay(st - s0, k);
+    p->sty = slope_decay(p->sty - sy, k);
+    p->s0 = slope_decay(s0, k) + SLOPE_ONE;
+    p->sy = slope_decay(sy, k) + (y * SLOPE_ONE);
+
+    if (p->samples < UINT32_MAX) {
+        p->samples++;
+    }
+
+    int64_t det = (p->s0 * p->stt) - (p->st * p->st);
+    if (det > 0) {
+        int64_t slope = ((p->s0 * p->sty) - (p->st * p->sy)) / det;
+        p->slope = (int32_t)slope;
+        p->level = temp_mc_saturate((p->sy - (slope * p->st)) / p->s0);
+    } else {
+        p->slope = 0;
+        p->level = (TempMilliC)y;
+    }
+}
+
+// horizon_samples 個樣本之後的預測溫度
+static inline TempMilliC slope_predictor_projected(const SlopePredictor *p) {
+    return temp_mc_saturate((int64_t)p->level + ((int64_t)p->slope * p->horizon_samples));
+}
+
+// 取代 get_temperature_event()：目前溫度的事件與預測溫度的事件取較嚴重者
+// (溫度事件列舉由 NORMAL 到 EXTREME 依嚴重程度遞增)
+SystemEvent predictive_temperature_event(SlopePredictor *p, TempMilliC current) {
+    SystemEvent event = get_temperature_event(current);
+
+    if (slope_predictor_ready(p) && (p->slope >= SLOPE_MIN_RISE_MC)) {
+        SystemEvent early = get_temperature_event(slope_predictor_projected(p));
+        if (early > event) {
+            event = early;
+            p->early_events++;
+        }
+    }
+
+    return event;
+}
+
+#ifndef SLOPE_PREDICTOR_NO_MAIN
+
+// === 示範與單樣本成本 ===
+#define DEMO_SHIFT              4U      // 有效窗口約 16 個樣本
+#define DEMO_HORIZON            30U     // 預測 30 秒後 (每秒一個樣本)
+#define BENCH_SAMPLES           4000000U
+#define BENCH_ROUNDS            5U
+
+static inline int32_t demo_noise(uint32_t *rng, int32_t amplitude_mc) {
+    *rng ^= *rng << 13;
+    *rng ^= *rng >> 17;
+    *rng ^= *rng << 5;
+    return (int32_t)(*rng % (uint32_t)((2 * amplitude_mc) + 1)) - amplitude_mc;
+}
+
+// 60°C 起每秒上升 0.25°C (含 ±0.3°C 雜訊)，比較兩種做法第一次送出各等級事件的時間
+static void demo_ramp(void) {
+    SlopePredictor p;
+    uint32_t rng = 0x1234ABCDU;
+    int32_t reactive_first[EVENT_COUNT];
+    int32_t predictive_first[EVENT_COUNT];
+
+    for (uint32_t e = 0U; e < EVENT_COUNT; e++) {
+        reactive_first[e] = -1;
+        predictive_first[e] = -1;
+    }
+    (void)slope_predictor_init(&p, DEMO_SHIFT, DEMO_HORIZON);
+
+    printf("--- 線性升溫 0.25°C/s，預測 %u 秒後 ---\n", DEMO_HORIZON);
+    for (int32_t second = 0; second < 160; second++) {
+        TempMilliC truth = TEMP_MC_FROM_C(60) + (second * 250);
+        TempMilliC reading = truth + demo_noise(&rng, 300);
+        slope_predictor_update(&p, reading);
+
+        SystemEvent reactive = get_temperature_event(reading);
+        SystemEvent predictive = predictive_temperature_event(&p, reading);
+        if (reactive_first[reactive] < 0) {
+            reactive_first[reactive] = second;
+        }
+        if (predictive_first[predictive] < 0) {
+            predictive_first[predictive] = second;
+        }
+        if ((second % 40) == 20) {
+            TempMilliC projected = slope_predictor_projected(&p);
+            printf("t=%3ds 讀值 " TEMP_MC_FMT "°C 平滑 " TEMP_MC_FMT "°C 斜率 %d m°C/s 預測 " TEMP_MC_FMT "°C\n",
+                   second, TEMP_MC_ARGS(reading), TEMP_MC_ARGS(p.level), p.slope,
+                   TEMP_MC_ARGS(projected));
+        }
+    }
+
+    static const char *const labels[] = { "WARNING", "CRITICAL", "EXTREME" };
+    for (uint32_t e = EVENT_TEMP_WARNING; e <= EVENT_TEMP_EXTREME; e++) {
+        printf("第一次 %-8s 事件: 目前值 t=%3ds, 預測 t=%3ds\n", labels[e - EVENT_TEMP_WARNING],
+               reactive_first[e], predictive_first[e]);
+    }
+}
+
+static TempMilliC bench_samples[BENCH_SAMPLES];
+
+static double bench_loop(bool predictive, uint32_t *sink) {
+    double best = 1e30;
+
+    for (uint32_t round = 0U; round < BENCH_ROUNDS; round++) {
+        SlopePredictor p;
+        uint32_t acc = 0U;
+        (void)slope_predictor_init(&p, DEMO_SHIFT, DEMO_HORIZON);
+
+        uint64_t start = sm_stats_now_ns();
+        if (predictive) {
+            for (uint32_t i = 0U; i < BENCH_SAMPLES; i++) {
+                slope_predictor_update(&p, bench_samples[i]);
+                acc += (uint32_t)predictive_temperature_event(&p, bench_samples[i]);
+            }
+        } else {
+            for (uint32_t i = 0U; i < BENCH_SAMPLES; i++) {
+                acc += (uint32_t)get_temperature_event(bench_samples[i]);
+            }
+        }
+        double ns = (double)(sm_stats_now_ns() - start) / BENCH_SAMPLES;
+
+        if (ns < best) {
+            best = ns;
+        }
+        *sink += acc;
+    }
+
+    return best;
+}
+
+int main(void) {
+    uint32_t rng = 0xBADC0DEU;
+    uint32_t sink = 0U;
+    TempMilliC t = TEMP_MC_FROM_C(60);
+
+    printf("=== 溫度變化率預測 (指數加權線性迴歸) ===\n");
+    demo_ramp();
+
+    // 隨機漫步 40-99°C
+    for (uint32_t i = 0U; i < BENCH_SAMPLES; i++) {
+        t += demo_noise(&rng, 600);
+        if (t < TEMP_MC_FROM_C(40)) {
+            t = TEMP_MC_FROM_C(40);
+        } else if (t > TEMP_MC_FROM_C(99)) {
+            t = TEMP_MC_FROM_C(99);
+        }
+        bench_samples[i] = t;
+    }
+
+    double plain_ns = bench_loop(false, &sink);
+    double predict_ns = bench_loop(true, &sink);
+    printf("\n--- 單樣本成本 (%u 樣本 x %u 輪，取最快) ---\n", BENCH_SAMPLES, BENCH_ROUNDS);
+    printf("get_temperature_event():          %6.2f ns/sample\n", plain_ns);
+    printf("slope_predictor_update() + 預測事件: %6.2f ns/sample (額外 %.2f ns)\n",
+           predict_ns, predict_ns - plain_ns);
+    printf("(校驗值 %u)\n", sink);
+
+    return 0;
+}
+
+#endif  // SLOPE_PREDICTOR_NO_MAIN
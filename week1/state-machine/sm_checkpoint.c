@@ -0,0 +1,451 @@
+// sm_checkpoint.c - 控制器狀態檢查點與快速重啟
+// 守護程序重新啟動時，每個 StateMachine 原本都經由 sm_init() 回到 IDLE、風扇 0%，
+// 再靠後續的事件一路轉換回原本的狀態：期間風扇轉速不足，而且
+//   - EMERGENCY_COOLING 的遲滯 (降到危急溫度仍維持全速) 會遺失
+//   - SHUTDOWN 的區域會被重新啟動
+// 檢查點把所有區域寫成一個有版本與 CRC 的小檔案 (每區域 16 bytes)，
+// 重啟時 mmap 讀回、整批驗證後直接套用，不執行任何中間狀態的 enter 回調，
+// 每個區域只寫一次風扇速度。
+//
+// 用法: sm_checkpoint [區域數] [檢查點路徑]
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SM_QUIET
+#define FAN_CONTROL_NO_MAIN
+#include "fan_control_state_machine.c"
+#include "sm_checkpoint.h"
+
+typedef enum {
+    SM_CHECKPOINT_OK,
+    SM_CHECKPOINT_MISSING,       // 檔案不存在或無法讀取
+    SM_CHECKPOINT_CORRUPT,       // magic/版本/大小/CRC/欄位範圍錯誤
+    SM_CHECKPOINT_MISMATCH,      // 區域數與目前設定不同
+    SM_CHECKPOINT_STALE          // 超過允許的存在時間
+} SmCheckpointResult;
+
+static const char *const sm_checkpoint_result_names[] = {
+    "OK", "MISSING", "CORRUPT", "MISMATCH", "STALE"
+};
+
+// === 寫入 ===
+static bool checkpoint_write_all(int fd, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    bool ok = true;
+
+    while ((len > 0U) && ok) {
+        ssize_t n = write(fd, p, len);
+        if (n > 0) {
+            p += n;
+            len -= (size_t)n;
+        } else if ((n < 0) && (errno == EINTR)) {
+            continue;
+        } else {
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+static void checkpoint_encode_zone(const StateMachine *sm, SmCheckpointZone *rec) {
+    rec->state = (uint8_t)sm->current_state;
+    rec->previous_state = (uint8_t)sm->previous_state;
+    rec->fan_speed = sm->current_fan_speed;
+    rec->flags = sm->emergency_cooling_active ? SM_CHECKPOINT_FLAG_EMERGENCY : 0U;
+    rec->temperature = sm->current_temperature;
+    rec->state_transitions = sm->state_transitions;
+    rec->events_processed = sm->events_processed;
+}
+
+// 寫到暫存檔、fsync、rename 取代舊檔：任何時間點當機都只會看到完整的舊檔或新檔
+bool sm_checkpoint_save(const char *path, const StateMachine *zones, uint32_t count,
+                        uint64_t generation) {
+    char tmp_path[PATH_MAX];
+    char dir_path[PATH_MAX];
+    size_t payload_size = (size_t)count * sizeof(SmCheckpointZone);
+    bool ok = false;
+
+    if ((count == 0U) || (count > SM_CHECKPOINT_MAX_ZONES) ||
+        (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path))) {
+        return false;
+    }
+
+    SmCheckpointZone *records = malloc(payload_size);
+    if (records == NULL) {
+        return false;
+    }
+    for (uint32_t i = 0U; i < count; i++) {
+        checkpoint_encode_zone(&zones[i], &records[i]);
+    }
+
+    SmCheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SM_CHECKPOINT_MAGIC;
+    header.version = SM_CHECKPOINT_VERSION;
+    header.header_size = (uint16_t)sizeof(SmCheckpointHeader);
+    header.zone_count = count;
+    header.record_size = (uint32_t)sizeof(SmCheckpointZone);
+    header.generation = generation;
+    header.saved_time = (uint64_t)time(NULL);
+    header.payload_crc = sm_checkpoint_crc32(records, payload_size);
+    header.header_crc = sm_checkpoint_header_crc(&header);
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd >= 0) {
+        ok = checkpoint_write_all(fd, &header, sizeof(header)) &&
+             checkpoint_write_all(fd, records, payload_size) &&
+             (fsync(fd) == 0);
+        ok = (close(fd) == 0) && ok;
+        ok = ok && (rename(tmp_path, path) == 0);
+        if (!ok) {
+            (void)unlink(tmp_path);
+        }
+    }
+    free(records);
+
+    // rename 本身也要落到磁碟
+    if (ok && (snprintf(dir_path, sizeof(dir_path), "%s", path) < (int)sizeof(dir_path))) {
+        int dir_fd = open(dirname(dir_path), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dir_fd >= 0) {
+            (void)fsync(dir_fd);
+            (void)close(dir_fd);
+        }
+    }
+
+    return ok;
+}
+
+// === 讀回 ===
+static bool checkpoint_zone_valid(const SmCheckpointZone *rec) {
+    return (rec->state < STATE_COUNT) && (rec->previous_state < STATE_COUNT) &&
+           (rec->fan_speed <= FAN_SPEED_MAX_PERCENT) &&
+           ((rec->flags & (uint8_t)~SM_CHECKPOINT_FLAG_EMERGENCY) == 0U);
+}
+
+// 直接套用到已經 sm_init() 過的區域：不經過轉換，不執行 on_enter/on_exit，
+// 只透過動作回調寫一次風扇速度，讓硬體與狀態一致
+static void checkpoint_apply_zone(StateMachine *sm, const SmCheckpointZone *rec, uint32_t now) {
+    sm->current_state = (SystemState)rec->state;
+    sm->previous_state = (SystemState)rec->previous_state;
+    sm->current_temperature = rec->temperature;
+    sm->emergency_cooling_active = (rec->flags & SM_CHECKPOINT_FLAG_EMERGENCY) != 0U;
+    sm->state_transitions = rec->state_transitions;
+    sm->events_processed = rec->events_processed;
+    sm->state_entry_time = now;
+    sm->set_fan_speed(sm, rec->fan_speed);
+}
+
+// zones 必須已經由 sm_init() 初始化 (回調與轉換表)。
+// 先驗證整個檔案再套用，失敗時 zones 完全不變，呼叫端退回冷啟動。
+// max_age_s 為 0 表示不檢查存在時間；generation 可為 NULL。
+SmCheckpointResult sm_checkpoint_restore(const char *path, StateMachine *zones, uint32_t count,
+                                         uint32_t max_age_s, uint64_t *generation) {
+    SmCheckpointResult result = SM_CHECKPOINT_OK;
+    struct stat st;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return SM_CHECKPOINT_MISSING;
+    }
+    if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(SmCheckpointHeader))) {
+        (void)close(fd);
+        return SM_CHECKPOINT_CORRUPT;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    (void)close(fd);
+    if (map == MAP_FAILED) {
+        return SM_CHECKPOINT_MISSING;
+    }
+
+    const SmCheckpointHeader *header = (const SmCheckpointHeader *)map;
+    const SmCheckpointZone *records =
+        (const SmCheckpointZone *)((const uint8_t *)map + sizeof(SmCheckpointHeader));
+    uint64_t now = (uint64_t)time(NULL);
+
+    if ((header->magic != SM_CHECKPOINT_MAGIC) || (header->version != SM_CHECKPOINT_VERSION) ||
+        (header->header_size != sizeof(SmCheckpointHeader)) ||
+        (header->record_size != sizeof(SmCheckpointZone)) ||
+        (header->header_crc != sm_checkpoint_header_crc(header)) ||
+        (header->zone_count > SM_CHECKPOINT_MAX_ZONES) ||
+        (size != (sizeof(SmCheckpointHeader) + ((size_t)header->zone_count * sizeof(SmCheckpointZone))))) {
+        result = SM_CHECKPOINT_CORRUPT;
+    } else if (header->zone_count != count) {
+        result = SM_CHECKPOINT_MISMATCH;
+    } else if ((max_age_s != 0U) &&
+               ((header->saved_time > now) || ((now - header->saved_time) > max_age_s))) {
+        result = SM_CHECKPOINT_STALE;
+    } else if (header->payload_crc !=
+               sm_checkpoint_crc32(records, (size_t)count * sizeof(SmCheckpointZone))) {
+        result = SM_CHECKPOINT_CORRUPT;
+    } else {
+        for (uint32_t i = 0U; (i < count) && (result == SM_CHECKPOINT_OK); i++) {
+            if (!checkpoint_zone_valid(&records[i])) {
+                result = SM_CHECKPOINT_CORRUPT;
+            }
+        }
+    }
+
+    if (result == SM_CHECKPOINT_OK) {
+        for (uint32_t i = 0U; i < count; i++) {
+            checkpoint_apply_zone(&zones[i], &records[i], (uint32_t)now);
+        }
+        if (generation != NULL) {
+            *generation = header->generation;
+        }
+    }
+
+    (void)munmap(map, size);
+    return result;
+}
+
+#ifndef SM_CHECKPOINT_NO_MAIN
+
+// === 重啟測試 ===
+#define DEFAULT_ZONES           10000U
+#define DEFAULT_PATH            "/tmp/bmc_fan_checkpoint.bin"
+#define HISTORY_READINGS        12U
+#define BENCH_ROUNDS            5U
+#define CHECKPOINT_MAX_AGE_S    300U
+
+// 計算風扇 PWM 寫入次數 (實際硬體上每次都是一次 hwmon/I2C 寫入)
+static uint64_t fan_writes;
+
+static void counting_set_fan_speed(StateMachine *sm, uint8_t speed_percent) {
+    sm->current_fan_speed = speed_percent;
+    fan_writes++;
+}
+
+static void init_zones(StateMachine *zones, uint32_t count) {
+    for (uint32_t i = 0U; i < count; i++) {
+        sm_init(&zones[i]);
+        zones[i].set_fan_speed = counting_set_fan_speed;
+    }
+}
+
+// 重啟前的運轉狀態：每個區域經歷一段隨機溫度歷史，少數冷卻失敗而關機
+static void run_history(StateMachine *zones, uint32_t count) {
+    uint32_t rng = 0xC0FFEE11U;
+
+    init_zones(zones, count);
+    for (uint32_t i = 0U; i < count; i++) {
+        StateMachine *sm = &zones[i];
+        TempMilliC temp = TEMP_MC_FROM_C(40);
+
+        sm_process_event(sm, EVENT_SYSTEM_INIT);
+        for (uint32_t r = 0U; r < HISTORY_READINGS; r++) {
+            rng ^= rng << 13;
+            rng ^= rng >> 17;
+            rng ^= rng << 5;
+            temp = temp_mc_add_sat(temp, (TempMilliC)(rng % 13001U) - 4500);
+            if (temp > TEMP_MC_FROM_C(99)) {
+                temp = TEMP_MC_FROM_C(99);
+            }
+            sm->current_temperature = temp;
+            sm_process_event(sm, get_temperature_event(temp));
+        }
+        if ((sm->current_state == STATE_EMERGENCY_COOLING) && ((rng % 8U) == 0U)) {
+            sm_process_event(sm, EVENT_COOLING_FAILURE);
+        }
+    }
+}
+
+typedef struct {
+    double cpu_ms;
+    uint32_t control_cycles;     // 達到最終狀態前經過的控制週期
+    uint64_t fan_writes;
+    uint32_t undercooled;        // 啟動期間風扇低於重啟前轉速的區域
+    uint32_t state_mismatch;     // 最終狀態與重啟前不同
+    uint32_t fan_mismatch;
+} RestartResult;
+
+static void compare_zones(const StateMachine *zones, const StateMachine *before, uint32_t count,
+                          RestartResult *result) {
+    for (uint32_t i = 0U; i < count; i++) {
+        if (zones[i].current_state != before[i].current_state) {
+            result->state_mismatch++;
+        }
+        if (zones[i].current_fan_speed != before[i].current_fan_speed) {
+            result->fan_mismatch++;
+        }
+    }
+}
+
+// 冷啟動：第 1 個週期 SYSTEM_INIT (IDLE -> NORMAL)，第 2 個週期讀溫度後轉到目標狀態
+static RestartResult cold_start(StateMachine *zones, const StateMachine *before, uint32_t count) {
+    RestartResult result = { .cpu_ms = 1e30, .control_cycles = 2U };
+
+    for (uint32_t round = 0U; round < BENCH_ROUNDS; round++) {
+        uint32_t undercooled = 0U;
+        fan_writes = 0U;
+
+        uint64_t start = sm_stats_now_ns();
+        init_zones(zones, count);
+        for (uint32_t i = 0U; i < count; i++) {
+            sm_process_event(&zones[i], EVENT_SYSTEM_INIT);
+            if (zones[i].current_fan_speed < before[i].current_fan_speed) {
+                undercooled++;
+            }
+        }
+        for (uint32_t i = 0U; i < count; i++) {
+            zones[i].current_temperature = before[i].current_temperature;
+            sm_process_event(&zones[i], get_temperature_event(zones[i].current_temperature));
+        }
+        double ms = (double)(sm_stats_now_ns() - start) / 1e6;
+
+        if (ms < result.cpu_ms) {
+            result.cpu_ms = ms;
+        }
+        result.fan_writes = fan_writes;
+        result.undercooled = undercooled;
+    }
+    compare_zones(zones, before, count, &result);
+
+    return result;
+}
+
+static RestartResult checkpoint_start(StateMachine *zones, const StateMachine *before,
+                                      uint32_t count, const char *path, bool *ok) {
+    RestartResult result = { .cpu_ms = 1e30, .control_cycles = 0U };
+
+    *ok = true;
+    for (uint32_t round = 0U; round < BENCH_ROUNDS; round++) {
+        fan_writes = 0U;
+
+        uint64_t start = sm_stats_now_ns();
+        init_zones(zones, count);
+        SmCheckpointResult rc = sm_checkpoint_restore(path, zones, count, CHECKPOINT_MAX_AGE_S, NULL);
+        double ms = (double)(sm_stats_now_ns() - start) / 1e6;
+
+        if (rc != SM_CHECKPOINT_OK) {
+            printf("檢查點讀回失敗: %s\n", sm_checkpoint_result_names[rc]);
+            *ok = false;
+        }
+        if (ms < result.cpu_ms) {
+            result.cpu_ms = ms;
+        }
+        result.fan_writes = fan_writes;
+    }
+    compare_zones(zones, before, count, &result);
+
+    return result;
+}
+
+static void print_result(const char *label, const RestartResult *r) {
+    double steady_ms = r->cpu_ms;
+    if (r->control_cycles > 1U) {
+        steady_ms += (double)(r->control_cycles - 1U) * TEMPERATURE_CHECK_INTERVAL;
+    }
+    printf("%-8s CPU %8.3f ms  週期 %u  至穩態 %8.1f ms  風扇寫入 %7lu  轉速不足 %5u  狀態不同 %4u  轉速不同 %4u\n",
+           label, r->cpu_ms, r->control_cycles, steady_ms, (unsigned long)r->fan_writes,
+           r->undercooled, r->state_mismatch, r->fan_mismatch);
+}
+
+// 損壞的檔案必須被拒絕，而且不能改動任何區域
+static bool check_corruption(const char *path, StateMachine *zones, uint32_t count) {
+    bool ok = true;
+    uint8_t byte = 0U;
+    off_t offset = (off_t)(sizeof(SmCheckpointHeader) + (count / 2U) * sizeof(SmCheckpointZone) + 4U);
+
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    ok = (fd >= 0) && (pread(fd, &byte, 1U, offset) == 1);
+    byte ^= 0x40U;
+    ok = ok && (pwrite(fd, &byte, 1U, offset) == 1);
+
+    init_zones(zones, count);
+    SmCheckpointResult corrupt = sm_checkpoint_restore(path, zones, count, 0U, NULL);
+    SmCheckpointResult mismatch = sm_checkpoint_restore(path, zones, count - 1U, 0U, NULL);
+    for (uint32_t i = 0U; i < count; i++) {
+        ok = ok && (zones[i].current_state == STATE_IDLE);
+    }
+
+    byte ^= 0x40U;
+    ok = ok && (pwrite(fd, &byte, 1U, offset) == 1);
+    if (fd >= 0) {
+        (void)close(fd);
+    }
+
+    printf("翻轉 1 bit: %s, 區域數不符: %s, 區域未被改動: %s\n",
+           sm_checkpoint_result_names[corrupt], sm_checkpoint_result_names[mismatch],
+           ok ? "是" : "否!");
+
+    return ok && (corrupt == SM_CHECKPOINT_CORRUPT) && (mismatch != SM_CHECKPOINT_OK);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t count = DEFAULT_ZONES;
+    const char *path = DEFAULT_PATH;
+    bool ok = true;
+
+    if (argc > 1) {
+        count = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        path = argv[2];
+    }
+    if ((count < 2U) || (count > SM_CHECKPOINT_MAX_ZONES)) {
+        printf("區域數必須介於 2 與 %u 之間\n", SM_CHECKPOINT_MAX_ZONES);
+        return 1;
+    }
+
+    StateMachine *before = calloc(count, sizeof(StateMachine));
+    StateMachine *zones = calloc(count, sizeof(StateMachine));
+    if ((before == NULL) || (zones == NULL)) {
+        printf("記憶體配置失敗\n");
+        free(before);
+        free(zones);
+        return 1;
+    }
+
+    printf("=== 控制器檢查點與快速重啟 (%u 區域) ===\n", count);
+    run_history(before, count);
+
+    uint32_t per_state[STATE_COUNT] = { 0U };
+    for (uint32_t i = 0U; i < count; i++) {
+        per_state[before[i].current_state]++;
+    }
+    printf("重啟前狀態分佈:");
+    for (uint32_t s = 0U; s < STATE_COUNT; s++) {
+        printf(" %s=%u", state_configs[s].name, per_state[s]);
+    }
+    printf("\n");
+
+    uint64_t start = sm_stats_now_ns();
+    if (!sm_checkpoint_save(path, before, count, 1U)) {
+        printf("檢查點寫入失敗: %s\n", path);
+        free(before);
+        free(zones);
+        return 1;
+    }
+    printf("寫入 %s: %zu bytes, %.3f ms (含 fsync)\n", path,
+           sizeof(SmCheckpointHeader) + ((size_t)count * sizeof(SmCheckpointZone)),
+           (double)(sm_stats_now_ns() - start) / 1e6);
+
+    printf("\n--- 重啟至穩態 (控制週期 %d ms，CPU 時間取 %u 輪最快，檔案在頁快取中) ---\n",
+           TEMPERATURE_CHECK_INTERVAL, BENCH_ROUNDS);
+    RestartResult cold = cold_start(zones, before, count);
+    print_result("冷啟動", &cold);
+    RestartResult warm = checkpoint_start(zones, before, count, path, &ok);
+    print_result("檢查點", &warm);
+    ok = ok && (warm.state_mismatch == 0U) && (warm.fan_mismatch == 0U);
+
+    printf("\n--- 損壞偵測 ---\n");
+    ok = check_corruption(path, zones, count) && ok;
+
+    printf("\n結果: %s\n", ok ? "檢查點完整還原所有區域" : "失敗!");
+
+    free(before);
+    free(zones);
+    return ok ? 0 : 1;
+}
+
+#endif  // SM_CHECKPOINT_NO_MAIN
@@ -0,0 +1,83 @@
+// sm_checkpoint.h - 風扇控制器狀態檢查點檔案格式
+// 守護程序定期把每個區域的狀態、溫度、風扇速度與計數器寫成一個檔案；
+// 重新啟動時以 mmap 讀回，直接回到原本的狀態，不必從 IDLE 重新爬升。
+//
+// 檔案配置 (主機位元組順序，只給同一台 BMC 使用)：
+//   SmCheckpointHeader
+//   SmCheckpointZone[zone_count]
+// header_crc 保護標頭，payload_crc 保護所有區域記錄 (CRC-32/IEEE)。
+
+#ifndef SM_CHECKPOINT_H
+#define SM_CHECKPOINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../common/fixed_point_temp.h"
+
+#define SM_CHECKPOINT_MAGIC         0x4B434E46U  // "FNCK"
+#define SM_CHECKPOINT_VERSION       1U
+#define SM_CHECKPOINT_MAX_ZONES     (1U << 20)
+
+#define SM_CHECKPOINT_FLAG_EMERGENCY    0x01U   // emergency_cooling_active
+
+// 單一區域 16 bytes；欄位順序固定，新增欄位必須遞增版本
+typedef struct {
+    uint8_t state;
+    uint8_t previous_state;
+    uint8_t fan_speed;
+    uint8_t flags;
+    TempMilliC temperature;      // 毫度 (0.001°C)
+    uint32_t state_transitions;
+    uint32_t events_processed;
+} SmCheckpointZone;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t zone_count;
+    uint32_t record_size;
+    uint64_t generation;         // 每次寫入遞增
+    uint64_t saved_time;         // CLOCK_REALTIME 秒，用來判斷檢查點是否過期
+    uint32_t payload_crc;
+    uint32_t header_crc;         // 涵蓋 header_crc 之前的所有欄位
+} SmCheckpointHeader;
+
+_Static_assert(sizeof(SmCheckpointZone) == 16U, "檢查點區域記錄大小改變，請遞增版本");
+_Static_assert(sizeof(SmCheckpointHeader) == 40U, "檢查點標頭大小改變，請遞增版本");
+
+// === CRC-32 (IEEE 802.3，反射多項式 0xEDB88320) ===
+static uint32_t sm_checkpoint_crc_table[256];
+static int sm_checkpoint_crc_ready;
+
+static inline void sm_checkpoint_crc_init(void) {
+    for (uint32_t i = 0U; i < 256U; i++) {
+        uint32_t c = i;
+        for (uint32_t bit = 0U; bit < 8U; bit++) {
+            c = ((c & 1U) != 0U) ? (0xEDB88320U ^ (c >> 1)) : (c >> 1);
+        }
+        sm_checkpoint_crc_table[i] = c;
+    }
+    sm_checkpoint_crc_ready = 1;
+}
+
+static inline uint32_t sm_checkpoint_crc32(const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t crc = 0xFFFFFFFFU;
+
+    if (sm_checkpoint_crc_ready == 0) {
+        sm_checkpoint_crc_init();
+    }
+    for (size_t i = 0U; i < len; i++) {
+        crc = sm_checkpoint_crc_table[(crc ^ p[i]) & 0xFFU] ^ (crc >> 8);
+    }
+
+    return crc ^ 0xFFFFFFFFU;
+}
+
+static inline uint32_t sm_checkpoint_header_crc(const SmCheckpointHeader *header) {
+    return sm_checkpoint_crc32(header, offsetof(SmCheckpointHeader, header_crc));
+}
+
+#endif  // SM_CHECKPOINT_H
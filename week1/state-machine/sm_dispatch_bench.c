@@ -0,0 +1,197 @@
+// sm_dispatch_bench.c - 階層狀態機 (展開轉換表) vs 原本的平面狀態機
+// 原本每個狀態的處理器各自重複一份溫度 switch；改成 THERMAL_MONITORING 父狀態後，
+// 初始化時把階層展開成 [狀態][事件] 轉換表。這裡驗證：
+//   1. 展開結果與原本平面處理器在所有 (狀態, 事件) 組合上完全一致
+//   2. 執行期分派不比原本的函數指標 + switch 慢
+
+#define _GNU_SOURCE
+#define SM_QUIET
+#define FAN_CONTROL_NO_MAIN
+#include "fan_control_state_machine.c"
+
+#define BENCH_EVENTS        4000000U
+#define BENCH_ROUNDS        5U
+
+// === 原本的平面處理器 (改成階層前的版本，作為對照) ===
+static SystemState legacy_idle_event(SystemEvent event) {
+    switch (event) {
+        case EVENT_SYSTEM_INIT: return STATE_NORMAL;
+        case EVENT_TEMP_NORMAL: return STATE_NORMAL;
+        default: return STATE_IDLE;
+    }
+}
+
+static SystemState legacy_normal_event(SystemEvent event) {
+    switch (event) {
+        case EVENT_TEMP_WARNING: return STATE_WARNING;
+        case EVENT_TEMP_CRITICAL: return STATE_CRITICAL;
+        case EVENT_TEMP_EXTREME: return STATE_EMERGENCY_COOLING;
+        default: return STATE_NORMAL;
+    }
+}
+
+static SystemState legacy_warning_event(SystemEvent event) {
+    switch (event) {
+        case EVENT_TEMP_NORMAL: return STATE_NORMAL;
+        case EVENT_TEMP_CRITICAL: return STATE_CRITICAL;
+        case EVENT_TEMP_EXTREME: return STATE_EMERGENCY_COOLING;
+        case EVENT_COOLING_SUCCESS: return STATE_NORMAL;
+        default: return STATE_WARNING;
+    }
+}
+
+static SystemState legacy_critical_event(SystemEvent event) {
+    switch (event) {
+        case EVENT_TEMP_NORMAL: return STATE_NORMAL;
+        case EVENT_TEMP_WARNING: return STATE_WARNING;
+        case EVENT_TEMP_EXTREME: return STATE_EMERGENCY_COOLING;
+        case EVENT_COOLING_SUCCESS: return STATE_WARNING;
+        default: return STATE_CRITICAL;
+    }
+}
+
+static SystemState legacy_emergency_event(SystemEvent event) {
+    switch (event) {
+        case EVENT_COOLING_SUCCESS: return STATE_WARNING;
+        case EVENT_COOLING_FAILURE: return STATE_SHUTDOWN;
+        case EVENT_TEMP_NORMAL: return STATE_NORMAL;
+        case EVENT_TEMP_WARNING: return STATE_WARNING;
+        default: return STATE_EMERGENCY_COOLING;
+    }
+}
+
+static SystemState legacy_shutdown_event(SystemEvent event) {
+    return (event == EVENT_SYSTEM_INIT) ? STATE_IDLE : STATE_SHUTDOWN;
+}
+
+typedef SystemState (*LegacyHandler)(SystemEvent event);
+
+static const LegacyHandler legacy_handlers[STATE_COUNT] = {
+    [STATE_IDLE] = legacy_idle_event,
+    [STATE_NORMAL] = legacy_normal_event,
+    [STATE_WARNING] = legacy_warning_event,
+    [STATE_CRITICAL] = legacy_critical_event,
+    [STATE_EMERGENCY_COOLING] = legacy_emergency_event,
+    [STATE_SHUTDOWN] = legacy_shutdown_event
+};
+
+// 與原本 sm_process_event() 相同的結構：經由函數指標呼叫處理器
+static void legacy_process_event(StateMachine *sm, SystemEvent event) {
+    if (event >= EVENT_COUNT) {
+        return;
+    }
+    sm->events_processed++;
+    SystemState new_state = legacy_handlers[sm->current_state](event);
+    if (new_state != sm->current_state) {
+        sm_transition(sm, new_state);
+    }
+}
+
+// === 測試 ===
+static SystemEvent event_stream[BENCH_EVENTS];
+
+static bool verify_equivalence(void) {
+    uint32_t mismatches = 0U;
+
+    for (uint32_t s = 0U; s < STATE_COUNT; s++) {
+        for (uint32_t e = 0U; e < EVENT_COUNT; e++) {
+            SystemState flat = legacy_handlers[s]((SystemEvent)e);
+            SystemState hier = fan_sm_dispatch_table[s][e];
+            if (flat != hier) {
+                printf("  不一致: %s + 事件 %u -> 平面 %s, 階層 %s\n",
+                       state_configs[s].name, e,
+                       state_configs[flat].name, state_configs[hier].name);
+                mismatches++;
+            }
+        }
+    }
+
+    return mismatches == 0U;
+}
+
+// steady 為 true 時只產生不會離開 NORMAL 的事件，只量測分派本身
+static void build_event_stream(bool steady) {
+    uint32_t rng = 0xC0FFEE11U;
+
+    for (uint32_t i = 0U; i < BENCH_EVENTS; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        // 大部分是溫度事件，偶爾穿插冷卻結果；不送 SYSTEM_INIT 避免一直重來
+        uint32_t r = rng % 100U;
+        if (steady) {
+            event_stream[i] = (r < 50U) ? EVENT_TEMP_NORMAL : EVENT_COOLING_FAILURE;
+        } else if (r < 2U) {
+            event_stream[i] = EVENT_COOLING_SUCCESS;
+        } else if (r < 3U) {
+            event_stream[i] = EVENT_COOLING_FAILURE;
+        } else {
+            event_stream[i] = get_temperature_event(TEMP_MC_FROM_C(40) + (TempMilliC)((rng >> 8) % 60000U));
+        }
+    }
+}
+
+typedef void (*ProcessFn)(StateMachine *sm, SystemEvent event);
+
+static double run_full(ProcessFn process, uint32_t *checksum) {
+    double best = 1e30;
+
+    for (uint32_t round = 0U; round < BENCH_ROUNDS; round++) {
+        StateMachine sm;
+        sm_init(&sm);
+        process(&sm, EVENT_SYSTEM_INIT);
+
+        uint64_t start = sm_stats_now_ns();
+        for (uint32_t i = 0U; i < BENCH_EVENTS; i++) {
+            process(&sm, event_stream[i]);
+            // 關機後重新初始化，讓事件流持續驅動轉換
+            if (sm.current_state == STATE_SHUTDOWN) {
+                process(&sm, EVENT_SYSTEM_INIT);
+                process(&sm, EVENT_SYSTEM_INIT);
+            }
+        }
+        uint64_t elapsed = sm_stats_now_ns() - start;
+
+        double per_event = (double)elapsed / BENCH_EVENTS;
+        if (per_event < best) {
+            best = per_event;
+        }
+        *checksum = sm.state_transitions;
+    }
+
+    return best;
+}
+
+int main(void) {
+    StateMachine init_sm;
+    sm_init(&init_sm);  // 觸發轉換表展開
+
+    printf("=== 階層狀態機：展開轉換表驗證與分派效能 ===\n");
+    bool ok = verify_equivalence();
+    printf("與平面處理器逐格比對 (%u 狀態 x %u 事件): %s\n",
+           (unsigned)STATE_COUNT, (unsigned)EVENT_COUNT, ok ? "完全一致" : "不一致!");
+
+    static const struct {
+        const char *label;
+        bool steady;
+    } cases[] = {
+        { "只分派 (不轉換)", true },
+        { "含轉換與 enter/exit 回調", false }
+    };
+
+    for (uint32_t c = 0U; c < (sizeof(cases) / sizeof(cases[0])); c++) {
+        uint32_t flat_transitions = 0U;
+        uint32_t hier_transitions = 0U;
+
+        build_event_stream(cases[c].steady);
+        double flat = run_full(legacy_process_event, &flat_transitions);
+        double hier = run_full(sm_process_event, &hier_transitions);
+
+        printf("\n%s：%u 事件 x %u 輪 (取最快)\n", cases[c].label, BENCH_EVENTS, BENCH_ROUNDS);
+        printf("  平面 (函數指標 + switch): %7.2f ns/event  轉換 %u 次\n", flat, flat_transitions);
+        printf("  階層 (展開轉換表):        %7.2f ns/event  轉換 %u 次\n", hier, hier_transitions);
+        printf("  差異: %+.2f ns/event (%+.1f%%)\n", hier - flat, (100.0 * (hier - flat)) / flat);
+    }
+
+    return ok ? 0 : 1;
+}
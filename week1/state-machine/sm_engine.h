@@ -0,0 +1,88 @@
+// sm_engine.h - 通用狀態機引擎 (巨集產生、可完全內聯)
+// 把 fan_control_state_machine.c 的 enter/exit/handler 模型抽出來，
+// 以狀態列舉、事件列舉與 context 類型為參數，為每台狀態機產生專用的 static inline 函數。
+// 沒有 void* 與執行期類型判斷，編譯器看得到整條分派路徑，結果與手寫版本相同。
+//
+// 用法 (P 為名稱前綴)：
+//   SM_ENGINE_DECLARE(P, StateT, EventT, CtxT)
+//       產生 P_StateConfig 類型；之後定義 static const P_StateConfig 設定表
+//   SM_ENGINE_DEFINE(P, StateT, EventT, CtxT, STATE_N, EVENT_N, UNHANDLED, CONFIGS,
+//                    HOOK_BEGIN, HOOK_EXITED, HOOK_ENTERED)
+//       產生 P_build_dispatch_table()、P_transition()、P_process_event()
+//
+// CtxT 必須有以下欄位：current_state、previous_state (StateT)、
+// state_transitions、events_processed (整數)。
+// 處理器回傳 UNHANDLED 表示交給 parent；處理器只能依事件決定結果，
+// 因為轉換表在 P_build_dispatch_table() 時以 ctx = NULL 預先展開。
+// 三個 HOOK 是 (ctx, from, to) 形式的函數或巨集，不需要時傳 SM_ENGINE_NO_HOOK。
+
+#ifndef SM_ENGINE_H
+#define SM_ENGINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SM_ENGINE_NO_HOOK(ctx, from, to)    ((void)(ctx), (void)(from), (void)(to))
+
+#define SM_ENGINE_DECLARE(P, StateT, EventT, CtxT)                                  \
+    typedef struct P##_StateConfig P##_StateConfig;                                 \
+    struct P##_StateConfig {                                                        \
+        const char *name;                                                           \
+        void (*on_enter)(CtxT *ctx);                                                \
+        void (*on_exit)(CtxT *ctx);                                                 \
+        StateT (*handle_event)(CtxT *ctx, EventT event);                            \
+        const P##_StateConfig *parent;                                              \
+    };
+
+#define SM_ENGINE_DEFINE(P, StateT, EventT, CtxT, STATE_N, EVENT_N, UNHANDLED,      \
+                         CONFIGS, HOOK_BEGIN, HOOK_EXITED, HOOK_ENTERED)            \
+    static StateT P##_dispatch_table[STATE_N][EVENT_N];                             \
+    static bool P##_dispatch_ready = false;                                         \
+                                                                                    \
+    /* 沿 parent 鏈展開每個 (狀態, 事件)；整條鏈都未處理時保持原狀態 */             \
+    static inline void P##_build_dispatch_table(void) {                             \
+        for (uint32_t s_ = 0U; s_ < (uint32_t)(STATE_N); s_++) {                    \
+            for (uint32_t e_ = 0U; e_ < (uint32_t)(EVENT_N); e_++) {                \
+                StateT target_ = (UNHANDLED);                                       \
+                const P##_StateConfig *cfg_ = &(CONFIGS)[s_];                       \
+                while ((cfg_ != NULL) && (target_ == (UNHANDLED))) {                \
+                    if (cfg_->handle_event != NULL) {                               \
+                        target_ = cfg_->handle_event(NULL, (EventT)e_);             \
+                    }                                                               \
+                    cfg_ = cfg_->parent;                                            \
+                }                                                                   \
+                P##_dispatch_table[s_][e_] =                                        \
+                    (target_ == (UNHANDLED)) ? (StateT)s_ : target_;                \
+            }                                                                       \
+        }                                                                           \
+        P##_dispatch_ready = true;                                                  \
+    }                                                                               \
+                                                                                    \
+    /* new_state 必須是合法狀態，由呼叫端檢查 */                                     \
+    static inline void P##_transition(CtxT *ctx, StateT new_state) {                \
+        StateT from_ = ctx->current_state;                                          \
+        HOOK_BEGIN(ctx, from_, new_state);                                          \
+        if ((CONFIGS)[from_].on_exit != NULL) {                                     \
+            (CONFIGS)[from_].on_exit(ctx);                                          \
+        }                                                                           \
+        ctx->previous_state = from_;                                                \
+        ctx->current_state = new_state;                                             \
+        ctx->state_transitions++;                                                   \
+        HOOK_EXITED(ctx, from_, new_state);                                         \
+        if ((CONFIGS)[new_state].on_enter != NULL) {                                \
+            (CONFIGS)[new_state].on_enter(ctx);                                     \
+        }                                                                           \
+        HOOK_ENTERED(ctx, from_, new_state);                                        \
+    }                                                                               \
+                                                                                    \
+    /* event 必須是合法事件，由呼叫端檢查 */                                         \
+    static inline void P##_process_event(CtxT *ctx, EventT event) {                 \
+        ctx->events_processed++;                                                    \
+        StateT new_state_ = P##_dispatch_table[ctx->current_state][event];          \
+        if (new_state_ != ctx->current_state) {                                     \
+            P##_transition(ctx, new_state_);                                        \
+        }                                                                           \
+    }
+
+#endif  // SM_ENGINE_H
@@ -0,0 +1,160 @@
+// sm_engine_bench.c - 通用引擎 (sm_engine.h) vs 手寫狀態機
+// 風扇控制器改用引擎產生的 fan_sm_process_event()/fan_sm_transition() 之後，
+// 這裡保留移植前手寫的 sm_transition()/sm_process_event() 作為對照，驗證：
+//   1. 同一事件流下兩者的轉換次數、最終狀態與風扇速度完全一致
+//   2. 引擎版本沒有額外開銷 (統計儀表停用與啟用兩種情況)
+
+#define _GNU_SOURCE
+#define SM_QUIET
+#define FAN_CONTROL_NO_MAIN
+#include "fan_control_state_machine.c"
+
+#define BENCH_EVENTS        4000000U
+#define BENCH_ROUNDS        5U
+
+// === 移植前的手寫版本 (逐行保留，只改名稱) ===
+static void handwritten_transition(StateMachine *sm, SystemState new_state) {
+    if (new_state >= STATE_COUNT) {
+        return;
+    }
+
+    SmStats *stats = sm->stats;
+    uint64_t t_exit = 0U;
+    if (stats != NULL) {
+        t_exit = sm_stats_now_ns();
+        sm_hist_record(&stats->states[sm->current_state].residency,
+                       t_exit - stats->state_entry_ns);
+    }
+
+    if (state_configs[sm->current_state].on_exit) {
+        state_configs[sm->current_state].on_exit(sm);
+    }
+
+    if (stats != NULL) {
+        uint64_t t_enter = sm_stats_now_ns();
+        sm_hist_record(&stats->states[sm->current_state].exit_latency, t_enter - t_exit);
+        stats->states[new_state].entries++;
+        stats->state_entry_ns = t_enter;
+    }
+
+    sm->previous_state = sm->current_state;
+    sm->current_state = new_state;
+    sm->state_entry_time = (uint32_t)time(NULL);
+    sm->state_transitions++;
+
+    SM_PRINTF("[轉換] %s -> %s\n",
+           state_configs[sm->previous_state].name,
+           state_configs[sm->current_state].name);
+
+    if (state_configs[sm->current_state].on_enter) {
+        state_configs[sm->current_state].on_enter(sm);
+    }
+
+    if (stats != NULL) {
+        uint64_t t_done = sm_stats_now_ns();
+        sm_hist_record(&stats->states[sm->current_state].enter_latency,
+                       t_done - stats->state_entry_ns);
+        stats->state_entry_ns = t_done;
+    }
+}
+
+static void handwritten_process_event(StateMachine *sm, SystemEvent event) {
+    if (event >= EVENT_COUNT) {
+        return;
+    }
+
+    sm->events_processed++;
+    SystemState new_state = fan_sm_dispatch_table[sm->current_state][event];
+    if (new_state != sm->current_state) {
+        handwritten_transition(sm, new_state);
+    }
+}
+
+// === 測試 ===
+static SystemEvent event_stream[BENCH_EVENTS];
+
+static void build_event_stream(bool volatile_temps) {
+    uint32_t rng = 0x5EED1234U;
+
+    for (uint32_t i = 0U; i < BENCH_EVENTS; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        TempMilliC temp;
+        if (volatile_temps) {
+            temp = TEMP_MC_FROM_C(40) + (TempMilliC)(rng % 60000U);  // 40-99.999°C，跨越所有閾值
+        } else {
+            temp = TEMP_MC_FROM_C(40) + (TempMilliC)(rng % 5000U);   // 40-44.999°C，維持 NORMAL
+        }
+        event_stream[i] = get_temperature_event(temp);
+    }
+}
+
+typedef void (*ProcessFn)(StateMachine *sm, SystemEvent event);
+
+typedef struct {
+    double ns_per_event;
+    uint32_t transitions;
+    SystemState final_state;
+    uint8_t final_fan_speed;
+} RunResult;
+
+static RunResult run_stream(ProcessFn process, SmStats *stats) {
+    RunResult result = { .ns_per_event = 1e30 };
+
+    for (uint32_t round = 0U; round < BENCH_ROUNDS; round++) {
+        StateMachine sm;
+        sm_init(&sm);
+        sm_attach_stats(&sm, stats);
+        process(&sm, EVENT_SYSTEM_INIT);
+
+        uint64_t start = sm_stats_now_ns();
+        for (uint32_t i = 0U; i < BENCH_EVENTS; i++) {
+            process(&sm, event_stream[i]);
+        }
+        uint64_t elapsed = sm_stats_now_ns() - start;
+
+        double per_event = (double)elapsed / BENCH_EVENTS;
+        if (per_event < result.ns_per_event) {
+            result.ns_per_event = per_event;
+        }
+        result.transitions = sm.state_transitions;
+        result.final_state = sm.current_state;
+        result.final_fan_speed = sm.current_fan_speed;
+    }
+
+    return result;
+}
+
+static bool bench_case(const char *label, bool volatile_temps, SmStats *stats) {
+    build_event_stream(volatile_temps);
+    RunResult hand = run_stream(handwritten_process_event, stats);
+    RunResult engine = run_stream(sm_process_event, stats);
+
+    bool same = (hand.transitions == engine.transitions) &&
+                (hand.final_state == engine.final_state) &&
+                (hand.final_fan_speed == engine.final_fan_speed);
+
+    printf("%-10s 儀表%s  手寫 %7.2f ns/event  引擎 %7.2f ns/event  差異 %+6.2f ns  轉換 %u/%u %s\n",
+           label, (stats != NULL) ? "啟用" : "停用",
+           hand.ns_per_event, engine.ns_per_event,
+           engine.ns_per_event - hand.ns_per_event,
+           hand.transitions, engine.transitions, same ? "一致" : "不一致!");
+
+    return same;
+}
+
+int main(void) {
+    static SmStats stats;
+    bool ok = true;
+
+    printf("=== 通用狀態機引擎 vs 手寫版本 (%u 事件 x %u 輪，取最快) ===\n",
+           BENCH_EVENTS, BENCH_ROUNDS);
+    ok = bench_case("穩定溫度", false, NULL) && ok;
+    ok = bench_case("劇烈波動", true, NULL) && ok;
+    ok = bench_case("穩定溫度", false, &stats) && ok;
+    ok = bench_case("劇烈波動", true, &stats) && ok;
+
+    printf("\n行為比對: %s\n", ok ? "完全一致" : "不一致!");
+    return ok ? 0 : 1;
+}
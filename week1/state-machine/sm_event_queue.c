@@ -0,0 +1,469 @@
+// sm_event_queue.c - 依優先等級接收事件，危急事件優先分派
+// sm_process_event() 依呼叫順序處理事件；突發流量時，一個 EVENT_TEMP_EXTREME 或
+// EVENT_COOLING_FAILURE 可能排在數百個例行的溫度樣本後面。
+// 這裡在狀態機前面加一層接收佇列：
+//   - CRITICAL：EVENT_TEMP_EXTREME、EVENT_COOLING_FAILURE，FIFO，永遠最先分派
+//   - CONTROL： EVENT_COOLING_SUCCESS、EVENT_SYSTEM_INIT，FIFO，不合併
+//   - ROUTINE： 其餘溫度樣本；同一區域只保留最新一筆 (後到的取代還沒分派的)
+// 例行佇列每個區域最多佔一格，所以積壓量以區域數為上限，不會隨流量無限成長。
+// 單執行緒使用 (與 reactor 相同)：post 與 pop 都在事件迴圈中呼叫。
+
+#ifndef SM_EVENT_QUEUE_NO_MAIN
+#define SM_QUIET                    // 本程式是效能測試，關閉狀態機輸出
+#endif
+#ifndef FAN_CONTROL_NO_MAIN
+#define FAN_CONTROL_NO_MAIN
+#endif
+#include "fan_control_state_machine.c"
+
+typedef enum {
+    SM_PRIO_CRITICAL,
+    SM_PRIO_CONTROL,
+    SM_PRIO_ROUTINE,
+    SM_PRIO_COUNT
+} SmEventPriority;
+
+static inline SmEventPriority sm_event_priority(SystemEvent event) {
+    SmEventPriority prio;
+
+    switch (event) {
+        case EVENT_TEMP_EXTREME:
+        case EVENT_COOLING_FAILURE:
+            prio = SM_PRIO_CRITICAL;
+            break;
+        case EVENT_COOLING_SUCCESS:
+        case EVENT_SYSTEM_INIT:
+            prio = SM_PRIO_CONTROL;
+            break;
+        default:
+            prio = SM_PRIO_ROUTINE;
+            break;
+    }
+
+    return prio;
+}
+
+// 溫度事件附帶讀值，分派時寫回 current_temperature
+static inline bool sm_event_is_temperature(SystemEvent event) {
+    return event <= EVENT_TEMP_EXTREME;
+}
+
+typedef struct {
+    uint32_t zone;
+    SystemEvent event;
+    TempMilliC temperature;
+    uint64_t post_ns;               // 呼叫端提供的時間戳記 (量測延遲用，可為 0)
+} SmQueuedEvent;
+
+// 2 的冪次環狀緩衝區
+typedef struct {
+    SmQueuedEvent *items;
+    uint32_t mask;
+    uint32_t head;
+    uint32_t tail;
+} SmEventRing;
+
+#define SM_ROUTINE_QUEUED           0x01U   // 區域編號在例行環中
+#define SM_ROUTINE_PENDING          0x02U   // routine_latest 有尚未分派的樣本
+
+typedef struct {
+    SmEventRing rings[SM_PRIO_ROUTINE];     // CRITICAL、CONTROL
+    uint32_t zone_count;
+    uint32_t *routine_ring;                 // 待分派的區域編號，容量 = 區域數
+    uint32_t routine_head;
+    uint32_t routine_tail;
+    uint32_t routine_count;                 // 每個區域都在環中時 head == tail，不能以此判斷空
+    SmQueuedEvent *routine_latest;          // 每個區域最新的例行樣本
+    uint8_t *routine_flags;
+
+    uint64_t posted[SM_PRIO_COUNT];
+    uint64_t dispatched[SM_PRIO_COUNT];
+    uint64_t coalesced;                     // 被較新樣本取代的例行事件
+    uint64_t superseded;                    // 被危急溫度事件取代的例行事件
+    uint64_t rejected;                      // CRITICAL/CONTROL 佇列滿
+} SmEventQueue;
+
+static bool sm_event_ring_init(SmEventRing *ring, uint32_t capacity) {
+    uint32_t size = 1U;
+
+    while (size < capacity) {
+        size <<= 1;
+    }
+    ring->items = calloc(size, sizeof(SmQueuedEvent));
+    ring->mask = size - 1U;
+    ring->head = 0U;
+    ring->tail = 0U;
+
+    return ring->items != NULL;
+}
+
+static inline bool sm_event_ring_push(SmEventRing *ring, const SmQueuedEvent *ev) {
+    bool ok = (ring->tail - ring->head) <= ring->mask;
+
+    if (ok) {
+        ring->items[ring->tail & ring->mask] = *ev;
+        ring->tail++;
+    }
+    return ok;
+}
+
+static inline bool sm_event_ring_pop(SmEventRing *ring, SmQueuedEvent *out) {
+    bool ok = ring->head != ring->tail;
+
+    if (ok) {
+        *out = ring->items[ring->head & ring->mask];
+        ring->head++;
+    }
+    return ok;
+}
+
+void sm_event_queue_free(SmEventQueue *q) {
+    for (uint32_t p = 0U; p < SM_PRIO_ROUTINE; p++) {
+        free(q->rings[p].items);
+    }
+    free(q->routine_ring);
+    free(q->routine_latest);
+    free(q->routine_flags);
+    memset(q, 0, sizeof(*q));
+}
+
+// urgent_capacity：CRITICAL 與 CONTROL 各自的容量 (會進位到 2 的冪次)
+bool sm_event_queue_init(SmEventQueue *q, uint32_t zone_count, uint32_t urgent_capacity) {
+    bool ok;
+
+    memset(q, 0, sizeof(*q));
+    q->zone_count = zone_count;
+    ok = (zone_count > 0U) && (urgent_capacity > 0U);
+    for (uint32_t p = 0U; ok && (p < SM_PRIO_ROUTINE); p++) {
+        ok = sm_event_ring_init(&q->rings[p], urgent_capacity);
+    }
+    if (ok) {
+        q->routine_ring = calloc(zone_count, sizeof(uint32_t));
+        q->routine_latest = calloc(zone_count, sizeof(SmQueuedEvent));
+        q->routine_flags = calloc(zone_count, sizeof(uint8_t));
+        ok = (q->routine_ring != NULL) && (q->routine_latest != NULL) && (q->routine_flags != NULL);
+    }
+    if (!ok) {
+        sm_event_queue_free(q);
+    }
+
+    return ok;
+}
+
+// 回傳 false 表示參數錯誤或 CRITICAL/CONTROL 佇列已滿；例行事件永遠成功 (最多取代舊樣本)
+bool sm_event_queue_post(SmEventQueue *q, uint32_t zone, SystemEvent event,
+                         TempMilliC temperature, uint64_t now_ns) {
+    if ((zone >= q->zone_count) || (event >= EVENT_COUNT)) {
+        return false;
+    }
+
+    SmQueuedEvent ev = { .zone = zone, .event = event, .temperature = temperature, .post_ns = now_ns };
+    SmEventPriority prio = sm_event_priority(event);
+    uint8_t *flags = &q->routine_flags[zone];
+    bool ok = true;
+
+    if (prio == SM_PRIO_ROUTINE) {
+        if ((*flags & SM_ROUTINE_PENDING) != 0U) {
+            q->coalesced++;
+        }
+        q->routine_latest[zone] = ev;
+        if ((*flags & SM_ROUTINE_QUEUED) == 0U) {
+            q->routine_ring[q->routine_tail] = zone;
+            q->routine_tail = (q->routine_tail + 1U == q->zone_count) ? 0U : (q->routine_tail + 1U);
+            q->routine_count++;
+        }
+        *flags = SM_ROUTINE_QUEUED | SM_ROUTINE_PENDING;
+    } else {
+        ok = sm_event_ring_push(&q->rings[prio], &ev);
+        if (!ok) {
+            q->rejected++;
+        } else if (sm_event_is_temperature(event) && ((*flags & SM_ROUTINE_PENDING) != 0U)) {
+            // 較舊的例行樣本不能在危急事件之後才分派，否則區域會被舊讀值拉回低等級
+            *flags &= (uint8_t)~SM_ROUTINE_PENDING;
+            q->superseded++;
+        }
+    }
+
+    if (ok) {
+        q->posted[prio]++;
+    }
+    return ok;
+}
+
+// 取出下一個要分派的事件：每次都先檢查 CRITICAL，再 CONTROL，最後例行樣本
+bool sm_event_queue_pop(SmEventQueue *q, SmQueuedEvent *out) {
+    for (uint32_t p = 0U; p < SM_PRIO_ROUTINE; p++) {
+        if (sm_event_ring_pop(&q->rings[p], out)) {
+            q->dispatched[p]++;
+            return true;
+        }
+    }
+
+    while (q->routine_count > 0U) {
+        uint32_t zone = q->routine_ring[q->routine_head];
+        uint8_t flags = q->routine_flags[zone];
+
+        q->routine_head = (q->routine_head + 1U == q->zone_count) ? 0U : (q->routine_head + 1U);
+        q->routine_count--;
+        q->routine_flags[zone] = 0U;
+        if ((flags & SM_ROUTINE_PENDING) != 0U) {
+            *out = q->routine_latest[zone];
+            q->dispatched[SM_PRIO_ROUTINE]++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static inline void sm_event_queue_apply(StateMachine *zones, const SmQueuedEvent *ev) {
+    StateMachine *sm = &zones[ev->zone];
+
+    if (sm_event_is_temperature(ev->event)) {
+        sm->current_temperature = ev->temperature;
+    }
+    sm_process_event(sm, ev->event);
+}
+
+// 分派最多 budget 個事件 (0 表示全部)；回傳實際分派數
+uint32_t sm_event_queue_dispatch(SmEventQueue *q, StateMachine *zones, uint32_t budget) {
+    SmQueuedEvent ev;
+    uint32_t count = 0U;
+
+    while (((budget == 0U) || (count < budget)) && sm_event_queue_pop(q, &ev)) {
+        sm_event_queue_apply(zones, &ev);
+        count++;
+    }
+
+    return count;
+}
+
+#ifndef SM_EVENT_QUEUE_NO_MAIN
+
+// === 突發流量下的危急事件延遲 ===
+#define BENCH_ZONES             1024U
+#define BENCH_EVENTS            2000000U
+#define BENCH_CRITICAL_EVERY    5000U
+#define BENCH_CONTROL_EVERY     997U
+#define BENCH_POST_PER_ROUND    48U     // 每輪收到的事件
+#define BENCH_SERVE_PER_ROUND   32U     // 每輪能處理的事件 (超載 1.5 倍)
+
+static SmQueuedEvent stream[BENCH_EVENTS];
+
+// 例行溫度樣本為主，穿插少量控制事件與危急事件
+static uint32_t build_stream(void) {
+    uint32_t rng = 0xF100D123U;
+    uint32_t critical = 0U;
+
+    for (uint32_t i = 0U; i < BENCH_EVENTS; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        SmQueuedEvent *ev = &stream[i];
+        ev->zone = rng % BENCH_ZONES;
+        if ((i % BENCH_CRITICAL_EVERY) == (BENCH_CRITICAL_EVERY - 1U)) {
+            ev->event = ((critical % 2U) == 0U) ? EVENT_TEMP_EXTREME : EVENT_COOLING_FAILURE;
+            ev->temperature = TEMP_MC_FROM_C(97);
+            critical++;
+        } else if ((i % BENCH_CONTROL_EVERY) == 0U) {
+            ev->event = EVENT_COOLING_SUCCESS;
+            ev->temperature = 0;
+        } else {
+            ev->temperature = TEMP_MC_FROM_C(40) + (TempMilliC)((rng >> 8) % 50000U);   // 40-89.999°C
+            ev->event = get_temperature_event(ev->temperature);
+        }
+    }
+
+    return critical;
+}
+
+typedef struct {
+    uint64_t *critical_ns;
+    uint32_t critical_count;
+    uint64_t routine_age_max_ns;
+    uint64_t dispatched;
+    uint32_t max_backlog;
+    uint32_t stale_zones;           // 最後溫度不是該區域最新樣本的區域
+    double total_ms;
+} BenchResult;
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void record_dispatch(const SmQueuedEvent *ev, uint64_t now, BenchResult *r) {
+    uint64_t age = now - ev->post_ns;
+
+    if (sm_event_priority(ev->event) == SM_PRIO_CRITICAL) {
+        r->critical_ns[r->critical_count++] = age;
+    } else if ((sm_event_priority(ev->event) == SM_PRIO_ROUTINE) && (age > r->routine_age_max_ns)) {
+        r->routine_age_max_ns = age;
+    }
+    r->dispatched++;
+}
+
+static void init_zones(StateMachine *zones) {
+    for (uint32_t z = 0U; z < BENCH_ZONES; z++) {
+        sm_init(&zones[z]);
+        sm_process_event(&zones[z], EVENT_SYSTEM_INIT);
+    }
+}
+
+// 每個區域最後一個溫度樣本 (危急或例行) 必須是最後寫進狀態機的溫度
+static uint32_t count_stale(const StateMachine *zones) {
+    static TempMilliC latest[BENCH_ZONES];
+    uint32_t stale = 0U;
+
+    for (uint32_t z = 0U; z < BENCH_ZONES; z++) {
+        latest[z] = zones[z].current_temperature;
+    }
+    for (uint32_t i = 0U; i < BENCH_EVENTS; i++) {
+        if (sm_event_is_temperature(stream[i].event)) {
+            latest[stream[i].zone] = stream[i].temperature;
+        }
+    }
+    for (uint32_t z = 0U; z < BENCH_ZONES; z++) {
+        if (zones[z].current_temperature != latest[z]) {
+            stale++;
+        }
+    }
+
+    return stale;
+}
+
+// 每個區域都有待分派的例行樣本時例行環全滿，必須全部分派，之後還能繼續接收
+static bool check_all_zones_pending(void) {
+    static StateMachine zones[BENCH_ZONES];
+    SmEventQueue q;
+    bool ok = sm_event_queue_init(&q, BENCH_ZONES, 16U);
+
+    init_zones(zones);
+    for (uint32_t round = 0U; ok && (round < 3U); round++) {
+        TempMilliC temp = TEMP_MC_FROM_C(50) + (TempMilliC)round;
+
+        for (uint32_t z = 0U; z < BENCH_ZONES; z++) {
+            (void)sm_event_queue_post(&q, z, get_temperature_event(temp), temp, 0U);
+        }
+        ok = (sm_event_queue_dispatch(&q, zones, 0U) == BENCH_ZONES) && (q.routine_count == 0U);
+        for (uint32_t z = 0U; ok && (z < BENCH_ZONES); z++) {
+            ok = zones[z].current_temperature == temp;
+        }
+    }
+    sm_event_queue_free(&q);
+
+    return ok;
+}
+
+// 對照組：單一 FIFO，依收到順序處理 (等同直接呼叫 sm_process_event)
+static void run_fifo(StateMachine *zones, BenchResult *r) {
+    SmEventRing fifo;
+    SmQueuedEvent ev;
+    uint32_t next = 0U;
+
+    init_zones(zones);
+    (void)sm_event_ring_init(&fifo, BENCH_EVENTS);
+    uint64_t start = sm_stats_now_ns();
+    while ((next < BENCH_EVENTS) || (fifo.head != fifo.tail)) {
+        for (uint32_t i = 0U; (i < BENCH_POST_PER_ROUND) && (next < BENCH_EVENTS); i++, next++) {
+            stream[next].post_ns = sm_stats_now_ns();
+            (void)sm_event_ring_push(&fifo, &stream[next]);
+        }
+        if ((fifo.tail - fifo.head) > r->max_backlog) {
+            r->max_backlog = fifo.tail - fifo.head;
+        }
+        for (uint32_t i = 0U; (i < BENCH_SERVE_PER_ROUND) && sm_event_ring_pop(&fifo, &ev); i++) {
+            sm_event_queue_apply(zones, &ev);
+            record_dispatch(&ev, sm_stats_now_ns(), r);
+        }
+    }
+    r->total_ms = (double)(sm_stats_now_ns() - start) / 1e6;
+    r->stale_zones = count_stale(zones);
+    free(fifo.items);
+}
+
+static void run_priority(StateMachine *zones, SmEventQueue *q, BenchResult *r) {
+    SmQueuedEvent ev;
+    uint32_t next = 0U;
+
+    init_zones(zones);
+    uint64_t start = sm_stats_now_ns();
+    for (;;) {
+        for (uint32_t i = 0U; (i < BENCH_POST_PER_ROUND) && (next < BENCH_EVENTS); i++, next++) {
+            const SmQueuedEvent *s = &stream[next];
+            (void)sm_event_queue_post(q, s->zone, s->event, s->temperature, sm_stats_now_ns());
+        }
+        uint32_t backlog = (q->rings[SM_PRIO_CRITICAL].tail - q->rings[SM_PRIO_CRITICAL].head) +
+                           (q->rings[SM_PRIO_CONTROL].tail - q->rings[SM_PRIO_CONTROL].head) +
+                           q->routine_count;
+        if (backlog > r->max_backlog) {
+            r->max_backlog = backlog;
+        }
+        uint32_t served = 0U;
+        while ((served < BENCH_SERVE_PER_ROUND) && sm_event_queue_pop(q, &ev)) {
+            sm_event_queue_apply(zones, &ev);
+            record_dispatch(&ev, sm_stats_now_ns(), r);
+            served++;
+        }
+        if ((next == BENCH_EVENTS) && (served == 0U)) {
+            break;
+        }
+    }
+    r->total_ms = (double)(sm_stats_now_ns() - start) / 1e6;
+    r->stale_zones = count_stale(zones);
+}
+
+static void print_result(const char *label, BenchResult *r) {
+    qsort(r->critical_ns, r->critical_count, sizeof(uint64_t), compare_u64);
+    uint64_t p50 = r->critical_ns[r->critical_count / 2U];
+    uint64_t p99 = r->critical_ns[(r->critical_count * 99U) / 100U];
+    uint64_t max = r->critical_ns[r->critical_count - 1U];
+
+    printf("%-12s 危急延遲 p50 %10.1f us  p99 %10.1f us  最大 %10.1f us  例行樣本最大延遲 %9.1f us\n",
+           label, (double)p50 / 1e3, (double)p99 / 1e3, (double)max / 1e3,
+           (double)r->routine_age_max_ns / 1e3);
+    printf("%-12s 分派 %8lu 事件  最大積壓 %7u  總時間 %7.1f ms  溫度非最新的區域 %u\n",
+           "", (unsigned long)r->dispatched, r->max_backlog, r->total_ms, r->stale_zones);
+}
+
+int main(void) {
+    static StateMachine zones[BENCH_ZONES];
+    SmEventQueue q;
+    uint32_t critical = build_stream();
+    BenchResult fifo = { .critical_ns = calloc(critical, sizeof(uint64_t)) };
+    BenchResult prio = { .critical_ns = calloc(critical, sizeof(uint64_t)) };
+
+    if ((fifo.critical_ns == NULL) || (prio.critical_ns == NULL) ||
+        !sm_event_queue_init(&q, BENCH_ZONES, 1024U)) {
+        printf("記憶體配置失敗\n");
+        free(fifo.critical_ns);
+        free(prio.critical_ns);
+        return 1;
+    }
+
+    bool full = check_all_zones_pending();
+    printf("例行環全滿 (%u 個區域同時待分派): %s\n", BENCH_ZONES, full ? "全部分派" : "失敗!");
+
+    printf("=== 優先等級事件接收 (%u 區域, %u 事件, 其中危急 %u 個；每輪收 %u 處理 %u) ===\n",
+           BENCH_ZONES, BENCH_EVENTS, critical, BENCH_POST_PER_ROUND, BENCH_SERVE_PER_ROUND);
+    run_fifo(zones, &fifo);
+    run_priority(zones, &q, &prio);
+    print_result("FIFO", &fifo);
+    print_result("優先+合併", &prio);
+
+    printf("\n接收 危急 %lu / 控制 %lu / 例行 %lu；合併 %lu，被危急事件取代 %lu，拒絕 %lu\n",
+           (unsigned long)q.posted[SM_PRIO_CRITICAL], (unsigned long)q.posted[SM_PRIO_CONTROL],
+           (unsigned long)q.posted[SM_PRIO_ROUTINE], (unsigned long)q.coalesced,
+           (unsigned long)q.superseded, (unsigned long)q.rejected);
+
+    bool ok = full && (prio.critical_count == critical) && (prio.stale_zones == 0U) && (q.rejected == 0U);
+    printf("結果: %s\n", ok ? "危急事件全部優先分派，每個區域都以最新樣本結束" : "失敗!");
+
+    free(fifo.critical_ns);
+    free(prio.critical_ns);
+    sm_event_queue_free(&q);
+    return ok ? 0 : 1;
+}
+
+#endif  // SM_EVENT_QUEUE_NO_MAIN
@@ -0,0 +1,1113 @@
+// sm_journal.c - 區域狀態轉換日誌 (關機事後分析)
+// 區域進入 SHUTDOWN 之後，必須能回答「它是怎麼一路走到這裡的」；sm_transition()
+// 原本只印一行訊息、遞增 state_transitions。日誌掛在 StateMachine 的轉換觀察者上，
+// 記錄每次轉換的前狀態、新狀態、觸發事件、溫度與時間 (格式見 sm_journal.h)：
+//   - 每個區域在記憶體中累積自己的壓縮區塊，滿了才附加到目前的段檔
+//   - 區域進入 SHUTDOWN 時立即寫出該區塊並 fdatasync，事後分析不會少掉最後幾筆
+//   - 段檔超過 max_segment_bytes 時封存 (寫入段尾索引) 並開新段，
+//     段數超過 max_segments 時刪除最舊的段，磁碟用量有上限
+//   - 查詢以段尾索引/區塊標頭跳過無關的段與區塊，只解碼相符的區塊
+// 其餘轉換留在記憶體中的區塊，daemon 應定期呼叫 sm_journal_flush()。
+//
+// 用法: sm_journal [區域數] [模擬小時數] [日誌目錄]
+//       sm_journal --query 日誌目錄 區域 狀態名稱 小時數
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SM_QUIET
+#define FAN_CONTROL_NO_MAIN
+#include "fan_control_state_machine.c"
+#include "sm_journal.h"
+
+#define SM_JOURNAL_WRITE_BUFFER     (64U * 1024U)
+#define SM_JOURNAL_LAST_NONE        0xFFU   // 區塊開頭，下一筆必須帶 from
+
+typedef struct {
+    uint64_t max_segment_bytes;      // 段檔大小上限，超過就封存並開新段
+    uint32_t max_segments;           // 保留的段數，磁碟用量約為兩者相乘
+} SmJournalConfig;
+
+typedef struct SmJournal SmJournal;
+
+// 單一區域目前累積中的區塊 (同時是轉換觀察者的 ctx)
+typedef struct {
+    SmJournal *journal;
+    uint32_t zone;
+    uint16_t count;
+    uint16_t len;
+    uint8_t to_mask;
+    uint8_t last_to;
+    TempMilliC last_temp;
+    uint64_t first_us;
+    uint64_t last_us;
+    uint8_t payload[SM_JOURNAL_BLOCK_PAYLOAD];
+} SmJournalZone;
+
+struct SmJournal {
+    char dir[PATH_MAX];
+    SmJournalConfig config;
+    SmJournalZone *zones;
+    uint32_t zone_count;
+    int fd;                          // 目前寫入中的段，-1 表示沒有
+    uint32_t sequence;               // 目前段的編號
+    uint32_t oldest;                 // 最舊的保留段
+    uint64_t segment_bytes;          // 目前段的大小 (含尚未寫出的緩衝)
+    uint64_t segment_first_us;
+    uint64_t segment_last_us;
+    uint8_t *buffer;
+    size_t buffered;
+    SmJournalIndexEntry *index;      // 目前段的索引，封存時寫到段尾
+    uint32_t index_count;
+    uint32_t index_capacity;
+    uint64_t sim_now_us;             // 非 0 時取代 CLOCK_REALTIME (模擬、測試用)
+    bool io_error;
+    // 統計
+    uint64_t records;
+    uint64_t blocks;
+    uint64_t bytes_written;
+    uint64_t segments_sealed;
+    uint64_t segments_deleted;
+    uint64_t syncs;
+};
+
+typedef struct {
+    uint32_t zone;
+    uint8_t from;
+    uint8_t to;
+    uint8_t event;                   // SM_JOURNAL_EVENT_NONE = 直接呼叫 sm_transition()
+    TempMilliC temperature;
+    uint64_t time_us;
+} SmJournalRecord;
+
+typedef struct {
+    uint32_t zone;                   // SM_JOURNAL_ANY_ZONE = 所有區域
+    uint64_t from_us;                // 時間範圍 [from_us, to_us]
+    uint64_t to_us;
+    uint8_t to_mask;                 // 新狀態遮罩，SM_JOURNAL_ANY_STATE = 全部
+    bool full_scan;                  // 不用索引，解碼每個區塊 (驗證與比較用)
+} SmJournalQuery;
+
+typedef struct {
+    uint32_t segments;
+    uint32_t segments_skipped;       // 段尾時間範圍不重疊，整段跳過
+    uint32_t segments_unsealed;      // 沿區塊標頭重建索引的段
+    uint64_t blocks_total;
+    uint64_t blocks_decoded;
+    uint64_t blocks_corrupt;         // CRC 不符或寫到一半的尾端
+    uint64_t records_decoded;
+    uint64_t matched;
+} SmJournalQueryStats;
+
+// 回傳 false 停止查詢
+typedef bool (*SmJournalVisitor)(void *ctx, const SmJournalRecord *record);
+
+static const char *const sm_journal_event_names[SM_JOURNAL_EVENT_NONE + 1U] = {
+    "TEMP_NORMAL", "TEMP_WARNING", "TEMP_CRITICAL", "TEMP_EXTREME",
+    "COOLING_SUCCESS", "COOLING_FAILURE", "SYSTEM_INIT", "(直接轉換)"
+};
+
+_Static_assert(EVENT_COUNT == SM_JOURNAL_EVENT_NONE, "事件編碼只有 3 bits");
+_Static_assert(STATE_COUNT <= 8, "狀態編碼只有 3 bits");
+
+// === 段檔 ===
+static uint64_t journal_realtime_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000ULL) + ((uint64_t)ts.tv_nsec / 1000ULL);
+}
+
+static uint64_t journal_now_us(const SmJournal *j) {
+    return (j->sim_now_us != 0U) ? j->sim_now_us : journal_realtime_us();
+}
+
+static bool journal_segment_path(const char *dir, uint32_t sequence, char *path, size_t size) {
+    return snprintf(path, size, "%s/journal-%08u.seg", dir, sequence) < (int)size;
+}
+
+static bool journal_parse_name(const char *name, uint32_t *sequence) {
+    unsigned int seq = 0U;
+    int used = 0;
+
+    if ((strlen(name) == 20U) && (sscanf(name, "journal-%8u.seg%n", &seq, &used) == 1) && (used == 20)) {
+        *sequence = (uint32_t)seq;
+        return true;
+    }
+    return false;
+}
+
+static int journal_compare_seq(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// 列出目錄中的段編號 (遞增排序)；呼叫者負責 free(*out)
+static bool journal_list_segments(const char *dir, uint32_t **out, uint32_t *count) {
+    DIR *d = opendir(dir);
+    uint32_t *list = NULL;
+    uint32_t n = 0U;
+    uint32_t capacity = 0U;
+    bool ok = (d != NULL);
+
+    while (ok) {
+        struct dirent *entry = readdir(d);
+        uint32_t seq = 0U;
+        if (entry == NULL) {
+            break;
+        }
+        if (!journal_parse_name(entry->d_name, &seq)) {
+            continue;
+        }
+        if (n == capacity) {
+            capacity = (capacity == 0U) ? 64U : (capacity * 2U);
+            uint32_t *grown = realloc(list, (size_t)capacity * sizeof(uint32_t));
+            ok = (grown != NULL);
+            list = ok ? grown : list;
+        }
+        if (ok) {
+            list[n] = seq;
+            n++;
+        }
+    }
+    if (d != NULL) {
+        (void)closedir(d);
+    }
+    if (ok && (n > 1U)) {
+        qsort(list, n, sizeof(uint32_t), journal_compare_seq);
+    }
+    if (!ok) {
+        free(list);
+        list = NULL;
+        n = 0U;
+    }
+    *out = list;
+    *count = n;
+
+    return ok;
+}
+
+static bool journal_write_all(int fd, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    bool ok = true;
+
+    while ((len > 0U) && ok) {
+        ssize_t n = write(fd, p, len);
+        if (n > 0) {
+            p += n;
+            len -= (size_t)n;
+        } else if ((n < 0) && (errno == EINTR)) {
+            continue;
+        } else {
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+static void journal_drain(SmJournal *j) {
+    if ((j->buffered > 0U) && (j->fd >= 0)) {
+        if (journal_write_all(j->fd, j->buffer, j->buffered)) {
+            j->bytes_written += j->buffered;
+        } else {
+            j->io_error = true;
+        }
+    }
+    j->buffered = 0U;
+}
+
+static void journal_put(SmJournal *j, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+
+    while (len > 0U) {
+        size_t room = SM_JOURNAL_WRITE_BUFFER - j->buffered;
+        size_t n = (len < room) ? len : room;
+        memcpy(j->buffer + j->buffered, p, n);
+        j->buffered += n;
+        j->segment_bytes += n;
+        p += n;
+        len -= n;
+        if (j->buffered == SM_JOURNAL_WRITE_BUFFER) {
+            journal_drain(j);
+        }
+    }
+}
+
+static void journal_sync(SmJournal *j) {
+    journal_drain(j);
+    if ((j->fd >= 0) && (fdatasync(j->fd) != 0)) {
+        j->io_error = true;
+    }
+    j->syncs++;
+}
+
+// 刪除超出保留數量的最舊段
+static void journal_prune(SmJournal *j) {
+    char path[PATH_MAX];
+
+    while (((j->sequence - j->oldest) + 1U) > j->config.max_segments) {
+        if (journal_segment_path(j->dir, j->oldest, path, sizeof(path)) &&
+            ((unlink(path) == 0) || (errno == ENOENT))) {
+            j->segments_deleted++;
+        }
+        j->oldest++;
+    }
+}
+
+static bool journal_open_segment(SmJournal *j) {
+    char path[PATH_MAX];
+    SmJournalSegmentHeader header = {
+        .magic = SM_JOURNAL_SEGMENT_MAGIC,
+        .version = SM_JOURNAL_VERSION,
+        .header_size = (uint16_t)sizeof(SmJournalSegmentHeader),
+        .block_payload_max = SM_JOURNAL_BLOCK_PAYLOAD
+    };
+
+    j->sequence++;
+    header.sequence = j->sequence;
+    header.created_us = journal_now_us(j);
+    j->fd = -1;
+    if (journal_segment_path(j->dir, j->sequence, path, sizeof(path))) {
+        j->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    j->segment_bytes = 0U;
+    j->segment_first_us = UINT64_MAX;
+    j->segment_last_us = 0U;
+    j->index_count = 0U;
+    j->buffered = 0U;
+    if (j->fd < 0) {
+        j->io_error = true;
+        return false;
+    }
+    journal_put(j, &header, sizeof(header));
+    journal_prune(j);
+
+    return true;
+}
+
+// 寫入段尾索引並關閉；封存的段一定已落到磁碟
+static void journal_seal_segment(SmJournal *j) {
+    SmJournalTrailer trailer = {
+        .magic = SM_JOURNAL_TRAILER_MAGIC,
+        .entry_count = j->index_count,
+        .index_offset = j->segment_bytes,
+        .first_us = (j->index_count > 0U) ? j->segment_first_us : 0U,
+        .last_us = j->segment_last_us
+    };
+
+    if (j->fd < 0) {
+        return;
+    }
+    trailer.index_crc = sm_checkpoint_crc32(j->index, (size_t)j->index_count * sizeof(SmJournalIndexEntry));
+    trailer.trailer_crc = sm_journal_trailer_crc(&trailer);
+    journal_put(j, j->index, (size_t)j->index_count * sizeof(SmJournalIndexEntry));
+    journal_put(j, &trailer, sizeof(trailer));
+    journal_sync(j);
+    (void)close(j->fd);
+    j->fd = -1;
+    j->segments_sealed++;
+}
+
+// 把區域累積中的區塊附加到目前的段 (必要時先輪替)，並清空區塊
+static void journal_emit_block(SmJournal *j, SmJournalZone *z) {
+    SmJournalBlockHeader header = {
+        .magic = SM_JOURNAL_BLOCK_MAGIC,
+        .zone = z->zone,
+        .first_us = z->first_us,
+        .last_us = z->last_us,
+        .count = z->count,
+        .payload_bytes = z->len,
+        .to_mask = z->to_mask
+    };
+    uint64_t block_size = sizeof(header) + z->len;
+    uint64_t sealed_size = j->segment_bytes + block_size +
+                           (((uint64_t)j->index_count + 1U) * sizeof(SmJournalIndexEntry)) +
+                           sizeof(SmJournalTrailer);
+
+    if (z->count == 0U) {
+        return;
+    }
+    if ((sealed_size > j->config.max_segment_bytes) && (j->index_count > 0U)) {
+        journal_seal_segment(j);
+        (void)journal_open_segment(j);
+    }
+    if (j->index_count == j->index_capacity) {
+        uint32_t capacity = (j->index_capacity == 0U) ? 1024U : (j->index_capacity * 2U);
+        SmJournalIndexEntry *grown = realloc(j->index, (size_t)capacity * sizeof(SmJournalIndexEntry));
+        if (grown == NULL) {
+            j->io_error = true;
+            return;
+        }
+        j->index = grown;
+        j->index_capacity = capacity;
+    }
+
+    SmJournalIndexEntry *entry = &j->index[j->index_count];
+    memset(entry, 0, sizeof(*entry));
+    entry->zone = z->zone;
+    entry->to_mask = z->to_mask;
+    entry->first_us = z->first_us;
+    entry->last_us = z->last_us;
+    entry->offset = (uint32_t)j->segment_bytes;
+    entry->count = z->count;
+    j->index_count++;
+    if (z->first_us < j->segment_first_us) {
+        j->segment_first_us = z->first_us;
+    }
+    if (z->last_us > j->segment_last_us) {
+        j->segment_last_us = z->last_us;
+    }
+
+    header.crc = sm_journal_block_crc(&header, z->payload);
+    journal_put(j, &header, sizeof(header));
+    journal_put(j, z->payload, z->len);
+    j->blocks++;
+
+    z->count = 0U;
+    z->len = 0U;
+    z->to_mask = 0U;
+    z->last_to = SM_JOURNAL_LAST_NONE;
+    z->last_temp = 0;
+}
+
+// === 寫入 API ===
+bool sm_journal_open(SmJournal *j, const char *dir, uint32_t zone_count, const SmJournalConfig *config) {
+    uint32_t *existing = NULL;
+    uint32_t existing_count = 0U;
+
+    memset(j, 0, sizeof(*j));
+    j->fd = -1;
+    if ((zone_count == 0U) || (config->max_segments == 0U) ||
+        (config->max_segment_bytes < (16U * 1024U)) || (config->max_segment_bytes > UINT32_MAX) ||
+        (snprintf(j->dir, sizeof(j->dir), "%s", dir) >= (int)sizeof(j->dir)) ||
+        ((mkdir(dir, 0755) != 0) && (errno != EEXIST)) ||
+        !journal_list_segments(dir, &existing, &existing_count)) {
+        return false;
+    }
+
+    j->config = *config;
+    j->zone_count = zone_count;
+    j->zones = calloc(zone_count, sizeof(SmJournalZone));
+    j->buffer = malloc(SM_JOURNAL_WRITE_BUFFER);
+    if ((j->zones == NULL) || (j->buffer == NULL)) {
+        free(existing);
+        free(j->zones);
+        free(j->buffer);
+        return false;
+    }
+    for (uint32_t i = 0U; i < zone_count; i++) {
+        j->zones[i].journal = j;
+        j->zones[i].zone = i;
+        j->zones[i].last_to = SM_JOURNAL_LAST_NONE;
+    }
+
+    // 接在既有的段之後；上次未封存的段保留原樣，查詢時重建其索引
+    j->oldest = (existing_count > 0U) ? existing[0] : 1U;
+    j->sequence = (existing_count > 0U) ? existing[existing_count - 1U] : 0U;
+    free(existing);
+
+    return journal_open_segment(j);
+}
+
+void sm_journal_append(SmJournal *j, uint32_t zone, SystemState from, SystemState to,
+                       SystemEvent event, TempMilliC temperature, uint64_t time_us) {
+    SmJournalZone *z;
+    uint8_t *p;
+    size_t n;
+    bool explicit_from;
+
+    if (zone >= j->zone_count) {
+        return;
+    }
+    z = &j->zones[zone];
+    // 區塊內時間必須遞增：時鐘被往回調時先結束目前的區塊
+    if (((z->len + SM_JOURNAL_RECORD_MAX) > SM_JOURNAL_BLOCK_PAYLOAD) || (z->count == UINT16_MAX) ||
+        ((z->count > 0U) && (time_us < z->last_us))) {
+        journal_emit_block(j, z);
+    }
+    if (z->count == 0U) {
+        z->first_us = time_us;
+        z->last_us = time_us;
+    }
+
+    p = &z->payload[z->len];
+    explicit_from = ((uint8_t)from != z->last_to);
+    n = sm_journal_put_varint(p, time_us - z->last_us);
+    p[n] = (uint8_t)((uint32_t)to | ((uint32_t)event << 3) | (explicit_from ? SM_JOURNAL_FROM_EXPLICIT : 0U));
+    n++;
+    if (explicit_from) {
+        p[n] = (uint8_t)from;
+        n++;
+    }
+    n += sm_journal_put_varint(&p[n], sm_journal_zigzag((int64_t)temperature - (int64_t)z->last_temp));
+
+    z->len = (uint16_t)(z->len + n);
+    z->count++;
+    z->to_mask |= (uint8_t)(1U << (uint32_t)to);
+    z->last_to = (uint8_t)to;
+    z->last_temp = temperature;
+    z->last_us = time_us;
+    j->records++;
+
+    // 關機前的轉換序列就是事後分析要的資料，不能只留在記憶體
+    if (to == STATE_SHUTDOWN) {
+        journal_emit_block(j, z);
+        journal_sync(j);
+    }
+}
+
+// 轉換觀察者：ctx 是區域自己的 SmJournalZone
+static void sm_journal_observer(void *ctx, const StateMachine *sm, SystemState from,
+                                SystemState to, SystemEvent event) {
+    SmJournalZone *z = (SmJournalZone *)ctx;
+    sm_journal_append(z->journal, z->zone, from, to, event, sm->current_temperature,
+                      journal_now_us(z->journal));
+}
+
+void sm_journal_attach(SmJournal *j, StateMachine *sm, uint32_t zone) {
+    if (zone < j->zone_count) {
+        sm->observer = sm_journal_observer;
+        sm->observer_ctx = &j->zones[zone];
+    }
+}
+
+// 寫出所有區域累積中的區塊；sync 為 true 時等到資料落到磁碟
+bool sm_journal_flush(SmJournal *j, bool sync) {
+    for (uint32_t i = 0U; i < j->zone_count; i++) {
+        journal_emit_block(j, &j->zones[i]);
+    }
+    if (sync) {
+        journal_sync(j);
+    } else {
+        journal_drain(j);
+    }
+
+    return !j->io_error;
+}
+
+bool sm_journal_close(SmJournal *j) {
+    bool ok;
+
+    if (j->fd >= 0) {
+        for (uint32_t i = 0U; i < j->zone_count; i++) {
+            journal_emit_block(j, &j->zones[i]);
+        }
+        journal_seal_segment(j);
+    }
+    ok = !j->io_error;
+    free(j->zones);
+    free(j->buffer);
+    free(j->index);
+    j->zones = NULL;
+    j->buffer = NULL;
+    j->index = NULL;
+    j->zone_count = 0U;
+
+    return ok;
+}
+
+// === 查詢 ===
+static bool journal_block_overlaps(uint32_t zone, uint8_t to_mask, uint64_t first_us, uint64_t last_us,
+                                   const SmJournalQuery *q) {
+    return ((q->zone == SM_JOURNAL_ANY_ZONE) || (q->zone == zone)) &&
+           ((to_mask & q->to_mask) != 0U) && (first_us <= q->to_us) && (last_us >= q->from_us);
+}
+
+// 解碼一個區塊並把相符的記錄交給 visitor；回傳 false 表示 visitor 要求停止
+static bool journal_decode_block(const uint8_t *base, uint64_t offset, uint64_t limit,
+                                 const SmJournalQuery *q, SmJournalVisitor visit, void *ctx,
+                                 SmJournalQueryStats *stats) {
+    SmJournalBlockHeader header;
+    const uint8_t *p;
+    const uint8_t *end;
+    SmJournalRecord rec;
+    uint8_t last_to = SM_JOURNAL_LAST_NONE;
+    int64_t temp = 0;
+    bool more = true;
+
+    memcpy(&header, base + offset, sizeof(header));
+    p = base + offset + sizeof(header);
+    end = p + header.payload_bytes;
+    if ((header.magic != SM_JOURNAL_BLOCK_MAGIC) || ((offset + sizeof(header) + header.payload_bytes) > limit) ||
+        (header.crc != sm_journal_block_crc(&header, p))) {
+        stats->blocks_corrupt++;
+        return true;
+    }
+    stats->blocks_decoded++;
+
+    rec.zone = header.zone;
+    rec.time_us = header.first_us;
+    for (uint32_t i = 0U; (i < header.count) && more; i++) {
+        uint64_t value = 0U;
+        size_t n = sm_journal_get_varint(p, end, &value);
+        if ((n == 0U) || ((p + n) >= end)) {
+            stats->blocks_corrupt++;
+            break;
+        }
+        p += n;
+        rec.time_us += value;
+        rec.to = *p & 0x07U;
+        rec.event = (uint8_t)((*p >> 3) & 0x07U);
+        rec.from = last_to;
+        if ((*p & SM_JOURNAL_FROM_EXPLICIT) != 0U) {
+            p++;
+            rec.from = (p < end) ? *p : SM_JOURNAL_LAST_NONE;
+        }
+        p++;
+        n = sm_journal_get_varint(p, end, &value);
+        if (n == 0U) {
+            stats->blocks_corrupt++;
+            break;
+        }
+        p += n;
+        temp += sm_journal_unzigzag(value);
+        rec.temperature = (TempMilliC)temp;
+        last_to = rec.to;
+        stats->records_decoded++;
+
+        if (((q->zone == SM_JOURNAL_ANY_ZONE) || (q->zone == rec.zone)) &&
+            (rec.time_us >= q->from_us) && (rec.time_us <= q->to_us) &&
+            ((q->to_mask & (1U << rec.to)) != 0U)) {
+            stats->matched++;
+            more = visit(ctx, &rec);
+        }
+    }
+
+    return more;
+}
+
+// 段尾有效時回傳 true 並填入 trailer
+static bool journal_read_trailer(const uint8_t *base, uint64_t size, SmJournalTrailer *trailer) {
+    if (size < (sizeof(SmJournalSegmentHeader) + sizeof(SmJournalTrailer))) {
+        return false;
+    }
+    memcpy(trailer, base + size - sizeof(SmJournalTrailer), sizeof(*trailer));
+    return (trailer->magic == SM_JOURNAL_TRAILER_MAGIC) &&
+           (trailer->trailer_crc == sm_journal_trailer_crc(trailer)) &&
+           ((trailer->index_offset + ((uint64_t)trailer->entry_count * sizeof(SmJournalIndexEntry)) +
+             sizeof(SmJournalTrailer)) == size) &&
+           (trailer->index_crc == sm_checkpoint_crc32(base + trailer->index_offset,
+                                                      (size_t)trailer->entry_count * sizeof(SmJournalIndexEntry)));
+}
+
+static bool journal_query_segment(const uint8_t *base, uint64_t size, const SmJournalQuery *q,
+                                  SmJournalVisitor visit, void *ctx, SmJournalQueryStats *stats) {
+    SmJournalSegmentHeader seg;
+    SmJournalTrailer trailer;
+    uint64_t limit = size;
+    bool more = true;
+
+    memcpy(&seg, base, sizeof(seg));
+    if ((seg.magic != SM_JOURNAL_SEGMENT_MAGIC) || (seg.version != SM_JOURNAL_VERSION)) {
+        stats->blocks_corrupt++;
+        return true;
+    }
+
+    bool sealed = journal_read_trailer(base, size, &trailer);
+    if (sealed) {
+        limit = trailer.index_offset;
+    }
+    if (sealed && !q->full_scan) {
+        if ((trailer.entry_count == 0U) || (trailer.first_us > q->to_us) || (trailer.last_us < q->from_us)) {
+            stats->segments_skipped++;
+            stats->blocks_total += trailer.entry_count;
+            return true;
+        }
+        for (uint32_t i = 0U; (i < trailer.entry_count) && more; i++) {
+            SmJournalIndexEntry entry;
+            memcpy(&entry, base + trailer.index_offset + ((uint64_t)i * sizeof(entry)), sizeof(entry));
+            stats->blocks_total++;
+            if (journal_block_overlaps(entry.zone, entry.to_mask, entry.first_us, entry.last_us, q) &&
+                ((entry.offset + sizeof(SmJournalBlockHeader)) <= limit)) {
+                more = journal_decode_block(base, entry.offset, limit, q, visit, ctx, stats);
+            }
+        }
+        return more;
+    }
+
+    // 未封存 (或要求全掃描)：沿區塊標頭走，遇到不完整的尾端就停
+    if (!sealed) {
+        stats->segments_unsealed++;
+    }
+    uint64_t offset = sizeof(SmJournalSegmentHeader);
+    while (more && ((offset + sizeof(SmJournalBlockHeader)) <= limit)) {
+        SmJournalBlockHeader header;
+        memcpy(&header, base + offset, sizeof(header));
+        if ((header.magic != SM_JOURNAL_BLOCK_MAGIC) ||
+            ((offset + sizeof(header) + header.payload_bytes) > limit)) {
+            stats->blocks_corrupt++;
+            break;
+        }
+        stats->blocks_total++;
+        if (q->full_scan ||
+            journal_block_overlaps(header.zone, header.to_mask, header.first_us, header.last_us, q)) {
+            more = journal_decode_block(base, offset, limit, q, visit, ctx, stats);
+        }
+        offset += sizeof(header) + header.payload_bytes;
+    }
+
+    return more;
+}
+
+// 依段編號由舊到新查詢；只看已寫到檔案的區塊 (需要最新資料時先 sm_journal_flush)
+bool sm_journal_query(const char *dir, const SmJournalQuery *q, SmJournalVisitor visit, void *ctx,
+                      SmJournalQueryStats *stats) {
+    uint32_t *segments = NULL;
+    uint32_t count = 0U;
+    bool more = true;
+
+    memset(stats, 0, sizeof(*stats));
+    if (!journal_list_segments(dir, &segments, &count)) {
+        return false;
+    }
+    for (uint32_t i = 0U; (i < count) && more; i++) {
+        char path[PATH_MAX];
+        struct stat st;
+        int fd = -1;
+
+        if (journal_segment_path(dir, segments[i], path, sizeof(path))) {
+            fd = open(path, O_RDONLY | O_CLOEXEC);
+        }
+        if (fd < 0) {
+            continue;  // 查詢期間被輪替刪除
+        }
+        if ((fstat(fd, &st) == 0) && ((uint64_t)st.st_size >= sizeof(SmJournalSegmentHeader))) {
+            void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                stats->segments++;
+                more = journal_query_segment((const uint8_t *)map, (uint64_t)st.st_size, q, visit, ctx, stats);
+                (void)munmap(map, (size_t)st.st_size);
+            }
+        }
+        (void)close(fd);
+    }
+    free(segments);
+
+    return true;
+}
+
+#ifndef SM_JOURNAL_NO_MAIN
+
+// === 示範與效能量測 ===
+#define DEFAULT_ZONES               1000U
+#define DEFAULT_HOURS               48U
+#define DEFAULT_DIR                 "/tmp/bmc_sm_journal"
+#define SIM_TICK_US                 10000000ULL     // 模擬讀值週期 10 秒
+#define HOUR_US                     3600000000ULL
+#define SEGMENT_BYTES               (4U * 1024U * 1024U)
+#define MAX_SEGMENTS                6U
+#define SHUTDOWN_TICKS              30U             // 關機後 5 分鐘重新啟動
+#define QUERY_ROUNDS                20U
+#define FULL_SCAN_ROUNDS            3U
+#define TORN_RECORDS                1000U
+#define TORN_FLUSH_EVERY            100U
+#define POSTMORTEM_RECORDS          8U
+
+typedef struct {
+    StateMachine *zones;
+    TempMilliC *temps;
+    uint16_t *down_ticks;
+    uint32_t count;
+    uint32_t rng;
+    uint64_t transitions;
+    uint32_t shutdowns;
+    uint32_t last_shutdown_zone;
+    uint64_t last_shutdown_us;
+} Fleet;
+
+static uint32_t fleet_rand(Fleet *f) {
+    f->rng ^= f->rng << 13;
+    f->rng ^= f->rng >> 17;
+    f->rng ^= f->rng << 5;
+    return f->rng;
+}
+
+static void fleet_init(Fleet *f, SmJournal *journal) {
+    f->rng = 0x5EEDF00DU;
+    f->transitions = 0U;
+    f->shutdowns = 0U;
+    for (uint32_t i = 0U; i < f->count; i++) {
+        sm_init(&f->zones[i]);
+        if (journal != NULL) {
+            sm_journal_attach(journal, &f->zones[i], i);
+        }
+        f->temps[i] = TEMP_MC_FROM_C(45);
+        f->down_ticks[i] = 0U;
+    }
+}
+
+// 每個區域的溫度是均值回歸的隨機漫步 (平均 68°C，在 WARNING 閾值附近頻繁穿越)；
+// 緊急冷卻中有小機率冷卻失敗而關機，5 分鐘後重新啟動
+static void fleet_tick(Fleet *f, uint64_t now_us) {
+    for (uint32_t i = 0U; i < f->count; i++) {
+        StateMachine *sm = &f->zones[i];
+        uint32_t before = sm->state_transitions;
+        TempMilliC old = f->temps[i];
+        TempMilliC temp = old + (TempMilliC)(fleet_rand(f) % 12001U) - 6000 + ((TEMP_MC_FROM_C(68) - old) / 8);
+
+        if (temp < TEMP_MC_FROM_C(20)) {
+            temp = TEMP_MC_FROM_C(20);
+        }
+        if (temp > TEMP_MC_FROM_C(100)) {
+            temp = TEMP_MC_FROM_C(100);
+        }
+        f->temps[i] = temp;
+        sm->current_temperature = temp;
+
+        if (sm->current_state == STATE_SHUTDOWN) {
+            f->down_ticks[i]--;
+            if (f->down_ticks[i] == 0U) {
+                f->temps[i] = TEMP_MC_FROM_C(45);
+                sm->current_temperature = f->temps[i];
+                sm_process_event(sm, EVENT_SYSTEM_INIT);
+            }
+        } else {
+            sm_process_event(sm, get_temperature_event(temp));
+            if ((sm->current_state == STATE_EMERGENCY_COOLING) && ((fleet_rand(f) % 16U) == 0U)) {
+                sm_process_event(sm, EVENT_COOLING_FAILURE);
+                f->down_ticks[i] = SHUTDOWN_TICKS;
+                f->shutdowns++;
+                f->last_shutdown_zone = i;
+                f->last_shutdown_us = now_us;
+            } else if ((temp < (old - TEMP_MC_FROM_C(4))) &&
+                       ((sm->current_state == STATE_WARNING) || (sm->current_state == STATE_CRITICAL))) {
+                sm_process_event(sm, EVENT_COOLING_SUCCESS);
+            }
+        }
+        f->transitions += sm->state_transitions - before;
+    }
+}
+
+static double fleet_run(Fleet *f, SmJournal *journal, uint64_t start_us, uint64_t ticks) {
+    uint64_t start = sm_stats_now_ns();
+
+    fleet_init(f, journal);
+    for (uint64_t t = 0U; t < ticks; t++) {
+        uint64_t now_us = start_us + (t * SIM_TICK_US);
+        if (journal != NULL) {
+            journal->sim_now_us = now_us;
+        }
+        fleet_tick(f, now_us);
+    }
+
+    return (double)(sm_stats_now_ns() - start) / 1e9;
+}
+
+// 只刪除日誌段檔，不動目錄中的其他檔案
+static void remove_segments(const char *dir) {
+    uint32_t *segments = NULL;
+    uint32_t count = 0U;
+    char path[PATH_MAX];
+
+    if (journal_list_segments(dir, &segments, &count)) {
+        for (uint32_t i = 0U; i < count; i++) {
+            if (journal_segment_path(dir, segments[i], path, sizeof(path))) {
+                (void)unlink(path);
+            }
+        }
+    }
+    free(segments);
+}
+
+static uint64_t dir_usage(const char *dir, uint32_t *files) {
+    uint32_t *segments = NULL;
+    uint32_t count = 0U;
+    uint64_t total = 0U;
+    char path[PATH_MAX];
+    struct stat st;
+
+    if (journal_list_segments(dir, &segments, &count)) {
+        for (uint32_t i = 0U; i < count; i++) {
+            if (journal_segment_path(dir, segments[i], path, sizeof(path)) && (stat(path, &st) == 0)) {
+                total += (uint64_t)st.st_size;
+            }
+        }
+    }
+    free(segments);
+    *files = count;
+
+    return total;
+}
+
+typedef struct {
+    uint64_t count;
+    uint64_t checksum;
+    uint64_t oldest_us;
+} QueryDigest;
+
+static bool digest_visitor(void *ctx, const SmJournalRecord *rec) {
+    QueryDigest *d = (QueryDigest *)ctx;
+
+    d->count++;
+    d->checksum += rec->time_us ^ ((uint64_t)rec->zone << 40) ^ ((uint64_t)(uint32_t)rec->temperature << 8) ^
+                   ((uint64_t)rec->from << 4) ^ rec->to;
+    if (rec->time_us < d->oldest_us) {
+        d->oldest_us = rec->time_us;
+    }
+    return true;
+}
+
+static double timed_query(const char *dir, const SmJournalQuery *q, QueryDigest *digest,
+                          SmJournalQueryStats *stats) {
+    double best_ms = 1e30;
+    uint32_t rounds = q->full_scan ? FULL_SCAN_ROUNDS : QUERY_ROUNDS;
+
+    for (uint32_t r = 0U; r < rounds; r++) {
+        uint64_t start = sm_stats_now_ns();
+        memset(digest, 0, sizeof(*digest));
+        digest->oldest_us = UINT64_MAX;
+        (void)sm_journal_query(dir, q, digest_visitor, digest, stats);
+        double ms = (double)(sm_stats_now_ns() - start) / 1e6;
+        if (ms < best_ms) {
+            best_ms = ms;
+        }
+    }
+
+    return best_ms;
+}
+
+// 以索引查詢並與全掃描比對結果
+static bool bench_query(const char *label, const char *dir, SmJournalQuery q) {
+    QueryDigest indexed;
+    QueryDigest full;
+    SmJournalQueryStats is;
+    SmJournalQueryStats fs;
+
+    q.full_scan = false;
+    double index_ms = timed_query(dir, &q, &indexed, &is);
+    q.full_scan = true;
+    double full_ms = timed_query(dir, &q, &full, &fs);
+    bool same = (indexed.count == full.count) && (indexed.checksum == full.checksum);
+
+    printf("%7lu 筆  索引 %7.3f ms (解碼 %5lu/%6lu 區塊)  全掃描 %8.2f ms  %4.0fx  %s  %s\n",
+           (unsigned long)indexed.count, index_ms, (unsigned long)is.blocks_decoded,
+           (unsigned long)is.blocks_total, full_ms, full_ms / index_ms, same ? "一致" : "不一致!", label);
+
+    return same;
+}
+
+typedef struct {
+    SmJournalRecord ring[POSTMORTEM_RECORDS];
+    uint32_t count;
+} PostMortem;
+
+static bool postmortem_visitor(void *ctx, const SmJournalRecord *rec) {
+    PostMortem *pm = (PostMortem *)ctx;
+    pm->ring[pm->count % POSTMORTEM_RECORDS] = *rec;
+    pm->count++;
+    return true;
+}
+
+// 最後一次關機的區域：在呼叫 sm_journal_flush() 之前查詢，確認關機路徑已經落到磁碟
+static bool show_postmortem(const char *dir, const Fleet *f) {
+    PostMortem pm = { .count = 0U };
+    SmJournalQueryStats stats;
+    SmJournalQuery q = {
+        .zone = f->last_shutdown_zone,
+        .from_us = f->last_shutdown_us - HOUR_US,
+        .to_us = f->last_shutdown_us,
+        .to_mask = SM_JOURNAL_ANY_STATE
+    };
+    uint32_t shown;
+
+    (void)sm_journal_query(dir, &q, postmortem_visitor, &pm, &stats);
+    shown = (pm.count < POSTMORTEM_RECORDS) ? pm.count : POSTMORTEM_RECORDS;
+    printf("區域 %u 在 T 關機，前 1 小時內 %u 次轉換，最後 %u 次:\n", f->last_shutdown_zone, pm.count, shown);
+    for (uint32_t i = pm.count - shown; i < pm.count; i++) {
+        const SmJournalRecord *rec = &pm.ring[i % POSTMORTEM_RECORDS];
+        printf("  T-%5lus  %-17s -> %-17s  %-16s " TEMP_MC_FMT " C\n",
+               (unsigned long)((f->last_shutdown_us - rec->time_us) / 1000000ULL),
+               (rec->from < STATE_COUNT) ? state_configs[rec->from].name : "?",
+               state_configs[rec->to].name, sm_journal_event_names[rec->event],
+               TEMP_MC_ARGS(rec->temperature));
+    }
+
+    return (shown > 0U) && (pm.ring[(pm.count - 1U) % POSTMORTEM_RECORDS].to == STATE_SHUTDOWN);
+}
+
+// 模擬當機：寫一段未封存的段，截掉最後一個區塊的尾巴，查詢必須只少掉那一個區塊
+static bool check_torn_tail(const char *dir, const SmJournalConfig *config, uint64_t start_us) {
+    SmJournal j;
+    SmJournalQueryStats stats = { .segments = 0U };
+    QueryDigest digest = { .oldest_us = UINT64_MAX };
+    SmJournalQuery q = { .zone = 0U, .from_us = start_us, .to_us = UINT64_MAX, .to_mask = SM_JOURNAL_ANY_STATE };
+    char path[PATH_MAX];
+    bool ok = sm_journal_open(&j, dir, 1U, config);
+
+    for (uint32_t i = 0U; ok && (i < TORN_RECORDS); i++) {
+        SystemState from = ((i % 2U) == 0U) ? STATE_NORMAL : STATE_WARNING;
+        SystemState to = ((i % 2U) == 0U) ? STATE_WARNING : STATE_NORMAL;
+        sm_journal_append(&j, 0U, from, to, EVENT_TEMP_WARNING, TEMP_MC_FROM_C(70), start_us + i);
+        if (((i + 1U) % TORN_FLUSH_EVERY) == 0U) {
+            ok = sm_journal_flush(&j, false);
+        }
+    }
+    ok = ok && journal_segment_path(dir, j.sequence, path, sizeof(path)) &&
+         (truncate(path, (off_t)(j.segment_bytes - 5U)) == 0);
+    (void)close(j.fd);  // 不封存：相當於程序在這裡當掉
+    j.fd = -1;
+    (void)sm_journal_close(&j);
+
+    ok = ok && sm_journal_query(dir, &q, digest_visitor, &digest, &stats);
+    printf("未封存段: %u 筆分 %u 個區塊寫入，截斷最後 5 bytes -> 讀回 %lu 筆，略過損壞區塊 %lu\n",
+           TORN_RECORDS, TORN_RECORDS / TORN_FLUSH_EVERY, (unsigned long)digest.count,
+           (unsigned long)stats.blocks_corrupt);
+
+    return ok && (digest.count == (TORN_RECORDS - TORN_FLUSH_EVERY)) && (stats.segments_unsealed == 1U);
+}
+
+static int run_query(const char *dir, uint32_t zone, const char *state_name, uint32_t hours) {
+    QueryDigest digest = { .oldest_us = UINT64_MAX };
+    SmJournalQueryStats stats;
+    SmJournalQuery q = { .zone = zone, .to_us = UINT64_MAX, .to_mask = 0U };
+    uint64_t now = journal_realtime_us();
+
+    for (uint32_t s = 0U; s < STATE_COUNT; s++) {
+        if ((strcmp(state_name, "ANY") == 0) || (strcmp(state_name, state_configs[s].name) == 0)) {
+            q.to_mask |= (uint8_t)(1U << s);
+        }
+    }
+    if (q.to_mask == 0U) {
+        printf("未知的狀態: %s (可用 ANY)\n", state_name);
+        return 1;
+    }
+    q.from_us = now - ((uint64_t)hours * HOUR_US);
+
+    uint64_t start = sm_stats_now_ns();
+    if (!sm_journal_query(dir, &q, digest_visitor, &digest, &stats)) {
+        printf("無法讀取日誌目錄 %s\n", dir);
+        return 1;
+    }
+    printf("區域 %u 最近 %u 小時進入 %s: %lu 筆 (%u 段，解碼 %lu/%lu 區塊，%.3f ms)\n", zone, hours,
+           state_name, (unsigned long)digest.count, stats.segments, (unsigned long)stats.blocks_decoded,
+           (unsigned long)stats.blocks_total, (double)(sm_stats_now_ns() - start) / 1e6);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t count = DEFAULT_ZONES;
+    uint32_t hours = DEFAULT_HOURS;
+    const char *dir = DEFAULT_DIR;
+    SmJournalConfig config = { .max_segment_bytes = SEGMENT_BYTES, .max_segments = MAX_SEGMENTS };
+    SmJournal journal;
+    Fleet fleet;
+    bool ok = true;
+
+    if ((argc >= 6) && (strcmp(argv[1], "--query") == 0)) {
+        return run_query(argv[2], (uint32_t)strtoul(argv[3], NULL, 10), argv[4],
+                         (uint32_t)strtoul(argv[5], NULL, 10));
+    }
+    if (argc > 1) {
+        count = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        hours = (uint32_t)strtoul(argv[2], NULL, 10);
+    }
+    if (argc > 3) {
+        dir = argv[3];
+    }
+    if ((count < 2U) || (hours < 25U)) {
+        printf("區域數至少 2，模擬時間至少 25 小時\n");
+        return 1;
+    }
+
+    fleet.count = count;
+    fleet.zones = calloc(count, sizeof(StateMachine));
+    fleet.temps = calloc(count, sizeof(TempMilliC));
+    fleet.down_ticks = calloc(count, sizeof(uint16_t));
+    if ((fleet.zones == NULL) || (fleet.temps == NULL) || (fleet.down_ticks == NULL)) {
+        printf("記憶體配置失敗\n");
+        return 1;
+    }
+
+    uint64_t ticks = ((uint64_t)hours * HOUR_US) / SIM_TICK_US;
+    uint64_t end_us = journal_realtime_us();
+    uint64_t start_us = end_us - (ticks * SIM_TICK_US);
+
+    printf("=== 狀態轉換日誌 (%u 區域，模擬 %u 小時，每 %llu 秒一次讀值) ===\n", count, hours,
+           SIM_TICK_US / 1000000ULL);
+    printf("段檔上限 %u MiB x %u 段 = %u MiB，目錄 %s\n", SEGMENT_BYTES >> 20, MAX_SEGMENTS,
+           (SEGMENT_BYTES >> 20) * MAX_SEGMENTS, dir);
+
+    // --- 寫入吞吐：同一段模擬跑兩次，差值就是日誌的成本 ---
+    double base_s = fleet_run(&fleet, NULL, start_us, ticks);
+    uint64_t base_transitions = fleet.transitions;
+
+    remove_segments(dir);
+    if (!sm_journal_open(&journal, dir, count, &config)) {
+        printf("無法開啟日誌目錄 %s\n", dir);
+        return 1;
+    }
+    double journal_s = fleet_run(&fleet, &journal, start_us, ticks);
+    ok = (fleet.transitions == journal.records) && (fleet.transitions == base_transitions);
+
+    printf("\n--- 寫入 ---\n");
+    printf("事件 %lu 次，轉換 %lu 筆 (%u 次關機)\n", (unsigned long)(ticks * count),
+           (unsigned long)journal.records, fleet.shutdowns);
+    printf("模擬 %.3f s (無日誌 %.3f s)，日誌成本 %.1f ns/筆，%.2f M 筆/s\n", journal_s, base_s,
+           ((journal_s - base_s) * 1e9) / (double)journal.records,
+           (double)journal.records / ((journal_s - base_s) * 1e6));
+
+    printf("\n--- 事後分析 (尚未 flush，只有關機路徑已落盤) ---\n");
+    ok = ((fleet.shutdowns == 0U) || show_postmortem(dir, &fleet)) && ok;
+
+    ok = sm_journal_flush(&journal, true) && ok;
+    uint64_t bytes_written = journal.bytes_written;
+    uint64_t records = journal.records;
+    printf("\n寫出 %.1f MiB (%.2f bytes/筆，原始記錄 %zu bytes，壓縮 %.1fx)，%lu 區塊，%lu 次 fdatasync\n",
+           (double)bytes_written / 1048576.0, (double)bytes_written / (double)records,
+           sizeof(SmJournalRecord), (double)(records * sizeof(SmJournalRecord)) / (double)bytes_written,
+           (unsigned long)journal.blocks, (unsigned long)journal.syncs);
+    ok = sm_journal_close(&journal) && ok;
+
+    uint32_t files = 0U;
+    uint64_t usage = dir_usage(dir, &files);
+    QueryDigest all;
+    SmJournalQueryStats all_stats;
+    SmJournalQuery everything = { .zone = SM_JOURNAL_ANY_ZONE, .from_us = 0U, .to_us = UINT64_MAX,
+                                  .to_mask = SM_JOURNAL_ANY_STATE, .full_scan = true };
+    (void)timed_query(dir, &everything, &all, &all_stats);
+    printf("輪替: 封存 %lu 段，刪除 %lu 段；保留 %u 段 %.1f MiB (上限 %u MiB)，涵蓋最近 %.1f 小時 %lu 筆\n",
+           (unsigned long)journal.segments_sealed, (unsigned long)journal.segments_deleted, files,
+           (double)usage / 1048576.0, (SEGMENT_BYTES >> 20) * MAX_SEGMENTS,
+           (double)(end_us - all.oldest_us) / (double)HOUR_US, (unsigned long)all.count);
+    ok = ok && (usage <= ((uint64_t)SEGMENT_BYTES * MAX_SEGMENTS)) && (all_stats.blocks_corrupt == 0U);
+
+    // --- 查詢 (頁快取已熱，取最快的一次) ---
+    uint32_t zone = count / 2U;
+    char label[64];
+    printf("\n--- 查詢 (以 %lu 筆為對象，索引 %u 次/全掃描 %u 次取最快) ---\n", (unsigned long)all.count,
+           QUERY_ROUNDS, FULL_SCAN_ROUNDS);
+    (void)snprintf(label, sizeof(label), "區域 %u 24h 進入 CRITICAL", zone);
+    ok = bench_query(label, dir, (SmJournalQuery){ .zone = zone, .from_us = end_us - (24U * HOUR_US),
+                                                   .to_us = UINT64_MAX,
+                                                   .to_mask = (uint8_t)(1U << STATE_CRITICAL) }) && ok;
+    (void)snprintf(label, sizeof(label), "區域 %u 1h 所有轉換", zone);
+    ok = bench_query(label, dir, (SmJournalQuery){ .zone = zone, .from_us = end_us - HOUR_US,
+                                                   .to_us = UINT64_MAX, .to_mask = SM_JOURNAL_ANY_STATE }) && ok;
+    ok = bench_query("所有區域 24h 進入 SHUTDOWN", dir,
+                     (SmJournalQuery){ .zone = SM_JOURNAL_ANY_ZONE, .from_us = end_us - (24U * HOUR_US),
+                                       .to_us = UINT64_MAX,
+                                       .to_mask = (uint8_t)(1U << STATE_SHUTDOWN) }) && ok;
+
+    printf("\n--- 當機後的未封存段 ---\n");
+    ok = check_torn_tail(dir, &config, end_us + HOUR_US) && ok;
+
+    printf("\n結果: %s\n", ok ? "日誌完整、輪替有上限、索引查詢與全掃描一致" : "失敗!");
+
+    free(fleet.zones);
+    free(fleet.temps);
+    free(fleet.down_ticks);
+    return ok ? 0 : 1;
+}
+
+#endif  // SM_JOURNAL_NO_MAIN
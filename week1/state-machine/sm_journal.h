@@ -0,0 +1,137 @@
+// sm_journal.h - 狀態轉換日誌檔案格式 (壓縮區塊 + 稀疏時間索引 + 輪替段)
+// 日誌目錄下是一連串段檔 journal-%08u.seg，編號遞增；總段數超過上限時刪除最舊的段。
+//
+// 段檔配置 (主機位元組順序，只給同一台 BMC 使用)：
+//   SmJournalSegmentHeader
+//   { SmJournalBlockHeader + payload[payload_bytes] } ...    (只附加)
+//   SmJournalIndexEntry[entry_count] + SmJournalTrailer       (封存時寫入)
+//
+// 每個區塊只含單一區域的記錄，標頭帶時間範圍與目標狀態遮罩，本身就是稀疏索引：
+// 查詢只解碼「區域相符、時間重疊、遮罩有交集」的區塊。封存的段在檔尾有緊湊的索引，
+// 查詢不必走過整個檔案；寫入中或當機留下的未封存段則沿著區塊標頭重建索引，
+// 遇到 magic 或 CRC 不符 (寫到一半的尾端) 就停止。
+//
+// 區塊內每筆記錄以變長整數編碼 (約 5~7 bytes，原始記錄 24 bytes)：
+//   varint  與前一筆的時間差 (微秒，第一筆相對於 first_us)
+//   uint8   to | event << 3 | SM_JOURNAL_FROM_EXPLICIT
+//   [uint8  from]  只在 from 不等於前一筆的 to 時出現 (區塊第一筆一定出現)
+//   varint  溫度差的 zigzag 編碼 (毫度，第一筆相對於 0)
+
+#ifndef SM_JOURNAL_H
+#define SM_JOURNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../common/fixed_point_temp.h"
+#include "sm_checkpoint.h"  // sm_checkpoint_crc32()
+
+#define SM_JOURNAL_SEGMENT_MAGIC    0x534A4D53U  // "SMJS"
+#define SM_JOURNAL_BLOCK_MAGIC      0x424A4D53U  // "SMJB"
+#define SM_JOURNAL_TRAILER_MAGIC    0x494A4D53U  // "SMJI"
+#define SM_JOURNAL_VERSION          1U
+
+#define SM_JOURNAL_BLOCK_PAYLOAD    1024U   // 單一區塊的最大 payload
+#define SM_JOURNAL_RECORD_MAX       24U     // 單筆記錄編碼後的最大長度
+#define SM_JOURNAL_FROM_EXPLICIT    0x40U
+#define SM_JOURNAL_EVENT_NONE       7U      // 直接呼叫 sm_transition() 的轉換 (EVENT_COUNT)
+#define SM_JOURNAL_ANY_ZONE         UINT32_MAX
+#define SM_JOURNAL_ANY_STATE        0xFFU
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t sequence;           // 段編號，與檔名相同
+    uint32_t block_payload_max;
+    uint64_t created_us;         // CLOCK_REALTIME 微秒
+} SmJournalSegmentHeader;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t zone;
+    uint64_t first_us;           // 區塊內第一筆與最後一筆的時間
+    uint64_t last_us;
+    uint16_t count;              // 記錄數
+    uint16_t payload_bytes;
+    uint8_t to_mask;             // bit n = 區塊內有轉換進入狀態 n
+    uint8_t reserved[7];
+    uint32_t crc;                // 涵蓋 crc 之前的欄位與 payload
+} SmJournalBlockHeader;
+
+typedef struct {
+    uint32_t zone;
+    uint8_t to_mask;
+    uint8_t reserved[3];
+    uint64_t first_us;
+    uint64_t last_us;
+    uint32_t offset;             // 區塊標頭在段檔中的位置
+    uint32_t count;
+} SmJournalIndexEntry;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t entry_count;
+    uint64_t index_offset;
+    uint64_t first_us;           // 整個段的時間範圍，查詢可直接跳過整段
+    uint64_t last_us;
+    uint32_t index_crc;
+    uint32_t trailer_crc;        // 涵蓋 trailer_crc 之前的欄位
+} SmJournalTrailer;
+
+_Static_assert(sizeof(SmJournalSegmentHeader) == 24U, "段標頭大小改變，請遞增版本");
+_Static_assert(sizeof(SmJournalBlockHeader) == 40U, "區塊標頭大小改變，請遞增版本");
+_Static_assert(sizeof(SmJournalIndexEntry) == 32U, "索引項目大小改變，請遞增版本");
+_Static_assert(sizeof(SmJournalTrailer) == 40U, "段尾大小改變，請遞增版本");
+
+static inline uint32_t sm_journal_block_crc(const SmJournalBlockHeader *header, const uint8_t *payload) {
+    uint32_t head = sm_checkpoint_crc32(header, offsetof(SmJournalBlockHeader, crc));
+    uint32_t body = sm_checkpoint_crc32(payload, header->payload_bytes);
+    return head ^ (body * 0x9E3779B1U);
+}
+
+static inline uint32_t sm_journal_trailer_crc(const SmJournalTrailer *trailer) {
+    return sm_checkpoint_crc32(trailer, offsetof(SmJournalTrailer, trailer_crc));
+}
+
+// === 變長整數 (LEB128) 與 zigzag ===
+static inline size_t sm_journal_put_varint(uint8_t *out, uint64_t value) {
+    size_t n = 0U;
+
+    while (value >= 0x80U) {
+        out[n] = (uint8_t)(value | 0x80U);
+        value >>= 7;
+        n++;
+    }
+    out[n] = (uint8_t)value;
+
+    return n + 1U;
+}
+
+// 回傳讀取的 bytes，超出 end 或超過 10 bytes 時回傳 0
+static inline size_t sm_journal_get_varint(const uint8_t *in, const uint8_t *end, uint64_t *value) {
+    uint64_t result = 0U;
+    size_t n = 0U;
+    size_t used = 0U;
+
+    while (((in + n) < end) && (n < 10U) && (used == 0U)) {
+        result |= (uint64_t)(in[n] & 0x7FU) << (7U * n);
+        if ((in[n] & 0x80U) == 0U) {
+            used = n + 1U;
+        }
+        n++;
+    }
+    *value = result;
+
+    return used;
+}
+
+static inline uint64_t sm_journal_zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t sm_journal_unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1U);
+}
+
+#endif  // SM_JOURNAL_H
@@ -0,0 +1,742 @@
+// sm_shard_controller.c - 每核一個分片的區域控制器 (機隊模擬器)
+// 單一 StateMachine 迴圈只用得到一個核心。這裡把區域分給多個分片，每個分片：
+//   - 一條綁定在自己 CPU 上的執行緒，獨佔分片內區域的狀態、溫度與接收通道
+//   - 記憶體配置在該 CPU 所屬的 NUMA 節點 (mbind)，並由分片執行緒自己初始化 (首次觸碰)
+//   - 跨分片只走 SPSC 環形通道：每對分片一條；處於 CRITICAL 以上的區域把熱量
+//     傳給相鄰區域，而相鄰區域 (編號 + 1) 一定在另一個分片
+//   - 統計以每個分片自己的 SPSC 通道定期送給彙總者 (主執行緒)，熱路徑沒有共用鎖或共用寫入
+// 區域 g 屬於分片 g % N (交錯分配)，分片內的本地編號為 g / N。
+// 拓撲由 /sys/devices/system/cpu/cpuN/nodeM 讀取，mbind/get_mempolicy 直接走系統呼叫，不依賴 libnuma。
+//
+// 用法: sm_shard_controller [總區域數] [每組秒數]     1 到所有核心的擴展與 NUMA 放置比較
+//       sm_shard_controller --run 分片數 秒數          每秒印出彙總統計
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define SM_QUIET
+#define FAN_CONTROL_NO_MAIN
+#include "fan_control_state_machine.c"
+
+#define SHARD_MAX                   256U
+#define SHARD_MAX_NODES             64U
+#define SHARD_CACHELINE             64U
+#define SHARD_CHANNEL_CAPACITY      1024U   // 跨分片通道 (2 的冪次)
+#define SHARD_DRAIN_EVERY           1024U   // 每處理這麼多區域就清一次接收通道
+#define SHARD_STATS_CAPACITY        64U     // 統計通道：彙總者晚 640 ms 才讀也不會滿
+#define SHARD_STATS_PERIOD_NS       10000000ULL
+#define SHARD_HEAT_MC               500     // 熱點區域每次事件傳給相鄰區域的熱量 (0.5°C)
+
+// === SPSC 環形通道 ===
+// 生產者與消費者的索引各佔一條快取線；對方的索引先讀本地快取，
+// 只有看起來滿/空時才重新讀取，一般情況下每則訊息不會跨核搬動索引。
+typedef struct {
+    uint64_t head __attribute__((aligned(SHARD_CACHELINE)));    // 只有生產者寫
+    uint64_t tail_cache;
+    uint64_t tail __attribute__((aligned(SHARD_CACHELINE)));    // 只有消費者寫
+    uint64_t head_cache;
+    uint32_t mask __attribute__((aligned(SHARD_CACHELINE)));
+    uint32_t slot_size;
+    uint8_t slots[] __attribute__((aligned(SHARD_CACHELINE)));
+} SpscChannel;
+
+static size_t spsc_size(uint32_t capacity, uint32_t slot_size) {
+    return sizeof(SpscChannel) + ((size_t)capacity * slot_size);
+}
+
+static void spsc_init(SpscChannel *ch, uint32_t capacity, uint32_t slot_size) {
+    memset(ch, 0, sizeof(*ch));
+    ch->mask = capacity - 1U;
+    ch->slot_size = slot_size;
+}
+
+// 通道滿時回傳 false，由呼叫者決定丟棄或稍後重送 (生產者永遠不等待)
+static bool spsc_push(SpscChannel *ch, const void *msg) {
+    uint64_t head = ch->head;
+
+    if ((head - ch->tail_cache) > ch->mask) {
+        ch->tail_cache = __atomic_load_n(&ch->tail, __ATOMIC_ACQUIRE);
+        if ((head - ch->tail_cache) > ch->mask) {
+            return false;
+        }
+    }
+    memcpy(&ch->slots[(head & ch->mask) * ch->slot_size], msg, ch->slot_size);
+    __atomic_store_n(&ch->head, head + 1U, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+static bool spsc_pop(SpscChannel *ch, void *msg) {
+    uint64_t tail = ch->tail;
+
+    if (tail == ch->head_cache) {
+        ch->head_cache = __atomic_load_n(&ch->head, __ATOMIC_ACQUIRE);
+        if (tail == ch->head_cache) {
+            return false;
+        }
+    }
+    memcpy(msg, &ch->slots[(tail & ch->mask) * ch->slot_size], ch->slot_size);
+    __atomic_store_n(&ch->tail, tail + 1U, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+static uint64_t spsc_pending(const SpscChannel *ch) {
+    return __atomic_load_n(&ch->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ch->tail, __ATOMIC_ACQUIRE);
+}
+
+// === 拓撲 ===
+typedef struct {
+    uint32_t cpu_count;                  // 可用 (affinity 允許) 的 CPU
+    int cpus[SHARD_MAX];
+    int node_of[SHARD_MAX];              // cpus[i] 所屬的 NUMA 節點
+    uint32_t node_count;
+    int nodes[SHARD_MAX_NODES];          // 出現過的節點 (遞增)
+} ShardTopology;
+
+static int topology_cpu_node(int cpu) {
+    char path[64];
+    int node = 0;
+
+    (void)snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *d = opendir(path);
+    if (d != NULL) {
+        struct dirent *entry;
+        while ((entry = readdir(d)) != NULL) {
+            if ((strncmp(entry->d_name, "node", 4U) == 0) && (entry->d_name[4] >= '0') &&
+                (entry->d_name[4] <= '9')) {
+                node = atoi(&entry->d_name[4]);
+            }
+        }
+        (void)closedir(d);
+    }
+
+    return node;
+}
+
+static void topology_load(ShardTopology *topo) {
+    cpu_set_t allowed;
+
+    memset(topo, 0, sizeof(*topo));
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        CPU_SET(0, &allowed);
+    }
+    for (int cpu = 0; (cpu < CPU_SETSIZE) && (topo->cpu_count < SHARD_MAX); cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        int node = topology_cpu_node(cpu);
+        topo->cpus[topo->cpu_count] = cpu;
+        topo->node_of[topo->cpu_count] = node;
+        topo->cpu_count++;
+
+        bool seen = false;
+        for (uint32_t n = 0U; n < topo->node_count; n++) {
+            seen = seen || (topo->nodes[n] == node);
+        }
+        if (!seen && (topo->node_count < SHARD_MAX_NODES)) {
+            uint32_t at = topo->node_count;
+            while ((at > 0U) && (topo->nodes[at - 1U] > node)) {
+                topo->nodes[at] = topo->nodes[at - 1U];
+                at--;
+            }
+            topo->nodes[at] = node;
+            topo->node_count++;
+        }
+    }
+}
+
+// 遠端放置用：拓撲中的下一個節點 (只有一個節點時就是自己)
+static int topology_other_node(const ShardTopology *topo, int node) {
+    for (uint32_t n = 0U; n < topo->node_count; n++) {
+        if (topo->nodes[n] == node) {
+            return topo->nodes[(n + 1U) % topo->node_count];
+        }
+    }
+    return node;
+}
+
+static bool numa_bind(void *addr, size_t len, int node) {
+    unsigned long mask = 1UL << (unsigned int)node;
+
+    if ((node < 0) || ((uint32_t)node >= SHARD_MAX_NODES)) {
+        return false;
+    }
+    return syscall(SYS_mbind, addr, len, MPOL_BIND, &mask, (unsigned long)SHARD_MAX_NODES + 1UL, 0U) == 0;
+}
+
+// 已觸碰頁面實際所在的節點，失敗時回傳 -1
+static int numa_page_node(const void *addr) {
+    int node = -1;
+
+    if (syscall(SYS_get_mempolicy, &node, NULL, 0UL, addr, MPOL_F_NODE | MPOL_F_ADDR) != 0) {
+        node = -1;
+    }
+    return node;
+}
+
+// === 分片 ===
+typedef enum {
+    SHARD_PLACE_LOCAL,                   // 綁定 CPU，記憶體在該 CPU 的節點
+    SHARD_PLACE_REMOTE,                  // 綁定 CPU，記憶體刻意放在另一個節點
+    SHARD_PLACE_NONE                     // 不綁定；主執行緒一次配置並初始化所有分片
+} ShardPlacement;
+
+static const char *const shard_placement_names[] = { "本地節點", "遠端節點", "不指定" };
+
+typedef struct {
+    uint64_t events;
+    uint64_t transitions;
+    uint64_t heat_sent;
+    uint64_t heat_received;
+    uint64_t heat_dropped;               // 目標通道滿，熱量捨棄 (生產者不等待)
+    uint64_t rounds;                     // 走過分片內所有區域的次數
+} ShardCounters;
+
+typedef struct {
+    uint32_t shard;
+    uint32_t census[STATE_COUNT];        // 送出時各狀態的區域數 (快照，不是差值)
+    ShardCounters delta;                 // 自上次送出以來的增量
+} ShardStatsMessage;
+
+typedef struct {
+    uint32_t zone;                       // 接收分片內的本地編號
+    TempMilliC heat;
+} ShardHeatMessage;
+
+typedef struct ShardController ShardController;
+
+// 配置在分片自己的 arena (NUMA 節點) 中，只有分片執行緒寫入
+typedef struct {
+    ShardController *ctrl;
+    uint32_t id;
+    int cpu;
+    int node;                            // 記憶體應在的節點
+    uint32_t zone_count;
+    StateMachine *zones;
+    TempMilliC *temps;
+    uint32_t census[STATE_COUNT];
+    uint32_t rng;
+    SpscChannel **inbox;                 // inbox[src]：分片 src 寫入、本分片讀取
+    SpscChannel **outbox;                // outbox[dst] = 分片 dst 的 inbox[id]
+    SpscChannel *stats;                  // 本分片 -> 彙總者
+    ShardCounters total;
+    ShardCounters reported;              // 已成功送進統計通道的部分
+    uint64_t last_report_ns;
+    void *arena;
+    size_t arena_size;
+    bool bind_failed;
+    bool pin_failed;
+} Shard;
+
+struct ShardController {
+    uint32_t shard_count;
+    uint32_t zone_count;
+    ShardPlacement placement;
+    const ShardTopology *topo;
+    Shard *shards[SHARD_MAX];
+    pthread_t threads[SHARD_MAX];
+    pthread_barrier_t ready;
+    uint32_t stop;                       // 主執行緒寫、分片只讀 (__atomic)
+    // 彙總者 (主執行緒) 的資料
+    ShardCounters merged;
+    uint32_t census[SHARD_MAX][STATE_COUNT];
+};
+
+static size_t align_up(size_t value) {
+    return (value + (SHARD_CACHELINE - 1U)) & ~(size_t)(SHARD_CACHELINE - 1U);
+}
+
+static uint32_t shard_zone_count(uint32_t zones, uint32_t shards, uint32_t id) {
+    return (zones / shards) + ((id < (zones % shards)) ? 1U : 0U);
+}
+
+// 配置並初始化分片 (LOCAL/REMOTE 由分片執行緒自己呼叫，頁面在綁定後才被觸碰)
+static Shard *shard_create(ShardController *ctrl, uint32_t id) {
+    uint32_t shards = ctrl->shard_count;
+    uint32_t slot = id % ctrl->topo->cpu_count;
+    uint32_t zones = shard_zone_count(ctrl->zone_count, shards, id);
+    size_t channel_size = align_up(spsc_size(SHARD_CHANNEL_CAPACITY, sizeof(ShardHeatMessage)));
+    size_t stats_size = align_up(spsc_size(SHARD_STATS_CAPACITY, sizeof(ShardStatsMessage)));
+    size_t off_zones = align_up(sizeof(Shard));
+    size_t off_temps = off_zones + align_up((size_t)zones * sizeof(StateMachine));
+    size_t off_ptrs = off_temps + align_up((size_t)zones * sizeof(TempMilliC));
+    size_t off_channels = off_ptrs + align_up(2U * shards * sizeof(SpscChannel *));
+    size_t off_stats = off_channels + ((size_t)shards * channel_size);
+    size_t size = off_stats + stats_size;
+    int node = ctrl->topo->node_of[slot];
+    bool bind_failed = false;
+
+    if (ctrl->placement == SHARD_PLACE_REMOTE) {
+        node = topology_other_node(ctrl->topo, node);
+    }
+    uint8_t *arena = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (arena == MAP_FAILED) {
+        return NULL;
+    }
+    if (ctrl->placement != SHARD_PLACE_NONE) {
+        bind_failed = !numa_bind(arena, size, node);
+    }
+
+    Shard *s = (Shard *)arena;
+    memset(s, 0, sizeof(*s));
+    s->ctrl = ctrl;
+    s->id = id;
+    s->cpu = ctrl->topo->cpus[slot];
+    s->node = node;
+    s->zone_count = zones;
+    s->zones = (StateMachine *)(arena + off_zones);
+    s->temps = (TempMilliC *)(arena + off_temps);
+    s->inbox = (SpscChannel **)(arena + off_ptrs);
+    s->outbox = s->inbox + shards;
+    s->stats = (SpscChannel *)(arena + off_stats);
+    s->rng = 0x9E3779B9U ^ (id * 0x85EBCA6BU);
+    s->arena = arena;
+    s->arena_size = size;
+    s->bind_failed = bind_failed;
+
+    for (uint32_t src = 0U; src < shards; src++) {
+        s->inbox[src] = NULL;
+        s->outbox[src] = NULL;
+        if (src != id) {
+            s->inbox[src] = (SpscChannel *)(arena + off_channels + ((size_t)src * channel_size));
+            spsc_init(s->inbox[src], SHARD_CHANNEL_CAPACITY, sizeof(ShardHeatMessage));
+        }
+    }
+    spsc_init(s->stats, SHARD_STATS_CAPACITY, sizeof(ShardStatsMessage));
+
+    for (uint32_t z = 0U; z < zones; z++) {
+        sm_init(&s->zones[z]);
+        sm_process_event(&s->zones[z], EVENT_SYSTEM_INIT);
+        s->temps[z] = TEMP_MC_FROM_C(45);
+        s->zones[z].current_temperature = s->temps[z];
+    }
+    s->census[STATE_NORMAL] = zones;
+
+    return s;
+}
+
+static uint32_t shard_rand(Shard *s) {
+    s->rng ^= s->rng << 13;
+    s->rng ^= s->rng >> 17;
+    s->rng ^= s->rng << 5;
+    return s->rng;
+}
+
+static void shard_drain_inbox(Shard *s) {
+    ShardHeatMessage msg;
+
+    for (uint32_t src = 0U; src < s->ctrl->shard_count; src++) {
+        SpscChannel *ch = s->inbox[src];
+        while ((ch != NULL) && spsc_pop(ch, &msg)) {
+            if (msg.zone < s->zone_count) {
+                s->temps[msg.zone] = temp_mc_add_sat(s->temps[msg.zone], msg.heat);
+            }
+            s->total.heat_received++;
+        }
+    }
+}
+
+// 熱量交給相鄰區域 g + 1：分片數大於 1 時一定在下一個分片
+static void shard_send_heat(Shard *s, uint32_t local) {
+    uint32_t shards = s->ctrl->shard_count;
+    uint32_t global = (local * shards) + s->id;
+    uint32_t neighbour = (global + 1U) % s->ctrl->zone_count;
+    uint32_t dst = neighbour % shards;
+    ShardHeatMessage msg = { .zone = neighbour / shards, .heat = SHARD_HEAT_MC };
+
+    if (dst == s->id) {
+        s->temps[msg.zone] = temp_mc_add_sat(s->temps[msg.zone], msg.heat);
+    } else if (spsc_push(s->outbox[dst], &msg)) {
+        s->total.heat_sent++;
+    } else {
+        s->total.heat_dropped++;
+    }
+}
+
+// 溫度是均值回歸的隨機漫步 (平均 68°C)，約 0.5% 的事件落在 CRITICAL 以上
+static void shard_round(Shard *s) {
+    for (uint32_t z = 0U; z < s->zone_count; z++) {
+        StateMachine *sm = &s->zones[z];
+        if ((z % SHARD_DRAIN_EVERY) == 0U) {
+            shard_drain_inbox(s);
+        }
+        TempMilliC old = s->temps[z];
+        TempMilliC temp = old + (TempMilliC)(shard_rand(s) % 12001U) - 6000 + ((TEMP_MC_FROM_C(68) - old) / 8);
+        SystemState before = sm->current_state;
+
+        s->temps[z] = temp;
+        sm->current_temperature = temp;
+        sm_process_event(sm, get_temperature_event(temp));
+        s->total.events++;
+        if (sm->current_state != before) {
+            s->census[before]--;
+            s->census[sm->current_state]++;
+            s->total.transitions++;
+        }
+        if (sm->current_state >= STATE_CRITICAL) {
+            shard_send_heat(s, z);
+        }
+    }
+    s->total.rounds++;
+}
+
+// 送出自上次以來的增量；通道滿時保留到下一次 (統計不會遺失)
+static void shard_report(Shard *s) {
+    ShardStatsMessage msg = { .shard = s->id };
+
+    memcpy(msg.census, s->census, sizeof(msg.census));
+    msg.delta.events = s->total.events - s->reported.events;
+    msg.delta.transitions = s->total.transitions - s->reported.transitions;
+    msg.delta.heat_sent = s->total.heat_sent - s->reported.heat_sent;
+    msg.delta.heat_received = s->total.heat_received - s->reported.heat_received;
+    msg.delta.heat_dropped = s->total.heat_dropped - s->reported.heat_dropped;
+    msg.delta.rounds = s->total.rounds - s->reported.rounds;
+    if (spsc_push(s->stats, &msg)) {
+        s->reported = s->total;
+    }
+}
+
+typedef struct {
+    ShardController *ctrl;
+    uint32_t id;
+} ShardStart;
+
+static void *shard_thread(void *arg) {
+    const ShardStart *start = (const ShardStart *)arg;
+    ShardController *ctrl = start->ctrl;
+    uint32_t id = start->id;
+    bool pin_failed = false;
+
+    if (ctrl->placement != SHARD_PLACE_NONE) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(ctrl->topo->cpus[id % ctrl->topo->cpu_count], &set);
+        pin_failed = (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0);
+        ctrl->shards[id] = shard_create(ctrl, id);
+    }
+    Shard *s = ctrl->shards[id];
+    if (s != NULL) {
+        s->pin_failed = pin_failed;
+    }
+
+    // 第一次會合：所有分片都已建立 (主執行緒在兩次會合之間檢查，有失敗就設定 stop)
+    (void)pthread_barrier_wait(&ctrl->ready);
+    (void)pthread_barrier_wait(&ctrl->ready);
+    if ((s == NULL) || (__atomic_load_n(&ctrl->stop, __ATOMIC_RELAXED) != 0U)) {
+        return NULL;
+    }
+    for (uint32_t dst = 0U; dst < ctrl->shard_count; dst++) {
+        s->outbox[dst] = (dst != id) ? ctrl->shards[dst]->inbox[id] : NULL;
+    }
+
+    s->last_report_ns = sm_stats_now_ns();
+    while (__atomic_load_n(&ctrl->stop, __ATOMIC_RELAXED) == 0U) {
+        shard_round(s);
+        uint64_t now = sm_stats_now_ns();
+        if ((now - s->last_report_ns) >= SHARD_STATS_PERIOD_NS) {
+            shard_report(s);
+            s->last_report_ns = now;
+        }
+    }
+    shard_report(s);
+
+    return NULL;
+}
+
+// === 彙總者 ===
+static void controller_collect(ShardController *ctrl) {
+    ShardStatsMessage msg;
+
+    for (uint32_t i = 0U; i < ctrl->shard_count; i++) {
+        while (spsc_pop(ctrl->shards[i]->stats, &msg)) {
+            ctrl->merged.events += msg.delta.events;
+            ctrl->merged.transitions += msg.delta.transitions;
+            ctrl->merged.heat_sent += msg.delta.heat_sent;
+            ctrl->merged.heat_received += msg.delta.heat_received;
+            ctrl->merged.heat_dropped += msg.delta.heat_dropped;
+            ctrl->merged.rounds += msg.delta.rounds;
+            memcpy(ctrl->census[msg.shard], msg.census, sizeof(msg.census));
+        }
+    }
+}
+
+static void controller_census(const ShardController *ctrl, uint32_t census[STATE_COUNT]) {
+    memset(census, 0, STATE_COUNT * sizeof(uint32_t));
+    for (uint32_t i = 0U; i < ctrl->shard_count; i++) {
+        for (uint32_t st = 0U; st < STATE_COUNT; st++) {
+            census[st] += ctrl->census[i][st];
+        }
+    }
+}
+
+static void controller_destroy(ShardController *ctrl) {
+    for (uint32_t i = 0U; i < ctrl->shard_count; i++) {
+        if (ctrl->shards[i] != NULL) {
+            (void)munmap(ctrl->shards[i]->arena, ctrl->shards[i]->arena_size);
+            ctrl->shards[i] = NULL;
+        }
+    }
+}
+
+typedef void (*ShardTickFn)(ShardController *ctrl, uint64_t elapsed_ns, void *ctx);
+
+typedef struct {
+    double seconds;
+    double events_per_s;
+    uint32_t local_pages;                // 區域陣列頁面位於分片 CPU 所屬節點的分片數
+    uint32_t bind_failures;
+    uint32_t pin_failures;
+    bool consistent;                     // 統計與通道計數守恆
+} ShardRunResult;
+
+// 啟動所有分片，執行 seconds 秒；每 SHARD_STATS_PERIOD_NS 彙總一次並呼叫 tick (可為 NULL)
+static bool controller_run(ShardController *ctrl, double seconds, ShardTickFn tick, void *ctx,
+                           ShardRunResult *result) {
+    ShardStart starts[SHARD_MAX];
+    uint32_t created = 0U;
+    bool ok = true;
+
+    memset(result, 0, sizeof(*result));
+    memset(&ctrl->merged, 0, sizeof(ctrl->merged));
+    memset(ctrl->census, 0, sizeof(ctrl->census));
+    ctrl->stop = 0U;
+    // sm_init() 第一次呼叫時才展開共用的轉換表；先在這裡建好，分片執行緒只會讀取
+    if (!fan_sm_dispatch_ready) {
+        fan_sm_build_dispatch_table();
+    }
+    for (uint32_t i = 0U; i < ctrl->shard_count; i++) {
+        ctrl->shards[i] = (ctrl->placement == SHARD_PLACE_NONE) ? shard_create(ctrl, i) : NULL;
+        ok = ok && ((ctrl->placement != SHARD_PLACE_NONE) || (ctrl->shards[i] != NULL));
+    }
+    if (!ok || (pthread_barrier_init(&ctrl->ready, NULL, ctrl->shard_count + 1U) != 0)) {
+        controller_destroy(ctrl);
+        return false;
+    }
+    for (uint32_t i = 0U; i < ctrl->shard_count; i++) {
+        starts[i] = (ShardStart){ .ctrl = ctrl, .id = i };
+        if (pthread_create(&ctrl->threads[i], NULL, shard_thread, &starts[i]) != 0) {
+            break;
+        }
+        created++;
+    }
+    if (created < ctrl->shard_count) {
+        // 無法建立所有執行緒：barrier 永遠等不齊，只能結束行程
+        printf("無法建立分片執行緒 (%u/%u)\n", created, ctrl->shard_count);
+        exit(1);
+    }
+
+    (void)pthread_barrier_wait(&ctrl->ready);
+    for (uint32_t i = 0U; i < ctrl->shard_count; i++) {
+        ok = ok && (ctrl->shards[i] != NULL);
+    }
+    if (!ok) {
+        __atomic_store_n(&ctrl->stop, 1U, __ATOMIC_RELAXED);
+    }
+    (void)pthread_barrier_wait(&ctrl->ready);
+    uint64_t start = sm_stats_now_ns();
+    uint64_t end = start + (uint64_t)(seconds * 1e9);
+    uint64_t now = start;
+    while (ok && (now < end)) {
+        struct timespec nap = { .tv_sec = 0, .tv_nsec = (long)SHARD_STATS_PERIOD_NS };
+        (void)nanosleep(&nap, NULL);
+        controller_collect(ctrl);
+        now = sm_stats_now_ns();
+        if (tick != NULL) {
+            tick(ctrl, now - start, ctx);
+        }
+    }
+    __atomic_store_n(&ctrl->stop, 1U, __ATOMIC_RELAXED);
+    for (uint32_t i = 0U; i < ctrl->shard_count; i++) {
+        (void)pthread_join(ctrl->threads[i], NULL);
+    }
+    uint64_t stopped = sm_stats_now_ns();
+    (void)pthread_barrier_destroy(&ctrl->ready);
+    if (!ok) {
+        controller_destroy(ctrl);
+        return false;
+    }
+    controller_collect(ctrl);
+
+    // 守恆檢查：彙總值 = 各分片已送出的部分；送出的熱量 = 已接收 + 仍在通道中
+    ShardCounters reported = { 0U };
+    ShardCounters total = { 0U };
+    uint64_t in_flight = 0U;
+    result->consistent = true;
+    for (uint32_t i = 0U; i < ctrl->shard_count; i++) {
+        const Shard *s = ctrl->shards[i];
+        reported.events += s->reported.events;
+        reported.transitions += s->reported.transitions;
+        total.events += s->total.events;
+        total.heat_sent += s->total.heat_sent;
+        total.heat_received += s->total.heat_received;
+        for (uint32_t src = 0U; src < ctrl->shard_count; src++) {
+            in_flight += (s->inbox[src] != NULL) ? spsc_pending(s->inbox[src]) : 0U;
+        }
+        result->consistent = result->consistent && (s->total.events == (s->total.rounds * s->zone_count));
+        result->local_pages += (numa_page_node(s->zones) == ctrl->topo->node_of[i % ctrl->topo->cpu_count]) ? 1U : 0U;
+        result->bind_failures += s->bind_failed ? 1U : 0U;
+        result->pin_failures += s->pin_failed ? 1U : 0U;
+    }
+    result->consistent = result->consistent && (ctrl->merged.events == reported.events) &&
+                         (ctrl->merged.transitions == reported.transitions) &&
+                         (total.heat_sent == (total.heat_received + in_flight));
+    result->seconds = (double)(stopped - start) / 1e9;
+    result->events_per_s = (double)total.events / result->seconds;
+
+    return true;
+}
+
+#ifndef SM_SHARD_CONTROLLER_NO_MAIN
+
+#define DEFAULT_ZONES               65536U
+#define DEFAULT_SECONDS             1.0
+#define OVERSUBSCRIBE_MAX           4U      // 只有 1 個 CPU 時，另外跑 2..4 個分片驗證通道
+
+// base_rate 為 0 時以這一組的速率作為擴展基準 (寫回 *base_rate)
+static bool bench_config(const ShardTopology *topo, uint32_t zones, uint32_t shards, ShardPlacement placement,
+                         double seconds, double *base_rate) {
+    ShardController *ctrl = calloc(1U, sizeof(ShardController));
+    ShardRunResult r;
+    bool ok;
+
+    if (ctrl == NULL) {
+        return false;
+    }
+    ctrl->shard_count = shards;
+    ctrl->zone_count = zones;
+    ctrl->placement = placement;
+    ctrl->topo = topo;
+    ok = controller_run(ctrl, seconds, NULL, NULL, &r);
+    if (ok) {
+        if (*base_rate <= 0.0) {
+            *base_rate = r.events_per_s;
+        }
+        double scale = r.events_per_s / *base_rate;
+        printf("%4u  %-8s %s %9.2f M/s  %7.2f M/s  %5.2fx  %6.1f%%  %8.1f k/s %8lu  %4u/%-4u %s\n", shards,
+               shard_placement_names[placement], (shards > topo->cpu_count) ? "超額" : "    ",
+               r.events_per_s / 1e6, r.events_per_s / 1e6 / shards, scale,
+               (100.0 * scale) / (double)((shards < topo->cpu_count) ? shards : topo->cpu_count),
+               (double)ctrl->merged.heat_sent / r.seconds / 1e3, (unsigned long)ctrl->merged.heat_dropped,
+               r.local_pages, shards, r.consistent ? "一致" : "不一致!");
+        if ((r.bind_failures > 0U) || (r.pin_failures > 0U)) {
+            printf("      [放置] mbind 失敗 %u 個分片，綁定 CPU 失敗 %u 個分片\n", r.bind_failures, r.pin_failures);
+        }
+        ok = r.consistent;
+    }
+    controller_destroy(ctrl);
+    free(ctrl);
+
+    return ok;
+}
+
+static void print_progress(ShardController *ctrl, uint64_t elapsed_ns, void *ctx) {
+    uint64_t *last = (uint64_t *)ctx;
+    uint32_t census[STATE_COUNT];
+
+    if ((elapsed_ns - last[0]) < 1000000000ULL) {
+        return;
+    }
+    controller_census(ctrl, census);
+    printf("t=%5.1fs 事件 %7.2f M/s 轉換 %9lu 跨分片熱量 %8lu 丟棄 %5lu |", (double)elapsed_ns / 1e9,
+           (double)(ctrl->merged.events - last[1]) * 1e3 / (double)(elapsed_ns - last[0]),
+           (unsigned long)ctrl->merged.transitions, (unsigned long)ctrl->merged.heat_sent,
+           (unsigned long)ctrl->merged.heat_dropped);
+    for (uint32_t st = 0U; st < STATE_COUNT; st++) {
+        printf(" %s=%u", state_configs[st].name, census[st]);
+    }
+    printf("\n");
+    last[0] = elapsed_ns;
+    last[1] = ctrl->merged.events;
+}
+
+static int run_mode(const ShardTopology *topo, uint32_t shards, double seconds) {
+    static ShardController ctrl;
+    ShardRunResult r;
+    uint64_t last[2] = { 0U, 0U };
+
+    ctrl.shard_count = shards;
+    ctrl.zone_count = DEFAULT_ZONES;
+    ctrl.placement = SHARD_PLACE_LOCAL;
+    ctrl.topo = topo;
+    printf("%u 區域分給 %u 個分片，執行 %.1f 秒\n", ctrl.zone_count, shards, seconds);
+    if (!controller_run(&ctrl, seconds, print_progress, last, &r)) {
+        printf("啟動失敗\n");
+        return 1;
+    }
+    printf("平均 %.2f M 區域事件/s，統計 %s\n", r.events_per_s / 1e6, r.consistent ? "一致" : "不一致!");
+    controller_destroy(&ctrl);
+
+    return r.consistent ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    ShardTopology topo;
+    uint32_t zones = DEFAULT_ZONES;
+    double seconds = DEFAULT_SECONDS;
+    bool ok = true;
+
+    topology_load(&topo);
+    if ((argc >= 4) && (strcmp(argv[1], "--run") == 0)) {
+        uint32_t shards = (uint32_t)strtoul(argv[2], NULL, 10);
+        if ((shards == 0U) || (shards > SHARD_MAX)) {
+            printf("分片數必須介於 1 與 %u 之間\n", SHARD_MAX);
+            return 1;
+        }
+        return run_mode(&topo, shards, strtod(argv[3], NULL));
+    }
+    if (argc > 1) {
+        zones = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        seconds = strtod(argv[2], NULL);
+    }
+    if ((zones < SHARD_MAX) || (seconds <= 0.0)) {
+        printf("區域數至少 %u，秒數必須大於 0\n", SHARD_MAX);
+        return 1;
+    }
+
+    printf("=== 分片區域控制器 (%u 區域，每組 %.1f 秒) ===\n", zones, seconds);
+    printf("拓撲: %u 個可用 CPU，%u 個 NUMA 節點 (", topo.cpu_count, topo.node_count);
+    for (uint32_t n = 0U; n < topo.node_count; n++) {
+        printf("%snode%d", (n > 0U) ? " " : "", topo.nodes[n]);
+    }
+    printf(")\n");
+
+    double base = 0.0;
+    printf("\n--- 擴展 (以 1 分片為基準) ---\n");
+    printf("分片  放置              事件/s     每分片    加速    效率    跨分片訊息  丟棄  本地頁面 統計\n");
+
+    uint32_t max_shards = (topo.cpu_count > 1U) ? topo.cpu_count : OVERSUBSCRIBE_MAX;
+    for (uint32_t shards = 1U; shards < max_shards; shards *= 2U) {
+        ok = bench_config(&topo, zones, shards, SHARD_PLACE_LOCAL, seconds, &base) && ok;
+    }
+    ok = bench_config(&topo, zones, max_shards, SHARD_PLACE_LOCAL, seconds, &base) && ok;
+
+    uint32_t numa_shards = topo.cpu_count;
+    printf("\n--- NUMA 放置 (%u 分片) ---\n", numa_shards);
+    if (topo.node_count < 2U) {
+        printf("只有 1 個 NUMA 節點：「遠端」與本地相同，差異只反映綁定 CPU 與首次觸碰的執行緒\n");
+    }
+    ok = bench_config(&topo, zones, numa_shards, SHARD_PLACE_LOCAL, seconds, &base) && ok;
+    ok = bench_config(&topo, zones, numa_shards, SHARD_PLACE_REMOTE, seconds, &base) && ok;
+    ok = bench_config(&topo, zones, numa_shards, SHARD_PLACE_NONE, seconds, &base) && ok;
+    if (topo.cpu_count == 1U) {
+        printf("\n註: 此主機只有 1 個 CPU，超額的分片共用同一核心，只驗證通道與彙總的正確性；\n"
+               "    接收端被排出 CPU 的整個時間片內通道會滿，丟棄數因此偏高\n");
+    }
+
+    printf("\n結果: %s\n", ok ? "所有組態的統計彙總與跨分片通道計數守恆" : "失敗!");
+
+    return ok ? 0 : 1;
+}
+
+#endif  // SM_SHARD_CONTROLLER_NO_MAIN
@@ -0,0 +1,83 @@
+// sm_stats_bench.c - 狀態統計儀表的額外開銷測試
+// 比較 sm->stats 為 NULL (停用) 與掛上 SmStats (啟用) 時，每個事件的平均耗時。
+// 兩種事件流：
+//   - 穩定溫度：幾乎不轉換狀態，只測 sm_process_event 的基本路徑
+//   - 劇烈波動：大部分事件都觸發轉換，儀表的每次轉換成本全部顯現
+
+#define _GNU_SOURCE
+#define SM_QUIET
+#define FAN_CONTROL_NO_MAIN
+#include "fan_control_state_machine.c"
+
+#define BENCH_EVENTS        2000000U
+#define BENCH_ROUNDS        5U
+
+static SystemEvent event_stream[BENCH_EVENTS];
+
+static void build_event_stream(bool volatile_temps) {
+    uint32_t rng = 0x12345678U;
+
+    for (uint32_t i = 0U; i < BENCH_EVENTS; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        TempMilliC temp;
+        if (volatile_temps) {
+            temp = TEMP_MC_FROM_C(40) + (TempMilliC)(rng % 60000U);  // 40-99.999°C，跨越所有閾值
+        } else {
+            temp = TEMP_MC_FROM_C(40) + (TempMilliC)(rng % 5000U);   // 40-44.999°C，維持 NORMAL
+        }
+        event_stream[i] = get_temperature_event(temp);
+    }
+}
+
+// 回傳每個事件的奈秒數 (取多輪中最快的一輪，降低雜訊)
+static double run_stream(SmStats *stats, uint32_t *transitions) {
+    double best = 1e30;
+
+    for (uint32_t round = 0U; round < BENCH_ROUNDS; round++) {
+        StateMachine sm;
+        sm_init(&sm);
+        sm_attach_stats(&sm, stats);
+        sm_process_event(&sm, EVENT_SYSTEM_INIT);
+
+        uint64_t start = sm_stats_now_ns();
+        for (uint32_t i = 0U; i < BENCH_EVENTS; i++) {
+            sm_process_event(&sm, event_stream[i]);
+        }
+        uint64_t elapsed = sm_stats_now_ns() - start;
+
+        double per_event = (double)elapsed / BENCH_EVENTS;
+        if (per_event < best) {
+            best = per_event;
+        }
+        *transitions = sm.state_transitions;
+    }
+
+    return best;
+}
+
+static void bench_case(const char *label, bool volatile_temps, SmStats *stats) {
+    uint32_t transitions = 0U;
+
+    build_event_stream(volatile_temps);
+    double off = run_stream(NULL, &transitions);
+    double on = run_stream(stats, &transitions);
+
+    printf("%-10s 轉換比例 %5.1f%%  停用 %7.2f ns/event  啟用 %7.2f ns/event  開銷 %+7.2f ns/event\n",
+           label, (100.0 * transitions) / BENCH_EVENTS, off, on, on - off);
+}
+
+int main(void) {
+    static SmStats stats;
+
+    printf("=== 狀態統計儀表開銷 (%u 事件 x %u 輪，取最快) ===\n",
+           BENCH_EVENTS, BENCH_ROUNDS);
+    bench_case("穩定溫度", false, &stats);
+    bench_case("劇烈波動", true, &stats);
+
+    printf("\n=== 劇烈波動事件流的統計結果 ===\n");
+    sm_stats_dump(&stats, stdout);
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+// sm_telemetry_reader.c - 風扇控制遙測讀取工具
+// 以唯讀方式映射 sm_telemetry_shm 發佈的共享記憶體，不需要與控制器有任何互動。
+// 用法: sm_telemetry_reader              印出目前快照
+//       sm_telemetry_reader --bench N    連續讀取 N 秒並回報快照速率
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "sm_telemetry_shm.h"
+
+static const char *const state_names[] = {
+    "IDLE", "NORMAL", "WARNING", "CRITICAL", "EMERGENCY_COOLING", "SHUTDOWN"
+};
+
+static uint64_t reader_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static const SmTelemetryRegion *telemetry_attach(void) {
+    const SmTelemetryRegion *region = NULL;
+    int fd = shm_open(SM_TELEMETRY_SHM_NAME, O_RDONLY, 0);
+
+    if (fd < 0) {
+        perror("shm_open (控制器是否正在執行?)");
+        return NULL;
+    }
+    void *addr = mmap(NULL, sizeof(SmTelemetryRegion), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+
+    region = (const SmTelemetryRegion *)addr;
+    if ((__atomic_load_n(&region->magic, __ATOMIC_ACQUIRE) != SM_TELEMETRY_MAGIC) ||
+        (region->version != SM_TELEMETRY_VERSION) ||
+        (region->zone_count > SM_TELEMETRY_MAX_ZONES)) {
+        printf("共享記憶體格式不符\n");
+        munmap(addr, sizeof(SmTelemetryRegion));
+        region = NULL;
+    }
+
+    return region;
+}
+
+static void print_snapshot(const SmTelemetryRegion *region) {
+    uint64_t now = reader_now_ns();
+    uint32_t state_count[6] = {0};
+
+    printf("寫入端 PID %u，%u 個區域\n", region->writer_pid, region->zone_count);
+    printf("%-6s %-18s %8s %6s %10s %10s %10s\n",
+           "區域", "狀態", "溫度", "風扇", "轉換", "事件", "距今(ms)");
+
+    for (uint32_t i = 0U; i < region->zone_count; i++) {
+        SmTelemetryZone zone;
+        if (sm_telemetry_read(&region->zones[i], &zone, 1000U) == UINT32_MAX) {
+            printf("%-6u (讀取失敗：寫入端可能已停止在寫入中)\n", i);
+            continue;
+        }
+        const char *name = (zone.state < 6U) ? state_names[zone.state] : "?";
+        if (zone.state < 6U) {
+            state_count[zone.state]++;
+        }
+        // 區域很多時只列出前 16 個，其餘只計入統計
+        if (i < 16U) {
+            printf("%-6u %-18s " TEMP_MC_FMT "°C %5u%% %10u %10u %10.1f\n",
+                   i, name, TEMP_MC_ARGS(zone.temperature), zone.fan_speed,
+                   zone.state_transitions, zone.events_processed,
+                   (double)(now - zone.update_ns) / 1e6);
+        }
+    }
+
+    printf("\n狀態分佈:");
+    for (uint32_t s = 0U; s < 6U; s++) {
+        printf(" %s=%u", state_names[s], state_count[s]);
+    }
+    printf("\n");
+}
+
+static void bench_snapshots(const SmTelemetryRegion *region, uint32_t seconds) {
+    uint64_t snapshots = 0U;
+    uint64_t retries = 0U;
+    uint64_t start = reader_now_ns();
+    uint64_t duration = (uint64_t)seconds * 1000000000ULL;
+    uint64_t elapsed = 0U;
+
+    while (elapsed < duration) {
+        for (uint32_t i = 0U; i < region->zone_count; i++) {
+            SmTelemetryZone zone;
+            uint32_t r = sm_telemetry_read(&region->zones[i], &zone, 1000U);
+            if (r != UINT32_MAX) {
+                retries += r;
+            }
+        }
+        snapshots++;
+        elapsed = reader_now_ns() - start;
+    }
+
+    printf("快照速率: %.0f 快照/sec (%u 區域)，讀取重試 %lu 次\n",
+           (double)snapshots / ((double)elapsed / 1e9), region->zone_count,
+           (unsigned long)retries);
+}
+
+int main(int argc, char *argv[]) {
+    const SmTelemetryRegion *region = telemetry_attach();
+    if (region == NULL) {
+        return 1;
+    }
+
+    if ((argc > 2) && (strcmp(argv[1], "--bench") == 0)) {
+        bench_snapshots(region, (uint32_t)strtoul(argv[2], NULL, 10));
+    } else {
+        print_snapshot(region);
+    }
+
+    munmap((void *)region, sizeof(SmTelemetryRegion));
+    return 0;
+}
@@ -0,0 +1,231 @@
+// sm_telemetry_shm.c - 將風扇控制器統計發佈到共享記憶體
+// StateMachine 的 state_transitions、events_processed、溫度與風扇速度
+// 原本只能在 main() 結束時 printf 看到。這個控制器每處理完一個事件，
+// 就把該區域的資料以 seqlock 寫入共享記憶體，外部監控程式 (sm_telemetry_reader)
+// 可隨時讀到一致的快照，寫入端完全不需要鎖或系統呼叫。
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SM_QUIET
+#define FAN_CONTROL_NO_MAIN
+#include "fan_control_state_machine.c"
+#include "sm_telemetry_shm.h"
+
+static inline uint64_t telemetry_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+// 建立 (或重新建立) 共享記憶體區段並初始化標頭
+SmTelemetryRegion *telemetry_create(uint32_t zone_count) {
+    SmTelemetryRegion *region = NULL;
+
+    if (zone_count > SM_TELEMETRY_MAX_ZONES) {
+        return NULL;
+    }
+
+    int fd = shm_open(SM_TELEMETRY_SHM_NAME, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        perror("shm_open");
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)sizeof(SmTelemetryRegion)) == 0) {
+        void *addr = mmap(NULL, sizeof(SmTelemetryRegion), PROT_READ | PROT_WRITE,
+                          MAP_SHARED, fd, 0);
+        if (addr != MAP_FAILED) {
+            region = (SmTelemetryRegion *)addr;
+            memset(region, 0, sizeof(*region));
+            region->version = SM_TELEMETRY_VERSION;
+            region->zone_count = zone_count;
+            region->writer_pid = (uint32_t)getpid();
+            // magic 最後寫入：讀取端看到 magic 才代表標頭已完整
+            __atomic_store_n(&region->magic, SM_TELEMETRY_MAGIC, __ATOMIC_RELEASE);
+        }
+    }
+    close(fd);
+
+    return region;
+}
+
+void telemetry_destroy(SmTelemetryRegion *region) {
+    munmap(region, sizeof(*region));
+    (void)shm_unlink(SM_TELEMETRY_SHM_NAME);
+}
+
+// 發佈單一區域：在每次 sm_process_event() 之後呼叫
+static inline void telemetry_publish(SmTelemetryRegion *region, uint32_t zone,
+                                     const StateMachine *sm, uint64_t now_ns) {
+    SmTelemetryZone data = {
+        .state = (uint32_t)sm->current_state,
+        .previous_state = (uint32_t)sm->previous_state,
+        .temperature = sm->current_temperature,
+        .fan_speed = sm->current_fan_speed,
+        .state_transitions = sm->state_transitions,
+        .events_processed = sm->events_processed,
+        .update_ns = now_ns
+    };
+    sm_telemetry_write(&region->zones[zone], &data);
+}
+
+// === 多區域控制器 ===
+typedef struct {
+    StateMachine *zones;
+    uint32_t zone_count;
+    uint32_t rng;
+    uint64_t events;
+} ZoneController;
+
+static void controller_init(ZoneController *ctl, StateMachine *zones, uint32_t count,
+                            SmTelemetryRegion *region) {
+    ctl->zones = zones;
+    ctl->zone_count = count;
+    ctl->rng = 0x9E3779B9U;
+    ctl->events = 0U;
+
+    uint64_t now = telemetry_now_ns();
+    for (uint32_t i = 0U; i < count; i++) {
+        sm_init(&zones[i]);
+        zones[i].current_temperature = TEMP_MC_FROM_C(40U + (i % 30U));
+        sm_process_event(&zones[i], EVENT_SYSTEM_INIT);
+        telemetry_publish(region, i, &zones[i], now);
+    }
+}
+
+// 處理一輪：每個區域一個溫度樣本，事件處理後立即發佈
+static void controller_step(ZoneController *ctl, SmTelemetryRegion *region) {
+    uint64_t now = telemetry_now_ns();
+
+    for (uint32_t i = 0U; i < ctl->zone_count; i++) {
+        StateMachine *sm = &ctl->zones[i];
+
+        ctl->rng ^= ctl->rng << 13;
+        ctl->rng ^= ctl->rng >> 17;
+        ctl->rng ^= ctl->rng << 5;
+        // 發熱 0..4.999°C，風扇每 25% 帶走 1°C
+        TempMilliC delta = (TempMilliC)(ctl->rng % 5000U) -
+                           TEMP_MC_FROM_C(sm->current_fan_speed / 25U);
+        TempMilliC temp = temp_mc_add_sat(sm->current_temperature, delta);
+        if (temp < TEMP_MC_FROM_C(20)) temp = TEMP_MC_FROM_C(20);
+        if (temp > TEMP_MC_FROM_C(100)) temp = TEMP_MC_FROM_C(100);
+        sm->current_temperature = temp;
+
+        sm_process_event(sm, get_temperature_event(sm->current_temperature));
+        telemetry_publish(region, i, sm, now);
+        ctl->events++;
+    }
+}
+
+#ifndef SM_TELEMETRY_SHM_NO_MAIN
+
+// === 效能測試：寫入端全速執行時的快照讀取速率 ===
+typedef struct {
+    const SmTelemetryRegion *region;
+    volatile bool stop;
+    uint64_t snapshots;
+    uint64_t retries;
+    uint64_t busy;              // 重試上限內仍未讀到一致資料的次數
+    uint64_t torn;              // 一致性檢查失敗次數 (應為 0)
+} ReaderBench;
+
+static void *reader_thread(void *arg) {
+    ReaderBench *bench = (ReaderBench *)arg;
+    uint32_t count = bench->region->zone_count;
+
+    while (!bench->stop) {
+        for (uint32_t i = 0U; i < count; i++) {
+            SmTelemetryZone zone;
+            uint32_t retries = sm_telemetry_read(&bench->region->zones[i], &zone, 1000U);
+            if (retries == UINT32_MAX) {
+                // 寫入端在寫入中途被排程出去 (單核心時常見)，這次略過該區域
+                bench->busy++;
+                continue;
+            }
+            bench->retries += retries;
+            // 一致性不變式：風扇速度必須對應狀態的進入回調設定值
+            if ((zone.state == STATE_NORMAL) && (zone.fan_speed != thermal_policy_get()->fan_speed_low_percent)) {
+                bench->torn++;
+            }
+            if (zone.state_transitions > zone.events_processed + 1U) {
+                bench->torn++;
+            }
+        }
+        bench->snapshots++;
+    }
+
+    return NULL;
+}
+
+// 主程式
+// 用法: sm_telemetry_shm              效能測試 (內建讀取執行緒)
+//       sm_telemetry_shm --serve N    全速執行 N 秒，供 sm_telemetry_reader 讀取
+int main(int argc, char *argv[]) {
+    static StateMachine zones[256];
+    uint32_t zone_count = (uint32_t)(sizeof(zones) / sizeof(zones[0]));
+    uint32_t serve_seconds = 0U;
+
+    if ((argc > 2) && (strcmp(argv[1], "--serve") == 0)) {
+        serve_seconds = (uint32_t)strtoul(argv[2], NULL, 10);
+    }
+
+    printf("=== OpenBMC 風扇控制遙測 (共享記憶體 + seqlock) ===\n");
+
+    SmTelemetryRegion *region = telemetry_create(zone_count);
+    if (region == NULL) {
+        printf("建立共享記憶體失敗\n");
+        return 1;
+    }
+    ZoneController ctl;
+    controller_init(&ctl, zones, zone_count, region);
+    printf("已發佈 %u 個區域到 /dev/shm%s (%zu bytes)\n",
+           zone_count, SM_TELEMETRY_SHM_NAME, sizeof(SmTelemetryRegion));
+
+    if (serve_seconds > 0U) {
+        printf("全速執行 %u 秒，可在另一個終端機執行 ./sm_telemetry_reader\n", serve_seconds);
+        uint64_t end = telemetry_now_ns() + ((uint64_t)serve_seconds * 1000000000ULL);
+        while (telemetry_now_ns() < end) {
+            controller_step(&ctl, region);
+        }
+        printf("寫入端處理事件: %lu\n", (unsigned long)ctl.events);
+        telemetry_destroy(region);
+        return 0;
+    }
+
+    printf("\n=== 寫入端全速執行 1 秒，讀取執行緒持續讀取完整快照 ===\n");
+    ReaderBench bench = { .region = region };
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, reader_thread, &bench) != 0) {
+        printf("建立讀取執行緒失敗\n");
+        telemetry_destroy(region);
+        return 1;
+    }
+
+    uint64_t start = telemetry_now_ns();
+    uint64_t elapsed = 0U;
+    while (elapsed < 1000000000ULL) {
+        controller_step(&ctl, region);
+        elapsed = telemetry_now_ns() - start;
+    }
+    bench.stop = true;
+    pthread_join(tid, NULL);
+
+    double seconds = (double)elapsed / 1e9;
+    printf("寫入端: %12.0f events/sec (每個事件一次發佈)\n", (double)ctl.events / seconds);
+    printf("讀取端: %12.0f 快照/sec (%u 區域) = %.0f 區域讀取/sec\n",
+           (double)bench.snapshots / seconds, zone_count,
+           ((double)bench.snapshots * zone_count) / seconds);
+    printf("讀取重試: %lu, 放棄讀取: %lu, 不一致快照: %lu\n",
+           (unsigned long)bench.retries, (unsigned long)bench.busy,
+           (unsigned long)bench.torn);
+
+    telemetry_destroy(region);
+    return 0;
+}
+
+#endif  // SM_TELEMETRY_SHM_NO_MAIN
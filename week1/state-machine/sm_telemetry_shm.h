@@ -0,0 +1,106 @@
+// sm_telemetry_shm.h - 風扇控制狀態機遙測共享記憶體格式
+// 控制器 (寫入端) 與監控工具 (讀取端) 共用此檔案。
+// 每個區域一個 seqlock 保護的槽位：寫入端不需要鎖也不需要系統呼叫，
+// 讀取端直接從映射記憶體複製，序號不一致時重試，保證讀到一致的快照。
+
+#ifndef SM_TELEMETRY_SHM_H
+#define SM_TELEMETRY_SHM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sched.h>
+
+#include "../common/fixed_point_temp.h"
+
+#define SM_TELEMETRY_SHM_NAME       "/bmc_fan_telemetry"
+#define SM_TELEMETRY_MAGIC          0x464E544DU  // "FNTM"
+#define SM_TELEMETRY_VERSION        2U   // v2：溫度改為毫度
+#define SM_TELEMETRY_MAX_ZONES      1024U
+#define SM_TELEMETRY_CACHELINE      64U
+
+// 單一區域的資料；每個欄位都用 relaxed atomic 存取，順序由 seq 決定
+typedef struct {
+    uint32_t state;
+    uint32_t previous_state;
+    TempMilliC temperature;      // 毫度 (0.001°C)
+    uint32_t fan_speed;
+    uint32_t state_transitions;
+    uint32_t events_processed;
+    uint64_t update_ns;          // CLOCK_MONOTONIC
+} SmTelemetryZone;
+
+// 獨佔一條快取線，避免相鄰區域的寫入互相干擾 (false sharing)
+typedef struct {
+    uint32_t seq;                // 奇數表示寫入中
+    uint32_t reserved;
+    SmTelemetryZone data;
+    uint8_t pad[SM_TELEMETRY_CACHELINE - 8U - sizeof(SmTelemetryZone)];
+} __attribute__((aligned(SM_TELEMETRY_CACHELINE))) SmTelemetrySlot;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t zone_count;
+    uint32_t writer_pid;
+    uint8_t pad[SM_TELEMETRY_CACHELINE - 16U];
+    SmTelemetrySlot zones[SM_TELEMETRY_MAX_ZONES];
+} SmTelemetryRegion;
+
+#define SM_TELEMETRY_LOAD(field)        __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define SM_TELEMETRY_STORE(field, v)    __atomic_store_n(&(field), (v), __ATOMIC_RELAXED)
+
+// === 寫入端 (只能有一個寫入者) ===
+static inline void sm_telemetry_write(SmTelemetrySlot *slot, const SmTelemetryZone *zone) {
+    uint32_t seq = SM_TELEMETRY_LOAD(slot->seq);
+
+    SM_TELEMETRY_STORE(slot->seq, seq + 1U);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    SM_TELEMETRY_STORE(slot->data.state, zone->state);
+    SM_TELEMETRY_STORE(slot->data.previous_state, zone->previous_state);
+    SM_TELEMETRY_STORE(slot->data.temperature, zone->temperature);
+    SM_TELEMETRY_STORE(slot->data.fan_speed, zone->fan_speed);
+    SM_TELEMETRY_STORE(slot->data.state_transitions, zone->state_transitions);
+    SM_TELEMETRY_STORE(slot->data.events_processed, zone->events_processed);
+    SM_TELEMETRY_STORE(slot->data.update_ns, zone->update_ns);
+
+    __atomic_store_n(&slot->seq, seq + 2U, __ATOMIC_RELEASE);
+}
+
+// === 讀取端 ===
+// 回傳重試次數；max_retries 次仍不一致時回傳 UINT32_MAX (寫入端可能在寫入中當機)
+static inline uint32_t sm_telemetry_read(const SmTelemetrySlot *slot, SmTelemetryZone *out,
+                                         uint32_t max_retries) {
+    uint32_t retries = 0U;
+
+    for (;;) {
+        uint32_t seq1 = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if ((seq1 & 1U) == 0U) {
+            out->state = SM_TELEMETRY_LOAD(slot->data.state);
+            out->previous_state = SM_TELEMETRY_LOAD(slot->data.previous_state);
+            out->temperature = SM_TELEMETRY_LOAD(slot->data.temperature);
+            out->fan_speed = SM_TELEMETRY_LOAD(slot->data.fan_speed);
+            out->state_transitions = SM_TELEMETRY_LOAD(slot->data.state_transitions);
+            out->events_processed = SM_TELEMETRY_LOAD(slot->data.events_processed);
+            out->update_ns = SM_TELEMETRY_LOAD(slot->data.update_ns);
+
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (SM_TELEMETRY_LOAD(slot->seq) == seq1) {
+                break;
+            }
+        }
+        retries++;
+        if (retries > max_retries) {
+            retries = UINT32_MAX;
+            break;
+        }
+        if ((retries % 64U) == 0U) {
+            // 寫入端可能在寫入中途被搶佔 (單核心時尤其常見)，讓出 CPU 讓它完成
+            (void)sched_yield();
+        }
+    }
+
+    return retries;
+}
+
+#endif  // SM_TELEMETRY_SHM_H